@@ -6,6 +6,7 @@
 #include "evm/asm.h"
 
 #include <array>
+#include <vector>
 
 
 #ifdef GDEXTENSION
@@ -26,6 +27,9 @@ public:
 
   bool parseFile(const String &, FileAccess *);
   bool parseLine(const String &, const String &, int);
+  bool parseBuffer(const String &, const PackedByteArray &);
+
+  bool setOptimization(int);
 
   int validateProgram();
 
@@ -38,7 +42,8 @@ protected:
 
 
 private:
-  evm_assembler_t *evm;
+  evm_assembler_t              *evm;
+  std::vector<PackedByteArray>  sources; // referenced by the parsed instructions
 };
 
 
@@ -16,17 +16,21 @@ EvmAssembler::~EvmAssembler() {
 
 
 bool EvmAssembler::parseFile(const String &name, FileAccess *fa) {
-  bool result;
+  if(fa && fa->is_open()) {
+    return parseBuffer(name, fa->get_buffer(fa->get_length() - fa->get_position()));
+  }
 
-  if((result = (fa && fa->is_open()))) {
-    int num = 0;
+  return false;
+}
 
-    while(!fa->eof_reached()) {
-      result &= parseLine(name, fa->get_line(), ++num);
-    }
-  }
 
-  return result;
+bool EvmAssembler::parseBuffer(const String &name, const PackedByteArray &src) {
+  // the assembler references the source text directly so it has to stay alive
+  sources.push_back(src);
+
+  const PackedByteArray &kept = sources.back();
+  return !evmasmParseBuffer(evm, name.utf8().get_data(),
+                            reinterpret_cast<const char *>(kept.ptr()), kept.size());
 }
 
 
@@ -35,6 +39,11 @@ bool EvmAssembler::parseLine(const String &name, const String &str, int num) {
 }
 
 
+bool EvmAssembler::setOptimization(int level) {
+  return !evmasmSetOptimization(evm, level);
+}
+
+
 int EvmAssembler::validateProgram() {
   return evmasmValidateProgram(evm);
 }
@@ -71,6 +80,9 @@ bool EvmAssembler::toFile(FileAccess *fa) {
 void EvmAssembler::_bind_methods() {
   ClassDB::bind_method(D_METHOD("parse_file", "name", "file"), &EvmAssembler::parseFile);
   ClassDB::bind_method(D_METHOD("parse_line", "name", "line", "num"), &EvmAssembler::parseLine);
+  ClassDB::bind_method(D_METHOD("parse_buffer", "name", "source"), &EvmAssembler::parseBuffer);
+
+  ClassDB::bind_method(D_METHOD("set_optimization", "level"), &EvmAssembler::setOptimization);
 
   ClassDB::bind_method(D_METHOD("validate_program"), &EvmAssembler::validateProgram);
   ClassDB::bind_method(D_METHOD("to_buffer"), &EvmAssembler::toBuffer);
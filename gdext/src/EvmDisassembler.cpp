@@ -53,13 +53,19 @@ PackedByteArray EvmDisassembler::toBuffer() {
 }
 
 
-bool EvmDisassembler::toFile(FileAccess *fa) {
-  PackedByteArray arr = toBuffer();
+// stream straight into the file rather than building the whole text first
+static int storeText(void *context, const char *text, uint32_t length) {
+  FileAccess *fa = static_cast<FileAccess *>(context);
+
+  fa->store_buffer(reinterpret_cast<const uint8_t *>(text), length);
+
+  return fa->get_error() == OK ? 0 : -1;
+}
 
-  if(arr.size() > 0) {
-    fa->store_buffer(arr);
 
-    return fa->get_error() == OK;
+bool EvmDisassembler::toFile(FileAccess *fa) {
+  if(fa && fa->is_open()) {
+    return !evmdisToWriter(evm, &storeText, fa);
   }
 
   return false;
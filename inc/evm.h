@@ -15,6 +15,7 @@ extern "C" {
 typedef struct evm_s {
   uint32_t       ip;
   uint16_t       sp;
+  uint16_t       fp;       // stack index of the first local of the current frame
   uint16_t       maxStack;
   uint32_t       maxProgram;
   uint32_t       flags;
@@ -24,6 +25,14 @@ typedef struct evm_s {
 #if EVM_MEMORY_SUPPORT == 1
   uint8_t       *mem;
   uint32_t       segment;
+  uint32_t       backing; // how system ram was allocated, an evm_backing_t
+  struct evm_segment_table_s *segments; // host buffers mapped over segments, NULL for all ram
+#endif
+#if EVM_REGISTER_SUPPORT == 1
+  struct evm_reg_code_s *regs; // translation of the program, NULL to interpret the bytecode
+#endif
+#if EVM_TRACE_SUPPORT == 1
+  struct evm_trace_cache_s *traces; // loops counted and traced by the interpreter
 #endif
 } evm_t;
 
@@ -38,6 +47,16 @@ typedef enum evm_flags_e {
 } evm_flags_t;
 
 
+#if EVM_MEMORY_SUPPORT == 1
+typedef enum evm_backing_e {
+  EVM_BACKING_HEAP,                   // calloc'ed
+  EVM_BACKING_PAGES,                  // mmap'ed in ordinary pages
+  EVM_BACKING_HUGE_PAGES,             // mmap'ed in huge pages reserved by the system
+  EVM_BACKING_TRANSPARENT_HUGE_PAGES, // ordinary pages the kernel has been asked to merge
+} evm_backing_t;
+#endif
+
+
 // a list of builtin functions callable from the virtual machine
 typedef int32_t (*EvmBuiltinFunction)(evm_t *);
 extern const EvmBuiltinFunction EVM_BUILTINS[EVM_MAX_BUILTINS];
@@ -55,6 +74,10 @@ EVM_API evm_t *evmInitialize(evm_t *vm, void *user, uint16_t stackSize);
 #endif
 EVM_API evm_t *evmFinalize(evm_t *vm);
 EVM_API void   evmFree(evm_t *vm);
+#if EVM_MEMORY_SUPPORT == 1 && EVM_HUGE_PAGES == 1
+// whether VMs initialized from now on try to put system ram in huge pages, returns the old setting
+EVM_API int    evmUseHugePages(int enable);
+#endif
 
 
 // set the program for the virtual machine instance
@@ -63,6 +86,9 @@ EVM_API int evmSetProgram(evm_t *vm, const uint8_t *prog, uint32_t length);
 // execute the virtual machine for the given number of operations
 EVM_API int evmRun(evm_t *vm, uint32_t maxOps);
 
+// the same, interpreting the bytecode rather than running its register translation
+EVM_API int evmRunStack(evm_t *vm, uint32_t maxOps);
+
 // status functions
 EVM_API int evmHasHalted(const evm_t *);
 EVM_API int evmHasYielded(const evm_t *);
@@ -70,6 +96,7 @@ EVM_API int evmHasYielded(const evm_t *);
 // simple query "functions"
 #define evmMaximumStack(EVM_PTR)    ((EVM_PTR)->maxStack)
 #define evmStackDepth(EVM_PTR)      ((EVM_PTR)->sp)
+#define evmFramePointer(EVM_PTR)    ((EVM_PTR)->fp)
 #define evmStackValue(EVM_PTR, IDX) ((EVM_PTR)->stack[(EVM_PTR)->sp - ((IDX) - 1U)])
 #define evmStackTop(EVM_PTR)        evmStackValue(EVM_PTR, 0U)
 #if EVM_FLOAT_SUPPORT == 1
@@ -80,8 +107,28 @@ EVM_API int evmHasYielded(const evm_t *);
 #  define evmSystemRam(EVM_PTR) ((EVM_PTR)->mem)
 #  define evmCurrentSegment(EVM_PTR) (((EVM_PTR)->segment >> 16) & 0xFF)
 #  define evmSetSegment(EVM_PTR, val) ((EVM_PTR)->segment = ((val) & 0xFF) << 16)
+#  define evmMemoryBacking(EVM_PTR) ((evm_backing_t) (EVM_PTR)->backing)
 
 EVM_API uint32_t evmEffectiveAddress(const evm_t *, uint16_t);
+
+// map the segments from first onwards onto a host buffer in place of system ram, as many as the
+// length covers, so scripts work on the buffer itself rather than a copy of it
+EVM_API int evmMapSegments(evm_t *vm, uint8_t first, void *buffer, uint32_t length, int writable);
+
+// give the segments back to system ram
+EVM_API int evmUnmapSegments(evm_t *vm, uint8_t first, uint32_t count);
+
+#  if EVM_FILE_MAPPING == 1
+typedef enum evm_map_flags_e {
+  EVM_MAP_PRIVATE   = 0,      // the VM writes to its own copy of the pages it touches
+  EVM_MAP_SHARED    = 1 << 0, // writes reach the file and every other VM or process mapping it
+  EVM_MAP_READ_ONLY = 1 << 1, // writes halt the VM
+} evm_map_flags_t;
+
+// map a file over the segments from first onwards, as much of it as fits, so its pages are read
+// in on demand rather than copied into system ram
+EVM_API int evmMapMemoryFile(evm_t *vm, uint8_t first, const char *path, int flags);
+#  endif
 #endif
 
 #define evmProgramSize(EVM_PTR) ((EVM_PTR)->maxProgram)
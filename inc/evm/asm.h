@@ -13,29 +13,46 @@
 extern "C" {
 #endif
 
+
+// bump whenever the same source assembles to different bytes so cached programs are discarded
+#define EVM_ASM_VERSION 1
+
+
 typedef struct evm_instruction_s {
-  struct evm_instruction_s *prev;
-  struct evm_instruction_s *next;
-  const char               *file;
-  uint32_t                  line;
-  uint8_t                   binary[6];
-  int8_t                    count;
-  int8_t                    flags;
-  char                      text[];
+  const char *file;
+  const char *text;   // not terminated, either in the arena or in a caller's source buffer
+  uint32_t    length;
+  uint32_t    line;
+  uint8_t     binary[6];
+  int8_t      count;
+  int8_t      flags;
 } evm_instruction_t;
 
 
 struct evm_program_s;
 typedef struct evm_program_s evm_program_t;
 
+struct evm_arena_s;
+typedef struct evm_arena_s evm_arena_t;
+
 
 typedef struct evm_asm_s {
   evm_program_t     *output;
+  evm_arena_t       *arena;        // storage for text, labels and sections freed all at once
+  evm_instruction_t *instructions; // every parsed line in source order
+  uint32_t           capacity;     // instructions allocated
   uint32_t           flags;
   uint32_t           length;
-  uint32_t           count;
+  uint32_t           count;        // instructions in use
   uint32_t           sequence;
-  evm_instruction_t  head;
+  uint32_t           level;        // optimization level, 0 disables the optimizer
+  uint32_t           removed;      // instructions removed by the optimizer
+  uint32_t           saved;        // bytes removed by the optimizer
+  uint32_t           threads;      // worker threads, 0 uses one per online processor
+  const char        *cache;        // directory of previous outputs, NULL disables the cache
+  uint8_t           *image;        // the output when it was found in the cache
+  uint64_t           key;          // hash of the sources and the configuration
+  uint32_t           sources;      // bytes of source included in the key
 } evm_assembler_t;
 
 
@@ -46,6 +63,21 @@ EVM_API void             evmasmFree(evm_assembler_t *);
 
 EVM_API int evmasmParseFile(evm_assembler_t *, const char *, FILE *);
 EVM_API int evmasmParseLine(evm_assembler_t *, const char *, const char *, int num);
+// the buffer is referenced rather than copied, it must outlive the assembler
+EVM_API int evmasmParseBuffer(evm_assembler_t *, const char *, const char *, size_t);
+// files are parsed concurrently when threads are available, the optional array receives the
+// result for each file and the instructions are always merged in the order given
+EVM_API int evmasmParseFiles(evm_assembler_t *, const char *const *, int, int *);
+
+EVM_API int evmasmSetThreads(evm_assembler_t *, int);
+
+// evmasmParseFiles looks the sources up in the cache directory before parsing them, a hit skips
+// straight to the output so the optimization level and relocatable output must be selected first
+EVM_API int evmasmSetCache(evm_assembler_t *, const char *);
+EVM_API int evmasmIsCached(const evm_assembler_t *);
+
+EVM_API int  evmasmSetOptimization(evm_assembler_t *, int);
+EVM_API void evmasmOptimizationReport(const evm_assembler_t *, uint32_t *, uint32_t *);
 
 EVM_API int evmasmValidateProgram(evm_assembler_t *);
 
@@ -54,6 +86,11 @@ EVM_API uint32_t evmasmProgramSize(const evm_assembler_t *);
 EVM_API uint32_t evmasmProgramToBuffer(const evm_assembler_t *, uint8_t *, uint32_t);
 EVM_API int      evmasmProgramToFile(const evm_assembler_t *, FILE *);
 
+// a relocatable assembler leaves labels it can't find to the linker and only outputs objects,
+// this has to be selected before the program is validated
+EVM_API int evmasmSetRelocatable(evm_assembler_t *, int);
+EVM_API int evmasmObjectToFile(const evm_assembler_t *, FILE *);
+
 
 #ifdef __cplusplus
 }
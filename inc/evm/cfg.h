@@ -0,0 +1,74 @@
+#ifndef EVM_EVM_CFG_H
+#  define EVM_EVM_CFG_H
+
+
+#include "evm/config.h"
+#include "evm/disasm.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define EVM_CFG_NONE 0xFFFFFFFFU
+
+
+typedef enum evm_cfg_flags_e {
+  EVM_CFG_ENTRY       = 1 << 0, // the first block of the program
+  EVM_CFG_FUNCTION    = 1 << 1, // the target of a call
+  EVM_CFG_LOOP_HEADER = 1 << 2, // the target of a back edge
+  EVM_CFG_EXIT        = 1 << 3, // ends with a return or a halt
+} evm_cfg_flags_t;
+
+
+// a straight run of instructions that is only entered at the top and only left at the bottom,
+// calls return to the following instruction so they don't end a block
+typedef struct evm_cfg_block_s {
+  uint32_t *succ;         // indices of the blocks control may continue with
+  uint32_t *pred;         // indices of the blocks that may continue with this one
+  uint32_t  start;        // offset of the first instruction
+  uint32_t  end;          // offset following the last instruction
+  uint32_t  instructions;
+  uint32_t  succCount;
+  uint32_t  predCount;
+  uint32_t  idom;         // immediate dominator, EVM_CFG_NONE for entries and call targets
+  uint32_t  flags;
+} evm_cfg_block_t;
+
+
+typedef struct evm_cfg_s {
+  evm_cfg_block_t *blocks;  // in ascending order of offset
+  uint32_t        *edges;   // storage for every succ and pred list
+  uint32_t         count;
+  uint32_t         edgeCount;
+} evm_cfg_t;
+
+
+EVM_API evm_cfg_t *evmcfgAllocate();
+EVM_API evm_cfg_t *evmcfgInitialize(evm_cfg_t *);
+EVM_API evm_cfg_t *evmcfgFinalize(evm_cfg_t *);
+EVM_API void       evmcfgFree(evm_cfg_t *);
+
+// splits the disassembled program into blocks, links them and finds their dominators and loops
+EVM_API int evmcfgFromDisassembler(evm_cfg_t *, const evm_disassembler_t *);
+
+// block index of the block holding the offset, EVM_CFG_NONE if there isn't one
+EVM_API uint32_t evmcfgFindBlock(const evm_cfg_t *, uint32_t);
+
+// true when the first block dominates the second
+EVM_API int evmcfgDominates(const evm_cfg_t *, uint32_t, uint32_t);
+
+EVM_API int evmcfgToDot(const evm_cfg_t *, FILE *);
+EVM_API int evmcfgToJson(const evm_cfg_t *, FILE *);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* EVM_EVM_CFG_H */
@@ -34,6 +34,27 @@
 #  define EVM_MEMORY_SUPPORT (1)
 #endif
 
+// Map system ram between inaccessible guard pages and halt a VM that strays into them?
+// (POSIX only, ignored without EVM_MEMORY_SUPPORT)
+// valid values: [0,1]
+#ifndef EVM_GUARD_PAGES
+#  define EVM_GUARD_PAGES (0)
+#endif
+
+// Back system ram with huge pages where the system has them, to spare the TLB?
+// (Linux only, ignored without EVM_MEMORY_SUPPORT)
+// valid values: [0,1]
+#ifndef EVM_HUGE_PAGES
+#  define EVM_HUGE_PAGES (0)
+#endif
+
+// Allow files to be memory mapped over system ram?
+// (POSIX only, ignored without EVM_MEMORY_SUPPORT)
+// valid values: [0,1]
+#ifndef EVM_FILE_MAPPING
+#  define EVM_FILE_MAPPING (0)
+#endif
+
 // Require statically allocated stack?
 // valid values: [0,1]
 #ifndef EVM_STATIC_STACK
@@ -46,6 +67,24 @@
 #  define EVM_STATIC_PROGRAM (0)
 #endif
 
+// Allow the assembler to use a pool of POSIX threads?
+// valid values: [0,1]
+#ifndef EVM_THREAD_SUPPORT
+#  define EVM_THREAD_SUPPORT (0)
+#endif
+
+// Translate programs into register code when they are loaded?
+// valid values: [0,1]
+#ifndef EVM_REGISTER_SUPPORT
+#  define EVM_REGISTER_SUPPORT (0)
+#endif
+
+// Record the paths taken through hot loops and replay them as traces?
+// valid values: [0,1]
+#ifndef EVM_TRACE_SUPPORT
+#  define EVM_TRACE_SUPPORT (0)
+#endif
+
 // What level of logging to support?
 // valid values: [0,6]
 // 0: don't print even on fatal errors
@@ -134,6 +173,24 @@
 #  error "EVM_MEMORY_SUPPORT is out of range"
 #endif
 
+#if !defined(EVM_GUARD_PAGES)
+#  error "EVM_GUARD_PAGES is undefined"
+#elif EVM_GUARD_PAGES < 0 || EVM_GUARD_PAGES > 1
+#  error "EVM_GUARD_PAGES is out of range"
+#endif
+
+#if !defined(EVM_HUGE_PAGES)
+#  error "EVM_HUGE_PAGES is undefined"
+#elif EVM_HUGE_PAGES < 0 || EVM_HUGE_PAGES > 1
+#  error "EVM_HUGE_PAGES is out of range"
+#endif
+
+#if !defined(EVM_FILE_MAPPING)
+#  error "EVM_FILE_MAPPING is undefined"
+#elif EVM_FILE_MAPPING < 0 || EVM_FILE_MAPPING > 1
+#  error "EVM_FILE_MAPPING is out of range"
+#endif
+
 #if !defined(EVM_STATIC_STACK)
 #  error "EVM_STATIC_STACK is undefined"
 #elif EVM_STATIC_STACK < 0 || EVM_STATIC_STACK > 1
@@ -146,6 +203,24 @@
 #  error "EVM_STATIC_PROGRAM is out of range"
 #endif
 
+#if !defined(EVM_THREAD_SUPPORT)
+#  error "EVM_THREAD_SUPPORT is undefined"
+#elif EVM_THREAD_SUPPORT < 0 || EVM_THREAD_SUPPORT > 1
+#  error "EVM_THREAD_SUPPORT is out of range"
+#endif
+
+#if !defined(EVM_REGISTER_SUPPORT)
+#  error "EVM_REGISTER_SUPPORT is undefined"
+#elif EVM_REGISTER_SUPPORT < 0 || EVM_REGISTER_SUPPORT > 1
+#  error "EVM_REGISTER_SUPPORT is out of range"
+#endif
+
+#if !defined(EVM_TRACE_SUPPORT)
+#  error "EVM_TRACE_SUPPORT is undefined"
+#elif EVM_TRACE_SUPPORT < 0 || EVM_TRACE_SUPPORT > 1
+#  error "EVM_TRACE_SUPPORT is out of range"
+#endif
+
 #if !defined(EVM_LOG_LEVEL)
 #  error "EVM_LOG_LEVEL is undefined"
 #elif EVM_LOG_LEVEL < 0 || EVM_LOG_LEVEL > 6
@@ -0,0 +1,98 @@
+#ifndef EVM_EVM_DECODE_H
+#  define EVM_EVM_DECODE_H
+
+
+#include "evm/config.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// how the bytes following an opcode are interpreted
+typedef enum evm_immediate_e {
+  EVM_IMM_NONE = 0,
+  EVM_IMM_I8,      // signed byte
+  EVM_IMM_U8,      // unsigned byte
+  EVM_IMM_I16,     // signed little endian short
+  EVM_IMM_U16,     // unsigned little endian short
+  EVM_IMM_I24,     // signed little endian trypple
+  EVM_IMM_U24,     // unsigned little endian trypple
+  EVM_IMM_I32,     // signed little endian int
+  EVM_IMM_F32,     // little endian float
+  EVM_IMM_NIBBLES, // two values less one packed into a byte, high nibble first
+  EVM_IMM_TABLE8,  // jump table entries less one, followed by a table of signed bytes
+  EVM_IMM_TABLE16, // jump table entries less one, followed by a table of signed shorts
+  EVM_IMM_CMP8,    // flags to branch on and a signed byte to compare to, then a signed byte
+  EVM_IMM_CMP16,   // flags to branch on and a signed byte to compare to, then a signed short
+  EVM_IMM_SCALE,   // a power of two in the low two bits of a byte, widened to the scale
+  EVM_IMM_SCALE16, // a scale byte, then an unsigned little endian short widened on its own
+} evm_immediate_t;
+
+
+// how an instruction affects the flow of control
+typedef enum evm_branch_e {
+  EVM_BRANCH_NONE = 0, // continue with the next instruction
+  EVM_BRANCH_JUMP,     // continue at the target
+  EVM_BRANCH_COND,     // continue at the target or with the next instruction
+  EVM_BRANCH_CALL,     // continue at the target, returning to the next instruction
+  EVM_BRANCH_TABLE,    // continue at one of the jump table entries
+  EVM_BRANCH_RETURN,   // continue at an address taken from the stack
+  EVM_BRANCH_HALT,     // stop execution
+} evm_branch_t;
+
+
+typedef struct evm_opcode_info_s {
+  uint8_t length;    // opcode and immediate bytes, zero for an illegal opcode
+  uint8_t immediate; // evm_immediate_t
+  uint8_t branch;    // evm_branch_t
+  uint8_t pops;      // depth of the stack consumed, builtins manage the stack themselves
+  uint8_t pushes;    // values left in place of those consumed
+} evm_opcode_info_t;
+
+
+// metadata for every opcode, shared by the tools that need to walk bytecode
+extern const evm_opcode_info_t EVM_OPCODE_INFO[256];
+
+
+typedef struct evm_decoded_s {
+  const uint8_t *table;     // first jump table entry, NULL for every other instruction
+  uint32_t       offset;    // of the opcode
+  uint32_t       next;      // of the following instruction, decoding resumes here
+  uint32_t       length;    // in bytes, including any jump table
+  uint32_t       target;    // of a relative call or jump
+  uint32_t       entries;   // in the jump table
+  union {
+    int32_t      i32;
+    uint32_t     u32;
+#if EVM_FLOAT_SUPPORT == 1
+    float        f32;
+#endif
+  }              operand;   // the immediate, widened to 32 bits
+  uint8_t        opcode;
+  uint8_t        immediate; // evm_immediate_t
+  uint8_t        branch;    // evm_branch_t
+  uint8_t        pops;      // resolved for REM_R and RET_I
+  uint8_t        pushes;
+} evm_decoded_t;
+
+
+// decode the instruction at decoded->next, zero the structure to start from the beginning, returns
+// 1 when an instruction was decoded, 0 at the end of the code and -1 for an illegal opcode or a
+// truncated instruction which leaves decoded->offset pointing at it
+EVM_API int evmDecodeNext(const uint8_t *, size_t, evm_decoded_t *);
+
+// absolute offset of a jump table entry
+EVM_API uint32_t evmDecodeTableTarget(const evm_decoded_t *, uint32_t);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* EVM_EVM_DECODE_H */
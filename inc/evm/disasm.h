@@ -31,11 +31,15 @@ typedef struct evm_disasm_inst_s {
   }                         arg;
   uint8_t                   opcode;
   int8_t                    label;
-  int16_t                   length;
-  char                     *text;
 } evm_disasm_inst_t;
 
 
+// receives the formatted text in pieces of at most EVM_DISASM_BUFFER bytes, non-zero aborts
+typedef int (*evm_disasm_writer_t)(void *, const char *, uint32_t);
+
+#define EVM_DISASM_BUFFER 4096U
+
+
 typedef struct evm_disasm_s {
   evm_disasm_inst_t instructions;
 } evm_disassembler_t;
@@ -51,6 +55,7 @@ EVM_API int      evmdisFromFile(evm_disassembler_t *, FILE *);
 
 EVM_API int      evmdisToBuffer(const evm_disassembler_t *, char **, int *);
 EVM_API int      evmdisToFile(const evm_disassembler_t *, FILE *);
+EVM_API int      evmdisToWriter(const evm_disassembler_t *, evm_disasm_writer_t, void *);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,122 @@
+#ifndef EVM_EVM_IR_H
+#  define EVM_EVM_IR_H
+
+
+#include "evm/config.h"
+#include "evm/disasm.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define EVM_IR_NONE      0xFFFFFFFFU
+#define EVM_IR_MAX_DEPTH 256U // deepest entry slot a block may reach
+
+
+// Stack slots become values in static single assignment form. Every block reads the slots it
+// finds on entry through its own values, a phi at a join, an argument where the stack is filled
+// from outside the program (the start, a call target, after a call, builtin or yield) and the
+// value of the single predecessor otherwise. Moves like DUP, SWAP, POP and REM disappear.
+//
+// Calls, builtins and yields may rearrange the whole stack so they end a block and everything
+// after them starts over with arguments. Frame instructions end a block the same way, the next one
+// is still reached only from them. Comparisons set flags that aren't values.
+
+
+typedef enum evm_ir_kind_e {
+  EVM_IR_DEF = 0, // pushed by an instruction
+  EVM_IR_PHI,     // joins the slot of every predecessor
+  EVM_IR_ARG,     // the slot as found when entered from outside
+} evm_ir_kind_t;
+
+
+typedef enum evm_ir_flags_e {
+  EVM_IR_ENTRY = 1 << 0, // may be entered from outside the program
+} evm_ir_flags_t;
+
+
+typedef struct evm_ir_value_s {
+  uint32_t block;
+  uint32_t index; // instruction for EVM_IR_DEF, entry slot otherwise
+  uint8_t  kind;  // evm_ir_kind_t
+} evm_ir_value_t;
+
+
+// lists of values and blocks are ranges of the operand pool
+typedef struct evm_ir_inst_s {
+  uint32_t offset;      // of the bytecode instruction
+  uint32_t def;         // value pushed, EVM_IR_NONE when there isn't one
+  uint32_t args;        // values read, top of the stack first
+  uint32_t targets;     // blocks branched or called to, jump tables keep every entry
+  int32_t  imm;         // immediate operand, the depth of the return address for RET
+  uint16_t targetCount;
+  uint8_t  argCount;
+  uint8_t  opcode;
+} evm_ir_inst_t;
+
+
+typedef struct evm_ir_block_s {
+  uint32_t start;     // bytecode offsets
+  uint32_t end;
+  uint32_t insts;     // first instruction
+  uint32_t instCount;
+  uint32_t preds;     // blocks the entry slots come from
+  uint32_t predCount;
+  uint32_t slots;     // value of each entry slot the block reads or passes on, top first
+  uint32_t inputs;
+  uint32_t phis;      // operands of each slot, one per predecessor and one more for an entry
+  uint32_t exits;     // values on top of the stack when the block is left, top first
+  uint32_t exitCount;
+  uint32_t consumed;  // entry slots below the exits are the ones from here on
+  uint32_t flags;
+} evm_ir_block_t;
+
+
+typedef struct evm_ir_s {
+  evm_ir_block_t *blocks;
+  evm_ir_inst_t  *insts;
+  evm_ir_value_t *values;
+  uint32_t       *pool;
+  uint8_t        *bytes;     // the program lifted
+  uint32_t        byteCount;
+  uint32_t        count;
+  uint32_t        instCount;
+  uint32_t        valueCount;
+  uint32_t        poolCount;
+  uint32_t        blockCapacity;
+  uint32_t        instCapacity;
+  uint32_t        valueCapacity;
+  uint32_t        poolCapacity;
+} evm_ir_t;
+
+
+#define evmirOperand(IR, IDX) ((IR)->pool[IDX])
+
+
+EVM_API evm_ir_t *evmirAllocate();
+EVM_API evm_ir_t *evmirInitialize(evm_ir_t *);
+EVM_API evm_ir_t *evmirFinalize(evm_ir_t *);
+EVM_API void      evmirFree(evm_ir_t *);
+
+// fails when a branch leaves the program or a loop keeps taking values off the stack
+EVM_API int evmirFromDisassembler(evm_ir_t *, const evm_disassembler_t *);
+EVM_API int evmirFromBuffer(evm_ir_t *, const uint8_t *, uint32_t);
+
+EVM_API int evmirToFile(const evm_ir_t *, FILE *);
+
+// lower back to stack bytecode, the buffer is allocated and belongs to the caller, a block with a
+// value deeper than DUP and REM reach keeps the bytecode it was lifted from
+EVM_API int evmirToBuffer(const evm_ir_t *, uint8_t **, uint32_t *);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* EVM_EVM_IR_H */
@@ -0,0 +1,52 @@
+#ifndef EVM_EVM_LINKER
+#  define EVM_EVM_LINKER
+
+
+#include "evm/config.h"
+#include "evm/object.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+struct evm_object_s;
+typedef struct evm_object_s evm_object_t;
+
+
+typedef struct evm_linker_s {
+  evm_object_t *objects;  // in the order they were added
+  uint8_t      *program;  // the linked image
+  uint32_t      length;
+  uint32_t      count;    // objects in use
+  uint32_t      capacity; // objects allocated
+} evm_linker_t;
+
+
+EVM_API evm_linker_t *evmldAllocate();
+EVM_API evm_linker_t *evmldInitialize(evm_linker_t *);
+EVM_API evm_linker_t *evmldFinalize(evm_linker_t *);
+EVM_API void          evmldFree(evm_linker_t *);
+
+// objects are copied, sections sharing a name are concatenated in the order they were added
+EVM_API int evmldAddBuffer(evm_linker_t *, const char *, const uint8_t *, uint32_t);
+EVM_API int evmldAddFile(evm_linker_t *, const char *, FILE *);
+
+EVM_API int evmldLink(evm_linker_t *);
+
+EVM_API uint32_t evmldProgramSize(const evm_linker_t *);
+
+EVM_API uint32_t evmldProgramToBuffer(const evm_linker_t *, uint8_t *, uint32_t);
+EVM_API int      evmldProgramToFile(const evm_linker_t *, FILE *);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* EVM_EVM_LINKER */
@@ -0,0 +1,43 @@
+#ifndef EVM_EVM_OBJECT_H
+#  define EVM_EVM_OBJECT_H
+
+
+#include <stdint.h>
+
+
+// Relocatable object files written by evmasmObjectToFile and linked by evm-ld.
+//
+// Every field is a little endian 32bit word and the file is laid out as follows:
+//
+//   header      magic, version, section count, symbol count, relocation count, string bytes
+//   sections    name, base, flags, length
+//   symbols     name, section, offset
+//   relocations section, offset, origin, size, symbol
+//   strings     terminated names referenced by their offset into this block
+//   contents    the bytes of every section in the order of the section table
+//
+// Every label is exported as a symbol, labels referenced but not defined by the object use
+// EVM_OBJECT_UNDEFINED as their section. A relocation stores the distance from the origin to
+// the symbol into the size bytes at the offset, both of which are relative to the section.
+
+
+#define EVM_OBJECT_MAGIC   0x4F4D5645U // "EVMO"
+#define EVM_OBJECT_VERSION 1U
+
+#define EVM_OBJECT_UNDEFINED 0xFFFFFFFFU
+
+
+typedef enum evm_object_flags_e {
+  EVM_OBJECT_BASED      = 1 << 0, // the section sets its own base address
+  EVM_OBJECT_DATA_FIRST = 1 << 1, // the section starts with data rather than an instruction
+} evm_object_flags_t;
+
+
+// number of words in each record
+#define EVM_OBJECT_HEADER_WORDS  6U
+#define EVM_OBJECT_SECTION_WORDS 4U
+#define EVM_OBJECT_SYMBOL_WORDS  3U
+#define EVM_OBJECT_RELOC_WORDS   5U
+
+
+#endif /* EVM_EVM_OBJECT_H */
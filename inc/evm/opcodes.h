@@ -15,10 +15,16 @@ typedef enum opcode_family_e {
   FAM_DUP  = 0x30,
   FAM_MATH = 0x40,
   FAM_BITS = 0x50,
-
-  // 0x60-0xB0 reserved for future expansion
+#if EVM_MEMORY_SUPPORT == 1
+  FAM_BLOCK = 0x60,
+  FAM_VEC   = 0x70,
+#endif
+  FAM_FRAME = 0x80,
+  FAM_IMM   = 0x90,
+  FAM_XMATH = 0xA0,
 
 #if EVM_MEMORY_SUPPORT == 1
+  FAM_INDEX = 0xB0,
   FAM_MEM  = 0xC0,
 #endif
   FAM_CMP  = 0xD0,
@@ -122,6 +128,94 @@ typedef enum opcode_e {
 #endif
 
 #if EVM_MEMORY_SUPPORT == 1
+  // block operations take their addresses relative to the active segment and stop at the end of
+  // memory, the stack holds the first address, then the second address or value, then the length
+  OP_MEMCPY  = FAM_BLOCK | 0x00, // copy bytes to the first address from the second
+  OP_MEMMOVE = FAM_BLOCK | 0x01, // copy bytes to the first address from the second, may overlap
+  OP_MEMSET  = FAM_BLOCK | 0x02, // fill bytes at the first address with the second value
+  OP_MEMCMP  = FAM_BLOCK | 0x03, // compare bytes at both addresses, leave -1, 0 or 1 in their place
+
+  // vector operations work on four lanes stored at addresses relative to the active segment, the
+  // stack holds the destination, then the left and the right operand
+  OP_VADD_I = FAM_VEC | 0x00, // add the vectors as integers
+  OP_VSUB_I = FAM_VEC | 0x01, // subtract the right vector from the left as integers
+  OP_VMUL_I = FAM_VEC | 0x02, // multiply the vectors as integers
+  OP_VDOT_I = FAM_VEC | 0x03, // replace both operand addresses by their dot product as an integer
+  OP_VMIN_I = FAM_VEC | 0x04, // the lesser lane of the vectors as integers
+  OP_VMAX_I = FAM_VEC | 0x05, // the greater lane of the vectors as integers
+#  if EVM_FLOAT_SUPPORT == 1
+  OP_VADD_F = FAM_VEC | 0x08, // add the vectors as floats
+  OP_VSUB_F = FAM_VEC | 0x09, // subtract the right vector from the left as floats
+  OP_VMUL_F = FAM_VEC | 0x0A, // multiply the vectors as floats
+  OP_VDOT_F = FAM_VEC | 0x0B, // replace both operand addresses by their dot product as a float
+  OP_VMIN_F = FAM_VEC | 0x0C, // the lesser lane of the vectors as floats
+  OP_VMAX_F = FAM_VEC | 0x0D, // the greater lane of the vectors as floats
+#  endif
+#endif
+
+  // frame operations index the stack from the frame pointer, ENTER saves it above the return
+  // address pushed by a call so argument 0 is the last value pushed before the call and local 0 is
+  // the first value reserved by ENTER
+  OP_ENTER    = FAM_FRAME | 0x00, // save the frame pointer, reserve the next byte of locals
+  OP_LEAVE    = FAM_FRAME | 0x01, // restore the frame pointer, keep the next byte of values on top
+  OP_LOAD_L   = FAM_FRAME | 0x02, // push the local indexed by the next byte
+  OP_STORE_L  = FAM_FRAME | 0x03, // pop the stack top into the local indexed by the next byte
+  OP_LOAD_A   = FAM_FRAME | 0x04, // push the argument indexed by the next byte
+  OP_LENTER   = FAM_FRAME | 0x08, // save the frame pointer, reserve the next two bytes of locals
+  OP_LLOAD_L  = FAM_FRAME | 0x0A, // push the local indexed by the next two bytes
+  OP_LSTORE_L = FAM_FRAME | 0x0B, // pop the stack top into the local indexed by the next two bytes
+  OP_LLOAD_A  = FAM_FRAME | 0x0C, // push the argument indexed by the next two bytes
+
+  OP_ADD_8I   = FAM_IMM | 0x00, // add the next byte as a signed integer to the top of the stack
+  OP_SUB_8I   = FAM_IMM | 0x01, // subtract the next byte as a signed integer from the stack top
+  OP_MUL_8I   = FAM_IMM | 0x02, // multiply the top of the stack by the next byte as an integer
+  OP_AND_8I   = FAM_IMM | 0x03, // bitwise AND the top of the stack with the next signed byte
+  OP_LSH_8I   = FAM_IMM | 0x04, // left shift the top of the stack by the next byte
+  OP_JCMP_8I  = FAM_IMM | 0x05, // compare the top to the 2nd byte, near jump on flags in the 1st
+  OP_DJNZ     = FAM_IMM | 0x06, // decrement the top of the stack, near jump if it is not zero
+  OP_ADD_16I  = FAM_IMM | 0x08, // add the next two bytes as a signed integer to the stack top
+  OP_SUB_16I  = FAM_IMM | 0x09, // subtract the next two bytes as a signed integer from the top
+  OP_MUL_16I  = FAM_IMM | 0x0A, // multiply the top of the stack by the next two bytes as an integer
+  OP_AND_16I  = FAM_IMM | 0x0B, // bitwise AND the top of the stack with the next two signed bytes
+  OP_LJCMP_8I = FAM_IMM | 0x0D, // compare the top to the 2nd byte, far jump on flags in the 1st
+  OP_LDJNZ    = FAM_IMM | 0x0E, // decrement the top of the stack, far jump if it is not zero
+
+  OP_POPCNT = FAM_XMATH | 0x00, // count the bits set in the top of the stack
+  OP_CLZ    = FAM_XMATH | 0x01, // count the leading zero bits of the top of the stack, 32 for 0
+  OP_CTZ    = FAM_XMATH | 0x02, // count the trailing zero bits of the top of the stack, 32 for 0
+  OP_ROL    = FAM_XMATH | 0x03, // rotate the top of the stack left by the second value
+  OP_ROR    = FAM_XMATH | 0x04, // rotate the top of the stack right by the second value
+  OP_MOD_I  = FAM_XMATH | 0x05, // remainder of the top of the stack divided by the second value
+  OP_MIN_I  = FAM_XMATH | 0x06, // the lesser of the top two values on the stack as integers
+  OP_MAX_I  = FAM_XMATH | 0x07, // the greater of the top two values on the stack as integers
+#if EVM_FLOAT_SUPPORT == 1
+  OP_MIN_F  = FAM_XMATH | 0x08, // the lesser of the top two values on the stack as floats
+  OP_MAX_F  = FAM_XMATH | 0x09, // the greater of the top two values on the stack as floats
+  OP_SQRT_F = FAM_XMATH | 0x0A, // square root of the top of the stack as a float
+  OP_FMA_F  = FAM_XMATH | 0x0B, // multiply the top two values and add the third as floats
+#endif
+
+#if EVM_MEMORY_SUPPORT == 1
+  // indexed operations address base + index * scale relative to the active segment, the scale is
+  // the next byte as a power of two, the base is on the stack below the index or the two bytes
+  // after the scale, a value to write is on top of the index
+  OP_SXREAD    = FAM_INDEX | 0x00, // read four bytes from the base on the stack
+  OP_SXREAD8   = FAM_INDEX | 0x01, // read a sign extended byte from the base on the stack
+  OP_SXREAD8U  = FAM_INDEX | 0x02, // read a zero extended byte from the base on the stack
+  OP_SXREAD16  = FAM_INDEX | 0x03, // read a sign extended short from the base on the stack
+  OP_SXREAD16U = FAM_INDEX | 0x04, // read a zero extended short from the base on the stack
+  OP_SXWRITE8  = FAM_INDEX | 0x05, // write the stack top as a byte from the base on the stack
+  OP_SXWRITE16 = FAM_INDEX | 0x06, // write the stack top as a short from the base on the stack
+  OP_SXWRITE32 = FAM_INDEX | 0x07, // write the stack top as an int from the base on the stack
+  OP_XREAD     = FAM_INDEX | 0x08, // read four bytes from a two byte base
+  OP_XREAD8    = FAM_INDEX | 0x09, // read a sign extended byte from a two byte base
+  OP_XREAD8U   = FAM_INDEX | 0x0A, // read a zero extended byte from a two byte base
+  OP_XREAD16   = FAM_INDEX | 0x0B, // read a sign extended short from a two byte base
+  OP_XREAD16U  = FAM_INDEX | 0x0C, // read a zero extended short from a two byte base
+  OP_XWRITE8   = FAM_INDEX | 0x0D, // write the stack top as a byte from a two byte base
+  OP_XWRITE16  = FAM_INDEX | 0x0E, // write the stack top as a short from a two byte base
+  OP_XWRITE32  = FAM_INDEX | 0x0F, // write the stack top as an int from a two byte base
+
   OP_SEG      = FAM_MEM | 0x00, // set the active memory segment
   OP_READ     = FAM_MEM | 0x01, // read four bytes from a two byte address and push onto the stack
   OP_WRITE8   = FAM_MEM | 0x02, // write a byte to a two byte address
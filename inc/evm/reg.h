@@ -0,0 +1,38 @@
+#ifndef EVM_EVM_REG_H
+#  define EVM_EVM_REG_H
+
+
+#include "evm.h"
+
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// Stack bytecode is translated into three address code when the program is loaded. Each block
+// addresses the stack through slots relative to the stack pointer it was entered with, so DUP,
+// SWAP, POP and REM vanish and only the values that end up somewhere new are moved, once, when
+// the block is left. The stack is therefore exact between blocks for builtins, yields and the
+// host. Memory, builtins, yields and jump tables are run by the stack interpreter, one stretch
+// up to the next block at a time together with any short block they fall through into, as is
+// any block entered with too little stack below it or too little room above it.
+typedef struct evm_reg_code_s evm_reg_code_t;
+
+
+// translate the bytes of a program, NULL when none of it could be translated
+EVM_API evm_reg_code_t *evmregTranslate(const uint8_t *, uint32_t);
+EVM_API void            evmregFree(evm_reg_code_t *);
+
+// run the translation of vm->program, behaves exactly like evmRunStack
+EVM_API int evmregRun(evm_t *, uint32_t);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* EVM_EVM_REG_H */
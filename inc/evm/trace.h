@@ -0,0 +1,40 @@
+#ifndef EVM_EVM_TRACE_H
+#  define EVM_EVM_TRACE_H
+
+
+#include "evm.h"
+
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// The stack interpreter counts the backward branches it takes to each loop. Once a loop is hot
+// the next pass through it is recorded, one instruction at a time, into a trace of operations
+// with their operands decoded and the branches replaced by guards that expect the direction
+// taken while recording. Later passes replay the trace until a guard fails, which leaves it for
+// the interpreter at the instruction the bytecode would have continued with. Instructions the
+// trace doesn't know are stepped by the interpreter itself.
+typedef struct evm_trace_cache_s evm_trace_cache_t;
+
+
+EVM_API evm_trace_cache_t *evmtraceAllocate();
+EVM_API void               evmtraceFree(evm_trace_cache_t *);
+
+// called by the interpreter after a backward branch to vm->ip, runs at most the given number of
+// instructions through the trace of the loop there and returns how many it ran
+EVM_API uint32_t evmtraceLoop(evm_t *, uint32_t);
+
+// the loops holding a trace, for telling whether a program reaches the traces at all
+EVM_API uint32_t evmtraceCount(const evm_trace_cache_t *);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* EVM_EVM_TRACE_H */
@@ -0,0 +1,26 @@
+; random access over all of system ram, a workload for evm-bench
+.name MAIN
+.offset 0
+
+entry:
+  PUSH 12345      ; seed of the generator
+  PUSH 8000000    ; words to visit
+
+loop:
+  SWAP            ; step the linear congruential generator
+  PUSH 1103515245
+  MUL
+  PUSH 12345
+  ADD
+  DUP             ; its low 22 bits index one of the 4M words in ram
+  PUSH 4194303
+  AND
+  DUP
+  XREAD 4 0       ; read the word
+  INC
+  XWRITE32 4 0    ; and write it back incremented
+  SWAP
+  DJNZ loop
+
+  POP 2
+  HALT
@@ -0,0 +1,39 @@
+; block operations over a few words of ram, a program for evm-check
+.name MAIN
+.offset 0
+
+entry:
+  PUSH 0          ; sum of the comparisons
+  PUSH 100        ; rounds
+
+loop:
+  PUSH 256        ; fill sixteen bytes at 0x100 with the round
+  DUP 2
+  PUSH 16
+  MEMSET
+  PUSH 512        ; copy them to 0x200
+  PUSH 256
+  PUSH 16
+  MEMCPY
+  PUSH 260        ; shift the first twelve up by a word
+  PUSH 256
+  PUSH 12
+  MEMMOVE
+  PUSH 518        ; break the copy in the middle
+  PUSH 0
+  PUSH 1
+  MEMSET
+  PUSH 256        ; compare the shifted bytes with the copy
+  PUSH 512
+  PUSH 16
+  MEMCMP
+  DUP 3           ; and add the result to the sum
+  ADD
+  REM 2
+  SWAP
+  DEC
+  CMP 0
+  JNE loop
+
+  POP
+  HALT
@@ -0,0 +1,36 @@
+; calls through stack frames, a program for evm-check
+.name MAIN
+.offset 0
+
+entry:
+  PUSH 0          ; sum of the squares
+  PUSH 100        ; rounds
+
+loop:
+  DUP             ; argument 1 is the round
+  DUP 3           ; argument 0 the sum so far
+  CALL square
+  REM 1           ; drop the arguments below the result
+  REM 1
+  REM 2           ; and replace the sum by it
+  SWAP
+  DEC
+  CMP 0
+  JNE loop
+
+  POP
+  HALT
+
+square:
+  ENTER 2         ; two locals
+  LDARG 1
+  DUP
+  MUL
+  STLOC 0         ; the square of the round
+  LDLOC 0
+  LDARG 0
+  ADD
+  STLOC 1         ; added to the sum
+  LDLOC 1
+  LEAVE 1         ; keep the new sum on top
+  RET 1
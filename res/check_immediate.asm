@@ -0,0 +1,38 @@
+; arithmetic with immediate operands, a program for evm-check
+.name MAIN
+.offset 0
+
+entry:
+  PUSH 1          ; the value stepped
+  PUSH 200        ; rounds
+
+loop:
+  DUP 2           ; step the value by the round
+  DUP 2
+  ADD
+  ADDI 3
+  MULI 5
+  ANDI 16383
+  SHLI 1
+  SUBI 1000
+  MULI 300
+  ADDI -2000
+  REM 2
+  SWAP
+  DUP 2           ; count the rounds leaving its low bits between 32 and 96 at 0x100
+  ANDI 127
+  JLTI 32 next
+  JGEI 96 next
+  JEQI 64 next
+  READ 0x100
+  ADDI 1
+  WRITE32 0x100
+  POP
+
+next:
+  POP
+  DJNZ loop
+
+  POP
+  READ 0x100
+  HALT
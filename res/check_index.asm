@@ -0,0 +1,49 @@
+; indexed reads and writes over tables in ram, a program for evm-check
+.name MAIN
+.offset 0
+
+entry:
+  PUSH 0          ; sum of what was read back
+  PUSH 100        ; rounds
+
+loop:
+  DUP             ; the round at its index in the table of words at 0x400
+  DUP
+  XWRITE32 4 0x400
+  DUP             ; and as a byte in the table at 0x800
+  DUP
+  XWRITE8 1 0x800
+  DUP             ; and negated as a short in the table at 0x1000
+  DUP
+  NEG
+  XWRITE16 2 0x1000
+  DUP             ; read all of them back
+  XREAD 4 0x400
+  DUP 2
+  XREAD8 1 0x800
+  ADD
+  DUP 2
+  XREAD8U 1 0x800
+  ADD
+  DUP 2
+  XREAD16 2 0x1000
+  ADD
+  DUP 2
+  XREAD16U 2 0x1000
+  ADD
+  PUSH 8192       ; the round again into the table of words at a base on the stack, 0x2000
+  DUP 3
+  DUP 4
+  XWRITE32 4
+  PUSH 8192       ; and read back from there
+  DUP 3
+  XREAD 4
+  ADD
+  DUP 3           ; add it all to the sum
+  ADD
+  REM 2
+  SWAP
+  DJNZ loop
+
+  POP
+  HALT
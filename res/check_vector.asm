@@ -0,0 +1,88 @@
+; vector operations over four lanes in ram, a program for evm-check
+.name MAIN
+.offset 0
+
+entry:
+  PUSH 1          ; the step at 0x110
+  WRITE32 0x110
+  INC
+  WRITE32 0x114
+  INC
+  WRITE32 0x118
+  INC
+  WRITE32 0x11C
+  POP
+  PUSHF 0.5       ; the float step at 0x170
+  WRITE32 0x170
+  PUSHF 1.0
+  ADDF
+  WRITE32 0x174
+  PUSHF 1.0
+  ADDF
+  WRITE32 0x178
+  PUSHF 1.0
+  ADDF
+  WRITE32 0x17C
+  POP
+  PUSH 0          ; sum of the dot products
+  PUSH 100        ; rounds
+
+loop:
+  PUSH 256        ; step the vector at 0x100
+  PUSH 256
+  PUSH 272
+  VADD
+  PUSH 288        ; scale it by the step into 0x120
+  PUSH 256
+  PUSH 272
+  VMUL
+  PUSH 304        ; the lesser lanes of both into 0x130
+  PUSH 256
+  PUSH 288
+  VMIN
+  PUSH 320        ; the greater ones into 0x140
+  PUSH 256
+  PUSH 288
+  VMAX
+  PUSH 336        ; and their difference into 0x150
+  PUSH 320
+  PUSH 304
+  VSUB
+  PUSH 336        ; add the dot product of the difference and the step to the sum
+  PUSH 272
+  VDOT
+  DUP 3
+  ADD
+  REM 2
+  SWAP
+  PUSH 352        ; the same on floats from 0x160, the last dot product stays at 0x1C0
+  PUSH 352
+  PUSH 368
+  VADDF
+  PUSH 384
+  PUSH 352
+  PUSH 368
+  VMULF
+  PUSH 400
+  PUSH 352
+  PUSH 384
+  VMINF
+  PUSH 416
+  PUSH 352
+  PUSH 384
+  VMAXF
+  PUSH 432
+  PUSH 416
+  PUSH 400
+  VSUBF
+  PUSH 432
+  PUSH 368
+  VDOTF
+  WRITE32 0x1C0
+  POP
+  DEC
+  CMP 0
+  JNE loop
+
+  POP
+  HALT
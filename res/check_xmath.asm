@@ -0,0 +1,57 @@
+; bit and math operations, a program for evm-check
+.name MAIN
+.offset 0
+
+entry:
+  PUSH 305419896  ; the value mixed at 0x100
+  WRITE32 0x100
+  POP
+  PUSHF 1.0       ; the float stepped at 0x104
+  WRITE32 0x104
+  POP
+  PUSH 100        ; rounds
+
+loop:
+  READ 0x100      ; rotate the value left by its bit count
+  DUP
+  POPCNT
+  SWAP
+  ROL
+  DUP             ; and right by its leading zeros
+  CLZ
+  SWAP
+  ROR
+  DUP             ; fold in its trailing zeros
+  CTZ
+  XOR
+  DUP 2           ; and the remainder of it by the round
+  DUP 2
+  MOD
+  XOR
+  DUP             ; and the lesser of it and the round, then add the greater
+  DUP 3
+  MIN
+  XOR
+  DUP
+  DUP 3
+  MAX
+  ADD
+  WRITE32 0x100
+  POP
+  READ 0x104      ; the float goes through the square root of its square plus itself
+  DUP
+  DUP
+  FMAF
+  SQRTF
+  PUSHF 1000.0    ; clamped to a range
+  MINF
+  PUSHF 1.0
+  MAXF
+  WRITE32 0x104
+  POP
+  DJNZ loop
+
+  POP
+  READ 0x100
+  READ 0x104
+  HALT
@@ -6,41 +6,91 @@
 
 int main(int argc, char **argv) {
   evm_assembler_t *assembler = evmasmInitialize(evmasmAllocate());
+  const char **files = calloc(argc, sizeof(const char *));
+  int *results = calloc(argc, sizeof(int));
   int result = EXIT_FAILURE;
-  int arg;
+  int arg, count = 0, relocatable = 0;
 
-  if(assembler) {
+  if(assembler && files && results) {
     for(result = EXIT_SUCCESS, arg = 1; result == EXIT_SUCCESS && arg < argc; ++arg) {
-      FILE *src = fopen(argv[arg], "r");
+      // -O[0-2] selects the optimization level, -O and -O2 are the same as -O1
+      if(argv[arg][0] == '-' && argv[arg][1] == 'O') {
+        const char *level = argv[arg][2] ? &argv[arg][2] : "1";
 
-      if(!src) {
-        fprintf(stderr, "%s: failed to open %s for reading\n", *argv, argv[arg]);
-        result = EXIT_FAILURE;
+        if(level[1] || evmasmSetOptimization(assembler, level[0] - '0')) {
+          fprintf(stderr, "%s: invalid optimization level %s\n", *argv, argv[arg]);
+          result = EXIT_FAILURE;
+        }
+        continue;
       }
-      else if(evmasmParseFile(assembler, argv[arg], src)) {
-        fprintf(stderr, "%s: failed to successfully parse %s\n", *argv, argv[arg]);
-        result = EXIT_FAILURE;
+
+      // -c outputs a relocatable object for evm-ld rather than a program
+      if(argv[arg][0] == '-' && argv[arg][1] == 'c' && !argv[arg][2]) {
+        evmasmSetRelocatable(assembler, 1);
+        relocatable = 1;
+        continue;
+      }
+
+      // -C DIR reuses the output of earlier runs on identical sources kept in DIR
+      if(argv[arg][0] == '-' && argv[arg][1] == 'C' && !argv[arg][2]) {
+        if(++arg == argc || evmasmSetCache(assembler, argv[arg])) {
+          fprintf(stderr, "%s: invalid cache directory\n", *argv);
+          result = EXIT_FAILURE;
+        }
+        continue;
       }
 
-      fclose(src);
+      // -jN limits the number of threads, -j0 (the default) uses every processor
+      if(argv[arg][0] == '-' && argv[arg][1] == 'j') {
+        char *end;
+        long threads = strtol(&argv[arg][2], &end, 10);
+
+        if(!argv[arg][2] || *end || threads > INT32_MAX || evmasmSetThreads(assembler, (int) threads)) {
+          fprintf(stderr, "%s: invalid thread count %s\n", *argv, argv[arg]);
+          result = EXIT_FAILURE;
+        }
+        continue;
+      }
+
+      files[count++] = argv[arg];
+    }
+
+    // the files are parsed concurrently but always merged in command line order
+    if(result == EXIT_SUCCESS && evmasmParseFiles(assembler, files, count, results)) {
+      for(arg = 0; arg < count; ++arg) {
+        if(results[arg]) {
+          fprintf(stderr, "%s: failed to successfully parse %s\n", *argv, files[arg]);
+        }
+      }
+
+      result = EXIT_FAILURE;
     }
 
     if(result == EXIT_SUCCESS) {
       if(!evmasmValidateProgram(assembler)) {
-        if(evmasmProgramToFile(assembler, stdout)) {
+        if(relocatable ? evmasmObjectToFile(assembler, stdout) :
+                         evmasmProgramToFile(assembler, stdout)) {
           fprintf(stderr, "%s: program failed to output\n", *argv);
           result = EXIT_FAILURE;
         }
+        else if(assembler->level && !evmasmIsCached(assembler)) {
+          uint32_t insts, bytes;
+
+          evmasmOptimizationReport(assembler, &insts, &bytes);
+          fprintf(stderr, "%s: optimizer removed %u instructions (%u bytes)\n", *argv, insts, bytes);
+        }
       }
       else {
         fprintf(stderr, "%s: program failed to validate\n", *argv);
         result = EXIT_FAILURE;
       }
     }
-
-    evmasmFree(evmasmFinalize(assembler));
   }
 
+  evmasmFree(evmasmFinalize(assembler));
+  free(results);
+  free(files);
+
   return result;
 }
 
@@ -0,0 +1,214 @@
+#include "evm.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __linux__
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+
+#if EVM_MEMORY_SUPPORT == 1
+static const char *BACKINGS[] = {
+  "heap",
+  "pages",
+  "huge pages",
+  "transparent huge pages",
+};
+#endif
+
+
+static int slurp(FILE *fp, uint8_t **buf, uint32_t *len, const char *exe, const char *name);
+static int bench(const uint8_t *prog, uint32_t length, const char *exe, const char *name);
+static int counterOpen(void);
+static int64_t counterRead(int fd);
+
+int main(int argc, char **argv) {
+  int result = EXIT_SUCCESS;
+  int arg;
+
+  if(argc > 1) {
+    for(arg = 1; arg < argc; ++arg) {
+      FILE *input = fopen(argv[arg], "rb");
+
+      if(input) {
+        uint8_t  *prog;
+        uint32_t  length;
+        if(slurp(input, &prog, &length, *argv, argv[arg]) ||
+           bench(prog, length, *argv, argv[arg])) {
+          result = EXIT_FAILURE;
+        }
+
+        free(prog);
+        fclose(input);
+      }
+      else {
+        fprintf(stderr, "%s: Failed to open %s for reading\n", *argv, argv[arg]);
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+  else {
+    fprintf(stderr, "Usage: %s PROG...\n", *argv);
+    result = EXIT_FAILURE;
+  }
+
+  return result;
+}
+
+
+// builtin bindings
+const EvmBuiltinFunction EVM_BUILTINS[EVM_MAX_BUILTINS] = {
+  &evmUnboundHandler,
+  &evmUnboundHandler,
+  &evmUnboundHandler,
+  &evmUnboundHandler,
+  &evmUnboundHandler,
+  &evmUnboundHandler,
+  &evmUnboundHandler,
+  &evmUnboundHandler,
+};
+
+
+static int slurp(FILE *fp, uint8_t **buffer, uint32_t *length, const char *exe, const char *name) {
+  long size;
+  *length = 0U;
+  *buffer = NULL;
+
+  if(!fseek(fp, 0L, SEEK_END) && (size = ftell(fp)) >= 0 && !fseek(fp, 0L, SEEK_SET)) {
+    if((*buffer = malloc(size))) {
+      if(fread(*buffer, 1, size, fp) == (size_t) size) {
+        *length = (uint32_t) size;
+      }
+      else {
+        free(*buffer);
+        *buffer = NULL;
+        fprintf(stderr, "%s: Failed to read program from %s\n", exe, name);
+      }
+    }
+    else {
+      fprintf(stderr, "%s: Failed to allocate buffer for program\n", exe);
+    }
+  }
+  else {
+    fprintf(stderr, "%s: Failed to obtain file size for %s\n", exe, name);
+  }
+
+  return !*length;
+}
+
+
+// run the program to completion once with system ram in ordinary pages and once in huge pages,
+// reporting the time taken and the dTLB load misses where the system will count them
+static int bench(const uint8_t *prog, uint32_t length, const char *exe, const char *name) {
+  int mode, modes = 1, counter = counterOpen();
+  double first = 0.0;
+
+#if EVM_MEMORY_SUPPORT == 1 && EVM_HUGE_PAGES == 1
+  modes = 2;
+#else
+  fprintf(stderr, "%s: built without huge pages, %s runs once in ordinary memory\n", exe, name);
+#endif
+  if(counter < 0) {
+    fprintf(stderr, "%s: dTLB load misses can't be counted here, only times are reported\n", exe);
+  }
+
+  for(mode = 0; mode < modes; ++mode) {
+    struct timespec start, stop;
+    int64_t misses;
+    double ms;
+    evm_t vm;
+
+#if EVM_MEMORY_SUPPORT == 1 && EVM_HUGE_PAGES == 1
+    (void) evmUseHugePages(mode);
+#endif
+    if(!evmInitialize(&vm, NULL, 1024U) || evmSetProgram(&vm, prog, length)) {
+      fprintf(stderr, "%s: Failed to initialize eVM for %s\n", exe, name);
+      evmFinalize(&vm);
+      return -1;
+    }
+
+#if EVM_MEMORY_SUPPORT == 1 && EVM_HUGE_PAGES == 1
+    if(mode && evmMemoryBacking(&vm) != EVM_BACKING_HUGE_PAGES) {
+      fprintf(stderr, "%s: no huge pages are reserved, the second run falls back to %s\n", exe,
+              BACKINGS[evmMemoryBacking(&vm)]);
+    }
+#endif
+
+#if EVM_MEMORY_SUPPORT == 1
+    // fault every page in first, so only the cost of reaching them is measured
+    if(evmSystemRam(&vm)) { memset(evmSystemRam(&vm), 0, 0x01000000U); }
+#endif
+
+#ifdef __linux__
+    if(counter >= 0) {
+      (void) ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+      (void) ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+      evmRun(&vm, 32768U);
+    } while(!evmHasHalted(&vm));
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    misses = counterRead(counter);
+
+    ms = (stop.tv_sec - start.tv_sec) * 1e3 + (stop.tv_nsec - start.tv_nsec) / 1e6;
+    first = mode ? first : ms;
+#if EVM_MEMORY_SUPPORT == 1
+    printf("%s: %-24s", name, BACKINGS[evmMemoryBacking(&vm)]);
+#else
+    printf("%s: %-24s", name, "no memory");
+#endif
+    printf(" %10.1f ms %6.2fx", ms, ms > 0.0 ? first / ms : 0.0);
+    if(misses >= 0) { printf(" %14lld dTLB load misses\n", (long long) misses); }
+    else            { printf(" %14s dTLB load misses\n", "-"); }
+
+    evmFinalize(&vm);
+  }
+
+#ifdef __linux__
+  if(counter >= 0) { close(counter); }
+#endif
+  return 0;
+}
+
+
+// dTLB load misses by this process in user space, where perf events are allowed
+static int counterOpen(void) {
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+
+static int64_t counterRead(int fd) {
+#ifdef __linux__
+  uint64_t count;
+  if(fd >= 0) {
+    (void) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if(read(fd, &count, sizeof(count)) == (ssize_t) sizeof(count)) {
+      return (int64_t) count;
+    }
+  }
+#else
+  (void) fd;
+#endif
+  return -1;
+}
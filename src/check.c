@@ -0,0 +1,289 @@
+#include "evm.h"
+#include "evm/ir.h"
+#include "evm/trace.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define CHECK_BUDGET 32768U    // operations each run is stepped by
+#define CHECK_LIMIT  0x100000U // budgets a program gets before it is taken not to halt
+
+
+// budgets the interpreters are stepped by side by side, odd so they run out inside loops and blocks
+static const uint32_t SLICES[] = { 7U, 61U, 1021U };
+
+
+static int slurp(const char *file, uint8_t **buf, uint32_t *len, const char *exe);
+static int run(evm_t *vm, const uint8_t *prog, uint32_t length, const char *exe, const char *name);
+static int lockstep(evm_t *vm, const uint8_t *prog, uint32_t length, int traced, const char *exe,
+                    const char *name);
+static int differ(const evm_t *lhs, const evm_t *rhs);
+static int compare(const evm_t *lhs, const evm_t *rhs, const char *exe, const char *name);
+static int lower(const evm_t *vm, const uint8_t *prog, uint32_t length, const char *exe,
+                 const char *name);
+
+int main(int argc, char **argv) {
+  int result = EXIT_SUCCESS;
+  uint8_t *prog = NULL;
+  uint32_t length;
+  // -t fails the program unless one of its loops ends up traced
+  int traced = argc > 1 && !strcmp(argv[1], "-t");
+  int first = 1 + traced, arg;
+  evm_t vm;
+
+  // the first program is the reference, the ones after it are other builds of the same source
+  if(argc <= first) {
+    fprintf(stderr, "Usage: %s [-t] PROG [BUILD...]\n", *argv);
+    return EXIT_FAILURE;
+  }
+
+  if(slurp(argv[first], &prog, &length, *argv)) {
+    return EXIT_FAILURE;
+  }
+
+  if(lockstep(&vm, prog, length, traced, *argv, argv[first]) ||
+     lower(&vm, prog, length, *argv, argv[first])) {
+    result = EXIT_FAILURE;
+  }
+
+  free(prog);
+
+  for(arg = first + 1; result == EXIT_SUCCESS && arg < argc; ++arg) {
+    evm_t build;
+
+    if(slurp(argv[arg], &prog, &length, *argv)) {
+      result = EXIT_FAILURE;
+      continue;
+    }
+
+    if(run(&build, prog, length, *argv, argv[arg]) || compare(&vm, &build, *argv, argv[arg])) {
+      result = EXIT_FAILURE;
+    }
+
+    evmFinalize(&build);
+    free(prog);
+  }
+
+  evmFinalize(&vm);
+
+  if(result == EXIT_SUCCESS) {
+    printf("%s: ok\n", argv[first]);
+  }
+
+  return result;
+}
+
+
+// the programs expect the builtins of evm-example, which have to behave the same for every build
+static int32_t checksum(evm_t *vm) {
+  evmPush(vm, 0x5A5A5A5A); // the real checksum differs between builds
+
+  return 0;
+}
+
+
+static int32_t quiet(evm_t *vm) {
+  (void) vm;
+
+  return 0;
+}
+
+
+// builtin bindings
+const EvmBuiltinFunction EVM_BUILTINS[EVM_MAX_BUILTINS] = {
+  &checksum,
+  &quiet,
+  &quiet,
+  &evmUnboundHandler,
+  &evmUnboundHandler,
+  &evmUnboundHandler,
+  &evmUnboundHandler,
+  &evmUnboundHandler,
+};
+
+
+static int slurp(const char *file, uint8_t **buffer, uint32_t *length, const char *exe) {
+  FILE *fp = fopen(file, "rb");
+  long size;
+  *length = 0U;
+  *buffer = NULL;
+
+  if(!fp) {
+    fprintf(stderr, "%s: Failed to open %s for reading\n", exe, file);
+    return -1;
+  }
+
+  if(!fseek(fp, 0L, SEEK_END) && (size = ftell(fp)) > 0 && !fseek(fp, 0L, SEEK_SET)) {
+    if((*buffer = malloc(size))) {
+      if(fread(*buffer, 1, size, fp) == (size_t) size) {
+        *length = (uint32_t) size;
+      }
+      else {
+        free(*buffer);
+        *buffer = NULL;
+        fprintf(stderr, "%s: Failed to read program from %s\n", exe, file);
+      }
+    }
+    else {
+      fprintf(stderr, "%s: Failed to allocate buffer for program\n", exe);
+    }
+  }
+  else {
+    fprintf(stderr, "%s: Failed to obtain file size for %s\n", exe, file);
+  }
+
+  fclose(fp);
+
+  return !*length;
+}
+
+
+// run a program until it halts, the VM is left for comparing and has to be finalized either way
+static int run(evm_t *vm, const uint8_t *prog, uint32_t length, const char *exe, const char *name) {
+  uint32_t budgets = 0;
+
+  if(!evmInitialize(vm, NULL, 1024U) || evmSetProgram(vm, prog, length)) {
+    fprintf(stderr, "%s: Failed to initialize eVM for %s\n", exe, name);
+    return -1;
+  }
+
+  while(!evmHasHalted(vm) && budgets++ < CHECK_LIMIT) {
+    evmRun(vm, CHECK_BUDGET);
+  }
+
+  if(!evmHasHalted(vm)) {
+    fprintf(stderr, "%s: %s didn't halt\n", exe, name);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+// evmRun and evmRunStack step the program side by side and have to agree after every budget, so
+// they count operations the same way as well as ending the same, vm is left as evmRun ends it
+static int lockstep(evm_t *vm, const uint8_t *prog, uint32_t length, int traced, const char *exe,
+                    const char *name) {
+  uint32_t budgets = 0;
+  int result = 0;
+  evm_t stack, plain;
+
+  evmInitialize(vm, NULL, 1024U);
+  evmInitialize(&stack, NULL, 1024U);
+  evmInitialize(&plain, NULL, 1024U);
+
+  if(evmSetProgram(vm, prog, length) || evmSetProgram(&stack, prog, length) ||
+     evmSetProgram(&plain, prog, length)) {
+    fprintf(stderr, "%s: Failed to initialize eVM for %s\n", exe, name);
+    result = -1;
+  }
+
+#if EVM_TRACE_SUPPORT == 1
+  // the stack interpreter runs every instruction itself without the traces
+  evmtraceFree(plain.traces);
+  plain.traces = NULL;
+#endif
+
+  while(!result && !evmHasHalted(vm) && budgets < CHECK_LIMIT) {
+    const uint32_t budget = SLICES[budgets++ % (sizeof(SLICES) / sizeof(*SLICES))];
+
+    evmRun(vm, budget);
+    evmRunStack(&stack, budget);
+    evmRunStack(&plain, budget);
+
+    if(differ(vm, &stack)) {
+      fprintf(stderr, "%s: %s reaches %06X under evmRun but %06X under evmRunStack\n", exe, name,
+              vm->ip, stack.ip);
+      result = -1;
+    }
+    else if(differ(&stack, &plain)) {
+      fprintf(stderr, "%s: %s reaches %06X with its traces but %06X without them\n", exe, name,
+              stack.ip, plain.ip);
+      result = -1;
+    }
+  }
+
+  if(!result && !evmHasHalted(vm)) {
+    fprintf(stderr, "%s: %s didn't halt\n", exe, name);
+    result = -1;
+  }
+
+  if(!result) {
+    result = compare(vm, &stack, exe, name) || compare(&stack, &plain, exe, name) ? -1 : 0;
+  }
+
+#if EVM_TRACE_SUPPORT == 1
+  if(!result && traced && !evmtraceCount(stack.traces)) {
+    fprintf(stderr, "%s: %s never entered a trace\n", exe, name);
+    result = -1;
+  }
+#else
+  if(traced) {
+    printf("%s: built without traces, skipped looking for them\n", name);
+  }
+#endif
+
+  evmFinalize(&stack);
+  evmFinalize(&plain);
+
+  return result;
+}
+
+
+static int differ(const evm_t *lhs, const evm_t *rhs) {
+  return lhs->ip != rhs->ip || lhs->sp != rhs->sp || lhs->fp != rhs->fp ||
+         lhs->flags != rhs->flags || memcmp(lhs->stack, rhs->stack, lhs->sp * sizeof(*lhs->stack));
+}
+
+
+// builds of the same source differ in their instructions but not in what they leave behind
+static int compare(const evm_t *lhs, const evm_t *rhs, const char *exe, const char *name) {
+  if(lhs->sp != rhs->sp || lhs->fp != rhs->fp ||
+     memcmp(lhs->stack, rhs->stack, lhs->sp * sizeof(*lhs->stack))) {
+    fprintf(stderr, "%s: %s halted with a different stack\n", exe, name);
+    return -1;
+  }
+
+#if EVM_MEMORY_SUPPORT == 1
+  if(memcmp(evmSystemRam(lhs), evmSystemRam(rhs), 0x01000000U)) {
+    fprintf(stderr, "%s: %s halted with different memory\n", exe, name);
+    return -1;
+  }
+#endif
+
+  return 0;
+}
+
+
+// a program lowered back from its IR is another build of it, as long as it could be lifted
+static int lower(const evm_t *vm, const uint8_t *prog, uint32_t length, const char *exe,
+                 const char *name) {
+  evm_ir_t *ir = evmirInitialize(evmirAllocate());
+  uint8_t *lowered = NULL;
+  uint32_t size = 0;
+  char label[256];
+  int result = 0;
+  evm_t build;
+
+  snprintf(label, sizeof(label), "%s lowered from its IR", name);
+
+  if(!ir || evmirFromBuffer(ir, prog, length)) {
+    printf("%s: not lifted into the IR, skipped lowering it\n", name);
+  }
+  else if(evmirToBuffer(ir, &lowered, &size)) {
+    fprintf(stderr, "%s: %s was lifted into the IR but not lowered\n", exe, name);
+    result = -1;
+  }
+  else {
+    result = run(&build, lowered, size, exe, label) || compare(vm, &build, exe, label) ? -1 : 0;
+    evmFinalize(&build);
+  }
+
+  free(lowered);
+  evmirFree(evmirFinalize(ir));
+
+  return result;
+}
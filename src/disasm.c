@@ -1,29 +1,103 @@
 #include "evm/opcodes.h"
 #include "evm/disasm.h"
+#include "evm/cfg.h"
+#include "evm/ir.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+
+typedef enum disasm_output_e {
+  OUTPUT_TEXT,
+  OUTPUT_DOT,
+  OUTPUT_JSON,
+  OUTPUT_IR,
+} disasm_output_t;
+
+
+static int writeGraph(const evm_disassembler_t *disasm, disasm_output_t output) {
+  evm_cfg_t *cfg = evmcfgInitialize(evmcfgAllocate());
+  int result = -1;
+
+  if(cfg && !evmcfgFromDisassembler(cfg, disasm)) {
+    result = output == OUTPUT_DOT ? evmcfgToDot(cfg, stdout) : evmcfgToJson(cfg, stdout);
+  }
+
+  evmcfgFree(evmcfgFinalize(cfg));
+
+  return result;
+}
+
+
+static int writeIR(const evm_disassembler_t *disasm) {
+  evm_ir_t *ir = evmirInitialize(evmirAllocate());
+  int result = -1;
+
+  if(ir && !evmirFromDisassembler(ir, disasm)) {
+    result = evmirToFile(ir, stdout);
+  }
+
+  evmirFree(evmirFinalize(ir));
+
+  return result;
+}
 
 
 int main(int argc, char **argv) {
+  disasm_output_t output = OUTPUT_TEXT;
   int result = EXIT_SUCCESS;
   int arg;
 
   for(arg = 1; arg < argc; ++arg) {
-    FILE *src = fopen(argv[arg], "rb");
+    FILE *src;
+
+    // -g dot|json outputs the control flow graph rather than the instructions
+    if(argv[arg][0] == '-' && argv[arg][1] == 'g' && !argv[arg][2]) {
+      if(++arg < argc && !strcmp(argv[arg], "dot")) {
+        output = OUTPUT_DOT;
+      }
+      else if(arg < argc && !strcmp(argv[arg], "json")) {
+        output = OUTPUT_JSON;
+      }
+      else {
+        fprintf(stderr, "%s: invalid graph format\n", *argv);
+        result = EXIT_FAILURE;
+        break;
+      }
+      continue;
+    }
+
+    // -i outputs the instructions as values instead of stack operations
+    if(argv[arg][0] == '-' && argv[arg][1] == 'i' && !argv[arg][2]) {
+      output = OUTPUT_IR;
+      continue;
+    }
 
-    if(src) {
+    if((src = fopen(argv[arg], "rb"))) {
       evm_disassembler_t *disasm = evmdisInitialize(evmdisAllocate());
 
       if(disasm) {
-        if(!evmdisFromFile(disasm, src)) {
-          fprintf(stdout, "; generated from %s\n", argv[arg]);
-          evmdisToFile(disasm, stdout);
-        }
-        else {
+        if(evmdisFromFile(disasm, src)) {
           result = EXIT_FAILURE;
           fprintf(stderr, "%s: Failed to disassemble %s\n", *argv, argv[arg]);
         }
+        else if(output == OUTPUT_IR) {
+          if(writeIR(disasm)) {
+            result = EXIT_FAILURE;
+            fprintf(stderr, "%s: Failed to lift %s\n", *argv, argv[arg]);
+          }
+        }
+        else if(output != OUTPUT_TEXT) {
+          if(writeGraph(disasm, output)) {
+            result = EXIT_FAILURE;
+            fprintf(stderr, "%s: Failed to build the control flow graph of %s\n", *argv, argv[arg]);
+          }
+        }
+        else {
+          fprintf(stdout, "; generated from %s\n", argv[arg]);
+          evmdisToFile(disasm, stdout);
+        }
 
         evmdisFree(evmdisFinalize(disasm));
       }
@@ -40,4 +114,3 @@ int main(int argc, char **argv) {
 
   return result;
 }
-
@@ -2,17 +2,272 @@
 
 #include "evm.h"
 #include "evm/opcodes.h"
+#if EVM_REGISTER_SUPPORT == 1
+#  include "evm/reg.h"
+#endif
+#if EVM_TRACE_SUPPORT == 1
+#  include "evm/trace.h"
+#endif
 
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if EVM_MEMORY_SUPPORT == 1 && EVM_GUARD_PAGES == 1
+#  include <setjmp.h>
+#  include <signal.h>
+#  if EVM_THREAD_SUPPORT == 1
+#    include <pthread.h>
+#  endif
+#endif
+#if EVM_MEMORY_SUPPORT == 1 && EVM_FILE_MAPPING == 1
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#endif
+#if EVM_MEMORY_SUPPORT == 1 && (EVM_GUARD_PAGES == 1 || EVM_HUGE_PAGES == 1)
+#  define EVM_MAPPED_MEMORY (1) // system ram is mmap'ed rather than calloc'ed
+#else
+#  define EVM_MAPPED_MEMORY (0)
+#endif
+#if EVM_MAPPED_MEMORY == 1 || (EVM_MEMORY_SUPPORT == 1 && EVM_FILE_MAPPING == 1)
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
 
 
 #define EVM_CALLOC(NUM, SZ) calloc((NUM), (SZ))
 #define EVM_MALLOC(SZ)      malloc(SZ)
 #define EVM_FREE(PTR)       free(PTR)
 
+#if EVM_MEMORY_SUPPORT == 1
+#  define EVM_MEMORY_BYTES 0x01000000U
+#endif
+#if EVM_MEMORY_SUPPORT == 1 && EVM_HUGE_PAGES == 1
+#  define EVM_HUGE_PAGE_BYTES 0x00200000U
+#endif
+#if EVM_MEMORY_SUPPORT == 1 && EVM_GUARD_PAGES == 1
+// on either side of system ram, large enough for any access a handler can make past either end
+// and a whole number of pages up to 64K
+#  define EVM_GUARD_BYTES 0x00010000U
+#else
+#  define EVM_GUARD_BYTES 0U
+#endif
+
+
+#if EVM_MEMORY_SUPPORT == 1 && EVM_HUGE_PAGES == 1
+static int evmHugePages = 1;
+#endif
+
+
+#if EVM_MEMORY_SUPPORT == 1 && EVM_GUARD_PAGES == 1
+// the run that armed the innermost trap on this thread, a fault between its bounds unwinds to it
+typedef struct evm_guard_trap_s {
+  sigjmp_buf                env;
+  const uint8_t            *lower; // first byte of the leading guard
+  const uint8_t            *upper; // one past the last byte of the trailing guard
+  const uint8_t            *fault;
+  struct evm_guard_trap_s *outer; // the trap to restore when this one is disarmed
+  // the registers of the last instruction to touch memory, which is where a fault leaves the VM
+  volatile uint32_t         ip;
+  volatile uint32_t         flags;
+  volatile uint32_t         segment;
+  volatile uint16_t         sp;
+  volatile uint16_t         fp;
+  volatile int              noted;
+} evm_guard_trap_t;
+
+static __thread evm_guard_trap_t *evmGuardTrap = NULL;
+static struct sigaction evmGuardPrevious;
+#  if EVM_THREAD_SUPPORT == 1
+static pthread_once_t evmGuardInstalled = PTHREAD_ONCE_INIT;
+#  else
+static char evmGuardInstalled = 0;
+#  endif
+
+
+static void evmGuardFault(int sig, siginfo_t *info, void *context) {
+  evm_guard_trap_t *trap = evmGuardTrap;
+  const uint8_t *addr = (const uint8_t *) info->si_addr;
+
+  if(trap && trap->lower <= addr && addr < trap->upper) {
+    trap->fault = addr;
+    siglongjmp(trap->env, 1);
+  }
+
+  // not an access by a running VM, so it is someone else's fault to handle
+  if(evmGuardPrevious.sa_flags & SA_SIGINFO) {
+    evmGuardPrevious.sa_sigaction(sig, info, context);
+  }
+  else if(evmGuardPrevious.sa_handler != SIG_DFL && evmGuardPrevious.sa_handler != SIG_IGN) {
+    evmGuardPrevious.sa_handler(sig);
+  }
+  else {
+    (void) signal(sig, SIG_DFL); // the faulting access is retried and takes the process down
+  }
+}
+
+
+static void evmGuardHandler(void) {
+  struct sigaction action;
+
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = &evmGuardFault;
+  action.sa_flags = SA_SIGINFO | SA_NODEFER; // unwinding never returns to unblock the signal
+  sigemptyset(&action.sa_mask);
+  if(sigaction(SIGSEGV, &action, &evmGuardPrevious)) {
+    EVM_ERROR("Unable to trap memory faults");
+  }
+}
+
+
+// every thread mapping memory waits for the handler, so no VM runs before its faults are trapped
+static void evmGuardInstall(void) {
+#  if EVM_THREAD_SUPPORT == 1
+  (void) pthread_once(&evmGuardInstalled, &evmGuardHandler);
+#  else
+  if(!evmGuardInstalled) {
+    evmGuardInstalled = 1;
+    evmGuardHandler();
+  }
+#  endif
+}
+
+
+// runs nested on the same memory (trace steps, register fallbacks) share the outermost trap
+static int evmGuardArm(evm_guard_trap_t *trap, const evm_t *vm) {
+  trap->outer = evmGuardTrap;
+  if(vm->mem == NULL || (trap->outer && trap->outer->lower == vm->mem - EVM_GUARD_BYTES)) {
+    return 0;
+  }
+
+  trap->lower = vm->mem - EVM_GUARD_BYTES;
+  trap->upper = vm->mem + EVM_MEMORY_BYTES + EVM_GUARD_BYTES;
+  trap->fault = NULL;
+  trap->noted = 0;
+  evmGuardTrap = trap;
+  return 1;
+}
+
+
+static void evmGuardDisarm(evm_guard_trap_t *trap) {
+  evmGuardTrap = trap->outer;
+}
+
+
+// the stack has been written in place all along, only the registers are put back
+static void evmGuardRestore(evm_t *vm, const evm_guard_trap_t *trap) {
+  if(trap->noted) {
+    vm->ip = trap->ip;
+    vm->flags = trap->flags;
+    vm->segment = trap->segment;
+    vm->sp = trap->sp;
+    vm->fp = trap->fp;
+  }
+}
+
+
+// taken before an instruction touches memory, by whichever run is stepping it
+#  define EVM_GUARD_NOTE(VM) \
+  do { \
+    evm_guard_trap_t *_trap = evmGuardTrap; \
+    if(_trap && _trap->lower + EVM_GUARD_BYTES == (VM).mem) { \
+      _trap->ip = (VM).ip; \
+      _trap->flags = (VM).flags; \
+      _trap->segment = (VM).segment; \
+      _trap->sp = (VM).sp; \
+      _trap->fp = (VM).fp; \
+      _trap->noted = 1; \
+    } \
+  } while(0)
+#else
+#  define EVM_GUARD_NOTE(VM) ((void) 0)
+#endif
+
+
+#if EVM_MEMORY_SUPPORT == 1 && EVM_HUGE_PAGES == 1
+int evmUseHugePages(int enable) {
+  int previous = evmHugePages;
+  evmHugePages = !!enable;
+  return previous;
+}
+
+
+// madvise accepts the advice even when the kernel has been told never to act on it
+static int evmTransparentHugePages(void) {
+  char mode[128] = "";
+  FILE *fp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+  if(fp) {
+    if(!fgets(mode, sizeof(mode), fp)) { mode[0] = '\0'; }
+    fclose(fp);
+  }
+
+  return strstr(mode, "[never]") == NULL;
+}
+#endif
+
+
+#if EVM_MAPPED_MEMORY == 1
+static void evmUnmapMemory(uint8_t *mem) {
+  (void) munmap(mem - EVM_GUARD_BYTES, EVM_MEMORY_BYTES + 2U * EVM_GUARD_BYTES);
+}
+
+
+// huge pages are tried first where they are wanted, falling back to transparent huge pages and
+// then ordinary ones
+static uint8_t *evmMapMemory(evm_t *vm) {
+  size_t align = 1U, total;
+  uint8_t *base, *mem;
+
+#  if EVM_GUARD_PAGES == 1
+  evmGuardInstall();
+#  endif
+#  if EVM_HUGE_PAGES == 1
+  if(evmHugePages) { align = EVM_HUGE_PAGE_BYTES; }
+#  endif
+
+  // reserve enough to line ram up on a huge page, then give back what the alignment didn't use
+  total = EVM_MEMORY_BYTES + 2U * EVM_GUARD_BYTES + align - 1U;
+  base = (uint8_t *) mmap(NULL, total, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                          -1, 0);
+  if(base == MAP_FAILED) {
+    return NULL;
+  }
+
+  mem = (uint8_t *) (((uintptr_t) base + EVM_GUARD_BYTES + align - 1U) & ~(uintptr_t) (align - 1U));
+  if(mem - EVM_GUARD_BYTES > base) {
+    (void) munmap(base, (size_t) (mem - EVM_GUARD_BYTES - base));
+  }
+  if(mem + EVM_MEMORY_BYTES + EVM_GUARD_BYTES < base + total) {
+    (void) munmap(mem + EVM_MEMORY_BYTES + EVM_GUARD_BYTES,
+                  (size_t) (base + total - (mem + EVM_MEMORY_BYTES + EVM_GUARD_BYTES)));
+  }
+
+#  if EVM_HUGE_PAGES == 1 && defined(MAP_HUGETLB)
+  if(evmHugePages && mmap(mem, EVM_MEMORY_BYTES, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0) == mem) {
+    vm->backing = EVM_BACKING_HUGE_PAGES;
+    return mem;
+  }
+#  endif
+
+  // only the memory between the guards is accessible, and like calloc it starts zeroed, mapped
+  // afresh in case a failed attempt at huge pages took the reservation with it
+  if(mmap(mem, EVM_MEMORY_BYTES, PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0) != mem) {
+    evmUnmapMemory(mem);
+    return NULL;
+  }
+
+  vm->backing = EVM_BACKING_PAGES;
+#  if EVM_HUGE_PAGES == 1 && defined(MADV_HUGEPAGE)
+  if(evmHugePages && !madvise(mem, EVM_MEMORY_BYTES, MADV_HUGEPAGE) && evmTransparentHugePages()) {
+    vm->backing = EVM_BACKING_TRANSPARENT_HUGE_PAGES;
+  }
+#  endif
+  return mem;
+}
+#endif
+
 
 evm_t *evmAllocate() {
   evm_t *retVal;
@@ -33,6 +288,7 @@ evm_t *evmInitialize(evm_t *vm, void *user, uint16_t stackSize) {
   if(vm) {
     vm->ip = 0;
     vm->sp = 0;
+    vm->fp = 0;
     vm->maxProgram = 0;
     vm->maxStack = stackSize;
 #if EVM_STATIC_STACK == 1
@@ -42,8 +298,20 @@ evm_t *evmInitialize(evm_t *vm, void *user, uint16_t stackSize) {
 #endif
     vm->program = NULL;
     vm->env = user;
+#if EVM_REGISTER_SUPPORT == 1
+    vm->regs = NULL;
+#endif
+#if EVM_TRACE_SUPPORT == 1
+    vm->traces = NULL;
+#endif
 #if EVM_MEMORY_SUPPORT == 1
-    vm->mem = (uint8_t *) EVM_CALLOC(0x01000000, sizeof(uint8_t));
+    vm->backing = EVM_BACKING_HEAP;
+#  if EVM_MAPPED_MEMORY == 1
+    vm->mem = evmMapMemory(vm);
+#  else
+    vm->mem = (uint8_t *) EVM_CALLOC(EVM_MEMORY_BYTES, sizeof(uint8_t));
+#  endif
+    vm->segments = NULL;
     EVM_DEBUGF(
       "eVM(%p) { stack: %p user: %p prog: %p mem: %p }",
       vm, vm->stack, vm->env, vm->program, vm->mem
@@ -67,8 +335,19 @@ evm_t *evmFinalize(evm_t *vm) {
     if(vm->stack  ) { EVM_FREE((void *) vm->stack);   }
 #endif
     if(vm->program) { EVM_FREE((void *) vm->program); }
-#if EVM_MEMORY_SUPPORT == 1
+#if EVM_MAPPED_MEMORY == 1
+    if(vm->mem) { evmUnmapMemory(vm->mem); }
+#elif EVM_MEMORY_SUPPORT == 1
     if(vm->mem) { EVM_FREE((void *) vm->mem); }
+#endif
+#if EVM_MEMORY_SUPPORT == 1
+    (void) evmUnmapSegments(vm, 0, 256U); // releases any files mapped along with the table
+#endif
+#if EVM_REGISTER_SUPPORT == 1
+    evmregFree(vm->regs);
+#endif
+#if EVM_TRACE_SUPPORT == 1
+    evmtraceFree(vm->traces);
 #endif
     memset(vm, 0, sizeof(evm_t));
     vm->flags |= EVM_HALTED;
@@ -124,6 +403,22 @@ int evmSetProgram(evm_t *vm, const uint8_t *prog, uint32_t length) {
     vm->maxProgram = length;
     vm->flags &= ~(EVM_HALTED | EVM_YIELD); // clear the halt and yield flags on success
 
+#if EVM_REGISTER_SUPPORT == 1
+    // a program that can't be translated is interpreted as it is
+    evmregFree(vm->regs);
+#  if EVM_STATIC_PROGRAM == 1
+    vm->regs = evmregTranslate(vm->program, length);
+#  else
+    vm->regs = evmregTranslate(vm->program, length + 1U);
+#  endif
+#endif
+
+#if EVM_TRACE_SUPPORT == 1
+    // loops are counted and traced afresh for every program
+    evmtraceFree(vm->traces);
+    vm->traces = evmtraceAllocate();
+#endif
+
 #if EVM_MEMORY_SUPPORT == 1
     EVM_DEBUGF(
       "eVM(%p) { stack: %p user: %p prog: %p mem: %p }",
@@ -199,6 +494,50 @@ static int32_t evmStackUnderflow(evm_t *vm) {
 }
 
 
+static int32_t evmDivisionFault(evm_t *vm) {
+  EVM_TRACEF("Enter %s", __FUNCTION__);
+  if(vm) {
+    vm->flags |= EVM_HALTED;
+    EVM_ERRORF("Division fault: sp(%04X) ip(%08X)", vm->sp, vm->ip);
+  }
+
+  EVM_TRACEF("Exit %s", __FUNCTION__);
+  return -1;
+}
+
+
+#if EVM_MEMORY_SUPPORT == 1
+static int32_t evmSegmentFault(evm_t *vm, uint32_t addr, int write) {
+  EVM_TRACEF("Enter %s", __FUNCTION__);
+  if(vm) {
+    vm->flags |= EVM_HALTED;
+    EVM_ERRORF("Segment fault: %s addr(%06X) ip(%08X)", write ? "write" : "read", addr, vm->ip);
+  }
+  (void) addr;
+  (void) write;
+
+  EVM_TRACEF("Exit %s", __FUNCTION__);
+  return -1;
+}
+#endif
+
+
+#if EVM_MEMORY_SUPPORT == 1 && EVM_GUARD_PAGES == 1
+// the VM halts at the instruction whose access landed in a guard
+static int32_t evmMemoryFault(evm_t *vm, const uint8_t *fault) {
+  EVM_TRACEF("Enter %s", __FUNCTION__);
+  if(vm) {
+    vm->flags |= EVM_HALTED;
+    EVM_ERRORF("Memory fault: addr(%+ld) ip(%08X)", (long) (fault - vm->mem), vm->ip);
+  }
+  (void) fault;
+
+  EVM_TRACEF("Exit %s", __FUNCTION__);
+  return -1;
+}
+#endif
+
+
 static int32_t evmIllegalInstruction(evm_t *vm) {
   EVM_TRACEF("Enter %s", __FUNCTION__);
   if(vm) {
@@ -237,6 +576,193 @@ uint32_t evmEffectiveAddress(const evm_t *vm, uint16_t addr) {
   EVM_TRACEF("Exit %s", __FUNCTION__);
   return ptr;
 }
+
+
+// a run of segments backed by one buffer, addresses in [lower, upper) land at base[addr - lower]
+typedef struct evm_segment_s {
+  uint8_t  *base;
+  uint32_t  lower;
+  uint32_t  upper;
+  uint8_t   host;     // backed by a host buffer rather than system ram
+  uint8_t   writable;
+  uint8_t   file;     // the buffer was mapped from a file and is unmapped with its last segment
+} evm_segment_t;
+
+typedef struct evm_segment_table_s {
+  evm_segment_t entries[256];
+  uint8_t       scratch[16]; // the target of an access that faulted, as wide as a vector
+} evm_segment_table_t;
+
+
+// system ram fills the gaps between host buffers, each gap bounded by the mappings around it so
+// an access can't run from ram into a neighbouring buffer
+static uint32_t evmSegmentsRebuild(evm_segment_table_t *table, uint8_t *mem) {
+  uint32_t idx = 0, end, mapped = 0;
+
+  while(idx < 256U) {
+    if(table->entries[idx].host) {
+      ++mapped;
+      ++idx;
+      continue;
+    }
+
+    for(end = idx; end < 256U && !table->entries[end].host; ++end) { }
+    for(; idx < end; ++idx) {
+      table->entries[idx].base = mem + (idx << 16);
+      table->entries[idx].lower = idx << 16;
+      table->entries[idx].upper = end << 16;
+      table->entries[idx].writable = 1;
+    }
+  }
+
+  return mapped;
+}
+
+
+// segments given back to ram, a mapped file goes once none of its segments are left
+static void evmSegmentsRelease(evm_segment_table_t *table, uint32_t first, uint32_t count) {
+  uint32_t idx;
+#  if EVM_FILE_MAPPING == 1
+  uint32_t other;
+#  endif
+
+  for(idx = first; idx < first + count; ++idx) {
+    table->entries[idx].host = 0;
+  }
+
+#  if EVM_FILE_MAPPING == 1
+  for(idx = first; idx < first + count; ++idx) {
+    evm_segment_t *seg = &table->entries[idx];
+    int used = 0;
+    if(!seg->file) { continue; }
+
+    for(other = 0; other < 256U; ++other) {
+      used |= table->entries[other].host && table->entries[other].base == seg->base;
+    }
+    if(!used) {
+      (void) munmap(seg->base, seg->upper - seg->lower);
+    }
+
+    // the rest of the range shares the mapping, and is already accounted for
+    for(other = idx + 1U; other < first + count; ++other) {
+      if(table->entries[other].base == seg->base) { table->entries[other].file = 0; }
+    }
+    seg->file = 0;
+  }
+#  endif
+}
+
+
+static int evmSegmentsMap(evm_t *vm, uint8_t first, uint8_t *buffer, uint32_t length,
+                          int writable, int file) {
+  uint32_t count, idx;
+  // in 64 bits, as a length near 4 GiB would wrap the rounding and the sum to a small range
+  if(!vm || !vm->mem || !buffer || !length ||
+     (uint64_t) length > ((uint64_t) (256U - first) << 16)) {
+    return -1;
+  }
+  count = (uint32_t) (((uint64_t) length + 0xFFFFU) >> 16);
+
+  if(vm->segments == NULL) {
+    vm->segments = (evm_segment_table_t *) EVM_CALLOC(1, sizeof(evm_segment_table_t));
+    if(vm->segments == NULL) {
+      return -1;
+    }
+  }
+
+  evmSegmentsRelease(vm->segments, first, count);
+  for(idx = first; idx < first + count; ++idx) {
+    vm->segments->entries[idx].base = buffer;
+    vm->segments->entries[idx].lower = (uint32_t) first << 16;
+    vm->segments->entries[idx].upper = (uint32_t) (((uint64_t) first << 16) + length);
+    vm->segments->entries[idx].host = 1;
+    vm->segments->entries[idx].writable = !!writable;
+    vm->segments->entries[idx].file = !!file;
+  }
+  (void) evmSegmentsRebuild(vm->segments, vm->mem);
+  EVM_DEBUGF("eVM(%p) segments %02X-%02X mapped onto %p", vm, first, first + count - 1U, buffer);
+  return 0;
+}
+
+
+int evmMapSegments(evm_t *vm, uint8_t first, void *buffer, uint32_t length, int writable) {
+  int result;
+  EVM_TRACEF("Enter %s", __FUNCTION__);
+  result = evmSegmentsMap(vm, first, (uint8_t *) buffer, length, writable, 0);
+  EVM_TRACEF("Exit %s", __FUNCTION__);
+  return result;
+}
+
+
+int evmUnmapSegments(evm_t *vm, uint8_t first, uint32_t count) {
+  EVM_TRACEF("Enter %s", __FUNCTION__);
+  if(vm && first + count <= 256U) {
+    if(vm->segments) {
+      evmSegmentsRelease(vm->segments, first, count);
+
+      // with nothing left mapped the handlers go back to indexing system ram directly
+      if(evmSegmentsRebuild(vm->segments, vm->mem) == 0) {
+        EVM_FREE(vm->segments);
+        vm->segments = NULL;
+      }
+    }
+    EVM_TRACEF("Exit %s", __FUNCTION__);
+    return 0;
+  }
+
+  EVM_TRACEF("Exit %s", __FUNCTION__);
+  return -1;
+}
+
+
+#  if EVM_FILE_MAPPING == 1
+int evmMapMemoryFile(evm_t *vm, uint8_t first, const char *path, int flags) {
+  int writable = !(flags & EVM_MAP_READ_ONLY), fd;
+  struct stat info;
+  uint32_t length;
+  void *data;
+  EVM_TRACEF("Enter %s", __FUNCTION__);
+  if(vm && vm->mem && path) {
+    // only a shared mapping the VM writes to needs the file itself to be writable
+    fd = open(path, writable && (flags & EVM_MAP_SHARED) ? O_RDWR : O_RDONLY);
+    if(fd < 0) {
+      EVM_ERRORF("Unable to open %s for mapping", path);
+      EVM_TRACEF("Exit %s", __FUNCTION__);
+      return -1;
+    }
+
+    // whatever of the file fits above the first segment
+    if(fstat(fd, &info) || info.st_size <= 0) {
+      (void) close(fd);
+      EVM_TRACEF("Exit %s", __FUNCTION__);
+      return -1;
+    }
+    length = EVM_MEMORY_BYTES - ((uint32_t) first << 16);
+    length = (uint64_t) info.st_size < length ? (uint32_t) info.st_size : length;
+
+    data = mmap(NULL, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                flags & EVM_MAP_SHARED ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    (void) close(fd); // the mapping holds its own reference to the file
+    if(data == MAP_FAILED) {
+      EVM_ERRORF("Unable to map %s", path);
+      EVM_TRACEF("Exit %s", __FUNCTION__);
+      return -1;
+    }
+
+    if(evmSegmentsMap(vm, first, (uint8_t *) data, length, writable, 1)) {
+      (void) munmap(data, length);
+      EVM_TRACEF("Exit %s", __FUNCTION__);
+      return -1;
+    }
+
+    EVM_TRACEF("Exit %s", __FUNCTION__);
+    return 0;
+  }
+
+  EVM_TRACEF("Exit %s", __FUNCTION__);
+  return -1;
+}
+#  endif
 #endif
 
 
@@ -343,6 +869,19 @@ int evmPop(evm_t *vm) {
   } while(0)
 
 
+#if EVM_TRACE_SUPPORT == 1
+// a backward branch may enter the trace of a hot loop, which runs some of the operations left
+#  define EVM_BRANCH(VM, DELTA) \
+  do { \
+    const int32_t _delta = (DELTA); \
+    (VM).ip += _delta; \
+    if(_delta < 0 && ops < maxOps) { ops += evmtraceLoop(&(VM), maxOps - ops); } \
+  } while(0)
+#else
+#  define EVM_BRANCH(VM, DELTA) ((VM).ip += (DELTA))
+#endif
+
+
 #define EVM_BIN_OP_I(VM, OP) \
   do { \
     if(local.sp < 2U) { (void) evmStackUnderflow(&local); } \
@@ -365,6 +904,40 @@ int evmPop(evm_t *vm) {
   } while(0)
 
 
+// the same for operations without an operator of their own
+#define EVM_BIN_FN_I(VM, FN) \
+  do { \
+    if((VM).sp < 2U) { (void) evmStackUnderflow(&(VM)); } \
+    else { \
+      EVM_TRACEF("BINARY FN (" #FN " %d %d)", EVM_TOP_I(VM), EVM_STACK_I(VM, 1)); \
+      EVM_STACK_I(VM, 1) = FN(EVM_TOP_I(VM), EVM_STACK_I(VM, 1)); \
+      --(VM).sp; \
+    } \
+  } while(0)
+
+
+#define EVM_BIN_FN_F(VM, FN) \
+  do { \
+    if((VM).sp < 2U) { (void) evmStackUnderflow(&(VM)); } \
+    else { \
+      EVM_TRACEF("BINARY FN (" #FN " %f %f)", EVM_TOP_F(VM), EVM_STACK_F(VM, 1)); \
+      EVM_STACK_F(VM, 1) = FN(EVM_TOP_F(VM), EVM_STACK_F(VM, 1)); \
+      --(VM).sp; \
+    } \
+  } while(0)
+
+
+// the immediate forms combine the top of the stack with the value following the opcode
+#define EVM_IMM_OP_I(VM, OP, IMM) \
+  do { \
+    if(!(VM).sp) { (void) evmStackUnderflow(&(VM)); } \
+    else { \
+      EVM_TRACEF("IMMEDIATE OP (%d " #OP " %d)", EVM_TOP_I(VM), (IMM)); \
+      EVM_TOP_I(VM) = EVM_TOP_I(VM) OP (IMM); \
+    } \
+  } while(0)
+
+
 #define EVM_STACK_I(VM, DEPTH) ((VM).stack[(VM).sp - ((DEPTH) + 1U)])
 #define EVM_STACK_FP(VM, DEPTH) ((float *) &EVM_STACK_I(VM, DEPTH))
 #define EVM_STACK_F(VM, DEPTH) (*EVM_STACK_FP(VM, DEPTH))
@@ -374,16 +947,100 @@ int evmPop(evm_t *vm) {
 #define EVM_TOP_F(VM) EVM_STACK_F(VM, 0U)
 
 
+// ENTER saves the frame pointer above the return address and zeroes the locals of the new frame
+static void evmEnterFrame(evm_t *vm, uint32_t locals) {
+  if((uint32_t) vm->sp + 1U + locals > vm->maxStack) { (void) evmStackOverflow(vm); }
+  else {
+    vm->stack[vm->sp++] = vm->fp;
+    vm->fp = vm->sp;
+    memset(&vm->stack[vm->sp], 0, locals * sizeof(*vm->stack));
+    vm->sp = (uint16_t) (vm->sp + locals);
+  }
+}
+
+
+// LEAVE drops the frame and the saved frame pointer, moving the values kept down in their place
+static void evmLeaveFrame(evm_t *vm, uint32_t keep) {
+  if(!vm->fp || (uint32_t) vm->fp + keep > vm->sp) { (void) evmStackUnderflow(vm); }
+  else {
+    uint16_t fp = (uint16_t) vm->stack[vm->fp - 1U];
+    memmove(&vm->stack[vm->fp - 1U], &vm->stack[vm->sp - keep], keep * sizeof(*vm->stack));
+    vm->sp = (uint16_t) (vm->fp - 1U + keep);
+    vm->fp = fp;
+  }
+}
+
+
+// the stack index of a local, or of an argument below the return address and saved frame pointer,
+// negative when it isn't on the stack
+static int32_t evmLocalSlot(const evm_t *vm, int32_t index) {
+  int32_t slot = (int32_t) vm->fp + index;
+  return slot < (int32_t) vm->sp ? slot : -1;
+}
+
+
+static int32_t evmArgumentSlot(const evm_t *vm, int32_t index) {
+  int32_t slot = (int32_t) vm->fp - index - 3;
+  return slot < (int32_t) vm->sp ? slot : -1;
+}
+
+
+static void evmLoadSlot(evm_t *vm, int32_t slot) {
+  if(slot < 0) { (void) evmStackUnderflow(vm); }
+  else { (void) evmPush(vm, vm->stack[slot]); }
+}
+
+
+// the value stored is popped so it has to be above the slot
+static void evmStoreSlot(evm_t *vm, int32_t slot) {
+  if(slot < 0 || slot + 1 >= (int32_t) vm->sp) { (void) evmStackUnderflow(vm); }
+  else { vm->stack[slot] = vm->stack[--vm->sp]; }
+}
+
+
+// set the flags as CMP would for the stack top against a value, report if any in the mask are set
+static int evmCompareTop(evm_t *vm, int32_t val, uint32_t mask) {
+  int32_t top = vm->stack[vm->sp - 1U];
+
+  vm->flags &= ~(EVM_LESS | EVM_EQUAL | EVM_GREATER);
+  if(top < val) {       vm->flags |= EVM_LESS;    }
+  else if(top == val) { vm->flags |= EVM_EQUAL;   }
+  else {                vm->flags |= EVM_GREATER; }
+
+  return (vm->flags & mask) != 0;
+}
+
+
+// rotates use the low five bits of the count, written the way compilers turn into one instruction
+static int32_t evmRotateLeft(int32_t value, int32_t count) {
+  const uint32_t bits = (uint32_t) count & 0x1FU;
+  return (int32_t) (((uint32_t) value << bits) | ((uint32_t) value >> ((32U - bits) & 0x1FU)));
+}
+
+
+static int32_t evmRotateRight(int32_t value, int32_t count) {
+  return evmRotateLeft(value, (int32_t) (0U - (uint32_t) count));
+}
+
+
+static int32_t evmMinimum(int32_t lhs, int32_t rhs) { return lhs < rhs ? lhs : rhs; }
+static int32_t evmMaximum(int32_t lhs, int32_t rhs) { return lhs > rhs ? lhs : rhs; }
+#if EVM_FLOAT_SUPPORT == 1
+static float   evmMinimumf(float lhs, float rhs)    { return lhs < rhs ? lhs : rhs; }
+static float   evmMaximumf(float lhs, float rhs)    { return lhs > rhs ? lhs : rhs; }
+#endif
+
+
 #if EVM_MEMORY_SUPPORT == 1
 static void evmSaveInt8(uint8_t *src, int32_t val) {
    *(int8_t *) src = (int8_t) val;
 }
+#endif
 
 
 static int32_t evmLoadUint8(const uint8_t *src) {
   return (int32_t) *src;
 }
-#endif
 
 
 static int32_t evmLoadInt8(const uint8_t *src) {
@@ -400,16 +1057,16 @@ static void evmSaveInt16(uint8_t *src, int32_t val) {
   src[1] = (val >> 8) & 0xFF;
 #endif
 }
+#endif
 
 
 static int32_t evmLoadUint16(const uint8_t *src) {
 #if EVM_UNALIGNED_READS == 1
   return (int32_t) *(const uint16_t *) src;
 #else
-  return (int32_t) (((uint32_t) src[0]) | (((uint32_t) src[1]) << 8)) >> 16;
+  return (int32_t) (((uint32_t) src[0]) | (((uint32_t) src[1]) << 8));
 #endif
 }
-#endif
 
 
 static int32_t evmLoadInt16(const uint8_t *src) {
@@ -459,21 +1116,255 @@ static void evmSaveInt32(uint8_t *src, int32_t val) {
   src[3] = (val >> 24) & 0xFF;
 #endif
 }
+
+
+// addresses taken from the stack by the block operations are relative to the active segment
+static uint32_t evmBlockAddress(const evm_t *vm, int32_t addr) {
+  return (vm->segment + (uint32_t) addr) & (EVM_MEMORY_BYTES - 1U);
+}
+
+
+// a negative length is an empty block
+static uint32_t evmBlockLength(int32_t len) {
+  return len > 0 ? (uint32_t) len : 0;
+}
+
+
+// where an access of the given width lands once the host has mapped buffers over segments, an
+// access that runs off the end of its mapping or writes to a read only one halts the VM and is
+// redirected to scratch space
+static uint8_t *evmSegmentAddress(evm_t *vm, uint32_t addr, uint32_t width, int write) {
+  const evm_segment_t *seg = &vm->segments->entries[(addr >> 16) & 0xFF];
+  if(addr + width > seg->upper || (write && !seg->writable)) {
+    (void) evmSegmentFault(vm, addr, write);
+    return vm->segments->scratch;
+  }
+
+  return seg->base + (addr - seg->lower);
+}
+
+
+// system ram is indexed directly until something is mapped over it
+static inline uint8_t *evmMemoryAddress(evm_t *vm, uint32_t addr, uint32_t width, int write) {
+  return vm->segments ? evmSegmentAddress(vm, addr, width, write) : &vm->mem[addr];
+}
+
+
+// the same for a block, which faults as a whole when it runs past the end of memory or of its
+// mapping so nothing is copied, and leaves the length at zero for the rest of the operation
+static uint8_t *evmMemoryBlock(evm_t *vm, uint32_t addr, uint32_t *len, int write) {
+  const evm_segment_t *seg;
+  if(*len == 0) { return &vm->mem[addr]; }
+
+  if(*len > EVM_MEMORY_BYTES - addr) {
+    (void) evmSegmentFault(vm, addr, write);
+    *len = 0;
+    return &vm->mem[addr];
+  }
+  if(vm->segments == NULL) { return &vm->mem[addr]; }
+
+  seg = &vm->segments->entries[(addr >> 16) & 0xFF];
+  if(addr >= seg->upper || *len > seg->upper - addr || (write && !seg->writable)) {
+    (void) evmSegmentFault(vm, addr, write);
+    *len = 0;
+    return vm->segments->scratch;
+  }
+
+  return seg->base + (addr - seg->lower);
+}
+
+
+// four lanes the compiler keeps in a single SIMD register where the target has them
+typedef int32_t  evm_vec_i_t __attribute__((vector_size(16)));
+typedef uint32_t evm_vec_u_t __attribute__((vector_size(16)));
+#  if EVM_FLOAT_SUPPORT == 1
+typedef float    evm_vec_f_t __attribute__((vector_size(16)));
+#  endif
+
+#  define EVM_VEC_BYTES ((uint32_t) sizeof(evm_vec_i_t))
+
+
+// an access running off the end of system ram lands in the trailing guard and faults, without
+// guard pages it halts the VM and is redirected to scratch space instead
+static uint8_t *evmWideAddress(evm_t *vm, uint32_t addr, uint32_t width, int write) {
+#  if EVM_GUARD_PAGES == 0
+  static __thread uint8_t scratch[EVM_VEC_BYTES];
+  if(!vm->segments && addr > EVM_MEMORY_BYTES - width) {
+    (void) evmSegmentFault(vm, addr, write);
+    return scratch;
+  }
+#  endif
+
+  return evmMemoryAddress(vm, addr, width, write);
+}
+
+
+// like the block operations, addresses are relative to the active segment
+static uint8_t *evmVectorAddress(evm_t *vm, int32_t addr, int write) {
+  return evmWideAddress(vm, evmBlockAddress(vm, addr), EVM_VEC_BYTES, write);
+}
+
+
+// vectors are stored as four little endian lanes
+static evm_vec_u_t evmLoadVector(const uint8_t *src) {
+  evm_vec_u_t vec;
+  memcpy(&vec, src, sizeof(vec));
+#  if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  vec = (evm_vec_u_t) {
+    __builtin_bswap32(vec[0]), __builtin_bswap32(vec[1]),
+    __builtin_bswap32(vec[2]), __builtin_bswap32(vec[3])
+  };
+#  endif
+  return vec;
+}
+
+
+static void evmSaveVector(uint8_t *dst, evm_vec_u_t vec) {
+#  if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  vec = (evm_vec_u_t) {
+    __builtin_bswap32(vec[0]), __builtin_bswap32(vec[1]),
+    __builtin_bswap32(vec[2]), __builtin_bswap32(vec[3])
+  };
+#  endif
+  memcpy(dst, &vec, sizeof(vec));
+}
+
+
+// the lane wise vector operations, integer arithmetic wraps around like the scalar operations
+static void evmVectorOp(uint8_t opcode, uint8_t *dst, const uint8_t *lhs, const uint8_t *rhs) {
+  evm_vec_u_t a = evmLoadVector(lhs), b = evmLoadVector(rhs), r;
+  evm_vec_i_t ia = (evm_vec_i_t) a, ib = (evm_vec_i_t) b;
+#  if EVM_FLOAT_SUPPORT == 1
+  evm_vec_f_t fa = (evm_vec_f_t) a, fb = (evm_vec_f_t) b;
+#  endif
+
+  switch(opcode) {
+    case OP_VADD_I: r = a + b; break;
+    case OP_VSUB_I: r = a - b; break;
+    case OP_VMUL_I: r = a * b; break;
+    case OP_VMIN_I: r = (a & (evm_vec_u_t) (ia < ib)) | (b & ~(evm_vec_u_t) (ia < ib)); break;
+    case OP_VMAX_I: r = (a & (evm_vec_u_t) (ia > ib)) | (b & ~(evm_vec_u_t) (ia > ib)); break;
+#  if EVM_FLOAT_SUPPORT == 1
+    case OP_VADD_F: r = (evm_vec_u_t) (fa + fb); break;
+    case OP_VSUB_F: r = (evm_vec_u_t) (fa - fb); break;
+    case OP_VMUL_F: r = (evm_vec_u_t) (fa * fb); break;
+    case OP_VMIN_F: r = (a & (evm_vec_u_t) (fa < fb)) | (b & ~(evm_vec_u_t) (fa < fb)); break;
+    case OP_VMAX_F: r = (a & (evm_vec_u_t) (fa > fb)) | (b & ~(evm_vec_u_t) (fa > fb)); break;
+#  endif
+
+    default:
+      return;
+  }
+
+  evmSaveVector(dst, r);
+}
+
+
+static int32_t evmVectorDotI(const uint8_t *lhs, const uint8_t *rhs) {
+  evm_vec_u_t r = evmLoadVector(lhs) * evmLoadVector(rhs);
+  return (int32_t) (r[0] + r[1] + r[2] + r[3]);
+}
+
+
+#  if EVM_FLOAT_SUPPORT == 1
+static float evmVectorDotF(const uint8_t *lhs, const uint8_t *rhs) {
+  evm_vec_f_t r = (evm_vec_f_t) evmLoadVector(lhs) * (evm_vec_f_t) evmLoadVector(rhs);
+  return ((r[0] + r[1]) + r[2]) + r[3];
+}
+#  endif
+#endif
+
+static int32_t evmLoadInt32(const uint8_t *src) {
+#if EVM_UNALIGNED_READS == 1
+  return *(const int32_t *) src;
+#else
+  return  ((int32_t) src[0]      ) | (((int32_t) src[1]) <<  8) |
+          ((int32_t) src[2] << 16) | (((int32_t) src[3]) << 24);
+#endif
+}
+
+
+#if EVM_MEMORY_SUPPORT == 1
+// like the vector operations, an indexed access running off the end of memory faults
+static uint8_t *evmIndexedAddress(evm_t *vm, int32_t base, int32_t index, uint8_t scale,
+                                  uint32_t width, int write) {
+  uint32_t ptr = (uint32_t) index << (scale & 3U);
+  ptr = evmBlockAddress(vm, (int32_t) (ptr + (uint32_t) base));
+  return evmWideAddress(vm, ptr, width, write);
+}
+
+
+// the element width and extension come from the low three bits of the opcode, shared by both forms
+static int32_t evmIndexedRead(evm_t *vm, uint8_t opcode, int32_t base, int32_t index,
+                              uint8_t scale) {
+  switch(FAM_INDEX | (opcode & 0x07)) {
+    case OP_SXREAD8:   return evmLoadInt8(evmIndexedAddress(vm, base, index, scale, 1U, 0));
+    case OP_SXREAD8U:  return evmLoadUint8(evmIndexedAddress(vm, base, index, scale, 1U, 0));
+    case OP_SXREAD16:  return evmLoadInt16(evmIndexedAddress(vm, base, index, scale, 2U, 0));
+    case OP_SXREAD16U: return evmLoadUint16(evmIndexedAddress(vm, base, index, scale, 2U, 0));
+    default:           return evmLoadInt32(evmIndexedAddress(vm, base, index, scale, 4U, 0));
+  }
+}
+
+
+static void evmIndexedWrite(evm_t *vm, uint8_t opcode, int32_t base, int32_t index, uint8_t scale,
+                            int32_t value) {
+  switch(FAM_INDEX | (opcode & 0x07)) {
+    case OP_SXWRITE8:  evmSaveInt8(evmIndexedAddress(vm, base, index, scale, 1U, 1), value);  break;
+    case OP_SXWRITE16: evmSaveInt16(evmIndexedAddress(vm, base, index, scale, 2U, 1), value); break;
+    default:           evmSaveInt32(evmIndexedAddress(vm, base, index, scale, 4U, 1), value); break;
+  }
+}
 #endif
 
-static int32_t evmLoadInt32(const uint8_t *src) {
-#if EVM_UNALIGNED_READS == 1
-  return *(const int32_t *) src;
-#else
-  return  ((int32_t) src[0]      ) | (((int32_t) src[1]) <<  8) |
-          ((int32_t) src[2] << 16) | (((int32_t) src[3]) << 24);
+
+int evmRun(evm_t *vm, uint32_t maxOps) {
+#if EVM_REGISTER_SUPPORT == 1
+  if(vm && vm->regs) {
+#  if EVM_MEMORY_SUPPORT == 1 && EVM_GUARD_PAGES == 1
+    // armed here so the interpreter steps the register code falls back on share one trap
+    evm_guard_trap_t trap;
+    int retVal;
+
+    if(evmGuardArm(&trap, vm)) {
+      if(sigsetjmp(trap.env, 0)) {
+        evmGuardDisarm(&trap);
+        evmGuardRestore(vm, &trap);
+        (void) evmMemoryFault(vm, trap.fault);
+        return 1;
+      }
+    }
+
+    retVal = evmregRun(vm, maxOps);
+    evmGuardDisarm(&trap);
+    return retVal;
+#  else
+    return evmregRun(vm, maxOps);
+#  endif
+  }
 #endif
+
+  return evmRunStack(vm, maxOps);
 }
 
 
-int evmRun(evm_t *vm, uint32_t maxOps) {
+int evmRunStack(evm_t *vm, uint32_t maxOps) {
   EVM_TRACEF("Enter %s", __FUNCTION__);
   if(vm && vm->program) {
+#if EVM_MEMORY_SUPPORT == 1 && EVM_GUARD_PAGES == 1
+    // a stray access lands in a guard page and unwinds here instead of bounds checking every one
+    evm_guard_trap_t trap;
+
+    if(evmGuardArm(&trap, vm)) {
+      if(sigsetjmp(trap.env, 0)) {
+        evmGuardDisarm(&trap);
+        evmGuardRestore(vm, &trap);
+        (void) evmMemoryFault(vm, trap.fault);
+        EVM_TRACEF("Exit %s", __FUNCTION__);
+        return 1;
+      }
+    }
+#endif
     evm_t local = *vm; // copy the state back to a local eVM
     uint32_t ops = 0;
 
@@ -497,7 +1388,7 @@ int evmRun(evm_t *vm, uint32_t maxOps) {
           EVM_TRACEF("%08X: LCALL %d", local.ip, evmLoadInt24(&local.program[local.ip + 1]));
           EVM_PUSH(local, local.ip + 4U); // push the return instruction pointer
           // update the instruction pointer to the function
-          local.ip = evmLoadInt24(&local.program[local.ip + 1]);
+          local.ip += evmLoadInt24(&local.program[local.ip + 1]);
         break;
 
         case OP_BCALL: {
@@ -509,6 +1400,7 @@ int evmRun(evm_t *vm, uint32_t maxOps) {
           }
           else {
 #endif
+          EVM_GUARD_NOTE(local); // builtins may touch memory too
           local.ip += 2; // move to the next instruction, allow builtin to override on error
           if((EVM_BUILTINS[id] ? EVM_BUILTINS[id] : &evmUnboundHandler)(&local)) {
             EVM_ERRORF("%08X: BAD BCALL(%02X)", local.ip - 2, local.program[local.ip - 1]);
@@ -1010,171 +1902,631 @@ int evmRun(evm_t *vm, uint32_t maxOps) {
         break;
 #endif
 
+        case OP_ENTER:
+          EVM_TRACEF("%08X: ENTER %d", local.ip, evmLoadUint8(&local.program[local.ip + 1U]));
+          local.ip += 2; // move to the next instruction
+          evmEnterFrame(&local, (uint32_t) evmLoadUint8(&local.program[local.ip - 1U]));
+        break;
+
+        case OP_LEAVE:
+          EVM_TRACEF("%08X: LEAVE %d", local.ip, evmLoadUint8(&local.program[local.ip + 1U]));
+          local.ip += 2; // move to the next instruction
+          evmLeaveFrame(&local, (uint32_t) evmLoadUint8(&local.program[local.ip - 1U]));
+        break;
+
+        case OP_LOAD_L:
+          EVM_TRACEF("%08X: LDLOC %d", local.ip, evmLoadUint8(&local.program[local.ip + 1U]));
+          local.ip += 2; // move to the next instruction
+          evmLoadSlot(&local, evmLocalSlot(&local, evmLoadUint8(&local.program[local.ip - 1U])));
+        break;
+
+        case OP_STORE_L:
+          EVM_TRACEF("%08X: STLOC %d", local.ip, evmLoadUint8(&local.program[local.ip + 1U]));
+          local.ip += 2; // move to the next instruction
+          evmStoreSlot(&local, evmLocalSlot(&local, evmLoadUint8(&local.program[local.ip - 1U])));
+        break;
+
+        case OP_LOAD_A:
+          EVM_TRACEF("%08X: LDARG %d", local.ip, evmLoadUint8(&local.program[local.ip + 1U]));
+          local.ip += 2; // move to the next instruction
+          evmLoadSlot(&local, evmArgumentSlot(&local, evmLoadUint8(&local.program[local.ip - 1U])));
+        break;
+
+        case OP_LENTER:
+          EVM_TRACEF("%08X: ENTER %d", local.ip, evmLoadUint16(&local.program[local.ip + 1U]));
+          local.ip += 3; // move to the next instruction
+          evmEnterFrame(&local, (uint32_t) evmLoadUint16(&local.program[local.ip - 2U]));
+        break;
+
+        case OP_LLOAD_L:
+          EVM_TRACEF("%08X: LDLOC %d", local.ip, evmLoadUint16(&local.program[local.ip + 1U]));
+          local.ip += 3; // move to the next instruction
+          evmLoadSlot(&local, evmLocalSlot(&local, evmLoadUint16(&local.program[local.ip - 2U])));
+        break;
+
+        case OP_LSTORE_L:
+          EVM_TRACEF("%08X: STLOC %d", local.ip, evmLoadUint16(&local.program[local.ip + 1U]));
+          local.ip += 3; // move to the next instruction
+          evmStoreSlot(&local, evmLocalSlot(&local, evmLoadUint16(&local.program[local.ip - 2U])));
+        break;
+
+        case OP_LLOAD_A:
+          EVM_TRACEF("%08X: LDARG %d", local.ip, evmLoadUint16(&local.program[local.ip + 1U]));
+          local.ip += 3; // move to the next instruction
+          evmLoadSlot(&local,
+                      evmArgumentSlot(&local, evmLoadUint16(&local.program[local.ip - 2U])));
+        break;
+
+        case OP_ADD_8I:
+          EVM_TRACEF("%08X: ADDI %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
+          local.ip += 2; // move to the next instruction
+          EVM_IMM_OP_I(local, +, evmLoadInt8(&local.program[local.ip - 1U]));
+        break;
+
+        case OP_SUB_8I:
+          EVM_TRACEF("%08X: SUBI %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
+          local.ip += 2; // move to the next instruction
+          EVM_IMM_OP_I(local, -, evmLoadInt8(&local.program[local.ip - 1U]));
+        break;
+
+        case OP_MUL_8I:
+          EVM_TRACEF("%08X: MULI %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
+          local.ip += 2; // move to the next instruction
+          EVM_IMM_OP_I(local, *, evmLoadInt8(&local.program[local.ip - 1U]));
+        break;
+
+        case OP_AND_8I:
+          EVM_TRACEF("%08X: ANDI %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
+          local.ip += 2; // move to the next instruction
+          EVM_IMM_OP_I(local, &, evmLoadInt8(&local.program[local.ip - 1U]));
+        break;
+
+        case OP_LSH_8I:
+          EVM_TRACEF("%08X: SHLI %d", local.ip, evmLoadUint8(&local.program[local.ip + 1U]));
+          local.ip += 2; // move to the next instruction
+          EVM_IMM_OP_I(local, <<, evmLoadUint8(&local.program[local.ip - 1U]) & 0x1F);
+        break;
+
+        case OP_JCMP_8I:
+          EVM_TRACEF("%08X: JCMPI 0x%X %d %d", local.ip, local.program[local.ip + 1U],
+                     evmLoadInt8(&local.program[local.ip + 2U]),
+                     evmLoadInt8(&local.program[local.ip + 3U]));
+          if(!local.sp) { (void) evmStackUnderflow(&local); }
+          else if(evmCompareTop(&local, evmLoadInt8(&local.program[local.ip + 2U]),
+                                local.program[local.ip + 1U])) {
+            EVM_BRANCH(local, evmLoadInt8(&local.program[local.ip + 3U]));
+          }
+          else {
+            local.ip += 4;
+          }
+        break;
+
+        case OP_DJNZ:
+          EVM_TRACEF("%08X: DJNZ %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
+          if(!local.sp) { (void) evmStackUnderflow(&local); }
+          else {
+            --EVM_TOP_I(local); // count down and branch unless the count reached zero
+            if(evmCompareTop(&local, 0, EVM_LESS | EVM_GREATER)) {
+              EVM_BRANCH(local, evmLoadInt8(&local.program[local.ip + 1U]));
+            }
+            else {
+              local.ip += 2;
+            }
+          }
+        break;
+
+        case OP_ADD_16I:
+          EVM_TRACEF("%08X: ADDI %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
+          local.ip += 3; // move to the next instruction
+          EVM_IMM_OP_I(local, +, evmLoadInt16(&local.program[local.ip - 2U]));
+        break;
+
+        case OP_SUB_16I:
+          EVM_TRACEF("%08X: SUBI %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
+          local.ip += 3; // move to the next instruction
+          EVM_IMM_OP_I(local, -, evmLoadInt16(&local.program[local.ip - 2U]));
+        break;
+
+        case OP_MUL_16I:
+          EVM_TRACEF("%08X: MULI %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
+          local.ip += 3; // move to the next instruction
+          EVM_IMM_OP_I(local, *, evmLoadInt16(&local.program[local.ip - 2U]));
+        break;
+
+        case OP_AND_16I:
+          EVM_TRACEF("%08X: ANDI %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
+          local.ip += 3; // move to the next instruction
+          EVM_IMM_OP_I(local, &, evmLoadInt16(&local.program[local.ip - 2U]));
+        break;
+
+        case OP_LJCMP_8I:
+          EVM_TRACEF("%08X: LJCMPI 0x%X %d %d", local.ip, local.program[local.ip + 1U],
+                     evmLoadInt8(&local.program[local.ip + 2U]),
+                     evmLoadInt16(&local.program[local.ip + 3U]));
+          if(!local.sp) { (void) evmStackUnderflow(&local); }
+          else if(evmCompareTop(&local, evmLoadInt8(&local.program[local.ip + 2U]),
+                                local.program[local.ip + 1U])) {
+            EVM_BRANCH(local, evmLoadInt16(&local.program[local.ip + 3U]));
+          }
+          else {
+            local.ip += 5;
+          }
+        break;
+
+        case OP_LDJNZ:
+          EVM_TRACEF("%08X: LDJNZ %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
+          if(!local.sp) { (void) evmStackUnderflow(&local); }
+          else {
+            --EVM_TOP_I(local); // count down and branch unless the count reached zero
+            if(evmCompareTop(&local, 0, EVM_LESS | EVM_GREATER)) {
+              EVM_BRANCH(local, evmLoadInt16(&local.program[local.ip + 1U]));
+            }
+            else {
+              local.ip += 3;
+            }
+          }
+        break;
+
+        case OP_POPCNT:
+          EVM_TRACEF("%08X: POPCNT", local.ip);
+          ++local.ip; // move to the next instruction
+          if(!local.sp) { (void) evmStackUnderflow(&local); }
+          else { EVM_TOP_I(local) = __builtin_popcount((uint32_t) EVM_TOP_I(local)); }
+        break;
+
+        case OP_CLZ:
+          EVM_TRACEF("%08X: CLZ", local.ip);
+          ++local.ip; // move to the next instruction
+          if(!local.sp) { (void) evmStackUnderflow(&local); }
+          else if(EVM_TOP_I(local)) {
+            EVM_TOP_I(local) = __builtin_clz((uint32_t) EVM_TOP_I(local));
+          }
+          else { EVM_TOP_I(local) = 32; }
+        break;
+
+        case OP_CTZ:
+          EVM_TRACEF("%08X: CTZ", local.ip);
+          ++local.ip; // move to the next instruction
+          if(!local.sp) { (void) evmStackUnderflow(&local); }
+          else if(EVM_TOP_I(local)) {
+            EVM_TOP_I(local) = __builtin_ctz((uint32_t) EVM_TOP_I(local));
+          }
+          else { EVM_TOP_I(local) = 32; }
+        break;
+
+        case OP_ROL:
+          EVM_TRACEF("%08X: ROL", local.ip);
+          ++local.ip; // move to the next instruction
+          EVM_BIN_FN_I(local, evmRotateLeft);
+        break;
+
+        case OP_ROR:
+          EVM_TRACEF("%08X: ROR", local.ip);
+          ++local.ip; // move to the next instruction
+          EVM_BIN_FN_I(local, evmRotateRight);
+        break;
+
+        case OP_MOD_I:
+          EVM_TRACEF("%08X: MOD", local.ip);
+          ++local.ip; // move to the next instruction
+          if(local.sp < 2U) { (void) evmStackUnderflow(&local); }
+          else if(!EVM_STACK_I(local, 1) ||
+                  (EVM_STACK_I(local, 1) == -1 && EVM_TOP_I(local) == INT32_MIN)) {
+            (void) evmDivisionFault(&local);
+          }
+          else { // replace the top two values with the remainder of their quotient
+            EVM_TRACEF("BINARY OP (%d %% %d)", EVM_TOP_I(local), EVM_STACK_I(local, 1));
+            EVM_STACK_I(local, 1) = EVM_TOP_I(local) % EVM_STACK_I(local, 1);
+            --local.sp;
+          }
+        break;
+
+        case OP_MIN_I:
+          EVM_TRACEF("%08X: MIN", local.ip);
+          ++local.ip; // move to the next instruction
+          EVM_BIN_FN_I(local, evmMinimum);
+        break;
+
+        case OP_MAX_I:
+          EVM_TRACEF("%08X: MAX", local.ip);
+          ++local.ip; // move to the next instruction
+          EVM_BIN_FN_I(local, evmMaximum);
+        break;
+
+#if EVM_FLOAT_SUPPORT == 1
+        case OP_MIN_F:
+          EVM_TRACEF("%08X: MINF", local.ip);
+          ++local.ip; // move to the next instruction
+          EVM_BIN_FN_F(local, evmMinimumf);
+        break;
+
+        case OP_MAX_F:
+          EVM_TRACEF("%08X: MAXF", local.ip);
+          ++local.ip; // move to the next instruction
+          EVM_BIN_FN_F(local, evmMaximumf);
+        break;
+
+        case OP_SQRT_F:
+          EVM_TRACEF("%08X: SQRTF", local.ip);
+          ++local.ip; // move to the next instruction
+          if(!local.sp) { (void) evmStackUnderflow(&local); }
+          else { EVM_TOP_F(local) = sqrtf(EVM_TOP_F(local)); }
+        break;
+
+        case OP_FMA_F:
+          EVM_TRACEF("%08X: FMAF", local.ip);
+          ++local.ip; // move to the next instruction
+          if(local.sp < 3U) { (void) evmStackUnderflow(&local); }
+          else { // the product of the top two values plus the third, rounded once
+            EVM_STACK_F(local, 2) = fmaf(EVM_TOP_F(local), EVM_STACK_F(local, 1),
+                                         EVM_STACK_F(local, 2));
+            local.sp -= 2U;
+          }
+        break;
+#endif
+
 #if EVM_MEMORY_SUPPORT == 1
+        case OP_MEMCPY:
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: MEMCPY", local.ip);
+          ++local.ip; // move to the next instruction
+          if(local.sp < 3) { (void) evmStackUnderflow(&local); }
+          else {
+            uint32_t dst = evmBlockAddress(&local, EVM_STACK_I(local, 2U));
+            uint32_t src = evmBlockAddress(&local, EVM_STACK_I(local, 1U));
+            uint32_t len = evmBlockLength(EVM_TOP_I(local));
+            uint8_t *to = evmMemoryBlock(&local, dst, &len, 1);
+            uint8_t *from = evmMemoryBlock(&local, src, &len, 0);
+            if(to + len <= from || from + len <= to) {
+              memcpy(to, from, len);
+            }
+            else {
+              memmove(to, from, len); // overlapping ranges are still defined
+            }
+            local.sp -= 3; // pop the values used
+          }
+        break;
+
+        case OP_MEMMOVE:
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: MEMMOVE", local.ip);
+          ++local.ip; // move to the next instruction
+          if(local.sp < 3) { (void) evmStackUnderflow(&local); }
+          else {
+            uint32_t dst = evmBlockAddress(&local, EVM_STACK_I(local, 2U));
+            uint32_t src = evmBlockAddress(&local, EVM_STACK_I(local, 1U));
+            uint32_t len = evmBlockLength(EVM_TOP_I(local));
+            uint8_t *to = evmMemoryBlock(&local, dst, &len, 1);
+            uint8_t *from = evmMemoryBlock(&local, src, &len, 0);
+            memmove(to, from, len);
+            local.sp -= 3; // pop the values used
+          }
+        break;
+
+        case OP_MEMSET:
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: MEMSET", local.ip);
+          ++local.ip; // move to the next instruction
+          if(local.sp < 3) { (void) evmStackUnderflow(&local); }
+          else {
+            uint32_t dst = evmBlockAddress(&local, EVM_STACK_I(local, 2U));
+            uint32_t len = evmBlockLength(EVM_TOP_I(local));
+            uint8_t *to = evmMemoryBlock(&local, dst, &len, 1);
+            memset(to, EVM_STACK_I(local, 1U) & 0xFF, len);
+            local.sp -= 3; // pop the values used
+          }
+        break;
+
+        case OP_MEMCMP:
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: MEMCMP", local.ip);
+          ++local.ip; // move to the next instruction
+          if(local.sp < 3) { (void) evmStackUnderflow(&local); }
+          else {
+            uint32_t lhs = evmBlockAddress(&local, EVM_STACK_I(local, 2U));
+            uint32_t rhs = evmBlockAddress(&local, EVM_STACK_I(local, 1U));
+            uint32_t len = evmBlockLength(EVM_TOP_I(local));
+            const uint8_t *left = evmMemoryBlock(&local, lhs, &len, 0);
+            const uint8_t *right = evmMemoryBlock(&local, rhs, &len, 0);
+            int cmp = memcmp(left, right, len);
+            local.sp -= 2; // pop all but the first address, which is replaced by the result
+            EVM_TOP_I(local) = (cmp > 0) - (cmp < 0);
+          }
+        break;
+
+        case OP_VADD_I:
+        case OP_VSUB_I:
+        case OP_VMUL_I:
+        case OP_VMIN_I:
+        case OP_VMAX_I:
+#  if EVM_FLOAT_SUPPORT == 1
+        case OP_VADD_F:
+        case OP_VSUB_F:
+        case OP_VMUL_F:
+        case OP_VMIN_F:
+        case OP_VMAX_F:
+#  endif
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: VECTOR %02X", local.ip, local.program[local.ip]);
+          ++local.ip; // move to the next instruction
+          if(local.sp < 3) { (void) evmStackUnderflow(&local); }
+          else {
+            evmVectorOp(
+              local.program[local.ip - 1U],
+              evmVectorAddress(&local, EVM_STACK_I(local, 2U), 1),
+              evmVectorAddress(&local, EVM_STACK_I(local, 1U), 0),
+              evmVectorAddress(&local, EVM_TOP_I(local), 0)
+            );
+            local.sp -= 3; // pop the values used
+          }
+        break;
+
+        case OP_VDOT_I:
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: VDOT", local.ip);
+          ++local.ip; // move to the next instruction
+          if(local.sp < 2) { (void) evmStackUnderflow(&local); }
+          else {
+            EVM_STACK_I(local, 1U) = evmVectorDotI(
+              evmVectorAddress(&local, EVM_STACK_I(local, 1U), 0),
+              evmVectorAddress(&local, EVM_TOP_I(local), 0)
+            );
+            --local.sp; // pop the right operand, the left is replaced by the result
+          }
+        break;
+
+#  if EVM_FLOAT_SUPPORT == 1
+        case OP_VDOT_F:
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: VDOTF", local.ip);
+          ++local.ip; // move to the next instruction
+          if(local.sp < 2) { (void) evmStackUnderflow(&local); }
+          else {
+            EVM_STACK_F(local, 1U) = evmVectorDotF(
+              evmVectorAddress(&local, EVM_STACK_I(local, 1U), 0),
+              evmVectorAddress(&local, EVM_TOP_I(local), 0)
+            );
+            --local.sp; // pop the right operand, the left is replaced by the result
+          }
+        break;
+#  endif
+
         case OP_SEG:
           EVM_TRACEF("%08X: SEG %d", local.ip, evmLoadUint8(&local.program[local.ip + 1U]));
           local.ip += 2; // move to the next instruction
           evmSetSegment(&local, evmLoadUint8(&local.program[local.ip - 1U])); // update the segment
         break;
 
-        case OP_READ:
-          EVM_TRACEF(
-            "%08X: READ 0x%06X", local.ip,
-            evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip + 1U]))
-          );
+        case OP_READ: {
+          uint32_t addr = evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip + 1U]));
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: READ 0x%06X", local.ip, addr);
           local.ip += 3; // move to the next instruction
-          EVM_PUSH(
-            local, evmLoadInt32(&local.mem[
-              evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip - 2U]))
-            ])
-          ); // push a signed int
-        break;
-
-        case OP_WRITE8:
-          EVM_TRACEF(
-            "%08X: WRITE8 0x%06X", local.ip,
-            evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip + 1U]))
-          );
+          EVM_PUSH(local, evmLoadInt32(evmMemoryAddress(&local, addr, 4U, 0))); // push a signed int
+        } break;
+
+        case OP_WRITE8: {
+          uint32_t addr = evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip + 1U]));
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: WRITE8 0x%06X", local.ip, addr);
           local.ip += 3; // move to the next instruction
           if(!local.sp) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt8(
-              &local.mem[evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip - 2U]))],
-              EVM_TOP_I(local)
-            );
+            evmSaveInt8(evmMemoryAddress(&local, addr, 1U, 1), EVM_TOP_I(local));
           }
-        break;
+        } break;
 
-        case OP_WRITE16:
-          EVM_TRACEF(
-            "%08X: WRITE16 0x%06X", local.ip,
-            evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip + 1U]))
-          );
+        case OP_WRITE16: {
+          uint32_t addr = evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip + 1U]));
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: WRITE16 0x%06X", local.ip, addr);
           local.ip += 3; // move to the next instruction
           if(!local.sp) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt16(
-              &local.mem[evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip - 2U]))],
-              EVM_TOP_I(local)
-            );
+            evmSaveInt16(evmMemoryAddress(&local, addr, 2U, 1), EVM_TOP_I(local));
           }
-        break;
+        } break;
 
-        case OP_WRITE24:
-          EVM_TRACEF(
-            "%08X: WRITE24 0x%06X", local.ip,
-            evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip + 1U]))
-          );
+        case OP_WRITE24: {
+          uint32_t addr = evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip + 1U]));
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: WRITE24 0x%06X", local.ip, addr);
           local.ip += 3; // move to the next instruction
           if(!local.sp) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt24(
-              &local.mem[evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip - 2U]))],
-              EVM_TOP_I(local)
-            );
+            evmSaveInt24(evmMemoryAddress(&local, addr, 3U, 1), EVM_TOP_I(local));
           }
-        break;
+        } break;
 
-        case OP_WRITE32:
-          EVM_TRACEF(
-            "%08X: WRITE32 0x%06X", local.ip,
-            evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip + 1U]))
-          );
+        case OP_WRITE32: {
+          uint32_t addr = evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip + 1U]));
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: WRITE32 0x%06X", local.ip, addr);
           local.ip += 3; // move to the next instruction
           if(!local.sp) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt32(
-              &local.mem[evmEffectiveAddress(&local, evmLoadUint16(&local.program[local.ip - 2U]))],
-              EVM_TOP_I(local)
-            );
+            evmSaveInt32(evmMemoryAddress(&local, addr, 4U, 1), EVM_TOP_I(local));
           }
-        break;
+        } break;
 
-        case OP_LREAD:
-          EVM_TRACEF("%08X: LREAD 0x%06X", local.ip, evmLoadUint24(&local.program[local.ip + 1U]));
+        case OP_LREAD: {
+          uint32_t addr = evmLoadUint24(&local.program[local.ip + 1U]);
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: LREAD 0x%06X", local.ip, addr);
           local.ip += 4; // move to the next instruction
-          EVM_PUSH(local, evmLoadInt32(&local.mem[evmLoadUint24(&local.program[local.ip - 3U])]));
-        break;
+          EVM_PUSH(local, evmLoadInt32(evmMemoryAddress(&local, addr, 4U, 0)));
+        } break;
 
-        case OP_LWRITE8:
-          EVM_TRACEF("%08X: LWRITE8 0x%06X", local.ip, evmLoadUint24(&local.program[local.ip + 1U]));
+        case OP_LWRITE8: {
+          uint32_t addr = evmLoadUint24(&local.program[local.ip + 1U]);
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: LWRITE8 0x%06X", local.ip, addr);
           local.ip += 4; // move to the next instruction
           if(!local.sp) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt8(&local.mem[evmLoadUint24(&local.program[local.ip - 3U])], EVM_TOP_I(local));
+            evmSaveInt8(evmMemoryAddress(&local, addr, 1U, 1), EVM_TOP_I(local));
           }
-        break;
+        } break;
 
-        case OP_LWRITE16:
-          EVM_TRACEF("%08X: LWRITE16 0x%06X", local.ip, evmLoadUint24(&local.program[local.ip + 1U]));
+        case OP_LWRITE16: {
+          uint32_t addr = evmLoadUint24(&local.program[local.ip + 1U]);
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: LWRITE16 0x%06X", local.ip, addr);
           local.ip += 4; // move to the next instruction
           if(!local.sp) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt16(&local.mem[evmLoadUint24(&local.program[local.ip - 3U])], EVM_TOP_I(local));
+            evmSaveInt16(evmMemoryAddress(&local, addr, 2U, 1), EVM_TOP_I(local));
           }
-        break;
+        } break;
 
-        case OP_LWRITE24:
-          EVM_TRACEF("%08X: LWRITE24 0x%06X", local.ip, evmLoadUint24(&local.program[local.ip + 1U]));
+        case OP_LWRITE24: {
+          uint32_t addr = evmLoadUint24(&local.program[local.ip + 1U]);
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: LWRITE24 0x%06X", local.ip, addr);
           local.ip += 4; // move to the next instruction
           if(!local.sp) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt24(&local.mem[evmLoadUint24(&local.program[local.ip - 3U])], EVM_TOP_I(local));
+            evmSaveInt24(evmMemoryAddress(&local, addr, 3U, 1), EVM_TOP_I(local));
           }
-        break;
+        } break;
 
-        case OP_LWRITE32:
-          EVM_TRACEF("%08X: LWRITE32 0x%06X", local.ip, evmLoadUint24(&local.program[local.ip + 1U]));
+        case OP_LWRITE32: {
+          uint32_t addr = evmLoadUint24(&local.program[local.ip + 1U]);
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: LWRITE32 0x%06X", local.ip, addr);
           local.ip += 4; // move to the next instruction
           if(!local.sp) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt32(&local.mem[evmLoadUint24(&local.program[local.ip - 3U])], EVM_TOP_I(local));
+            evmSaveInt32(evmMemoryAddress(&local, addr, 4U, 1), EVM_TOP_I(local));
           }
-        break;
+        } break;
 
         case OP_SREAD:
+          EVM_GUARD_NOTE(local);
           EVM_TRACEF("%08X: SREAD", local.ip);
           ++local.ip; // move to the next instruction
           if(!local.sp) { (void) evmStackUnderflow(&local); }
-          else { EVM_TOP_I(local) = local.mem[EVM_TOP_I(local) & 0x00FFFFFF]; }
+          else {
+            EVM_TOP_I(local) = *evmMemoryAddress(&local, EVM_TOP_I(local) & 0x00FFFFFF, 1U, 0);
+          }
         break;
 
         case OP_SWRITE8:
+          EVM_GUARD_NOTE(local);
           EVM_TRACEF("%08X: SWRITE8", local.ip);
           ++local.ip; // move to the next instruction
           if(local.sp < 2) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt8(&local.mem[EVM_STACK_I(local, 1U) & 0x00FFFFFF], EVM_TOP_I(local));
+            evmSaveInt8(
+              evmMemoryAddress(&local, EVM_STACK_I(local, 1U) & 0x00FFFFFF, 1U, 1), EVM_TOP_I(local)
+            );
             local.sp -= 2; // pop the values used
           }
         break;
 
         case OP_SWRITE16:
+          EVM_GUARD_NOTE(local);
           EVM_TRACEF("%08X: SWRITE16", local.ip);
           ++local.ip; // move to the next instruction
           if(local.sp < 2) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt16(&local.mem[EVM_STACK_I(local, 1U) & 0x00FFFFFF], EVM_TOP_I(local));
+            evmSaveInt16(
+              evmMemoryAddress(&local, EVM_STACK_I(local, 1U) & 0x00FFFFFF, 2U, 1), EVM_TOP_I(local)
+            );
             local.sp -= 2; // pop the values used
           }
         break;
 
         case OP_SWRITE24:
+          EVM_GUARD_NOTE(local);
           EVM_TRACEF("%08X: SWRITE24", local.ip);
           ++local.ip; // move to the next instruction
           if(local.sp < 2) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt24(&local.mem[EVM_STACK_I(local, 1U) & 0x00FFFFFF], EVM_TOP_I(local));
+            evmSaveInt24(
+              evmMemoryAddress(&local, EVM_STACK_I(local, 1U) & 0x00FFFFFF, 3U, 1), EVM_TOP_I(local)
+            );
             local.sp -= 2; // pop the values used
           }
         break;
 
         case OP_SWRITE32:
+          EVM_GUARD_NOTE(local);
           EVM_TRACEF("%08X: SWRITE32", local.ip);
           ++local.ip; // move to the next instruction
           if(local.sp < 2) { (void) evmStackUnderflow(&local); }
           else {
-            evmSaveInt32(&local.mem[EVM_STACK_I(local, 1U) & 0x00FFFFFF], EVM_TOP_I(local));
+            evmSaveInt32(
+              evmMemoryAddress(&local, EVM_STACK_I(local, 1U) & 0x00FFFFFF, 4U, 1), EVM_TOP_I(local)
+            );
+            local.sp -= 2; // pop the values used
+          }
+        break;
+
+        case OP_SXREAD:
+        case OP_SXREAD8:
+        case OP_SXREAD8U:
+        case OP_SXREAD16:
+        case OP_SXREAD16U:
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: SXREAD%02X %d", local.ip, local.program[local.ip],
+                     1 << (local.program[local.ip + 1U] & 3));
+          local.ip += 2; // move to the next instruction
+          if(local.sp < 2) { (void) evmStackUnderflow(&local); }
+          else { // replace the base and the index with the value read
+            EVM_STACK_I(local, 1U) = evmIndexedRead(&local, local.program[local.ip - 2U],
+                                                    EVM_STACK_I(local, 1U), EVM_TOP_I(local),
+                                                    local.program[local.ip - 1U]);
+            --local.sp;
+          }
+        break;
+
+        case OP_SXWRITE8:
+        case OP_SXWRITE16:
+        case OP_SXWRITE32:
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: SXWRITE%02X %d", local.ip, local.program[local.ip],
+                     1 << (local.program[local.ip + 1U] & 3));
+          local.ip += 2; // move to the next instruction
+          if(local.sp < 3) { (void) evmStackUnderflow(&local); }
+          else {
+            evmIndexedWrite(&local, local.program[local.ip - 2U], EVM_STACK_I(local, 2U),
+                            EVM_STACK_I(local, 1U), local.program[local.ip - 1U], EVM_TOP_I(local));
+            local.sp -= 3; // pop the values used
+          }
+        break;
+
+        case OP_XREAD:
+        case OP_XREAD8:
+        case OP_XREAD8U:
+        case OP_XREAD16:
+        case OP_XREAD16U:
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: XREAD%02X %d 0x%04X", local.ip, local.program[local.ip],
+                     1 << (local.program[local.ip + 1U] & 3),
+                     evmLoadUint16(&local.program[local.ip + 2U]));
+          local.ip += 4; // move to the next instruction
+          if(!local.sp) { (void) evmStackUnderflow(&local); }
+          else { // replace the index with the value read
+            EVM_TOP_I(local) = evmIndexedRead(&local, local.program[local.ip - 4U],
+                                              evmLoadUint16(&local.program[local.ip - 2U]),
+                                              EVM_TOP_I(local), local.program[local.ip - 3U]);
+          }
+        break;
+
+        case OP_XWRITE8:
+        case OP_XWRITE16:
+        case OP_XWRITE32:
+          EVM_GUARD_NOTE(local);
+          EVM_TRACEF("%08X: XWRITE%02X %d 0x%04X", local.ip, local.program[local.ip],
+                     1 << (local.program[local.ip + 1U] & 3),
+                     evmLoadUint16(&local.program[local.ip + 2U]));
+          local.ip += 4; // move to the next instruction
+          if(local.sp < 2) { (void) evmStackUnderflow(&local); }
+          else {
+            evmIndexedWrite(&local, local.program[local.ip - 4U],
+                            evmLoadUint16(&local.program[local.ip - 2U]), EVM_STACK_I(local, 1U),
+                            local.program[local.ip - 3U], EVM_TOP_I(local));
             local.sp -= 2; // pop the values used
           }
         break;
@@ -1290,13 +2642,13 @@ int evmRun(evm_t *vm, uint32_t maxOps) {
 
         case OP_JMP:
           EVM_TRACEF("%08X: JMP %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
-          local.ip += evmLoadInt8(&local.program[local.ip + 1U]);
+          EVM_BRANCH(local, evmLoadInt8(&local.program[local.ip + 1U]));
         break;
 
         case OP_JLT:
           EVM_TRACEF("%08X: JLT %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
           if(local.flags & EVM_LESS) {
-            local.ip += evmLoadInt8(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt8(&local.program[local.ip + 1U]));
           }
           else {
             local.ip += 2;
@@ -1306,7 +2658,7 @@ int evmRun(evm_t *vm, uint32_t maxOps) {
         case OP_JLE:
           EVM_TRACEF("%08X: JLE %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
           if(local.flags & (EVM_LESS | EVM_EQUAL)) {
-            local.ip += evmLoadInt8(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt8(&local.program[local.ip + 1U]));
           }
           else {
             local.ip += 2;
@@ -1316,7 +2668,7 @@ int evmRun(evm_t *vm, uint32_t maxOps) {
         case OP_JNE:
           EVM_TRACEF("%08X: JNE %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
           if(local.flags & (EVM_LESS | EVM_GREATER)) {
-            local.ip += evmLoadInt8(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt8(&local.program[local.ip + 1U]));
           }
           else {
             local.ip += 2;
@@ -1326,7 +2678,7 @@ int evmRun(evm_t *vm, uint32_t maxOps) {
         case OP_JEQ:
           EVM_TRACEF("%08X: JEQ %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
           if(local.flags & EVM_EQUAL) {
-            local.ip += evmLoadInt8(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt8(&local.program[local.ip + 1U]));
           }
           else {
             local.ip += 2;
@@ -1336,7 +2688,7 @@ int evmRun(evm_t *vm, uint32_t maxOps) {
         case OP_JGE:
           EVM_TRACEF("%08X: JGE %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
           if(local.flags & (EVM_GREATER | EVM_EQUAL)) {
-            local.ip += evmLoadInt8(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt8(&local.program[local.ip + 1U]));
           }
           else {
             local.ip += 2;
@@ -1346,7 +2698,7 @@ int evmRun(evm_t *vm, uint32_t maxOps) {
         case OP_JGT:
           EVM_TRACEF("%08X: JGT %d", local.ip, evmLoadInt8(&local.program[local.ip + 1U]));
           if(local.flags & EVM_GREATER) {
-            local.ip += evmLoadInt8(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt8(&local.program[local.ip + 1U]));
           }
           else {
             local.ip += 2;
@@ -1355,66 +2707,66 @@ int evmRun(evm_t *vm, uint32_t maxOps) {
 
         case OP_LJMP:
           EVM_TRACEF("%08X: LJMP %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
-          local.ip += evmLoadInt16(&local.program[local.ip + 1U]);
+          EVM_BRANCH(local, evmLoadInt16(&local.program[local.ip + 1U]));
         break;
 
         case OP_LJLT:
           EVM_TRACEF("%08X: LJLT %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
           if(local.flags & EVM_LESS) {
-            local.ip += evmLoadInt16(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt16(&local.program[local.ip + 1U]));
           }
           else {
-            local.ip += 2;
+            local.ip += 3;
           }
         break;
 
         case OP_LJLE:
           EVM_TRACEF("%08X: LJLE %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
           if(local.flags & (EVM_LESS | EVM_EQUAL)) {
-            local.ip += evmLoadInt16(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt16(&local.program[local.ip + 1U]));
           }
           else {
-            local.ip += 2;
+            local.ip += 3;
           }
         break;
 
         case OP_LJNE:
           EVM_TRACEF("%08X: LJNE %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
           if(local.flags & (EVM_LESS | EVM_GREATER)) {
-            local.ip += evmLoadInt16(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt16(&local.program[local.ip + 1U]));
           }
           else {
-            local.ip += 2;
+            local.ip += 3;
           }
         break;
 
         case OP_LJEQ:
           EVM_TRACEF("%08X: LJEQ %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
           if(local.flags & EVM_EQUAL) {
-            local.ip += evmLoadInt16(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt16(&local.program[local.ip + 1U]));
           }
           else {
-            local.ip += 2;
+            local.ip += 3;
           }
         break;
 
         case OP_LJGE:
           EVM_TRACEF("%08X: LJGE %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
           if(local.flags & (EVM_GREATER | EVM_EQUAL)) {
-            local.ip += evmLoadInt16(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt16(&local.program[local.ip + 1U]));
           }
           else {
-            local.ip += 2;
+            local.ip += 3;
           }
         break;
 
         case OP_LJGT:
           EVM_TRACEF("%08X: LJGT %d", local.ip, evmLoadInt16(&local.program[local.ip + 1U]));
           if(local.flags & EVM_GREATER) {
-            local.ip += evmLoadInt16(&local.program[local.ip + 1U]);
+            EVM_BRANCH(local, evmLoadInt16(&local.program[local.ip + 1U]));
           }
           else {
-            local.ip += 2;
+            local.ip += 3;
           }
         break;
 
@@ -1554,6 +2906,9 @@ int evmRun(evm_t *vm, uint32_t maxOps) {
     EVM_DEBUGF("Performed %u of %u VM operations", ops, maxOps);
 
     *vm = local; // copy the state back to the canonical eVM
+#if EVM_MEMORY_SUPPORT == 1 && EVM_GUARD_PAGES == 1
+    evmGuardDisarm(&trap);
+#endif
     EVM_TRACEF("Exit %s", __FUNCTION__);
     return !!(local.flags & EVM_HALTED);
   }
@@ -1,12 +1,21 @@
 #include "evm/asm.h"
+#include "evm/decode.h"
+#include "evm/object.h"
 #include "evm/opcodes.h"
 
 #include <math.h>
 #include <ctype.h>
 #include <float.h>
+#include <stdarg.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if EVM_THREAD_SUPPORT == 1
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
 
 typedef enum evm_arg_e {
   ARG_NONE,   // no argument
@@ -20,6 +29,7 @@ typedef enum evm_arg_e {
   ARG_I24,    // three byte integer literal
 #if EVM_MEMORY_SUPPORT == 1
   ARG_U24,    // three byte unsigned integer literal
+  ARG_SCALE,  // scale of 1, 2, 4 or 8 and an optional two byte unsigned integer literal
 #endif
   ARG_I32,    // four byte integer literal
   ARG_O1,     // optional one bit integer literal
@@ -28,6 +38,8 @@ typedef enum evm_arg_e {
   ARG_I4_O4,  // four bit integer literal and optional four bit integer literal
   ARG_O8,     // optional one byte integer literal
   ARG_LBL,    // a label literal
+  ARG_I8_L,   // one byte integer literal and a label literal
+  ARG_SLOT,   // frame slot index, count or the name of an argument or local
 #if EVM_FLOAT_SUPPORT == 1
   ARG_F32,    // four byte floating point literal
   ARG_OF32    // optional four byte floating point literal
@@ -36,6 +48,8 @@ typedef enum evm_arg_e {
 
 
 typedef enum evm_flags_e {
+  INST_RELAXABLE   = 1 << 0,
+  INST_REMOVED     = 1 << 1,
   INST_DIRECTIVE   = 1 << 2,
   INST_LABEL       = 1 << 3,
   INST_FINALIZED   = 1 << 4,
@@ -45,11 +59,22 @@ typedef enum evm_flags_e {
 } evm_flags_t;
 
 
+typedef enum evm_asm_flags_e {
+  ASM_OPTIMIZED   = 1 << 0,
+  ASM_RELOCATABLE = 1 << 1,
+  ASM_CACHED      = 1 << 2, // the output was loaded from the cache
+  ASM_KEYED       = 1 << 3, // the key covers every parsed source so the output can be cached
+} evm_asm_flags_t;
+
+
 typedef enum evm_dir_e {
   DIR_BASE,
   DIR_NAME,
   DIR_DATA,
   DIR_TBL,
+  DIR_FRAME,
+  DIR_ARG,
+  DIR_LOCAL,
 } evm_dir_t;
 
 
@@ -87,8 +112,8 @@ struct evm_mnemonic_s {
 
 typedef struct evm_label_s {
   struct evm_label_s *next;
-  struct evm_label_s *prev;
   evm_section_t      *section;
+  uint32_t            after;  // number of section instructions preceding the label
   uint32_t            offset;
   uint32_t            id;
   char                name[];
@@ -96,21 +121,36 @@ typedef struct evm_label_s {
 
 
 typedef struct evm_instruction_ref_s {
-  struct evm_instruction_ref_s *next;
-  evm_label_t                  *target;
-  evm_instruction_t            *instruction;
-  int32_t                       offset;
-  int32_t                       size;
+  evm_label_t       *target;
+  evm_instruction_t *instruction;
+  int32_t            offset;
+  int32_t            size;
 } evm_instruction_ref_t;
 
 
+// a field left for the linker to patch with the distance from origin to the named label
+typedef struct evm_reloc_s {
+  const evm_instruction_t *instruction; // the operand names the label
+  uint32_t                 offset;
+  uint32_t                 origin;
+  uint32_t                 size;
+} evm_reloc_t;
+
+
 struct evm_section_s {
   evm_section_t         *next;
   evm_section_t         *prev;
   uint8_t               *contents;
-  evm_label_t            labels;
-  evm_instruction_ref_t *instructions;
-  evm_instruction_ref_t *tail;
+  evm_label_t           *labels;       // labels in order of placement
+  evm_label_t           *lastLabel;
+  evm_instruction_ref_t *refs;         // contiguous vector of the section's instructions
+  evm_reloc_t           *relocs;       // only populated when assembling an object
+  uint32_t               refCount;
+  uint32_t               refCapacity;
+  uint32_t               relocCount;
+  uint32_t               relocCapacity;
+  uint32_t               labelCount;
+  uint32_t               flags;        // evm_object_flags_t
   uint32_t               base;
   uint32_t               length;
   uint32_t               capacity;
@@ -118,39 +158,106 @@ struct evm_section_s {
 };
 
 
-typedef struct evm_ptr_list_s {
-  struct evm_ptr_list_s *prev;
-  struct evm_ptr_list_s *next;
-  void                  *ptr;
-} evm_ptr_list_t;
+// bump allocator, blocks are only released when the assembler is finalized
+struct evm_arena_s {
+  struct evm_arena_s *next;
+  size_t              used;
+  size_t              size;
+  uint8_t             data[];
+};
+
+#define EVM_ARENA_BLOCK 65536U
+
+
+// cache entries start with magic, version, key (low and high words), source bytes and length
+#define EVM_CACHE_MAGIC        0x434D5645U // "EVMC"
+#define EVM_CACHE_HEADER_WORDS 6U
+
+
+// work item callback for evmasmParallelFor
+typedef void (*evm_task_t)(void *, uint32_t);
+
+#define EVM_MAX_THREADS 64U
+
+
+typedef struct evm_hash_entry_s {
+  const char *key;    // owned by the value, not necessarily terminated
+  void       *value;
+  uint32_t    hash;
+  uint32_t    length;
+} evm_hash_entry_t;
+
+
+// open addressing hash table with linear probing
+typedef struct evm_hash_s {
+  evm_hash_entry_t *slots;
+  uint32_t          capacity; // always zero or a power of two
+  uint32_t          count;
+} evm_hash_t;
 
 
 struct evm_program_s {
   evm_section_t  sections;
-  evm_ptr_list_t files;
+  evm_hash_t     names;  // index of the canonical file names
+  evm_hash_t     labels; // index of the labels in every section
   uint32_t       base;
   uint32_t       length;
   uint32_t       count;
 };
 
 
-static void               evmasmClearLabelList(evm_label_t *);
-static void               evmasmClearFilesList(evm_ptr_list_t *);
+static void              *evmasmArenaAllocate(evm_assembler_t *, size_t);
+static char              *evmasmArenaString(evm_assembler_t *, const char *, const char *);
+static void               evmasmArenaAdopt(evm_assembler_t *, evm_assembler_t *);
+static void               evmasmArenaClear(evm_assembler_t *);
 static void               evmasmClearSectionList(evm_section_t *);
-static void               evmasmClearInstructionList(evm_instruction_t *);
-static void               evmasmAppendInstruction(evm_instruction_t *, evm_instruction_t *);
-static evm_instruction_t *evmasmNewInstruction(const char *, const char *, const char *, uint32_t);
+static evm_instruction_t *evmasmNewInstruction(evm_assembler_t *, const char *, const char *,
+                                               const char *, uint32_t, int);
+static int                evmasmParseSpan(evm_assembler_t *, const char *, const char *,
+                                          const char *, int, int);
+static int                evmasmScan(const evm_instruction_t *, const char *, ...);
+static uint32_t           evmasmOperandLength(const evm_instruction_t *);
 static evm_program_t     *evmasmNewProgram();
 static void               evmasmDeleteProgram(evm_program_t *);
-static const char        *evmasmCanonicalizeString(evm_ptr_list_t *, const char *);
-static evm_section_t     *evmasmNewSection(const char *);
+static const char        *evmasmCanonicalizeString(evm_assembler_t *, const char *);
+static evm_section_t     *evmasmNewSection(evm_assembler_t *, const char *, uint32_t);
 static void               evmasmDeleteSection(evm_section_t *);
-static evm_section_t     *evmasmCanonicalizeSection(evm_section_t *, const char *);
-static void               evmasmAddToSection(evm_section_t *, evm_instruction_t *);
+static evm_section_t     *evmasmCanonicalizeSection(evm_assembler_t *, const char *, uint32_t);
+static void               evmasmSortSections(evm_section_t *);
+static evm_instruction_ref_t *evmasmAddToSection(evm_section_t *, evm_instruction_t *);
+static int                evmasmSerializeSection(evm_section_t *, int);
+static int                evmasmSerializeSections(const evm_assembler_t *, evm_section_t *);
+static int                evmasmTargetDelta(evm_section_t *, const evm_instruction_ref_t *, uint32_t,
+                                            uint32_t, uint32_t, int, int *);
+static const evm_instruction_t *evmasmLeadingData(const evm_section_t *);
+static uint32_t           evmasmThreadCount(const evm_assembler_t *);
+static void               evmasmParallelFor(uint32_t, uint32_t, evm_task_t, void *);
+static int                evmasmMerge(evm_assembler_t *, evm_assembler_t *);
 static uint32_t           evmasmCalculateLikelySectionLength(evm_section_t *);
-static evm_label_t       *evmasmNewLabel(const char *, uint32_t);
-static evm_label_t       *evmasmAppendLabel(evm_section_t *, const char *);
+static void               evmasmRelaxBranches(evm_section_t *, int);
+static uint8_t            evmasmRelaxedOpcode(const evm_instruction_ref_t *);
+static evm_label_t       *evmasmAppendLabel(evm_assembler_t *, evm_section_t *, const char *,
+                                            uint32_t);
 static int                mnemonicCompare(const char *, const char *, const char *);
+static void               evmasmPopulateIndices(void);
+static void               evmasmBuildIndices(void);
+static const evm_mnemonic_t *evmasmFindMnemonic(const char *, const char *);
+static const evm_directive_t *evmasmFindDirective(const char *, const char *);
+static uint32_t           evmasmHashString(const char *, uint32_t);
+static uint32_t           evmasmHashToken(const char *, const char *);
+static void              *evmasmHashFind(const evm_hash_t *, const char *, uint32_t, uint32_t);
+static int                evmasmHashInsert(evm_hash_t *, const char *, uint32_t, uint32_t, void *);
+static void               evmasmHashClear(evm_hash_t *);
+static void               evmasmOptimize(evm_assembler_t *);
+static int                evmasmResolveFrames(evm_assembler_t *);
+static int                evmasmFrameOperand(evm_instruction_t *, uint32_t);
+static uint64_t           evmasmHash64(uint64_t, const uint8_t *, size_t);
+static int                evmasmCacheKey(evm_assembler_t *, const char *const *, int);
+static char              *evmasmCachePath(const evm_assembler_t *, const char *);
+static int                evmasmCacheLoad(evm_assembler_t *);
+static void               evmasmCacheStore(const evm_assembler_t *, const uint8_t *, uint32_t);
+static uint8_t           *evmasmStoreWord(uint8_t *, uint32_t);
+static uint32_t           evmasmLoadWord(const uint8_t *);
 
 
 evm_assembler_t *evmasmAllocate() {
@@ -162,10 +269,10 @@ evm_assembler_t *evmasmInitialize(evm_assembler_t *evm) {
   if(evm) {
     evm_program_t *program = evmasmNewProgram();
 
+    evmasmBuildIndices();
+
     if(program) {
       memset((void *) evm, 0, sizeof(evm_assembler_t));
-      evm->head.prev = &evm->head;
-      evm->head.next = &evm->head;
       evm->output = program;
     }
     else {
@@ -180,10 +287,12 @@ evm_assembler_t *evmasmInitialize(evm_assembler_t *evm) {
 
 evm_assembler_t *evmasmFinalize(evm_assembler_t *evm) {
   if(evm) {
-    evmasmClearInstructionList(&evm->head);
+    free(evm->instructions);
+    free(evm->image);
     if(evm->output) {
       evmasmDeleteProgram(evm->output);
     }
+    evmasmArenaClear(evm);
     memset((void *) evm, 0, sizeof(evm_assembler_t));
   }
 
@@ -200,11 +309,164 @@ int evmasmParseFile(evm_assembler_t *evm, const char *name, FILE *fp) {
   int result = 0;
 
   if(evm && fp) {
-    int line = 0;
-    char buffer[BUFSIZ];
+    long start = ftell(fp), size;
+    char *source;
+
+    // seekable files are read whole into the arena so the instructions can reference them directly
+    if(start >= 0 && !fseek(fp, 0L, SEEK_END) && (size = ftell(fp)) >= start &&
+       !fseek(fp, start, SEEK_SET) && (source = evmasmArenaAllocate(evm, size - start + 1))) {
+      if(fread(source, 1, size - start, fp) == (size_t) (size - start)) {
+        result = evmasmParseBuffer(evm, name, source, size - start);
+      }
+      else {
+        EVM_ERRORF("Failed to read %s", name);
+        result = -1;
+      }
+    }
+    else {
+      int line = 0;
+      char buffer[BUFSIZ];
+
+      while(fgets(&buffer[0], BUFSIZ, fp)) {
+        result |= evmasmParseLine(evm, name, &buffer[0], ++line);
+      }
+    }
+  }
+  else {
+    result = -1;
+  }
+
+  return result;
+}
+
+
+int evmasmParseBuffer(evm_assembler_t *evm, const char *name, const char *buf, size_t len) {
+  int result = 0;
+
+  if(evm && (buf || !len)) {
+    const char *end = &buf[len];
+    const char *line;
+    int num = 0;
+
+    for(line = buf; line < end; ) {
+      const char *eol = memchr(line, '\n', end - line);
+
+      if(!eol) {
+        eol = end;
+      }
+
+      result |= evmasmParseSpan(evm, name, line, eol, ++num, 0);
+      line = &eol[1];
+    }
+  }
+  else {
+    result = -1;
+  }
+
+  return result;
+}
+
+
+typedef struct evm_parse_job_s {
+  const char *const *names;
+  evm_assembler_t   *parsers;
+  int               *results;
+} evm_parse_job_t;
+
+
+static void evmasmParseTask(void *context, uint32_t index) {
+  evm_parse_job_t *job = (evm_parse_job_t *) context;
+  const char *name = job->names[index];
+  FILE *fp;
+
+  if(!job->parsers[index].output) {
+    return; // failed to initialize
+  }
+
+  if((fp = fopen(name, "r"))) {
+    job->results[index] = evmasmParseFile(&job->parsers[index], name, fp);
+    fclose(fp);
+  }
+  else {
+    EVM_ERRORF("Failed to open %s for reading", name);
+    job->results[index] = -1;
+  }
+}
+
+
+int evmasmParseFiles(evm_assembler_t *evm, const char *const *names, int count, int *results) {
+  int result = 0;
+
+  if(evm && names && count >= 0) {
+    uint32_t threads = evmasmThreadCount(evm);
+    evm_parse_job_t job = { names, NULL, NULL };
+    int file, keyed = 0;
+
+    // the key only describes the program when these are its only sources
+    if(evm->cache && !evm->count && !(evm->flags & ASM_CACHED)) {
+      keyed = !evmasmCacheKey(evm, names, count);
+
+      if(keyed && !evmasmCacheLoad(evm)) {
+        for(file = 0; results && file < count; ++file) {
+          results[file] = 0;
+        }
+
+        return 0; // assembled before, nothing to parse
+      }
+    }
+
+    // each file gets its own assembler so the workers share nothing
+    if(threads > 1 && count > 1 &&
+       (job.parsers = calloc(count, sizeof(evm_assembler_t))) &&
+       (job.results = calloc(count, sizeof(int)))) {
+      for(file = 0; file < count; ++file) {
+        if(!evmasmInitialize(&job.parsers[file])) {
+          job.results[file] = -1;
+        }
+      }
+
+      evmasmParallelFor(threads, (uint32_t) count, &evmasmParseTask, &job);
+
+      // merge in the order given so the output matches the serial assembler
+      for(file = 0; file < count; ++file) {
+        if(job.parsers[file].output && evmasmMerge(evm, &job.parsers[file])) {
+          job.results[file] = -1;
+        }
+
+        evmasmFinalize(&job.parsers[file]);
+        result |= job.results[file];
+
+        if(results) {
+          results[file] = job.results[file];
+        }
+      }
+    }
+    else {
+      for(file = 0; file < count; ++file) {
+        FILE *fp = fopen(names[file], "r");
+        int status = -1;
+
+        if(fp) {
+          status = evmasmParseFile(evm, names[file], fp);
+          fclose(fp);
+        }
+        else {
+          EVM_ERRORF("Failed to open %s for reading", names[file]);
+        }
 
-    while(fgets(&buffer[0], BUFSIZ, fp)) {
-      result |= evmasmParseLine(evm, name, &buffer[0], ++line);
+        result |= status;
+
+        if(results) {
+          results[file] = status;
+        }
+      }
+    }
+
+    free(job.parsers);
+    free(job.results);
+
+    if(keyed && !result) {
+      evm->flags |= ASM_KEYED;
     }
   }
   else {
@@ -215,23 +477,53 @@ int evmasmParseFile(evm_assembler_t *evm, const char *name, FILE *fp) {
 }
 
 
+int evmasmSetCache(evm_assembler_t *evm, const char *directory) {
+  if(evm && !(evm->flags & ASM_CACHED)) {
+    evm->cache = directory ? evmasmArenaString(evm, directory, &directory[strlen(directory)]) : NULL;
+    evm->flags &= ~ASM_KEYED;
+    return directory && !evm->cache ? -1 : 0;
+  }
+
+  return -1;
+}
+
+
+int evmasmIsCached(const evm_assembler_t *evm) {
+  return evm && (evm->flags & ASM_CACHED) ? 1 : 0;
+}
+
+
+int evmasmSetThreads(evm_assembler_t *evm, int threads) {
+  if(evm && 0 <= threads && threads <= (int) EVM_MAX_THREADS) {
+    evm->threads = (uint32_t) threads;
+    return 0;
+  }
+
+  return -1;
+}
+
+
 static int evmDataDirective(const evm_directive_t *, evm_instruction_t *);
 static int evmTextDirective(const evm_directive_t *, evm_instruction_t *);
 static int evmAddressDirective(const evm_directive_t *, evm_instruction_t *);
+static int evmFrameDirective(const evm_directive_t *, evm_instruction_t *);
 
 
 // List of directives and associated arguments
 static const evm_directive_t DIRECTIVES[] = {
-  { ".name",   &evmTextDirective,    ARG_LBL,  DIR_NAME },
-  { ".offset", &evmAddressDirective, ARG_I24,  DIR_BASE },
-  { ".addr",   &evmTextDirective,    ARG_LBL,  DIR_TBL  },
-  { ".db",     &evmDataDirective,    ARG_I8,   DIR_DATA },
-  { ".dh",     &evmDataDirective,    ARG_I16,  DIR_DATA },
-  { ".dw",     &evmDataDirective,    ARG_I32,  DIR_DATA },
+  { ".name",   &evmTextDirective,    ARG_LBL,  DIR_NAME  },
+  { ".offset", &evmAddressDirective, ARG_I24,  DIR_BASE  },
+  { ".addr",   &evmTextDirective,    ARG_LBL,  DIR_TBL   },
+  { ".db",     &evmDataDirective,    ARG_I8,   DIR_DATA  },
+  { ".dh",     &evmDataDirective,    ARG_I16,  DIR_DATA  },
+  { ".dw",     &evmDataDirective,    ARG_I32,  DIR_DATA  },
 #if EVM_FLOAT_SUPPORT == 1
-  { ".df",     &evmDataDirective,    ARG_F32,  DIR_DATA },
+  { ".df",     &evmDataDirective,    ARG_F32,  DIR_DATA  },
 #endif
-  { NULL,      NULL,                 ARG_NONE, 0        },
+  { ".frame",  &evmFrameDirective,   ARG_NONE, DIR_FRAME },
+  { ".arg",    &evmFrameDirective,   ARG_LBL,  DIR_ARG   },
+  { ".local",  &evmFrameDirective,   ARG_LBL,  DIR_LOCAL },
+  { NULL,      NULL,                 ARG_NONE, 0         },
 };
 
 
@@ -240,6 +532,12 @@ static int evmLabelSerializer(const evm_mnemonic_t *, evm_instruction_t *);
 static int evmSimpleSerializer(const evm_mnemonic_t *, evm_instruction_t *);
 static int evmCompareSerializer(const evm_mnemonic_t *, evm_instruction_t *);
 static int evmOptionalSerializer(const evm_mnemonic_t *, evm_instruction_t *);
+static int evmFrameSerializer(const evm_mnemonic_t *, evm_instruction_t *);
+static int evmOperandSerializer(const evm_mnemonic_t *, evm_instruction_t *);
+static int evmFusedSerializer(const evm_mnemonic_t *, evm_instruction_t *);
+#if EVM_MEMORY_SUPPORT == 1
+static int evmIndexedSerializer(const evm_mnemonic_t *, evm_instruction_t *);
+#endif
 
 
 // List of mnemonics, associated arguments, and covered opcodes
@@ -273,7 +571,25 @@ static const evm_mnemonic_t MNEMONICS[] = {
   { "NOT",      ARG_NONE,  OP_NOT,      &evmSimpleSerializer   },
   { "TRUNC",    ARG_I5,    OP_TRUNC,    &evmSimpleSerializer   },
   { "SIGNEXT",  ARG_I5,    OP_SIGNEXT,  &evmSimpleSerializer   },
+  { "POPCNT",   ARG_NONE,  OP_POPCNT,   &evmSimpleSerializer   },
+  { "CLZ",      ARG_NONE,  OP_CLZ,      &evmSimpleSerializer   },
+  { "CTZ",      ARG_NONE,  OP_CTZ,      &evmSimpleSerializer   },
+  { "ROL",      ARG_NONE,  OP_ROL,      &evmSimpleSerializer   },
+  { "ROR",      ARG_NONE,  OP_ROR,      &evmSimpleSerializer   },
+  { "MOD",      ARG_NONE,  OP_MOD_I,    &evmSimpleSerializer   },
+  { "MIN",      ARG_NONE,  OP_MIN_I,    &evmSimpleSerializer   },
+  { "MAX",      ARG_NONE,  OP_MAX_I,    &evmSimpleSerializer   },
 #if EVM_MEMORY_SUPPORT == 1
+  { "MEMCPY",   ARG_NONE,  OP_MEMCPY,   &evmSimpleSerializer   },
+  { "MEMMOVE",  ARG_NONE,  OP_MEMMOVE,  &evmSimpleSerializer   },
+  { "MEMSET",   ARG_NONE,  OP_MEMSET,   &evmSimpleSerializer   },
+  { "MEMCMP",   ARG_NONE,  OP_MEMCMP,   &evmSimpleSerializer   },
+  { "VADD",     ARG_NONE,  OP_VADD_I,   &evmSimpleSerializer   },
+  { "VSUB",     ARG_NONE,  OP_VSUB_I,   &evmSimpleSerializer   },
+  { "VMUL",     ARG_NONE,  OP_VMUL_I,   &evmSimpleSerializer   },
+  { "VDOT",     ARG_NONE,  OP_VDOT_I,   &evmSimpleSerializer   },
+  { "VMIN",     ARG_NONE,  OP_VMIN_I,   &evmSimpleSerializer   },
+  { "VMAX",     ARG_NONE,  OP_VMAX_I,   &evmSimpleSerializer   },
   { "SEG",      ARG_U8,    OP_SEG,      &evmSimpleSerializer   },
   { "READ",     ARG_U16,   OP_READ,     &evmSimpleSerializer   },
   { "WRITE8",   ARG_U16,   OP_WRITE8,   &evmSimpleSerializer   },
@@ -290,15 +606,47 @@ static const evm_mnemonic_t MNEMONICS[] = {
   { "SWRITE16", ARG_NONE,  OP_SWRITE16, &evmSimpleSerializer   },
   { "SWRITE24", ARG_NONE,  OP_SWRITE24, &evmSimpleSerializer   },
   { "SWRITE32", ARG_NONE,  OP_SWRITE32, &evmSimpleSerializer   },
+  { "XREAD",    ARG_SCALE, OP_SXREAD,   &evmIndexedSerializer  }, // OP_{SXREAD,XREAD}
+  { "XREAD8",   ARG_SCALE, OP_SXREAD8,  &evmIndexedSerializer  }, // OP_{SXREAD8,XREAD8}
+  { "XREAD8U",  ARG_SCALE, OP_SXREAD8U, &evmIndexedSerializer  }, // OP_{SXREAD8U,XREAD8U}
+  { "XREAD16",  ARG_SCALE, OP_SXREAD16, &evmIndexedSerializer  }, // OP_{SXREAD16,XREAD16}
+  { "XREAD16U", ARG_SCALE, OP_SXREAD16U, &evmIndexedSerializer }, // OP_{SXREAD16U,XREAD16U}
+  { "XWRITE8",  ARG_SCALE, OP_SXWRITE8, &evmIndexedSerializer  }, // OP_{SXWRITE8,XWRITE8}
+  { "XWRITE16", ARG_SCALE, OP_SXWRITE16, &evmIndexedSerializer }, // OP_{SXWRITE16,XWRITE16}
+  { "XWRITE32", ARG_SCALE, OP_SXWRITE32, &evmIndexedSerializer }, // OP_{SXWRITE32,XWRITE32}
 #endif
+  { "ENTER",    ARG_SLOT,  OP_ENTER,    &evmFrameSerializer    }, // OP_ENTER, OP_LENTER
+  { "LEAVE",    ARG_SLOT,  OP_LEAVE,    &evmFrameSerializer    },
+  { "LDLOC",    ARG_SLOT,  OP_LOAD_L,   &evmFrameSerializer    }, // OP_LOAD_L, OP_LLOAD_L
+  { "STLOC",    ARG_SLOT,  OP_STORE_L,  &evmFrameSerializer    }, // OP_STORE_L, OP_LSTORE_L
+  { "LDARG",    ARG_SLOT,  OP_LOAD_A,   &evmFrameSerializer    }, // OP_LOAD_A, OP_LLOAD_A
+  { "ADDI",     ARG_I16,   OP_ADD_8I,   &evmOperandSerializer  }, // OP_ADD_{8I,16I}
+  { "SUBI",     ARG_I16,   OP_SUB_8I,   &evmOperandSerializer  }, // OP_SUB_{8I,16I}
+  { "MULI",     ARG_I16,   OP_MUL_8I,   &evmOperandSerializer  }, // OP_MUL_{8I,16I}
+  { "ANDI",     ARG_I16,   OP_AND_8I,   &evmOperandSerializer  }, // OP_AND_{8I,16I}
+  { "SHLI",     ARG_I5,    OP_LSH_8I,   &evmSimpleSerializer   },
+  { "JLTI",     ARG_I8_L,  OP_JLT,      &evmFusedSerializer    }, // OP_JCMP_8I, OP_LJCMP_8I
+  { "JLEI",     ARG_I8_L,  OP_JLE,      &evmFusedSerializer    }, // OP_JCMP_8I, OP_LJCMP_8I
+  { "JNEI",     ARG_I8_L,  OP_JNE,      &evmFusedSerializer    }, // OP_JCMP_8I, OP_LJCMP_8I
+  { "JEQI",     ARG_I8_L,  OP_JEQ,      &evmFusedSerializer    }, // OP_JCMP_8I, OP_LJCMP_8I
+  { "JGEI",     ARG_I8_L,  OP_JGE,      &evmFusedSerializer    }, // OP_JCMP_8I, OP_LJCMP_8I
+  { "JGTI",     ARG_I8_L,  OP_JGT,      &evmFusedSerializer    }, // OP_JCMP_8I, OP_LJCMP_8I
+  { "LJLTI",    ARG_I8_L,  OP_LJLT,     &evmFusedSerializer    },
+  { "LJLEI",    ARG_I8_L,  OP_LJLE,     &evmFusedSerializer    },
+  { "LJNEI",    ARG_I8_L,  OP_LJNE,     &evmFusedSerializer    },
+  { "LJEQI",    ARG_I8_L,  OP_LJEQ,     &evmFusedSerializer    },
+  { "LJGEI",    ARG_I8_L,  OP_LJGE,     &evmFusedSerializer    },
+  { "LJGTI",    ARG_I8_L,  OP_LJGT,     &evmFusedSerializer    },
+  { "DJNZ",     ARG_LBL,   OP_DJNZ,     &evmLabelSerializer    }, // OP_DJNZ, OP_LDJNZ
+  { "LDJNZ",    ARG_LBL,   OP_LDJNZ,    &evmLabelSerializer    },
   { "CMP",      ARG_O8,    OP_CMP_I0,   &evmCompareSerializer  }, // OP_CMP_{I0,I1,IN1,I}
-  { "JMP",      ARG_LBL,   OP_JMP,      &evmLabelSerializer    },
-  { "JLT",      ARG_LBL,   OP_JLT,      &evmLabelSerializer    },
-  { "JLE",      ARG_LBL,   OP_JLE,      &evmLabelSerializer    },
-  { "JNE",      ARG_LBL,   OP_JNE,      &evmLabelSerializer    },
-  { "JEQ",      ARG_LBL,   OP_JEQ,      &evmLabelSerializer    },
-  { "JGE",      ARG_LBL,   OP_JGE,      &evmLabelSerializer    },
-  { "JGT",      ARG_LBL,   OP_JGT,      &evmLabelSerializer    },
+  { "JMP",      ARG_LBL,   OP_JMP,      &evmLabelSerializer    }, // OP_JMP, OP_LJMP
+  { "JLT",      ARG_LBL,   OP_JLT,      &evmLabelSerializer    }, // OP_JLT, OP_LJLT
+  { "JLE",      ARG_LBL,   OP_JLE,      &evmLabelSerializer    }, // OP_JLE, OP_LJLE
+  { "JNE",      ARG_LBL,   OP_JNE,      &evmLabelSerializer    }, // OP_JNE, OP_LJNE
+  { "JEQ",      ARG_LBL,   OP_JEQ,      &evmLabelSerializer    }, // OP_JEQ, OP_LJEQ
+  { "JGE",      ARG_LBL,   OP_JGE,      &evmLabelSerializer    }, // OP_JGE, OP_LJGE
+  { "JGT",      ARG_LBL,   OP_JGT,      &evmLabelSerializer    }, // OP_JGT, OP_LJGT
   { "JTBL",     ARG_NONE,  OP_JTBL,     &evmSimpleSerializer   },
   { "LJMP",     ARG_LBL,   OP_LJMP,     &evmLabelSerializer    },
   { "LJLT",     ARG_LBL,   OP_LJLT,     &evmLabelSerializer    },
@@ -323,18 +671,61 @@ static const evm_mnemonic_t MNEMONICS[] = {
   { "CNVFI",    ARG_O1,    OP_CONV_FI,  &evmOptionalSerializer }, // OP_CONV_{FI,FI_1}
   { "CNVIF",    ARG_O1,    OP_CONV_IF,  &evmOptionalSerializer }, // OP_CONV_{IF,IF_1}
   { "CMPF",     ARG_OF32,  OP_CMP_F0,   &evmCompareSerializer  }, // OP_CMP_{F0,F1,FN1,F}
+  { "MINF",     ARG_NONE,  OP_MIN_F,    &evmSimpleSerializer   },
+  { "MAXF",     ARG_NONE,  OP_MAX_F,    &evmSimpleSerializer   },
+  { "SQRTF",    ARG_NONE,  OP_SQRT_F,   &evmSimpleSerializer   },
+  { "FMAF",     ARG_NONE,  OP_FMA_F,    &evmSimpleSerializer   },
+#  if EVM_MEMORY_SUPPORT == 1
+  { "VADDF",    ARG_NONE,  OP_VADD_F,   &evmSimpleSerializer   },
+  { "VSUBF",    ARG_NONE,  OP_VSUB_F,   &evmSimpleSerializer   },
+  { "VMULF",    ARG_NONE,  OP_VMUL_F,   &evmSimpleSerializer   },
+  { "VDOTF",    ARG_NONE,  OP_VDOT_F,   &evmSimpleSerializer   },
+  { "VMINF",    ARG_NONE,  OP_VMIN_F,   &evmSimpleSerializer   },
+  { "VMAXF",    ARG_NONE,  OP_VMAX_F,   &evmSimpleSerializer   },
+#  endif
 #endif
 
   { NULL,    ARG_NONE,  OP_NOP,     NULL }, // "null" terminator at the end of the array
 };
 
 
+// hashed indices into MNEMONICS and DIRECTIVES, each slot holds the entry index plus one
+#define EVM_MNEMONIC_SLOTS  512U
+#define EVM_DIRECTIVE_SLOTS  32U
+
+static uint16_t MNEMONIC_INDEX[EVM_MNEMONIC_SLOTS];
+static uint16_t DIRECTIVE_INDEX[EVM_DIRECTIVE_SLOTS];
+#if EVM_THREAD_SUPPORT == 1
+static pthread_once_t INDICES_BUILT = PTHREAD_ONCE_INIT;
+#else
+static int INDICES_BUILT = 0;
+#endif
+
+// the probes always find a free slot while the indices are at most half full
+_Static_assert(sizeof(MNEMONICS) / sizeof(MNEMONICS[0]) * 2U <= EVM_MNEMONIC_SLOTS,
+               "Mnemonic index is too small for the mnemonics");
+_Static_assert(sizeof(DIRECTIVES) / sizeof(DIRECTIVES[0]) * 2U <= EVM_DIRECTIVE_SLOTS,
+               "Directive index is too small for the directives");
+
+
 int evmasmParseLine(evm_assembler_t *evm, const char *name, const char *line, int num) {
-  const char *start = line;
-  const char *end = &line[strlen(line)];
+  return evm && line ? evmasmParseSpan(evm, name, line, &line[strlen(line)], num, -1) : -1;
+}
+
+
+// parse a single line of source, the instruction text is copied only when requested
+static int evmasmParseSpan(evm_assembler_t *evm, const char *name, const char *start,
+                           const char *end, int num, int copy) {
   const char *cur;
   int result = 0;
 
+  if(evm->flags & ASM_CACHED) {
+    EVM_ERRORF("Unable to add %s to a program loaded from the cache", name);
+    return -1;
+  }
+
+  evm->flags &= ~ASM_KEYED; // the sources no longer match the key
+
   // trim leading whitespace
   while(start < end && isspace(*start)) { ++start; }
   // trim trailing whitespace
@@ -352,51 +743,42 @@ int evmasmParseLine(evm_assembler_t *evm, const char *name, const char *line, in
 
   // empty string check
   if(start != end) {
-    name = evmasmCanonicalizeString(&evm->output->files, name);
+    name = evmasmCanonicalizeString(evm, name);
 
     if(*start == '.') {
-      const evm_directive_t *directive;
-      int handled = 0;
-
       // parse directives
-      for(directive = &DIRECTIVES[0]; directive->tag; ++directive) {
-        if(!mnemonicCompare(&directive->tag[0], start, end)) {
-          evm_instruction_t *inst = evmasmNewInstruction(name, start, end, num);
-          evmasmAppendInstruction(&evm->head, inst);
-          result = directive->process(directive, inst);
-          handled = -1;
-          break;
-        }
-      }
+      const evm_directive_t *directive = evmasmFindDirective(start, end);
 
-      if(!handled) {
-        EVM_ERRORF("Unknown directive on line %d: %s", num, line);
+      if(directive) {
+        evm_instruction_t *inst = evmasmNewInstruction(evm, name, start, end, num, copy);
+        result = inst ? directive->process(directive, inst) : -1;
+      }
+      else {
+        EVM_ERRORF("Unknown directive on line %d: %.*s", num, (int) (end - start), start);
         result = -1;
       }
     }
     else if(end[-1] == ':') {
       // process labels
-      evm_instruction_t *inst = evmasmNewInstruction(name, start, end - 1, num);
-      evmasmAppendInstruction(&evm->head, inst);
-      inst->flags |= INST_LABEL;
+      evm_instruction_t *inst = evmasmNewInstruction(evm, name, start, end - 1, num, copy);
+
+      if(inst) {
+        inst->flags |= INST_LABEL;
+      }
+      else {
+        result = -1;
+      }
     }
     else {
-      const evm_mnemonic_t *mnemonic;
-      int handled = 0;
-
       // parse instructions
-      for(mnemonic = &MNEMONICS[0]; mnemonic->tag; ++mnemonic) {
-        if(!mnemonicCompare(&mnemonic->tag[0], start, end)) {
-          evm_instruction_t *inst = evmasmNewInstruction(name, start, end, num);
-          evmasmAppendInstruction(&evm->head, inst);
-          result = mnemonic->process(mnemonic, inst);
-          handled = -1;
-          break;
-        }
-      }
+      const evm_mnemonic_t *mnemonic = evmasmFindMnemonic(start, end);
 
-      if(!handled) {
-        EVM_ERRORF("Unexpected input on line %d: %s", num, line);
+      if(mnemonic) {
+        evm_instruction_t *inst = evmasmNewInstruction(evm, name, start, end, num, copy);
+        result = inst ? mnemonic->process(mnemonic, inst) : -1;
+      }
+      else {
+        EVM_ERRORF("Unexpected input on line %d: %.*s", num, (int) (end - start), start);
         result = -1;
       }
     }
@@ -410,22 +792,37 @@ int evmasmValidateProgram(evm_assembler_t *evm) {
   int result = 0;
 
   if(evm) {
-    evm_ptr_list_t     list;
     evm_program_t     *prog = evm->output;
-    evm_instruction_t *insts = &evm->head;
     evm_instruction_t *inst;
     evm_section_t     *sects = &prog->sections;
     evm_section_t     *sect = NULL;
+    uint32_t           index;
+    int                relocatable = !!(evm->flags & ASM_RELOCATABLE);
+
+    if(evm->flags & ASM_CACHED) {
+      return 0; // validated when it was first assembled
+    }
 
     evm->length = 0;
 
+    // frame slots have to be known before the optimizer or the sections size the instructions
+    result |= evmasmResolveFrames(evm);
+
+    // run the optimizer over the instruction stream once before it is split into sections
+    if(evm->level && !(evm->flags & ASM_OPTIMIZED)) {
+      evmasmOptimize(evm);
+      evm->flags |= ASM_OPTIMIZED;
+    }
+
     // build the sections based on instruction stream
-    for(inst = insts->next; inst != insts; inst = inst->next) {
+    for(index = 0; index < evm->count; ++index) {
+      inst = &evm->instructions[index];
+
       if(inst->flags & (INST_MISSING_ARG | INST_INVALID_ARG)) {
         result |= 1; // missing or bad argument on a specific instruction/directive
         EVM_ERRORF(
-          "Invalid instruction in %s on line %d: %s",
-          inst->file, inst->line, &inst->text[0]
+          "Invalid instruction in %s on line %d: %.*s",
+          inst->file, inst->line, (int) inst->length, inst->text
         );
         continue;
       }
@@ -436,11 +833,12 @@ int evmasmValidateProgram(evm_assembler_t *evm) {
             // set the base for the current section
             if(sect) {
               sect->base = inst->binary[1] | (inst->binary[2] << 8) | (inst->binary[3] << 16);
+              sect->flags |= EVM_OBJECT_BASED;
             }
             else {
               EVM_ERRORF(
-                "Section not yet specified in %s on line %d: %s",
-                inst->file, inst->line, &inst->text[0]
+                "Section not yet specified in %s on line %d: %.*s",
+                inst->file, inst->line, (int) inst->length, inst->text
               );
               result |= 8;
             }
@@ -448,7 +846,9 @@ int evmasmValidateProgram(evm_assembler_t *evm) {
 
           case DIR_NAME:
             // create a new section or select a previous section with the given name
-            sect = evmasmCanonicalizeSection(sects, &inst->text[inst->binary[1]]);
+            sect = evmasmCanonicalizeSection(
+              evm, &inst->text[inst->binary[1]], evmasmOperandLength(inst)
+            );
           break;
 
           case DIR_DATA:
@@ -458,8 +858,8 @@ int evmasmValidateProgram(evm_assembler_t *evm) {
             }
             else {
               EVM_ERRORF(
-                "Section not yet specified in %s on line %d: %s",
-                inst->file, inst->line, &inst->text[0]
+                "Section not yet specified in %s on line %d: %.*s",
+                inst->file, inst->line, (int) inst->length, inst->text
               );
               result |= 8;
             }
@@ -468,45 +868,64 @@ int evmasmValidateProgram(evm_assembler_t *evm) {
           case DIR_TBL:
             // add the jump table entry to the current table
             if(sect) {
-              evmasmAddToSection(sect, inst);
+              evm_instruction_ref_t *ref = evmasmAddToSection(sect, inst);
 
-              if(!sect->tail->size) {
+              if(ref && !ref->size) {
                 EVM_ERRORF(
-                  "Headerless jump table entry in %s on line %d: %s",
-                  inst->file, inst->line, &inst->text[0]
+                  "Headerless jump table entry in %s on line %d: %.*s",
+                  inst->file, inst->line, (int) inst->length, inst->text
                 );
                 result |= 4096;
               }
             }
             else {
               EVM_ERRORF(
-                "Section not yet specified in %s on line %d: %s",
-                inst->file, inst->line, &inst->text[0]
+                "Section not yet specified in %s on line %d: %.*s",
+                inst->file, inst->line, (int) inst->length, inst->text
               );
               result |= 8;
             }
           break;
+
+          case DIR_FRAME:
+          case DIR_ARG:
+          case DIR_LOCAL:
+            // already replaced by the slots of the instructions that use them
+          break;
         }
       }
       else if(inst->flags & INST_LABEL) {
         // add the label to the current section
         if(sect) {
-          evm_label_t *label = evmasmAppendLabel(sect, &inst->text[inst->binary[1]]);
-          if(label) {
+          const char *name = &inst->text[inst->binary[1]];
+          uint32_t length = evmasmOperandLength(inst);
+          uint32_t hash = evmasmHashString(name, length);
+          evm_label_t *label;
+
+          if(evmasmHashFind(&prog->labels, name, length, hash)) {
+            EVM_ERRORF(
+              "Duplicate label in %s on line %d: %.*s",
+              inst->file, inst->line, (int) inst->length, inst->text
+            );
+            result |= 2;
+          }
+          else if((label = evmasmAppendLabel(evm, sect, name, length)) &&
+                  !evmasmHashInsert(&prog->labels, &label->name[0], length, hash, label)) {
+            label->after = sect->refCount;
             label->offset = evmasmCalculateLikelySectionLength(sect);
           }
           else {
             EVM_ERRORF(
-              "Failure to create label in %s on line %d: %s",
-              inst->file, inst->line, &inst->text[0]
+              "Failure to create label in %s on line %d: %.*s",
+              inst->file, inst->line, (int) inst->length, inst->text
             );
             result |= 16;
           }
         }
         else {
           EVM_ERRORF(
-            "Section not yet specified in %s on line %d: %s",
-            inst->file, inst->line, &inst->text[0]
+            "Section not yet specified in %s on line %d: %.*s",
+            inst->file, inst->line, (int) inst->length, inst->text
           );
           result |= 8;
         }
@@ -518,64 +937,29 @@ int evmasmValidateProgram(evm_assembler_t *evm) {
         }
         else {
           EVM_ERRORF(
-            "Section not yet specified in %s on line %d: %s",
-            inst->file, inst->line, &inst->text[0]
+            "Section not yet specified in %s on line %d: %.*s",
+            inst->file, inst->line, (int) inst->length, inst->text
           );
           result |= 8;
         }
       }
     }
 
-    // ensure no duplicate labels
-    list.prev = &list;
-    list.next = &list;
-    for(sect = sects->next; sect != sects; sect = sect->next) {
-      evm_label_t *labels = &sect->labels;
-      evm_label_t *label;
-
-      for(label = labels->next; label != labels; label = label->next) {
-        evm_ptr_list_t *node;
-
-        for(node = list.next; node != &list; node = node->next) {
-          if(!strcmp(&label->name[0], (const char *) node->ptr)) {
-            break; // found duplicate
-          }
-        }
-
-        if(node != &list) {
-          // report error
-          EVM_ERRORF("Duplicate label: %s", &label->name[0]);
-          result |= 2;
-        }
-        else {
-          evmasmCanonicalizeString(&list, &label->name[0]);
-        }
-      }
-    }
-
     // ensure all jmp targets are resolved
     for(sect = sects->next; sect != sects; sect = sect->next) {
-      evm_instruction_ref_t *ref;
-
-      for(ref = sect->instructions; ref; ref = ref->next) {
+      for(index = 0; index < sect->refCount; ++index) {
+        evm_instruction_ref_t *ref = &sect->refs[index];
         inst = ref->instruction;
 
         if(inst->flags & INST_UNRESOLVED) {
-          evm_section_t *section;
-          const char *name = (char *) &inst->text[inst->binary[1]];
-         
-          for(section = sects->next; section != sects; section = section->next) {
-            evm_label_t *labels = &sect->labels;
-            evm_label_t *label;
-
-            for(label = labels->next; label != labels; label = label->next) {
-              if(!strcmp(&label->name[0], name)) {
-                // found target label
-                ref->target = label;
-                section = sects->prev;
-                break;
-              }
-            }
+          const char *name = &inst->text[inst->binary[1]];
+          uint32_t length = evmasmOperandLength(inst);
+
+          // label names are unique across every section but only reach within their own
+          ref->target = evmasmHashFind(&prog->labels, name, length, evmasmHashString(name, length));
+
+          if(ref->target && ref->target->section != sect) {
+            ref->target = NULL;
           }
 
           if(ref->target) {
@@ -583,11 +967,14 @@ int evmasmValidateProgram(evm_assembler_t *evm) {
             inst->flags &= ~INST_UNRESOLVED;
             inst->flags |=  INST_FINALIZED;
           }
+          else if(relocatable) {
+            // left for the linker to find in another object
+          }
           else {
             // report error
             EVM_ERRORF(
-              "Missing label in %s on line %d: %s",
-              inst->file, inst->line, &inst->text[0]
+              "Missing label in %s on line %d: %.*s",
+              inst->file, inst->line, (int) inst->length, inst->text
             );
             result |= 4;
           }
@@ -598,235 +985,13 @@ int evmasmValidateProgram(evm_assembler_t *evm) {
     // only process further if there have been no errors
     if(!result) {
       // sort the sections on base address
-      for(sect = sects->next; sect != sects; sect = sect->next) {
-        evm_section_t *min = sect;
-        evm_section_t *test;
-
-        // find the minimum base offset
-        for(test = sect->next; test != sects; test = test->next) {
-          if(test->base < min->base) {
-            min = test;
-          }
-        }
+      evmasmSortSections(sects);
 
-        // swap if required
-        if(sect != min) {
-          evm_section_t *ptrs[4] = { sect->prev, sect->next, min->prev, min->next };
-
-          // point min at sect's neighbors
-          min->prev = ptrs[0];
-          min->next = ptrs[1];
-          min->prev->next = min;
-          min->next->prev = min;
-
-          // point sect at min's neighbors
-          sect->prev = ptrs[2];
-          sect->next = ptrs[3];
-          sect->prev->next = sect;
-          sect->next->prev = sect;
-        }
-      }
+      // select the smallest encoding of each branch that can reach its target
+      evmasmRelaxBranches(sects, relocatable);
 
       // serialize the instructions into their respective sections
-      for(sect = sects->next; sect != sects; sect = sect->next) {
-        sect->capacity = evmasmCalculateLikelySectionLength(sect);
-        sect->length = 0;
-
-        if(sect->contents) {
-          free(sect->contents); // avoid memory leaks
-        }
-
-        if((sect->contents = calloc(sect->capacity, 1))) {
-          evm_instruction_ref_t *ref;
-          evm_label_t *target;
-          enum { INVALID, SHORT, LONG } mode = INVALID;
-          int delta, branches = 0, entries = 0, tbl_off = 0;
-
-          for(ref = sect->instructions; ref; ref = ref->next) {
-            inst = ref->instruction;
-
-            if(inst->flags & INST_DIRECTIVE) { // handle the data/address directives
-              switch(inst->binary[0]) {
-                case DIR_DATA:
-                  memcpy(&sect->contents[sect->length], &inst->binary[1], ref->size);
-                  sect->length += ref->size;
-                break;
-
-                case DIR_TBL:
-                  switch(mode) {
-                    case SHORT:
-                      target = ref->target;
-                      delta = (target->section->base + target->offset) - tbl_off;
-
-                      if(-128 <= delta && delta <= 127) {
-                        ++entries;
-                        sect->contents[branches]++;
-                        sect->contents[sect->length++] = (int8_t) delta;
-                      }
-                      else {
-                        // report error
-                        EVM_ERRORF(
-                          "Jump too far in %s on line %d: %s",
-                          inst->file, inst->line, &inst->text[0]
-                        );
-                        result |= 64;
-                      }
-                    break;
-
-                    case LONG:
-                      target = ref->target;
-                      delta = (target->section->base + target->offset) - tbl_off;
-
-                      if(-32768 <= delta && delta <= 32767) {
-                        ++entries;
-                        sect->contents[branches]++;
-                        sect->contents[sect->length++] =  delta       & 0xFF;
-                        sect->contents[sect->length++] = (delta >> 8) & 0xFF;
-                      }
-                      else {
-                        // report error
-                        EVM_ERRORF(
-                          "Jump too far in %s on line %d: %s",
-                          inst->file, inst->line, &inst->text[0]
-                        );
-                        result |= 64;
-                      }
-                    break;
-
-                    default:
-                      // report error
-                      EVM_ERRORF(
-                        "Table entry without preceding jump instruction in %s on line %d: %s",
-                        inst->file, inst->line, &inst->text[0]
-                      );
-                      result |= 128;
-                    break;
-                  }
-                break;
-
-                default:
-                  // nothing to do
-                break;
-              }
-            }
-            else { // handle normal instructions
-              switch(inst->binary[0]) {
-                default:
-                  if(mode != INVALID && !entries) {
-                    EVM_ERRORF(
-                      "Empty jump table detected in %s on line %d: %s",
-                      inst->file, inst->line, &inst->text[0]
-                    );
-                    result |= 2048;
-                  }
-                  mode = INVALID;
-                  memcpy(&sect->contents[sect->length], &inst->binary[0], inst->count);
-                  sect->length += inst->count;
-                break;
-
-                // short jumps
-                case OP_JMP:
-                case OP_JLT:
-                case OP_JLE:
-                case OP_JNE:
-                case OP_JEQ:
-                case OP_JGE:
-                case OP_JGT:
-                  mode = INVALID;
-                  target = ref->target;
-                  delta = (target->section->base + target->offset) - (sect->base + ref->offset);
-
-                  if(-128 <= delta && delta <= 127) {
-                    sect->contents[sect->length++] = inst->binary[0];
-                    sect->contents[sect->length++] = (int8_t) delta;
-                  }
-                  else {
-                    // report error
-                    EVM_ERRORF(
-                      "Jump too far in %s on line %d: %s",
-                      inst->file, inst->line, &inst->text[0]
-                    );
-                    result |= 64;
-                  }
-                break;
-
-                // short jump table
-                case OP_JTBL:
-                  sect->contents[sect->length++] = inst->binary[0];
-                  sect->contents[branches = sect->length++] = -1;
-                  tbl_off = sect->base + ref->offset;
-                  entries = 0;
-                  mode = SHORT;
-                break;
-
-                // long jumps
-                case OP_LJMP:
-                case OP_LJLT:
-                case OP_LJLE:
-                case OP_LJNE:
-                case OP_LJEQ:
-                case OP_LJGE:
-                case OP_LJGT:
-                case OP_CALL:
-                  mode = INVALID;
-                  target = ref->target;
-                  delta = (target->section->base + target->offset) - (sect->base + ref->offset);
-
-                  if(-32768 <= delta && delta <= 32767) {
-                    sect->contents[sect->length++] = inst->binary[0];
-                    sect->contents[sect->length++] =  delta       & 0xFF;
-                    sect->contents[sect->length++] = (delta >> 8) & 0xFF;
-                  }
-                  else {
-                    // report error
-                    EVM_ERRORF(
-                      "Jump too far in %s on line %d: %s",
-                      inst->file, inst->line, &inst->text[0]
-                    );
-                    result |= 64;
-                  }
-                break;
-
-                // long jump table
-                case OP_LJTBL:
-                  sect->contents[sect->length++] = inst->binary[0];
-                  sect->contents[branches = sect->length++] = -1;
-                  tbl_off = sect->base + ref->offset;
-                  entries = 0;
-                  mode = LONG;
-                break;
-
-                // extremely long jump
-                case OP_LCALL:
-                  target = ref->target;
-                  delta = (target->section->base + target->offset) - (sect->base + ref->offset);
-
-                  if(-8388608 <= delta && delta <= 8388607) {
-                    sect->contents[sect->length++] = inst->binary[0];
-                    sect->contents[sect->length++] =  delta        & 0xFF;
-                    sect->contents[sect->length++] = (delta >>  8) & 0xFF;
-                    sect->contents[sect->length++] = (delta >> 16) & 0xFF;
-                  }
-                  else {
-                    // report error
-                    EVM_ERRORF(
-                      "Jump too far in %s on line %d: %s",
-                      inst->file, inst->line, &inst->text[0]
-                    );
-                    result |= 64;
-                  }
-                break;
-              }
-            }
-          }
-        }
-        else {
-          // report error
-          EVM_ERRORF("Unable to allocate memory for section: %s", &sect->name[0]);
-          result |= 32;
-          break;
-        }
-      }
+      result |= evmasmSerializeSections(evm, sects);
     }
 
     if(!result) {
@@ -838,7 +1003,7 @@ int evmasmValidateProgram(evm_assembler_t *evm) {
             EVM_ERRORF("Section %s is empty", &sect->name[0]);
             result |= 256;
           }
-          else if((sect->base + sect->length) > sect->next->base) {
+          else if(!relocatable && (sect->base + sect->length) > sect->next->base) {
             // report error
             EVM_ERRORF("Sections %s and %s overlap", &sect->name[0], &sect->next->name[0]);
             result |= 512;
@@ -850,33 +1015,26 @@ int evmasmValidateProgram(evm_assembler_t *evm) {
       }
     }
 
-    if(!result) {
-      evm_instruction_ref_t *ref;
-
+    // the linker checks the placement of sections that are part of an object
+    if(!result && !relocatable) {
       // ensure first byte is a valid instruction and not data
-      for(ref = sects->next->instructions; ref; ref = ref->next) {
-        inst = ref->instruction;
-
-        if(inst->flags & INST_DIRECTIVE) {
-          if(inst->binary[0] == DIR_DATA || inst->binary[0] == DIR_TBL) {
-            // report error
-            EVM_ERRORF(
-              "First byte is not an instruction in %s from line %d: %s",
-              inst->file, inst->line, &inst->text[0]
-            );
-            result |= 1024;
-          }
-        }
-        else if(inst->flags & INST_LABEL) {
-          // ignore normal lables
-        }
-        else {
-          break; // any regular instruction counts
-        }
+      if((inst = (evm_instruction_t *) evmasmLeadingData(sects->next))) {
+        // report error
+        EVM_ERRORF(
+          "First byte is not an instruction in %s from line %d: %.*s",
+          inst->file, inst->line, (int) inst->length, inst->text
+        );
+        result |= 1024;
       }
     }
 
-    if(!result) {
+    if(!result && relocatable) {
+      // an object is as long as all of its sections together
+      for(sect = sects->next; sect != sects; sect = sect->next) {
+        evm->length += sect->length;
+      }
+    }
+    else if(!result) {
       // update the program length
       evm->length = sects->prev->base + sects->prev->length;
     }
@@ -895,9 +1053,13 @@ uint32_t evmasmProgramSize(const evm_assembler_t *evm) {
 
 
 uint32_t evmasmProgramToBuffer(const evm_assembler_t *evm, uint8_t *buf, uint32_t max) {
-  if(evm && buf) {
+  if(evm && buf && !(evm->flags & ASM_RELOCATABLE)) {
     if(evm->length || !evmasmValidateProgram((evm_assembler_t *) evm)) {
-      if(evm->length <= max) {
+      if(evm->length <= max && (evm->flags & ASM_CACHED)) {
+        memcpy(buf, evm->image, evm->length);
+        return evm->length;
+      }
+      else if(evm->length <= max) {
         evm_program_t *prog = evm->output;
         evm_section_t *s;
 
@@ -908,6 +1070,10 @@ uint32_t evmasmProgramToBuffer(const evm_assembler_t *evm, uint8_t *buf, uint32_
           memcpy(&buf[s->base], s->contents, s->length);
         }
 
+        if(evm->flags & ASM_KEYED) {
+          evmasmCacheStore(evm, buf, evm->length);
+        }
+
         return evm->length;
       }
     }
@@ -919,7 +1085,7 @@ uint32_t evmasmProgramToBuffer(const evm_assembler_t *evm, uint8_t *buf, uint32_
 
 int evmasmProgramToFile(const evm_assembler_t *evm, FILE *fp) {
   int result = -1;
-  if(evm && fp) {
+  if(evm && fp && !(evm->flags & ASM_RELOCATABLE)) {
     if(evm->length || !evmasmValidateProgram((evm_assembler_t *) evm)) {
       uint8_t *buffer = malloc(evm->length);
 
@@ -948,316 +1114,2048 @@ int evmasmProgramToFile(const evm_assembler_t *evm, FILE *fp) {
 }
 
 
-static void evmasmClearInstructionList(evm_instruction_t *list) {
-  evm_instruction_t *node, *tmp;
-
-  for(node = list->next; node != list; node = tmp) {
-    tmp = node->next;
-    free(node);
+int evmasmSetRelocatable(evm_assembler_t *evm, int relocatable) {
+  if(evm && !evm->length) {
+    evm->flags = relocatable ? evm->flags | ASM_RELOCATABLE : evm->flags & ~ASM_RELOCATABLE;
+    evm->flags &= ~ASM_KEYED;
+    return 0;
   }
 
-  list->prev = list;
-  list->next = list;
+  return -1;
 }
 
 
-static void evmasmAppendInstruction(evm_instruction_t *list, evm_instruction_t *item) {
-  // point at the new peers
-  item->next = list;
-  item->prev = list->prev;
+// symbol table of an object under construction
+typedef struct evm_symbols_s {
+  evm_hash_t  index;    // symbol number plus one by name
+  struct {
+    const char *name;   // not necessarily terminated
+    uint32_t    length;
+    uint32_t    section;
+    uint32_t    offset;
+  }          *entries;
+  uint32_t    count;
+  uint32_t    capacity;
+  uint32_t    strings;  // bytes needed for the terminated names
+} evm_symbols_t;
 
-  // make new peers consistent
-  list->prev->next = item;
-  list->prev = item;
-}
 
+static int evmasmAddSymbol(evm_symbols_t *table, const char *name, uint32_t length,
+                           uint32_t section, uint32_t offset) {
+  uint32_t hash = evmasmHashString(name, length);
 
-static void evmasmClearSectionList(evm_section_t *list) {
-  evm_section_t *node, *tmp;
+  if(evmasmHashFind(&table->index, name, length, hash)) {
+    return 0; // labels are unique so only references to undefined labels repeat
+  }
 
-  for(node = list->next; node != list; node = tmp) {
-    tmp = node->next;
-    evmasmDeleteSection(node);
+  if(table->count == table->capacity) {
+    uint32_t capacity = table->capacity ? table->capacity * 2U : 256U;
+    void *entries = realloc(table->entries, capacity * sizeof(*table->entries));
+
+    if(entries) {
+      table->entries = entries;
+      table->capacity = capacity;
+    }
+    else {
+      return -1;
+    }
   }
 
-  list->prev = list;
-  list->next = list;
+  table->entries[table->count].name = name;
+  table->entries[table->count].length = length;
+  table->entries[table->count].section = section;
+  table->entries[table->count].offset = offset;
+  table->strings += length + 1U;
+
+  return evmasmHashInsert(&table->index, name, length, hash, (void *) (uintptr_t) ++table->count);
 }
 
 
-static void evmasmClearLabelList(evm_label_t *list) {
-  evm_label_t *node, *tmp;
+int evmasmObjectToFile(const evm_assembler_t *evm, FILE *fp) {
+  evm_symbols_t symbols = { { NULL, 0, 0 }, NULL, 0, 0, 0 };
+  uint8_t      *buffer = NULL;
+  int           result = -1;
 
-  for(node = list->next; node != list; node = tmp) {
-    tmp = node->next;
-    free(node);
+  if(evm && fp && (evm->flags & (ASM_RELOCATABLE | ASM_CACHED)) == (ASM_RELOCATABLE | ASM_CACHED)) {
+    return fwrite(evm->image, 1, evm->length, fp) == evm->length ? 0 : -1;
   }
 
-  list->prev = list;
-  list->next = list;
-}
+  if(evm && fp && (evm->flags & ASM_RELOCATABLE) &&
+     (evm->length || !evmasmValidateProgram((evm_assembler_t *) evm))) {
+    evm_section_t *list = &evm->output->sections, *sect;
+    evm_label_t   *label;
+    uint32_t       sections = 0, relocs = 0, names = 0, size, index;
 
+    result = 0;
 
-static void evmasmClearFilesList(evm_ptr_list_t *list) {
-  evm_ptr_list_t *node, *tmp;
+    // every label is exported followed by the labels the object expects the linker to find
+    for(sect = list->next; sect != list; sect = sect->next, ++sections) {
+      for(label = sect->labels; label; label = label->next) {
+        result |= evmasmAddSymbol(
+          &symbols, &label->name[0], (uint32_t) strlen(&label->name[0]), sections, label->offset
+        );
+      }
 
-  for(node = list->next; node != list; node = tmp) {
-    tmp = node->next;
-    free(node);
-  }
+      names += (uint32_t) strlen(&sect->name[0]) + 1U;
+    }
 
-  list->prev = list;
-  list->next = list;
-}
+    for(sect = list->next; sect != list; sect = sect->next) {
+      for(index = 0; index < sect->relocCount; ++index) {
+        const evm_instruction_t *inst = sect->relocs[index].instruction;
+
+        result |= evmasmAddSymbol(
+          &symbols, &inst->text[inst->binary[1]], evmasmOperandLength(inst), EVM_OBJECT_UNDEFINED, 0
+        );
+      }
+
+      relocs += sect->relocCount;
+    }
+
+    size = 4U * (EVM_OBJECT_HEADER_WORDS + sections * EVM_OBJECT_SECTION_WORDS +
+                 symbols.count * EVM_OBJECT_SYMBOL_WORDS + relocs * EVM_OBJECT_RELOC_WORDS) +
+           symbols.strings + names + evm->length;
+
+    if(!result && (buffer = malloc(size))) {
+      uint8_t *out = buffer;
+      uint32_t string = 0, number = 0;
+
+      out = evmasmStoreWord(out, EVM_OBJECT_MAGIC);
+      out = evmasmStoreWord(out, EVM_OBJECT_VERSION);
+      out = evmasmStoreWord(out, sections);
+      out = evmasmStoreWord(out, symbols.count);
+      out = evmasmStoreWord(out, relocs);
+      out = evmasmStoreWord(out, symbols.strings + names);
+
+      // the section names follow the symbol names in the string table
+      for(sect = list->next, string = symbols.strings; sect != list; sect = sect->next) {
+        out = evmasmStoreWord(out, string);
+        out = evmasmStoreWord(out, sect->base);
+        out = evmasmStoreWord(out, (sect->flags & EVM_OBJECT_BASED) |
+                                   (evmasmLeadingData(sect) ? EVM_OBJECT_DATA_FIRST : 0));
+        out = evmasmStoreWord(out, sect->length);
+        string += (uint32_t) strlen(&sect->name[0]) + 1U;
+      }
+
+      for(index = 0, string = 0; index < symbols.count; ++index) {
+        out = evmasmStoreWord(out, string);
+        out = evmasmStoreWord(out, symbols.entries[index].section);
+        out = evmasmStoreWord(out, symbols.entries[index].offset);
+        string += symbols.entries[index].length + 1U;
+      }
+
+      for(sect = list->next; sect != list; sect = sect->next, ++number) {
+        for(index = 0; index < sect->relocCount; ++index) {
+          const evm_reloc_t *reloc = &sect->relocs[index];
+          const char *name = &reloc->instruction->text[reloc->instruction->binary[1]];
+          uint32_t length = evmasmOperandLength(reloc->instruction);
+          uintptr_t symbol = (uintptr_t) evmasmHashFind(
+            &symbols.index, name, length, evmasmHashString(name, length)
+          );
+
+          out = evmasmStoreWord(out, number);
+          out = evmasmStoreWord(out, reloc->offset);
+          out = evmasmStoreWord(out, reloc->origin);
+          out = evmasmStoreWord(out, reloc->size);
+          out = evmasmStoreWord(out, (uint32_t) symbol - 1U);
+        }
+      }
+
+      for(index = 0; index < symbols.count; ++index) {
+        memcpy(out, symbols.entries[index].name, symbols.entries[index].length);
+        out += symbols.entries[index].length;
+        *out++ = '\0';
+      }
+
+      for(sect = list->next; sect != list; sect = sect->next) {
+        size_t length = strlen(&sect->name[0]) + 1U;
+
+        memcpy(out, &sect->name[0], length);
+        out += length;
+      }
+
+      for(sect = list->next; sect != list; sect = sect->next) {
+        if(sect->length) {
+          memcpy(out, sect->contents, sect->length);
+          out += sect->length;
+        }
+      }
+
+      if(evm->flags & ASM_KEYED) {
+        evmasmCacheStore(evm, buffer, size);
+      }
+
+      result = fwrite(buffer, 1, size, fp) == size ? 0 : -1;
+    }
+    else {
+      result = -1;
+    }
+  }
+
+  evmasmHashClear(&symbols.index);
+  free(symbols.entries);
+  free(buffer);
+
+  return result;
+}
+
+
+int evmasmSetOptimization(evm_assembler_t *evm, int level) {
+  if(evm && 0 <= level && level <= 2) {
+    evm->level = level ? 1U : 0U; // -O2 runs the passes of -O1 and shares its cache entries
+    evm->flags &= ~ASM_KEYED;
+    return 0;
+  }
+
+  return -1;
+}
+
+
+void evmasmOptimizationReport(const evm_assembler_t *evm, uint32_t *insts, uint32_t *bytes) {
+  if(insts) { *insts = evm ? evm->removed : 0; }
+  if(bytes) { *bytes = evm ? evm->saved   : 0; }
+}
+
+
+static void *evmasmArenaAllocate(evm_assembler_t *evm, size_t size) {
+  evm_arena_t *block = evm->arena;
+  void *ptr;
+
+  size = (size + 7U) & ~(size_t) 7U; // keep every allocation pointer aligned
+
+  if(!block || block->size - block->used < size) {
+    size_t capacity = size > EVM_ARENA_BLOCK ? size : EVM_ARENA_BLOCK;
+
+    if(!(block = malloc(sizeof(evm_arena_t) + capacity))) {
+      return NULL;
+    }
+
+    block->size = capacity;
+    block->used = 0;
+    block->next = evm->arena;
+    evm->arena = block;
+  }
+
+  ptr = &block->data[block->used];
+  block->used += size;
+  memset(ptr, 0, size);
+
+  return ptr;
+}
+
+
+// copy the text between start and end into the arena and terminate it
+static char *evmasmArenaString(evm_assembler_t *evm, const char *start, const char *end) {
+  char *str = evmasmArenaAllocate(evm, (end - start) + 1U);
+
+  if(str) {
+    memcpy(str, start, end - start);
+    str[end - start] = '\0';
+  }
+
+  return str;
+}
+
+
+// take ownership of every block of another assembler's arena
+static void evmasmArenaAdopt(evm_assembler_t *evm, evm_assembler_t *other) {
+  evm_arena_t *tail = other->arena;
+
+  if(tail) {
+    while(tail->next) { tail = tail->next; }
+
+    // keep allocating from the current block by splicing the others in behind it
+    if(evm->arena) {
+      tail->next = evm->arena->next;
+      evm->arena->next = other->arena;
+    }
+    else {
+      evm->arena = other->arena;
+    }
+
+    other->arena = NULL;
+  }
+}
+
+
+static void evmasmArenaClear(evm_assembler_t *evm) {
+  evm_arena_t *block, *tmp;
+
+  for(block = evm->arena; block; block = tmp) {
+    tmp = block->next;
+    free(block);
+  }
+
+  evm->arena = NULL;
+}
+
+
+static void evmasmClearSectionList(evm_section_t *list) {
+  evm_section_t *node, *tmp;
+
+  for(node = list->next; node != list; node = tmp) {
+    tmp = node->next;
+    evmasmDeleteSection(node);
+  }
+
+  list->prev = list;
+  list->next = list;
+}
+
+
+// append a new instruction to the end of the instruction vector, without a copy the text must
+// outlive the assembler
+static evm_instruction_t *evmasmNewInstruction(evm_assembler_t *evm, const char *name,
+                                               const char *start, const char *end, uint32_t line,
+                                               int copy) {
+  evm_instruction_t *inst;
+
+  if(evm->count == evm->capacity) {
+    uint32_t capacity = evm->capacity ? evm->capacity * 2U : 1024U;
+    evm_instruction_t *insts = realloc(evm->instructions, capacity * sizeof(evm_instruction_t));
+
+    if(!insts) {
+      return NULL;
+    }
+
+    evm->instructions = insts;
+    evm->capacity = capacity;
+  }
+
+  inst = &evm->instructions[evm->count];
+  memset((void *) inst, 0, sizeof(evm_instruction_t));
+
+  if(!(inst->text = copy ? evmasmArenaString(evm, start, end) : start)) {
+    return NULL;
+  }
+
+  inst->length = (uint32_t) (end - start);
+  inst->file = name;
+  inst->line = line;
+  ++evm->count;
+
+  return inst;
+}
+
+
+static evm_program_t *evmasmNewProgram() {
+  evm_program_t *prog = calloc(1, sizeof(evm_program_t));
+
+  if(prog) {
+    prog->sections.prev = &prog->sections;
+    prog->sections.next = &prog->sections;
+  }
+
+  return prog;
+}
+
+
+static void evmasmDeleteProgram(evm_program_t *prog) {
+  if(prog) {
+    evmasmHashClear(&prog->labels);
+    evmasmHashClear(&prog->names);
+    evmasmClearSectionList(&prog->sections);
+    free(prog);
+  }
+}
+
+
+static const char *evmasmCanonicalizeString(evm_assembler_t *evm, const char *str) {
+  evm_program_t *prog = evm->output;
+  uint32_t length = (uint32_t) strlen(str);
+  uint32_t hash = evmasmHashString(str, length);
+  char *found = evmasmHashFind(&prog->names, str, length, hash);
+
+  if(!found && (found = evmasmArenaString(evm, str, &str[length])) &&
+     evmasmHashInsert(&prog->names, found, length, hash, found)) {
+    found = NULL; // failure!
+  }
+
+  return found;
+}
+
+
+static evm_section_t *evmasmNewSection(evm_assembler_t *evm, const char *name, uint32_t length) {
+  evm_section_t *section = evmasmArenaAllocate(evm, sizeof(evm_section_t) + length + 1U);
+
+  if(section) {
+    memcpy(&section->name[0], name, length); // the arena has already terminated it
+  }
+
+  return section;
+}
+
+
+static void evmasmDeleteSection(evm_section_t *section) {
+  if(section) {
+    // the section itself lives in the arena
+    free(section->refs);
+    free(section->relocs);
+    free(section->contents);
+  }
+}
+
+
+static evm_section_t *evmasmCanonicalizeSection(evm_assembler_t *evm, const char *name,
+                                                uint32_t length) {
+  evm_section_t *list = &evm->output->sections;
+  evm_section_t *section;
+
+  for(section = list->next; section != list; section = section->next) {
+    if(!strncmp(&section->name[0], name, length) && !section->name[length]) {
+      return section; // found it
+    }
+  }
+
+  // append to list if not found
+  if((section = evmasmNewSection(evm, name, length))) {
+    section->prev = list->prev;
+    list->prev->next = section;
+    section->next = list;
+    list->prev = section;
+  }
+
+  return section;
+}
+
+
+// stable insertion sort of the sections on their base address
+static void evmasmSortSections(evm_section_t *list) {
+  evm_section_t *sect, *next, *pos;
+
+  for(sect = list->next->next; sect != list; sect = next) {
+    next = sect->next;
+
+    for(pos = sect->prev; pos != list && pos->base > sect->base; pos = pos->prev);
+
+    if(pos != sect->prev) {
+      // unlink
+      sect->prev->next = sect->next;
+      sect->next->prev = sect->prev;
+
+      // insert after pos
+      sect->prev = pos;
+      sect->next = pos->next;
+      pos->next->prev = sect;
+      pos->next = sect;
+    }
+  }
+}
+
+
+static evm_instruction_ref_t *evmasmAddToSection(evm_section_t *section, evm_instruction_t *inst) {
+  evm_instruction_ref_t *ref = NULL;
+
+  if(section) {
+    if(section->refCount == section->refCapacity) {
+      uint32_t capacity = section->refCapacity ? section->refCapacity * 2U : 256U;
+      evm_instruction_ref_t *refs = realloc(section->refs, capacity * sizeof(evm_instruction_ref_t));
+
+      if(refs) {
+        section->refs = refs;
+        section->refCapacity = capacity;
+      }
+      else {
+        return NULL;
+      }
+    }
+
+    ref = &section->refs[section->refCount++];
+    memset((void *) ref, 0, sizeof(evm_instruction_ref_t));
+
+    if(section->refCount > 1) {
+      ref->offset = ref[-1].offset + ref[-1].size;
+    }
+
+    ref->instruction = inst;
+
+    if(!(inst->flags & INST_DIRECTIVE)) {
+      // assume the simple serializer has done a good job except for jumps and calls, which wait
+      // for all labels to be resolved before their size is settled, jump tables don't include
+      // their entries
+      if(EVM_OPCODE_INFO[inst->binary[0]].branch != EVM_BRANCH_NONE) {
+        ref->size = EVM_OPCODE_INFO[inst->binary[0]].length;
+      }
+      else {
+        ref->size = inst->count; // assume the serializer got it right
+      }
+    }
+    else if(inst->binary[0] == DIR_DATA) {
+      ref->size = inst->count - 1;
+    }
+    else if(inst->binary[0] == DIR_TBL) {
+      // search back for jump table instruction
+      const evm_instruction_ref_t *prev = ref;
+      ref->size = 0; // invalid size until resolved
+
+      while(prev-- != section->refs) {
+        const evm_instruction_t *i = prev->instruction;
+
+        if(i->binary[0] == OP_JTBL) {
+          ref->size = 1; // short jumps only
+          break;
+        }
+        else if(i->binary[0] == OP_LJTBL) {
+          ref->size = 2; // long jumps
+          break;
+        }
+      }
+    }
+    else {
+      // most directives and invalid instructions don't get added to the binary
+      ref->size = 0;
+    }
+  }
+
+  return ref;
+}
+
+
+// serialize the instructions of a single section, the layout must already be final
+static int evmasmSerializeSection(evm_section_t *sect, int relocatable) {
+  evm_instruction_t *inst;
+  uint32_t index;
+  int result = 0;
+
+  sect->capacity = evmasmCalculateLikelySectionLength(sect);
+  sect->length = 0;
+  sect->relocCount = 0;
+
+  if(sect->contents) {
+    free(sect->contents); // avoid memory leaks
+  }
+
+  if((sect->contents = calloc(sect->capacity, 1)) || !sect->capacity) {
+    enum { INVALID, SHORT, LONG } mode = INVALID;
+    int delta, branches = 0, entries = 0;
+    uint32_t tbl_off = 0;
+
+    for(index = 0; index < sect->refCount; ++index) {
+      evm_instruction_ref_t *ref = &sect->refs[index];
+      inst = ref->instruction;
+
+      if(inst->flags & INST_DIRECTIVE) { // handle the data/address directives
+        switch(inst->binary[0]) {
+          case DIR_DATA:
+            memcpy(&sect->contents[sect->length], &inst->binary[1], ref->size);
+            sect->length += ref->size;
+          break;
+
+          case DIR_TBL:
+            switch(mode) {
+              case SHORT:
+                if(evmasmTargetDelta(sect, ref, tbl_off, sect->length, 1, relocatable, &delta)) {
+                  result |= 32;
+                }
+                else if(-128 <= delta && delta <= 127) {
+                  ++entries;
+                  sect->contents[branches]++;
+                  sect->contents[sect->length++] = (int8_t) delta;
+                }
+                else {
+                  // report error
+                  EVM_ERRORF(
+                    "Jump too far in %s on line %d: %.*s",
+                    inst->file, inst->line, (int) inst->length, inst->text
+                  );
+                  result |= 64;
+                }
+              break;
+
+              case LONG:
+                if(evmasmTargetDelta(sect, ref, tbl_off, sect->length, 2, relocatable, &delta)) {
+                  result |= 32;
+                }
+                else if(-32768 <= delta && delta <= 32767) {
+                  ++entries;
+                  sect->contents[branches]++;
+                  sect->contents[sect->length++] =  delta       & 0xFF;
+                  sect->contents[sect->length++] = (delta >> 8) & 0xFF;
+                }
+                else {
+                  // report error
+                  EVM_ERRORF(
+                    "Jump too far in %s on line %d: %.*s",
+                    inst->file, inst->line, (int) inst->length, inst->text
+                  );
+                  result |= 64;
+                }
+              break;
+
+              default:
+                // report error
+                EVM_ERRORF(
+                  "Table entry without preceding jump instruction in %s on line %d: %.*s",
+                  inst->file, inst->line, (int) inst->length, inst->text
+                );
+                result |= 128;
+              break;
+            }
+          break;
+
+          default:
+            // nothing to do
+          break;
+        }
+      }
+      else { // handle normal instructions
+        uint8_t op = evmasmRelaxedOpcode(ref);
+
+        switch(op) {
+          default:
+            if(mode != INVALID && !entries) {
+              EVM_ERRORF(
+                "Empty jump table detected in %s on line %d: %.*s",
+                inst->file, inst->line, (int) inst->length, inst->text
+              );
+              result |= 2048;
+            }
+            mode = INVALID;
+            memcpy(&sect->contents[sect->length], &inst->binary[0], inst->count);
+            sect->length += inst->count;
+          break;
+
+          // short jumps
+          case OP_JMP:
+          case OP_JLT:
+          case OP_JLE:
+          case OP_JNE:
+          case OP_JEQ:
+          case OP_JGE:
+          case OP_JGT:
+          case OP_DJNZ:
+            mode = INVALID;
+            if(evmasmTargetDelta(sect, ref, ref->offset, sect->length + 1, 1, relocatable, &delta)) {
+              result |= 32;
+            }
+            else if(-128 <= delta && delta <= 127) {
+              sect->contents[sect->length++] = op;
+              sect->contents[sect->length++] = (int8_t) delta;
+            }
+            else {
+              // report error
+              EVM_ERRORF(
+                "Jump too far in %s on line %d: %.*s",
+                inst->file, inst->line, (int) inst->length, inst->text
+              );
+              result |= 64;
+            }
+          break;
+
+          // short jump table
+          case OP_JTBL:
+            sect->contents[sect->length++] = op;
+            sect->contents[branches = sect->length++] = -1;
+            tbl_off = ref->offset;
+            entries = 0;
+            mode = SHORT;
+          break;
+
+          // long jumps
+          case OP_LJMP:
+          case OP_LJLT:
+          case OP_LJLE:
+          case OP_LJNE:
+          case OP_LJEQ:
+          case OP_LJGE:
+          case OP_LJGT:
+          case OP_LDJNZ:
+          case OP_CALL:
+            mode = INVALID;
+            if(evmasmTargetDelta(sect, ref, ref->offset, sect->length + 1, 2, relocatable, &delta)) {
+              result |= 32;
+            }
+            else if(-32768 <= delta && delta <= 32767) {
+              sect->contents[sect->length++] = op;
+              sect->contents[sect->length++] =  delta       & 0xFF;
+              sect->contents[sect->length++] = (delta >> 8) & 0xFF;
+            }
+            else {
+              // report error
+              EVM_ERRORF(
+                "Jump too far in %s on line %d: %.*s",
+                inst->file, inst->line, (int) inst->length, inst->text
+              );
+              result |= 64;
+            }
+          break;
+
+          // compare and branch, the flags and the value compared to come before the offset
+          case OP_JCMP_8I:
+          case OP_LJCMP_8I: {
+            uint32_t size = op == OP_LJCMP_8I ? 2U : 1U;
+            int32_t limit = op == OP_LJCMP_8I ? 32767 : 127;
+
+            mode = INVALID;
+            if(evmasmTargetDelta(sect, ref, ref->offset, sect->length + 3, size, relocatable,
+                                 &delta)) {
+              result |= 32;
+            }
+            else if(-limit - 1 <= delta && delta <= limit) {
+              sect->contents[sect->length++] = op;
+              sect->contents[sect->length++] = inst->binary[2];
+              sect->contents[sect->length++] = inst->binary[3];
+              sect->contents[sect->length++] = delta & 0xFF;
+              if(size == 2U) {
+                sect->contents[sect->length++] = (delta >> 8) & 0xFF;
+              }
+            }
+            else {
+              // report error
+              EVM_ERRORF(
+                "Jump too far in %s on line %d: %.*s",
+                inst->file, inst->line, (int) inst->length, inst->text
+              );
+              result |= 64;
+            }
+          } break;
+
+          // long jump table
+          case OP_LJTBL:
+            sect->contents[sect->length++] = op;
+            sect->contents[branches = sect->length++] = -1;
+            tbl_off = ref->offset;
+            entries = 0;
+            mode = LONG;
+          break;
+
+          // extremely long jump
+          case OP_LCALL:
+            if(evmasmTargetDelta(sect, ref, ref->offset, sect->length + 1, 3, relocatable, &delta)) {
+              result |= 32;
+            }
+            else if(-8388608 <= delta && delta <= 8388607) {
+              sect->contents[sect->length++] = op;
+              sect->contents[sect->length++] =  delta        & 0xFF;
+              sect->contents[sect->length++] = (delta >>  8) & 0xFF;
+              sect->contents[sect->length++] = (delta >> 16) & 0xFF;
+            }
+            else {
+              // report error
+              EVM_ERRORF(
+                "Jump too far in %s on line %d: %.*s",
+                inst->file, inst->line, (int) inst->length, inst->text
+              );
+              result |= 64;
+            }
+          break;
+        }
+      }
+    }
+  }
+  else {
+    // report error
+    EVM_ERRORF("Unable to allocate memory for section: %s", &sect->name[0]);
+    result |= 32;
+  }
+
+  return result;
+}
+
+
+// distance from an origin within the section to the target of the instruction, a target the
+// linker has to place is recorded as a relocation of the field and written as zero
+static int evmasmTargetDelta(evm_section_t *sect, const evm_instruction_ref_t *ref, uint32_t origin,
+                             uint32_t field, uint32_t size, int relocatable, int *delta) {
+  const evm_label_t *target = ref->target;
+  evm_reloc_t *reloc;
+
+  if(target && (!relocatable || target->section == sect)) {
+    *delta = (int) (target->section->base + target->offset) - (int) (sect->base + origin);
+    return 0;
+  }
+
+  if(sect->relocCount == sect->relocCapacity) {
+    uint32_t capacity = sect->relocCapacity ? sect->relocCapacity * 2U : 64U;
+    evm_reloc_t *relocs = realloc(sect->relocs, capacity * sizeof(evm_reloc_t));
+
+    if(relocs) {
+      sect->relocs = relocs;
+      sect->relocCapacity = capacity;
+    }
+    else {
+      EVM_ERRORF("Unable to allocate memory for relocations in section: %s", &sect->name[0]);
+      return -1;
+    }
+  }
+
+  reloc = &sect->relocs[sect->relocCount++];
+  reloc->instruction = ref->instruction;
+  reloc->offset = field;
+  reloc->origin = origin;
+  reloc->size = size;
+  *delta = 0;
+
+  return 0;
+}
+
+
+typedef struct evm_serialize_job_s {
+  evm_section_t **sections;
+  int            *results;
+  int             relocatable;
+} evm_serialize_job_t;
+
+
+static void evmasmSerializeTask(void *context, uint32_t index) {
+  evm_serialize_job_t *job = (evm_serialize_job_t *) context;
+
+  job->results[index] = evmasmSerializeSection(job->sections[index], job->relocatable);
+}
+
+
+// sections only read each other's labels once laid out so they can be serialized independently
+static int evmasmSerializeSections(const evm_assembler_t *evm, evm_section_t *sects) {
+  uint32_t threads = evmasmThreadCount(evm);
+  evm_serialize_job_t job = { NULL, NULL, !!(evm->flags & ASM_RELOCATABLE) };
+  evm_section_t *sect;
+  uint32_t count = 0, index;
+  int result = 0;
+
+  for(sect = sects->next; sect != sects; sect = sect->next) {
+    ++count;
+  }
+
+  if(threads > 1 && count > 1 &&
+     (job.sections = malloc(count * sizeof(evm_section_t *))) &&
+     (job.results = malloc(count * sizeof(int)))) {
+    for(index = 0, sect = sects->next; sect != sects; sect = sect->next) {
+      job.sections[index++] = sect;
+    }
+
+    evmasmParallelFor(threads, count, &evmasmSerializeTask, &job);
+
+    for(index = 0; index < count; ++index) {
+      result |= job.results[index];
+    }
+  }
+  else {
+    for(sect = sects->next; sect != sects; sect = sect->next) {
+      result |= evmasmSerializeSection(sect, job.relocatable);
+    }
+  }
+
+  free(job.sections);
+  free(job.results);
+
+  return result;
+}
+
+
+// move the instructions of another assembler to the end of this one
+static int evmasmMerge(evm_assembler_t *evm, evm_assembler_t *other) {
+  const char *file = NULL, *canonical = NULL;
+  uint32_t index;
+
+  if(evm->count + other->count > evm->capacity) {
+    uint32_t capacity = evm->capacity ? evm->capacity : 1024U;
+    evm_instruction_t *insts;
+
+    while(capacity < evm->count + other->count) { capacity *= 2U; }
+
+    if(!(insts = realloc(evm->instructions, capacity * sizeof(evm_instruction_t)))) {
+      return -1;
+    }
+
+    evm->instructions = insts;
+    evm->capacity = capacity;
+  }
+
+  for(index = 0; index < other->count; ++index) {
+    evm_instruction_t *inst = &evm->instructions[evm->count + index];
+
+    *inst = other->instructions[index];
+
+    // file names are canonical within the other assembler, so they only change occasionally
+    if(inst->file != file) {
+      file = inst->file;
+      canonical = evmasmCanonicalizeString(evm, file);
+    }
+
+    inst->file = canonical;
+  }
+
+  evm->count += other->count;
+  other->count = 0;
+
+  // the instruction text may live in the other arena
+  evmasmArenaAdopt(evm, other);
+
+  return 0;
+}
+
+
+static uint32_t evmasmThreadCount(const evm_assembler_t *evm) {
+#if EVM_THREAD_SUPPORT == 1
+  long online = evm->threads ? (long) evm->threads : sysconf(_SC_NPROCESSORS_ONLN);
+
+  return online < 1 ? 1U : online > (long) EVM_MAX_THREADS ? EVM_MAX_THREADS : (uint32_t) online;
+#else
+  (void) evm;
+  return 1U;
+#endif
+}
+
+
+#if EVM_THREAD_SUPPORT == 1
+typedef struct evm_pool_s {
+  pthread_mutex_t  lock;
+  evm_task_t       task;
+  void            *context;
+  uint32_t         next;
+  uint32_t         count;
+} evm_pool_t;
+
+
+static void *evmasmWorker(void *arg) {
+  evm_pool_t *pool = (evm_pool_t *) arg;
+
+  for(;;) {
+    uint32_t index;
+
+    pthread_mutex_lock(&pool->lock);
+    index = pool->next < pool->count ? pool->next++ : pool->count;
+    pthread_mutex_unlock(&pool->lock);
+
+    if(index == pool->count) {
+      return NULL;
+    }
+
+    pool->task(pool->context, index);
+  }
+}
+#endif
+
+
+// run the task for every index, the calling thread is one of the workers
+static void evmasmParallelFor(uint32_t threads, uint32_t count, evm_task_t task, void *context) {
+  uint32_t index;
+#if EVM_THREAD_SUPPORT == 1
+  evm_pool_t pool;
+  pthread_t workers[EVM_MAX_THREADS];
+  uint32_t started = 0;
+
+  pool.task = task;
+  pool.context = context;
+  pool.next = 0;
+  pool.count = count;
+
+  if(!pthread_mutex_init(&pool.lock, NULL)) {
+    // fewer workers than requested only means the remaining ones do more of the work
+    while(started + 1U < threads && started + 1U < count &&
+          !pthread_create(&workers[started], NULL, &evmasmWorker, &pool)) {
+      ++started;
+    }
+
+    evmasmWorker(&pool);
+
+    for(index = 0; index < started; ++index) {
+      pthread_join(workers[index], NULL);
+    }
+
+    pthread_mutex_destroy(&pool.lock);
+    return;
+  }
+#else
+  (void) threads;
+#endif
+
+  for(index = 0; index < count; ++index) {
+    task(context, index);
+  }
+}
+
+
+// the far form a relaxable branch is promoted to, the long jumps follow their near forms
+static uint8_t evmasmFarOpcode(uint8_t opcode) {
+  return opcode == OP_CALL ? OP_LCALL : (uint8_t) (opcode | (OP_LJMP - OP_JMP));
+}
+
+
+// determine which encoding a relaxable branch has been assigned
+static uint8_t evmasmRelaxedOpcode(const evm_instruction_ref_t *ref) {
+  const evm_instruction_t *inst = ref->instruction;
+
+  if((inst->flags & INST_RELAXABLE) && ref->size > EVM_OPCODE_INFO[inst->binary[0]].length) {
+    return evmasmFarOpcode(inst->binary[0]);
+  }
+
+  return inst->binary[0];
+}
+
+
+// grow branches to their long form until every branch can reach its target, the distance to a
+// label outside the section is unknown in an object so those branches take the longest form
+static void evmasmRelaxBranches(evm_section_t *sects, int relocatable) {
+  evm_section_t *sect;
+  int changed, passes = 0;
+
+  do {
+    changed = 0;
+    ++passes;
+
+    // lay out the instructions with the current branch sizes
+    for(sect = sects->next; sect != sects; sect = sect->next) {
+      evm_instruction_ref_t *refs = sect->refs;
+      evm_label_t *label;
+      uint32_t index, offset = 0;
+
+      for(index = 0; index < sect->refCount; ++index) {
+        refs[index].offset = offset;
+        offset += refs[index].size;
+      }
+
+      for(label = sect->labels; label; label = label->next) {
+        label->offset = label->after ? refs[label->after - 1].offset + refs[label->after - 1].size : 0;
+      }
+    }
+
+    // grow any short branch that can't reach its target, sizes only ever increase
+    for(sect = sects->next; sect != sects; sect = sect->next) {
+      uint32_t index;
+
+      for(index = 0; index < sect->refCount; ++index) {
+        evm_instruction_ref_t *ref = &sect->refs[index];
+        evm_instruction_t *inst = ref->instruction;
+        int32_t far = EVM_OPCODE_INFO[evmasmFarOpcode(inst->binary[0])].length;
+
+        if((inst->flags & INST_RELAXABLE) &&
+           (!ref->target || (relocatable && ref->target->section != sect))) {
+          if(ref->size < far) {
+            ref->size = far;
+            changed = -1;
+          }
+        }
+        else if(inst->flags & INST_RELAXABLE) {
+          evm_label_t *target = ref->target;
+          int32_t delta = (int32_t) (target->section->base + target->offset) -
+                          (int32_t) (sect->base + ref->offset);
+          int32_t limit = inst->binary[0] == OP_CALL ? 32767 : 127; // reach of the near form
+
+          if(ref->size < far && (delta < -limit - 1 || limit < delta)) {
+            ref->size = far;
+            changed = -1;
+          }
+        }
+      }
+    }
+  } while(changed);
+
+  EVM_DEBUGF("Branch relaxation finished after %d passes", passes);
+}
+
+
+static uint32_t evmasmCalculateLikelySectionLength(evm_section_t *section) {
+  uint32_t length = 0U;
+
+  if(section && section->refCount) {
+    evm_instruction_ref_t *inst = &section->refs[section->refCount - 1];
+
+    length = inst->offset + inst->size;
+  }
+
+  return length;
+}
+
+
+// the data that would be mistaken for the first instruction of a section, if any
+static const evm_instruction_t *evmasmLeadingData(const evm_section_t *section) {
+  uint32_t index;
+
+  for(index = 0; index < section->refCount; ++index) {
+    const evm_instruction_t *inst = section->refs[index].instruction;
+
+    if(inst->flags & INST_DIRECTIVE) {
+      if(inst->binary[0] == DIR_DATA || inst->binary[0] == DIR_TBL) {
+        return inst;
+      }
+    }
+    else if(!(inst->flags & INST_LABEL)) {
+      break; // any regular instruction counts
+    }
+  }
+
+  return NULL;
+}
+
+
+static evm_label_t *evmasmAppendLabel(evm_assembler_t *evm, evm_section_t *section,
+                                      const char *name, uint32_t length) {
+  evm_label_t *label = NULL;
+
+  if(section && (label = evmasmArenaAllocate(evm, sizeof(evm_label_t) + length + 1U))) {
+    label->offset = 0xFF000000U; // maximum section size is 24bits
+    label->id = ++section->labelCount;
+    label->section = section;
+    memcpy(&label->name[0], name, length); // the arena has already terminated it
+
+    if(section->lastLabel) {
+      section->lastLabel->next = label;
+    }
+    else {
+      section->labels = label;
+    }
+    section->lastLabel = label;
+  }
+
+  return label;
+}
+
+
+// populate the mnemonic and directive indices, the tables are constant so this only happens once
+static void evmasmPopulateIndices(void) {
+  uint32_t index, slot;
+
+  for(index = 0; MNEMONICS[index].tag; ++index) {
+    const char *tag = &MNEMONICS[index].tag[0];
+
+    for(slot = evmasmHashToken(tag, NULL); MNEMONIC_INDEX[slot & (EVM_MNEMONIC_SLOTS - 1U)]; ++slot);
+    MNEMONIC_INDEX[slot & (EVM_MNEMONIC_SLOTS - 1U)] = (uint16_t) (index + 1U);
+  }
+
+  for(index = 0; DIRECTIVES[index].tag; ++index) {
+    const char *tag = &DIRECTIVES[index].tag[0];
+
+    for(slot = evmasmHashToken(tag, NULL); DIRECTIVE_INDEX[slot & (EVM_DIRECTIVE_SLOTS - 1U)]; ++slot);
+    DIRECTIVE_INDEX[slot & (EVM_DIRECTIVE_SLOTS - 1U)] = (uint16_t) (index + 1U);
+  }
+}
+
+
+// assemblers initialized on several threads wait for the one populating the indices
+static void evmasmBuildIndices(void) {
+#if EVM_THREAD_SUPPORT == 1
+  (void) pthread_once(&INDICES_BUILT, &evmasmPopulateIndices);
+#else
+  if(!INDICES_BUILT) {
+    evmasmPopulateIndices();
+    INDICES_BUILT = 1;
+  }
+#endif
+}
+
+
+static const evm_mnemonic_t *evmasmFindMnemonic(const char *start, const char *end) {
+  uint32_t slot = evmasmHashToken(start, end);
+  uint16_t index;
+
+  while((index = MNEMONIC_INDEX[slot++ & (EVM_MNEMONIC_SLOTS - 1U)])) {
+    if(!mnemonicCompare(&MNEMONICS[index - 1U].tag[0], start, end)) {
+      return &MNEMONICS[index - 1U];
+    }
+  }
+
+  return NULL;
+}
+
+
+static const evm_directive_t *evmasmFindDirective(const char *start, const char *end) {
+  uint32_t slot = evmasmHashToken(start, end);
+  uint16_t index;
+
+  while((index = DIRECTIVE_INDEX[slot++ & (EVM_DIRECTIVE_SLOTS - 1U)])) {
+    if(!mnemonicCompare(&DIRECTIVES[index - 1U].tag[0], start, end)) {
+      return &DIRECTIVES[index - 1U];
+    }
+  }
+
+  return NULL;
+}
+
+
+// FNV-1a of a string that isn't necessarily terminated
+static uint32_t evmasmHashString(const char *str, uint32_t length) {
+  uint32_t hash = 2166136261U;
+
+  while(length--) {
+    hash = (hash ^ (uint8_t) *str++) * 16777619U;
+  }
+
+  return hash;
+}
+
+
+// case insensitive FNV-1a of the leading mnemonic or directive, a NULL end means NUL terminated
+static uint32_t evmasmHashToken(const char *start, const char *end) {
+  uint32_t hash = 2166136261U;
+
+  while(start != end && *start && !isspace(*start) && *start != ';') {
+    hash = (hash ^ (uint8_t) tolower(*start++)) * 16777619U;
+  }
+
+  return hash;
+}
+
+
+static void *evmasmHashFind(const evm_hash_t *table, const char *key, uint32_t length,
+                            uint32_t hash) {
+  if(table->capacity) {
+    uint32_t slot;
+
+    for(slot = hash; table->slots[slot & (table->capacity - 1U)].key; ++slot) {
+      const evm_hash_entry_t *entry = &table->slots[slot & (table->capacity - 1U)];
+
+      if(entry->hash == hash && entry->length == length && !memcmp(entry->key, key, length)) {
+        return entry->value;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+
+// add the key without checking for an existing entry, the table grows to stay at most half full
+static int evmasmHashInsert(evm_hash_t *table, const char *key, uint32_t length, uint32_t hash,
+                            void *value) {
+  uint32_t slot;
+
+  if((table->count + 1U) * 2U > table->capacity) {
+    uint32_t capacity = table->capacity ? table->capacity * 2U : 64U;
+    evm_hash_entry_t *slots = calloc(capacity, sizeof(evm_hash_entry_t));
+    uint32_t index;
+
+    if(!slots) {
+      return -1;
+    }
+
+    // rehash the existing entries into the larger table
+    for(index = 0; index < table->capacity; ++index) {
+      if(table->slots[index].key) {
+        for(slot = table->slots[index].hash; slots[slot & (capacity - 1U)].key; ++slot);
+        slots[slot & (capacity - 1U)] = table->slots[index];
+      }
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+  }
+
+  for(slot = hash; table->slots[slot & (table->capacity - 1U)].key; ++slot);
+  table->slots[slot & (table->capacity - 1U)].key = key;
+  table->slots[slot & (table->capacity - 1U)].value = value;
+  table->slots[slot & (table->capacity - 1U)].hash = hash;
+  table->slots[slot & (table->capacity - 1U)].length = length;
+  ++table->count;
+
+  return 0;
+}
+
+
+static void evmasmHashClear(evm_hash_t *table) {
+  free(table->slots);
+  memset((void *) table, 0, sizeof(evm_hash_t));
+}
+
+
+// instructions that the optimizer is allowed to touch
+static int evmasmIsPlain(const evm_instruction_t *inst) {
+  return !(inst->flags &
+           (INST_REMOVED | INST_DIRECTIVE | INST_LABEL | INST_INVALID_ARG | INST_MISSING_ARG));
+}
+
+
+// labels that are not part of a directive
+static int evmasmIsLabel(const evm_instruction_t *inst) {
+  return (inst->flags & (INST_REMOVED | INST_DIRECTIVE | INST_LABEL)) == INST_LABEL;
+}
+
+
+// the next instruction the optimizer hasn't removed, NULL at the end of the program
+static evm_instruction_t *evmasmNextInstruction(const evm_assembler_t *evm,
+                                                const evm_instruction_t *inst) {
+  const evm_instruction_t *end = &evm->instructions[evm->count];
+
+  for(++inst; inst < end; ++inst) {
+    if(!(inst->flags & INST_REMOVED)) {
+      return (evm_instruction_t *) inst;
+    }
+  }
+
+  return NULL;
+}
+
+
+// the previous instruction the optimizer hasn't removed, NULL at the start of the program
+static evm_instruction_t *evmasmPrevInstruction(const evm_assembler_t *evm,
+                                                const evm_instruction_t *inst) {
+  while(inst-- != evm->instructions) {
+    if(!(inst->flags & INST_REMOVED)) {
+      return (evm_instruction_t *) inst;
+    }
+  }
+
+  return NULL;
+}
+
+
+static int evmasmIsBranch(const evm_instruction_t *inst) {
+  return (inst->binary[0] & 0xF0) == FAM_JMP &&
+         inst->binary[0] != OP_JTBL && inst->binary[0] != OP_LJTBL;
+}
+
+
+// the largest number of bytes the instruction can occupy once serialized
+static uint32_t evmasmEstimateSize(const evm_instruction_t *inst) {
+  if(inst->flags & INST_DIRECTIVE) {
+    switch(inst->binary[0]) {
+      case DIR_DATA: return inst->count - 1;
+      case DIR_TBL:  return 2;
+      default:       return 0;
+    }
+  }
+  else if(inst->flags & INST_LABEL) {
+    return 0;
+  }
+
+  switch(inst->binary[0]) {
+    case OP_JMP: case OP_JLT: case OP_JLE: case OP_JNE: case OP_JEQ: case OP_JGE: case OP_JGT:
+    case OP_JTBL: case OP_LJTBL: case OP_DJNZ:
+      return 2;
+
+    case OP_LJMP: case OP_LJLT: case OP_LJLE: case OP_LJNE: case OP_LJEQ: case OP_LJGE: case OP_LJGT:
+    case OP_CALL: case OP_LDJNZ:
+      return 3;
+
+    case OP_LCALL: case OP_JCMP_8I:
+      return 4;
+
+    case OP_LJCMP_8I:
+      return 5;
+
+    default:
+      return inst->count;
+  }
+}
+
+
+// estimate the distance between two instructions without leaving the current section
+static int evmasmEstimateDistance(const evm_assembler_t *evm, const evm_instruction_t *from,
+                                  const evm_instruction_t *to, int32_t limit, int32_t *delta) {
+  const evm_instruction_t *inst;
+  int32_t distance;
+
+  // search forward
+  for(distance = 0, inst = from; inst && distance <= limit; inst = evmasmNextInstruction(evm, inst)) {
+    if(inst == to) {
+      *delta = distance;
+      return 0;
+    }
+    else if(inst != from && (inst->flags & INST_DIRECTIVE) &&
+            (inst->binary[0] == DIR_NAME || inst->binary[0] == DIR_BASE)) {
+      break;
+    }
+
+    distance += (int32_t) evmasmEstimateSize(inst) + !!(inst->flags & INST_RELAXABLE);
+  }
+
+  // search backward
+  for(distance = 0, inst = evmasmPrevInstruction(evm, from); inst && distance <= limit;
+      inst = evmasmPrevInstruction(evm, inst)) {
+    if((inst->flags & INST_DIRECTIVE) &&
+       (inst->binary[0] == DIR_NAME || inst->binary[0] == DIR_BASE)) {
+      break;
+    }
+
+    distance += (int32_t) evmasmEstimateSize(inst) + !!(inst->flags & INST_RELAXABLE);
+
+    if(inst == to) {
+      *delta = -distance;
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+
+// the label instruction named by the operand of the given instruction
+static evm_instruction_t *evmasmFindLabel(const evm_hash_t *labels, const evm_instruction_t *inst) {
+  const char *name = &inst->text[inst->binary[1]];
+  uint32_t length = evmasmOperandLength(inst);
+
+  return (evm_instruction_t *) evmasmHashFind(labels, name, length, evmasmHashString(name, length));
+}
+
+
+static int evmasmPushValue(const evm_instruction_t *inst, int32_t *value) {
+  switch(inst->binary[0]) {
+    case OP_PUSH_I0:  *value =  0; break;
+    case OP_PUSH_I1:  *value =  1; break;
+    case OP_PUSH_IN1: *value = -1; break;
+    case OP_PUSH_8I:  *value = (int8_t) inst->binary[1]; break;
+    case OP_PUSH_16I: *value = (int16_t) (inst->binary[1] | (inst->binary[2] << 8)); break;
+    case OP_PUSH_24I:
+      *value = ((int32_t) (((uint32_t) inst->binary[1] <<  8) | ((uint32_t) inst->binary[2] << 16) |
+                           ((uint32_t) inst->binary[3] << 24))) >> 8;
+    break;
+    case OP_PUSH_32I:
+      *value = (int32_t) (((uint32_t) inst->binary[1]      ) | ((uint32_t) inst->binary[2] <<  8) |
+                          ((uint32_t) inst->binary[3] << 16) | ((uint32_t) inst->binary[4] << 24));
+    break;
+    default:
+      return 0;
+  }
+
+  return 1;
+}
+
+
+// evaluate the eVM binary operation using the top (rhs) and second (lhs) values of the stack
+static int evmasmFold(uint8_t op, int32_t top, int32_t second, int32_t *result) {
+  switch(op) {
+    case OP_ADD_I: *result = (int32_t) ((uint32_t) top + (uint32_t) second); break;
+    case OP_SUB_I: *result = (int32_t) ((uint32_t) top - (uint32_t) second); break;
+    case OP_MUL_I: *result = (int32_t) ((uint32_t) top * (uint32_t) second); break;
+    case OP_AND:   *result = top & second; break;
+    case OP_OR:    *result = top | second; break;
+    case OP_XOR:   *result = top ^ second; break;
+
+    case OP_DIV_I:
+      if(!second || (second == -1 && top == INT32_MIN)) { return 0; }
+      *result = top / second;
+    break;
+
+    case OP_LSH:
+      if(second < 0 || 31 < second) { return 0; }
+      *result = (int32_t) ((uint32_t) top << second);
+    break;
+
+    case OP_RSH:
+      if(second < 0 || 31 < second) { return 0; }
+      *result = top >> second;
+    break;
+
+    case OP_MOD_I:
+      if(!second || (second == -1 && top == INT32_MIN)) { return 0; }
+      *result = top % second;
+    break;
+
+    case OP_ROL:
+    case OP_ROR: {
+      uint32_t count = (op == OP_ROL ? (uint32_t) second : 0U - (uint32_t) second) & 0x1FU;
+      *result = (int32_t) (((uint32_t) top << count) | ((uint32_t) top >> ((32U - count) & 0x1FU)));
+    } break;
+
+    case OP_MIN_I: *result = top < second ? top : second; break;
+    case OP_MAX_I: *result = top > second ? top : second; break;
+
+    default:
+      return 0;
+  }
+
+  return 1;
+}
+
+
+// removed instructions stay in place until the optimizer compacts the vector
+static void evmasmRemoveInstruction(evm_assembler_t *evm, evm_instruction_t *inst) {
+  inst->flags |= INST_REMOVED;
+  ++evm->removed;
+}
+
+
+// replace an instruction in place with a freshly parsed one from the given text
+static int evmasmReplaceInstruction(evm_assembler_t *evm, evm_instruction_t *inst,
+                                    const char *text) {
+  const char *end = &text[strlen(text)];
+  const evm_mnemonic_t *mnemonic = evmasmFindMnemonic(text, end);
+  evm_instruction_t repl;
+
+  memset((void *) &repl, 0, sizeof(evm_instruction_t));
+  repl.file = inst->file;
+  repl.line = inst->line;
+
+  repl.length = (uint32_t) (end - text);
+
+  if(!mnemonic || !(repl.text = evmasmArenaString(evm, text, end)) ||
+     mnemonic->process(mnemonic, &repl)) {
+    return -1;
+  }
+
+  *inst = repl;
+
+  return 0;
+}
+
+
+// the label following the branch, when the only thing between them is other labels
+static int evmasmFallsInto(const evm_assembler_t *evm, const evm_instruction_t *branch) {
+  const char *name = &branch->text[branch->binary[1]];
+  uint32_t length = evmasmOperandLength(branch);
+  const evm_instruction_t *inst;
+
+  for(inst = evmasmNextInstruction(evm, branch); inst && evmasmIsLabel(inst);
+      inst = evmasmNextInstruction(evm, inst)) {
+    if(evmasmOperandLength(inst) == length && !memcmp(&inst->text[inst->binary[1]], name, length)) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+
+// follow a chain of unconditional jumps to its final destination
+static evm_instruction_t *evmasmThreadJump(const evm_assembler_t *evm, const evm_hash_t *labels,
+                                           evm_instruction_t *inst) {
+  evm_instruction_t *first = evmasmFindLabel(labels, inst);
+  evm_instruction_t *label = first;
+  int hops;
+
+  for(hops = 0; label && hops < 16; ++hops) {
+    evm_instruction_t *next = label;
+
+    // skip any other labels attached to the same location
+    while(next && evmasmIsLabel(next)) { next = evmasmNextInstruction(evm, next); }
+
+    if(!next || !evmasmIsPlain(next) ||
+       (next->binary[0] != OP_JMP && next->binary[0] != OP_LJMP)) {
+      return label != first ? label : NULL;
+    }
+
+    label = evmasmFindLabel(labels, next);
+  }
+
+  return NULL; // unresolved label or a cycle of jumps
+}
+
+
+static int evmasmPeephole(evm_assembler_t *evm, const evm_hash_t *labels) {
+  evm_instruction_t *inst, *next, *third;
+  int changed = 0;
+
+  for(inst = evm->count ? &evm->instructions[0] : NULL; inst; inst = next) {
+    int32_t lhs, rhs, value;
+    char text[64];
+
+    next = evmasmNextInstruction(evm, inst);
+
+    if(!evmasmIsPlain(inst)) {
+      continue;
+    }
+
+    // jumps to the next instruction
+    if(evmasmIsBranch(inst) && evmasmFallsInto(evm, inst)) {
+      evmasmRemoveInstruction(evm, inst);
+      changed = -1;
+      continue;
+    }
+
+    // jumps to jumps
+    if(evmasmIsBranch(inst)) {
+      evm_instruction_t *dest = evmasmThreadJump(evm, labels, inst);
+      int32_t limit = inst->binary[0] < OP_LJMP && !(inst->flags & INST_RELAXABLE) ? 127 : 32767;
+      int32_t delta;
+
+      if(dest && !evmasmEstimateDistance(evm, inst, dest, limit + 1, &delta) &&
+         -limit - 1 <= delta && delta <= limit) {
+        int length = 0;
+
+        while(length < (int) inst->length && !isspace(inst->text[length])) { ++length; }
+
+        if(snprintf(&text[0], sizeof(text), "%.*s %.*s", length, inst->text,
+                    (int) evmasmOperandLength(dest), &dest->text[dest->binary[1]]) <
+             (int) sizeof(text) &&
+           !evmasmReplaceInstruction(evm, inst, &text[0])) {
+          changed = -1;
+        }
+      }
+      continue;
+    }
+
+    if(!next || !evmasmIsPlain(next)) {
+      continue;
+    }
+
+    // instruction pairs that cancel each other out
+    if((inst->binary[0] == OP_SWAP  && next->binary[0] == OP_SWAP) ||
+       (inst->binary[0] == OP_DUP_0 && next->binary[0] == OP_POP_1) ||
+       (evmasmPushValue(inst, &value) && next->binary[0] == OP_POP_1)) {
+      evmasmRemoveInstruction(evm, next);
+      evmasmRemoveInstruction(evm, inst);
+      next = evmasmNextInstruction(evm, next);
+      changed = -1;
+      continue;
+    }
+
+    // identity operations
+    if(evmasmPushValue(inst, &value) &&
+       ((value == 0 && (next->binary[0] == OP_ADD_I || next->binary[0] == OP_OR ||
+                        next->binary[0] == OP_XOR)) ||
+        (value == 1 && next->binary[0] == OP_MUL_I))) {
+      evmasmRemoveInstruction(evm, next);
+      evmasmRemoveInstruction(evm, inst);
+      next = evmasmNextInstruction(evm, next);
+      changed = -1;
+      continue;
+    }
+
+    // constant folding
+    third = evmasmNextInstruction(evm, next);
+    if(third && evmasmIsPlain(third) &&
+       evmasmPushValue(inst, &lhs) && evmasmPushValue(next, &rhs) &&
+       evmasmFold(third->binary[0], rhs, lhs, &value)) {
+      snprintf(&text[0], sizeof(text), "PUSH %d", value);
+
+      if(!evmasmReplaceInstruction(evm, third, &text[0])) {
+        evmasmRemoveInstruction(evm, next);
+        evmasmRemoveInstruction(evm, inst);
+        next = third; // allow the result to take part in further folding
+        changed = -1;
+      }
+      continue;
+    }
+  }
+
+  return changed;
+}
+
+
+// the instruction after the given one when the optimizer may touch it, NULL otherwise
+static evm_instruction_t *evmasmNextPlain(const evm_assembler_t *evm,
+                                          const evm_instruction_t *inst) {
+  evm_instruction_t *next = inst ? evmasmNextInstruction(evm, inst) : NULL;
+
+  return next && evmasmIsPlain(next) ? next : NULL;
+}
+
+
+// the immediate form of a binary operation on the top of the stack and a constant
+static const char *evmasmImmediateMnemonic(uint8_t op) {
+  switch(op) {
+    case OP_ADD_I: return "ADDI";
+    case OP_SUB_I: return "SUBI";
+    case OP_MUL_I: return "MULI";
+    case OP_AND:   return "ANDI";
+    case OP_LSH:   return "SHLI";
+    default:       return NULL;
+  }
+}
+
+
+// replace the last instruction of a sequence with the given text and remove the ones before it
+static int evmasmFuseSequence(evm_assembler_t *evm, evm_instruction_t *first,
+                              evm_instruction_t *last, const char *text) {
+  evm_instruction_t *inst;
+
+  if(evmasmReplaceInstruction(evm, last, text)) {
+    return 0;
+  }
+
+  for(inst = first; inst != last; inst = evmasmNextInstruction(evm, inst)) {
+    evmasmRemoveInstruction(evm, inst);
+  }
+
+  return -1;
+}
+
+
+// select the immediate and fused branch opcodes for the sequences they stand for, this runs once
+// the peephole pass has settled since the fused forms hide their parts from it
+static void evmasmFuse(evm_assembler_t *evm) {
+  evm_instruction_t *inst, *next;
+
+  for(inst = evm->count ? &evm->instructions[0] : NULL; inst; inst = next) {
+    evm_instruction_t *second, *third, *fourth, *fifth;
+    const char *mnemonic;
+    int32_t value;
+    char text[64];
+
+    next = evmasmNextInstruction(evm, inst);
+
+    if(!evmasmIsPlain(inst) || !(second = evmasmNextPlain(evm, inst))) {
+      continue;
+    }
+
+    third = evmasmNextPlain(evm, second);
+    fourth = evmasmNextPlain(evm, third);
+    fifth = evmasmNextPlain(evm, fourth);
+
+    if(evmasmPushValue(inst, &value) && -32768 <= value && value <= 32767) {
+      // PUSH k; ADD, MUL or AND, which read both values the same way round
+      if(second->binary[0] == OP_ADD_I || second->binary[0] == OP_MUL_I ||
+         second->binary[0] == OP_AND) {
+        mnemonic = evmasmImmediateMnemonic(second->binary[0]);
+        snprintf(&text[0], sizeof(text), "%s %d", mnemonic, value);
+        if(evmasmFuseSequence(evm, inst, second, &text[0])) {
+          next = evmasmNextInstruction(evm, second);
+        }
+        continue;
+      }
+
+      // PUSH k; SWAP; op, the constant ends up as the second operand
+      if(second->binary[0] == OP_SWAP && third &&
+         (mnemonic = evmasmImmediateMnemonic(third->binary[0])) &&
+         (third->binary[0] != OP_LSH || (1 <= value && value <= 31))) {
+        snprintf(&text[0], sizeof(text), "%s %d", mnemonic, value);
+        if(evmasmFuseSequence(evm, inst, third, &text[0])) {
+          next = evmasmNextInstruction(evm, third);
+        }
+        continue;
+      }
+
+      // PUSH k; SWAP; CMP; REM 1; Jcc, comparing the top to a constant that is dropped again
+      if(-128 <= value && value <= 127 && second->binary[0] == OP_SWAP && third &&
+         third->binary[0] == OP_CMP_I && fourth && fourth->binary[0] == OP_REM_1 && fifth &&
+         ((OP_JLT <= fifth->binary[0] && fifth->binary[0] <= OP_JGT) ||
+          (OP_LJLT <= fifth->binary[0] && fifth->binary[0] <= OP_LJGT))) {
+        int length = 0;
+
+        while(length < (int) fifth->length && !isspace(fifth->text[length])) { ++length; }
+
+        if(snprintf(&text[0], sizeof(text), "%.*sI %d %.*s", length, fifth->text, value,
+                    (int) evmasmOperandLength(fifth), &fifth->text[fifth->binary[1]]) <
+             (int) sizeof(text) &&
+           evmasmFuseSequence(evm, inst, fifth, &text[0])) {
+          next = evmasmNextInstruction(evm, fifth);
+        }
+        continue;
+      }
+    }
+
+    // DEC; CMP 0; JNE, counting down to zero
+    if(inst->binary[0] == OP_DEC_I && second->binary[0] == OP_CMP_I0 && third &&
+       (third->binary[0] == OP_JNE || third->binary[0] == OP_LJNE)) {
+      if(snprintf(&text[0], sizeof(text), "%s %.*s", third->binary[0] == OP_JNE ? "DJNZ" : "LDJNZ",
+                  (int) evmasmOperandLength(third), &third->text[third->binary[1]]) <
+           (int) sizeof(text) &&
+         evmasmFuseSequence(evm, inst, third, &text[0])) {
+        next = evmasmNextInstruction(evm, third);
+      }
+      continue;
+    }
+
+    // CMP -1, 0 or 1; Jcc
+    if((inst->binary[0] == OP_CMP_I0 || inst->binary[0] == OP_CMP_I1 ||
+        inst->binary[0] == OP_CMP_IN1) &&
+       ((OP_JLT <= second->binary[0] && second->binary[0] <= OP_JGT) ||
+        (OP_LJLT <= second->binary[0] && second->binary[0] <= OP_LJGT))) {
+      int length = 0;
+
+      value = inst->binary[0] == OP_CMP_IN1 ? -1 : inst->binary[0] - OP_CMP_I0;
+      while(length < (int) second->length && !isspace(second->text[length])) { ++length; }
+
+      if(snprintf(&text[0], sizeof(text), "%.*sI %d %.*s", length, second->text, value,
+                  (int) evmasmOperandLength(second), &second->text[second->binary[1]]) <
+           (int) sizeof(text) &&
+         evmasmFuseSequence(evm, inst, second, &text[0])) {
+        next = evmasmNextInstruction(evm, second);
+      }
+      continue;
+    }
+  }
+}
+
+
+static void evmasmOptimize(evm_assembler_t *evm) {
+  evm_instruction_t *inst;
+  evm_hash_t labels = { NULL, 0, 0 };
+  uint32_t before = 0, after = 0, index, count;
+  int passes;
+
+  // labels are never rewritten by the optimizer so they only need indexing once
+  for(index = 0; index < evm->count; ++index) {
+    inst = &evm->instructions[index];
+    before += evmasmEstimateSize(inst);
+
+    if(evmasmIsLabel(inst)) {
+      const char *name = &inst->text[inst->binary[1]];
+      uint32_t length = evmasmOperandLength(inst);
+      uint32_t hash = evmasmHashString(name, length);
+
+      if(!evmasmHashFind(&labels, name, length, hash) &&
+         evmasmHashInsert(&labels, name, length, hash, inst)) {
+        evmasmHashClear(&labels);
+        return; // without a complete index jump threading could pick the wrong target
+      }
+    }
+  }
+
+  // repeat until nothing changes, each pass can expose new opportunities
+  for(passes = 0; passes < 64 && evmasmPeephole(evm, &labels); ++passes);
+  evmasmFuse(evm);
+
+  evmasmHashClear(&labels);
+
+  // compact the surviving instructions
+  for(index = count = 0; index < evm->count; ++index) {
+    inst = &evm->instructions[index];
+
+    if(!(inst->flags & INST_REMOVED)) {
+      after += evmasmEstimateSize(inst);
+      evm->instructions[count++] = *inst;
+    }
+  }
+
+  evm->count = count;
+
+  evm->saved += before - after;
+  EVM_DEBUGF("Optimizer removed %u bytes in %d passes", before - after, passes);
+}
+
+
+// replace the argument and local names used by frame instructions with their slots, each .frame
+// starts a new scope and a name is only known to the instructions after its declaration
+static int evmasmResolveFrames(evm_assembler_t *evm) {
+  evm_hash_t names = { NULL, 0, 0 };
+  uint32_t index, args = 0, locals = 0;
+  int result = 0;
+
+  for(index = 0; index < evm->count; ++index) {
+    evm_instruction_t *inst = &evm->instructions[index];
+
+    if(inst->flags & (INST_MISSING_ARG | INST_INVALID_ARG)) {
+      continue; // reported when the sections are built
+    }
+    else if((inst->flags & INST_DIRECTIVE) && inst->binary[0] == DIR_FRAME) {
+      evmasmHashClear(&names);
+      args = locals = 0;
+    }
+    else if((inst->flags & INST_DIRECTIVE) &&
+            (inst->binary[0] == DIR_ARG || inst->binary[0] == DIR_LOCAL)) {
+      const char *name = &inst->text[inst->binary[1]];
+      uint32_t length = evmasmOperandLength(inst);
+      uint32_t hash = evmasmHashString(name, length);
+      // the slot is kept shifted with the kind in the lowest bit, plus one so it is never NULL
+      uintptr_t value = inst->binary[0] == DIR_ARG ? (args++ << 1) + 1U : (locals++ << 1) + 2U;
+
+      if(evmasmHashFind(&names, name, length, hash)) {
+        EVM_ERRORF(
+          "Duplicate frame name in %s on line %d: %.*s",
+          inst->file, inst->line, (int) inst->length, inst->text
+        );
+        result |= 8192;
+      }
+      else if(evmasmHashInsert(&names, name, length, hash, (void *) value)) {
+        EVM_ERRORF(
+          "Failure to declare frame name in %s on line %d: %.*s",
+          inst->file, inst->line, (int) inst->length, inst->text
+        );
+        result |= 16;
+      }
+    }
+    else if(!(inst->flags & INST_DIRECTIVE) && (inst->flags & INST_UNRESOLVED) &&
+            (inst->binary[0] & 0xF0) == FAM_FRAME) {
+      const char *name = &inst->text[inst->binary[1]];
+      uint32_t length = evmasmOperandLength(inst);
+      uintptr_t value;
+
+      if(!length) {
+        // ENTER without a count reserves the locals declared so far
+        value = (locals << 1) + 2U;
+      }
+      else {
+        value = (uintptr_t) evmasmHashFind(&names, name, length, evmasmHashString(name, length));
+      }
 
+      if(!value) {
+        EVM_ERRORF(
+          "Unknown frame name in %s on line %d: %.*s",
+          inst->file, inst->line, (int) inst->length, inst->text
+        );
+        result |= 8192;
+      }
+      else if(length && ((value & 1U) != 0) != (inst->binary[0] == OP_LOAD_A)) {
+        EVM_ERRORF(
+          "Wrong kind of frame name in %s on line %d: %.*s",
+          inst->file, inst->line, (int) inst->length, inst->text
+        );
+        result |= 8192;
+      }
+      else if(evmasmFrameOperand(inst, (uint32_t) ((value - 1U) >> 1))) {
+        EVM_ERRORF(
+          "Too many frame slots in %s on line %d: %.*s",
+          inst->file, inst->line, (int) inst->length, inst->text
+        );
+        result |= 8192;
+      }
 
-static evm_instruction_t *
-evmasmNewInstruction(const char *name, const char *start, const char *end, uint32_t line) {
-  evm_instruction_t *inst = calloc(1, (end - start) + sizeof(evm_instruction_t) + 1U);
-  if(inst) {
-    inst->file = name;
-    inst->line = line;
-    memcpy(&inst->text[0], start, end - start);
-    inst->text[end - start] = '\0';
+      inst->flags &= ~INST_UNRESOLVED; // not a label, even when the name was wrong
+    }
   }
 
-  return inst;
+  evmasmHashClear(&names);
+
+  return result;
 }
 
 
-static evm_program_t *evmasmNewProgram() {
-  evm_program_t *prog = calloc(1, sizeof(evm_program_t));
+static uint64_t evmasmHash64(uint64_t hash, const uint8_t *data, size_t length) {
+  size_t index;
 
-  if(prog) {
-    prog->sections.prev = &prog->sections;
-    prog->sections.next = &prog->sections;
-    prog->files.prev = &prog->files;
-    prog->files.next = &prog->files;
+  // 64bit FNV-1a
+  for(index = 0; index < length; ++index) {
+    hash = (hash ^ data[index]) * 0x100000001B3ULL;
   }
 
-  return prog;
+  return hash;
 }
 
 
-static void evmasmDeleteProgram(evm_program_t *prog) {
-  if(prog) {
-    evmasmClearSectionList(&prog->sections);
-    evmasmClearFilesList(&prog->files);
-    free(prog);
-  }
-}
+// hash the configuration and the contents of every file in order without parsing them
+static int evmasmCacheKey(evm_assembler_t *evm, const char *const *names, int count) {
+  uint64_t key = 0xCBF29CE484222325ULL;
+  uint32_t sources = 0;
+  uint8_t block[BUFSIZ], *out = &block[0];
+  int file;
 
+  out = evmasmStoreWord(out, EVM_ASM_VERSION);
+  out = evmasmStoreWord(out, EVM_FLOAT_SUPPORT);
+  out = evmasmStoreWord(out, EVM_MEMORY_SUPPORT);
+  out = evmasmStoreWord(out, evm->level);
+  out = evmasmStoreWord(out, evm->flags & ASM_RELOCATABLE);
+  key = evmasmHash64(key, &block[0], out - &block[0]);
 
-const char *evmasmCanonicalizeString(evm_ptr_list_t *list, const char *str) {
-  evm_ptr_list_t *node;
+  for(file = 0; file < count; ++file) {
+    FILE *fp = fopen(names[file], "rb");
+    uint32_t length = 0;
+    size_t got;
 
-  for(node = list->next; node != list; node = node->next) {
-    if(!strcmp(str, (const char *) node->ptr)) {
-      return (const char *) node->ptr;
+    if(!fp) {
+      return -1; // let the parser report it
     }
-  }
-
-  node = calloc(1, sizeof(evm_ptr_list_t) + strlen(str) + 1);
-  if(node) {
-    node->ptr = strcpy((char *) &node[1], str);
 
-    node->prev = list;
-    node->next = list->next;
-    list->next->prev = node;
-    list->next = node;
-  }
-
-  return NULL; // failure!
-}
+    while((got = fread(&block[0], 1, sizeof(block), fp))) {
+      key = evmasmHash64(key, &block[0], got);
+      length += (uint32_t) got;
+    }
 
+    if(ferror(fp)) {
+      fclose(fp);
+      return -1;
+    }
 
-static evm_section_t *evmasmNewSection(const char *name) {
-  evm_section_t *section = calloc(1, sizeof(evm_section_t) + strlen(name) + 1U);
+    fclose(fp);
 
-  if(section) {
-    section->labels.prev = &section->labels;
-    section->labels.next = &section->labels;
-    if((section->contents = (uint8_t *) calloc(1, 512U))) {
-      section->capacity = 512U;
-    }
-    strcpy(&section->name[0], name);
+    // the length keeps the boundaries between files part of the key
+    evmasmStoreWord(&block[0], length);
+    key = evmasmHash64(key, &block[0], 4);
+    sources += length;
   }
 
-  return section;
+  evm->key = key;
+  evm->sources = sources;
+
+  return 0;
 }
 
 
-static void evmasmDeleteSection(evm_section_t *section) {
-  if(section) {
-    evmasmClearLabelList(&section->labels);
-    if(section->contents) {
-      free(section->contents);
-    }
-    free(section);
+static char *evmasmCachePath(const evm_assembler_t *evm, const char *suffix) {
+  size_t size = strlen(evm->cache) + strlen(suffix) + 32U;
+  char *path = malloc(size);
+
+  if(path) {
+    snprintf(path, size, "%s/%016" PRIx64 "-%08" PRIx32 ".evmc%s", evm->cache, evm->key,
+             evm->sources, suffix);
   }
-}
 
+  return path;
+}
 
-static evm_section_t *evmasmCanonicalizeSection(evm_section_t *list, const char *name) {
-  evm_section_t *section = NULL;
 
-  if(list) {
-    for(section = list->next; section != list; section = section->next) {
-      if(!strcmp(name, &section->name[0])) {
-        break; // found it
-      }
-    }
+static int evmasmCacheLoad(evm_assembler_t *evm) {
+  uint8_t header[4U * EVM_CACHE_HEADER_WORDS], *image = NULL;
+  char *path = evmasmCachePath(evm, "");
+  FILE *fp = path ? fopen(path, "rb") : NULL;
+  uint32_t length;
+  int result = -1;
 
-    if(section == list) {
-      // append to list if not found
-      section = evmasmNewSection(name);
-      section->prev = list->prev;
-      list->prev->next = section;
-      section->next = list;
-      list->prev = section;
+  if(fp) {
+    // anything that doesn't match exactly is treated as a miss and replaced later
+    if(fread(&header[0], 1, sizeof(header), fp) == sizeof(header) &&
+       evmasmLoadWord(&header[0]) == EVM_CACHE_MAGIC &&
+       evmasmLoadWord(&header[4]) == EVM_ASM_VERSION &&
+       evmasmLoadWord(&header[8]) == (uint32_t) evm->key &&
+       evmasmLoadWord(&header[12]) == (uint32_t) (evm->key >> 32) &&
+       evmasmLoadWord(&header[16]) == evm->sources &&
+       (length = evmasmLoadWord(&header[20])) &&
+       (image = malloc(length)) &&
+       fread(image, 1, length, fp) == length && fgetc(fp) == EOF) {
+      evm->image = image;
+      evm->length = length;
+      evm->flags |= ASM_CACHED;
+      result = 0;
     }
-  }
-  else {
-    if((section = evmasmNewSection(name))) {
-      section->prev = section;
-      section->next = section;
+    else {
+      free(image);
     }
+
+    fclose(fp);
   }
 
-  return section;
+  EVM_DEBUGF("Cache %s for %s", result ? "miss" : "hit", path ? path : "(null)");
+  free(path);
+
+  return result;
 }
 
 
-static void evmasmAddToSection(evm_section_t *section, evm_instruction_t *inst) {
-  if(section) {
-    evm_instruction_ref_t *ref = calloc(1, sizeof(evm_instruction_ref_t));
+// failures only cost a future miss so they aren't reported
+static void evmasmCacheStore(const evm_assembler_t *evm, const uint8_t *data, uint32_t length) {
+  char *path = evmasmCachePath(evm, "");
+  char *temp = evmasmCachePath(evm, ".tmp");
+  uint8_t header[4U * EVM_CACHE_HEADER_WORDS], *out = &header[0];
+  FILE *fp;
 
-    if(ref) {
-      if(section->instructions) {
-        ref->offset = section->tail->offset + section->tail->size;
-        section->tail->next = ref;
-        section->tail = ref;
-      }
-      else {
-        section->instructions = section->tail = ref;
-      }
-
-      ref->instruction = inst;
-
-      if(!(inst->flags & INST_DIRECTIVE)) {
-        // assume the simple serializer has done a good job except for jumps and calls
-        if((inst->binary[0] & 0xF0) == FAM_JMP) {
-          switch(inst->binary[0]) {
-            // short jumps
-            case OP_JMP:
-            case OP_JLT:
-            case OP_JLE:
-            case OP_JNE:
-            case OP_JEQ:
-            case OP_JGE:
-            case OP_JGT:
-              ref->size = 2;
-            break;
-
-            // jump tables
-            case OP_JTBL:
-            case OP_LJTBL:
-              ref->size = 2; // doesn't include jump table entries
-            break;
-
-            // long jumps
-            case OP_LJMP:
-            case OP_LJLT:
-            case OP_LJLE:
-            case OP_LJNE:
-            case OP_LJEQ:
-            case OP_LJGE:
-            case OP_LJGT:
-              ref->size = 3;
-            break;
-          }
-        }
-        // wait for all labels to be resolved to make a selection about the size of the jump
-        else if(inst->binary[0] == OP_CALL) {
-            ref->size = 3; // long jump
-        }
-        else if(inst->binary[0] == OP_LCALL) {
-            ref->size = 4; // longest possible jump
-        }
-        else {
-          ref->size = inst->count; // assume the serializer got it right
-        }
-      }
-      else if(inst->binary[0] == DIR_DATA) {
-        ref->size = inst->count - 1;
-      }
-      else if(inst->binary[0] == DIR_TBL) {
-        // search back for jump table instruction
-        evm_instruction_t *i = inst->prev, *head = section->instructions->instruction->prev;
-        ref->size = 0; // invalid size until resolved
+  out = evmasmStoreWord(out, EVM_CACHE_MAGIC);
+  out = evmasmStoreWord(out, EVM_ASM_VERSION);
+  out = evmasmStoreWord(out, (uint32_t) evm->key);
+  out = evmasmStoreWord(out, (uint32_t) (evm->key >> 32));
+  out = evmasmStoreWord(out, evm->sources);
+  out = evmasmStoreWord(out, length);
 
-        while(i != head) {
-          if(i->binary[0] == OP_JTBL) {
-            ref->size = 1; // short jumps only
-            break;
-          }
-          else if(i->binary[0] == OP_LJTBL) {
-            ref->size = 2; // long jumps
-            break;
-          }
+  // readers only ever see complete entries as they are renamed into place
+  if(path && temp && (fp = fopen(temp, "wb"))) {
+    int written = fwrite(&header[0], 1, sizeof(header), fp) == sizeof(header) &&
+                  fwrite(data, 1, length, fp) == length;
 
-          i = i->prev;
-        }
-      }
-      else {
-        // most directives and invalid instructions don't get added to the binary
-        ref->size = 0;
-      }
+    if(fclose(fp) || !written || rename(temp, path)) {
+      remove(temp);
     }
   }
+
+  free(temp);
+  free(path);
 }
 
 
-static uint32_t evmasmCalculateLikelySectionLength(evm_section_t *section) {
-  uint32_t length = 0U;
+static uint8_t *evmasmStoreWord(uint8_t *out, uint32_t word) {
+  out[0] =  word        & 0xFF;
+  out[1] = (word >>  8) & 0xFF;
+  out[2] = (word >> 16) & 0xFF;
+  out[3] = (word >> 24) & 0xFF;
 
-  if(section && section->tail) {
-    evm_instruction_ref_t *inst = section->tail;
+  return &out[4];
+}
 
-    length = inst->offset + inst->size;
-  }
 
-  return length;
+static uint32_t evmasmLoadWord(const uint8_t *data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
 }
 
 
-static evm_label_t *evmasmNewLabel(const char *name, uint32_t id) {
-  evm_label_t *label = calloc(1, sizeof(evm_label_t) + strlen(name) + 1U);
+// sscanf over the text of an instruction, which is not terminated when it references the source
+static int evmasmScan(const evm_instruction_t *inst, const char *format, ...) {
+  char line[256];
+  uint32_t length = inst->length < sizeof(line) ? inst->length : sizeof(line) - 1U;
+  va_list args;
+  int result;
 
-  if(label) {
-    label->offset = 0xFF000000U; // maximum section size is 24bits
-    label->id = id;
-    strcpy(&label->name[0], name);
-  }
+  memcpy(&line[0], inst->text, length);
+  line[length] = '\0';
 
-  return label;
-}
+  va_start(args, format);
+  result = vsscanf(&line[0], format, args);
+  va_end(args);
 
+  return result;
+}
 
-static evm_label_t *evmasmAppendLabel(evm_section_t *section, const char *name) {
-  evm_label_t *label = NULL;
- 
-  if(section) {
-    if((label = evmasmNewLabel(name, ++section->labels.id))) {
-      label->section = section;
-      label->next = &section->labels;
-      label->prev = section->labels.prev;
-      section->labels.prev->next = label;
-      section->labels.prev = label;
-    }
-  }
 
-  return label;
+// length of the label operand that starts binary[1] characters into the instruction text
+static uint32_t evmasmOperandLength(const evm_instruction_t *inst) {
+  return inst->length - inst->binary[1];
 }
 
 
@@ -1293,7 +3191,7 @@ static int evmDataDirective(const evm_directive_t *d, evm_instruction_t *i) {
   if(d->arg == ARG_I8) {
     int32_t operand;
 
-    if(sscanf(&i->text[0], "%*s %d", &operand) == 1) {
+    if(evmasmScan(i, "%*s %d", &operand) == 1) {
       if(-128 <= operand && operand <= 255) {
         i->binary[1] = (uint8_t) (operand & 0xFF);
         i->count += 1;
@@ -1313,7 +3211,7 @@ static int evmDataDirective(const evm_directive_t *d, evm_instruction_t *i) {
   else if(d->arg == ARG_I16) {
     int32_t operand;
 
-    if(sscanf(&i->text[0], "%*s %d", &operand) == 1) {
+    if(evmasmScan(i, "%*s %d", &operand) == 1) {
       if(-32768 <= operand && operand <= 65535) {
         i->binary[1] = (uint8_t) ( operand       & 0xFF);
         i->binary[2] = (uint8_t) ((operand >> 8) & 0xFF);
@@ -1334,7 +3232,7 @@ static int evmDataDirective(const evm_directive_t *d, evm_instruction_t *i) {
   else if(d->arg == ARG_I32) {
     int64_t operand;
 
-    if(sscanf(&i->text[0], "%*s %ld", &operand) == 1) {
+    if(evmasmScan(i, "%*s %ld", &operand) == 1) {
       if(-2147483648 <= operand && operand <= 4294967295) {
         i->binary[1] = (uint8_t) ( operand        & 0xFF);
         i->binary[2] = (uint8_t) ((operand >>  8) & 0xFF);
@@ -1360,7 +3258,7 @@ static int evmDataDirective(const evm_directive_t *d, evm_instruction_t *i) {
   else if(d->arg == ARG_F32) {
     float operand;
 
-    if(sscanf(&i->text[0], "%*s %f", &operand) == 1) {
+    if(evmasmScan(i, "%*s %f", &operand) == 1) {
       uint32_t bits = *(uint32_t *) &operand;
       i->binary[1] = (uint8_t) ( bits        & 0xFF);
       i->binary[2] = (uint8_t) ((bits >>  8) & 0xFF);
@@ -1391,13 +3289,13 @@ static int evmTextDirective(const evm_directive_t *d, evm_instruction_t *i) {
   i->count = 1;
 
   if(d->arg == ARG_LBL) {
-    const char *ptr = &i->text[0];
+    const char *ptr = &i->text[0], *end = &i->text[i->length];
     // skip the mnemonic
-    while(*ptr && !isspace(*ptr)) { ++ptr; }
+    while(ptr != end && !isspace(*ptr)) { ++ptr; }
     // skip the whitespace
-    while(*ptr && isspace(*ptr)) { ++ptr; }
+    while(ptr != end && isspace(*ptr)) { ++ptr; }
 
-    if(*ptr) {
+    if(ptr != end) {
       i->binary[1] = (int8_t) (ptr - &i->text[0]);
       i->flags |= INST_LABEL | (d->kind != DIR_TBL ? INST_FINALIZED : 0);
       i->count++;
@@ -1426,7 +3324,7 @@ static int evmAddressDirective(const evm_directive_t *d, evm_instruction_t *i) {
   if(d->arg == ARG_I24) {
     int32_t operand;
 
-    if(sscanf(&i->text[0], "%*s %d", &operand) == 1) {
+    if(evmasmScan(i, "%*s %d", &operand) == 1) {
       if(0 <= operand && operand <= 16777215) {
         i->binary[1] = (uint8_t) ( operand        & 0xFF);
         i->binary[2] = (uint8_t) ((operand >>  8) & 0xFF);
@@ -1453,6 +3351,42 @@ static int evmAddressDirective(const evm_directive_t *d, evm_instruction_t *i) {
 }
 
 
+static int evmFrameDirective(const evm_directive_t *d, evm_instruction_t *i) {
+  int result = 0;
+
+  i->binary[0] = d->kind;
+  i->flags |= INST_DIRECTIVE;
+  i->count = 1;
+
+  if(d->arg == ARG_NONE) {
+    i->flags |= INST_FINALIZED;
+  }
+  else if(d->arg == ARG_LBL) {
+    const char *ptr = &i->text[0], *end = &i->text[i->length];
+    // skip the mnemonic
+    while(ptr != end && !isspace(*ptr)) { ++ptr; }
+    // skip the whitespace
+    while(ptr != end && isspace(*ptr)) { ++ptr; }
+
+    if(ptr != end) {
+      i->binary[1] = (int8_t) (ptr - &i->text[0]);
+      i->flags |= INST_FINALIZED;
+      i->count++;
+    }
+    else {
+      result = -1;
+      i->flags |= INST_MISSING_ARG;
+      EVM_ERRORF("Missing operand for %s", &d->tag[0]);
+    }
+  }
+  else {
+    EVM_FATALF("Unsupported operand type while processing %s", &d->tag[0]);
+  }
+
+  return result;
+}
+
+
 static int evmPushSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
   int result = 0;
 
@@ -1462,7 +3396,7 @@ static int evmPushSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
   if(m->arg == ARG_I32) {
     int32_t operand;
 
-    if(sscanf(&i->text[0], "%*s %d", &operand) == 1) {
+    if(evmasmScan(i, "%*s %d", &operand) == 1) {
       // handle the special cases
       if(-1 <= operand  && operand <= 1) {
         switch(operand) {
@@ -1518,7 +3452,7 @@ static int evmPushSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
   else if(m->arg == ARG_F32) {
     float operand;
 
-    if(sscanf(&i->text[0], "%*s %f", &operand) == 1) {
+    if(evmasmScan(i, "%*s %f", &operand) == 1) {
       // handle the special cases
       if(operand == -1.0f) {
         i->binary[0] = m->op + 2;
@@ -1562,15 +3496,20 @@ static int evmLabelSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
   i->count = 1;
 
   if(m->arg == ARG_LBL) {
-    const char *ptr = &i->text[0];
+    const char *ptr = &i->text[0], *end = &i->text[i->length];
     // skip the mnemonic
-    while(*ptr && !isspace(*ptr)) { ++ptr; }
+    while(ptr != end && !isspace(*ptr)) { ++ptr; }
     // skip the whitespace
-    while(*ptr && isspace(*ptr)) { ++ptr; }
+    while(ptr != end && isspace(*ptr)) { ++ptr; }
 
-    if(*ptr) {
+    if(ptr != end) {
       i->binary[1] = (int8_t) (ptr - &i->text[0]);
       i->flags |= INST_UNRESOLVED;
+
+      // the near forms may be promoted to their far equivalents as needed
+      if(m->op == OP_CALL || (OP_JMP <= m->op && m->op <= OP_JGT) || m->op == OP_DJNZ) {
+        i->flags |= INST_RELAXABLE;
+      }
     }
     else {
       result = -1;
@@ -1598,7 +3537,7 @@ static int evmSimpleSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
   else if(m->arg == ARG_I5) {
     int32_t operand;
 
-    if(sscanf(&i->text[0], "%*s %d", &operand) == 1) {
+    if(evmasmScan(i, "%*s %d", &operand) == 1) {
       if(1 <= operand && operand <= 31) {
         i->binary[1] = (int8_t) operand;
         i->flags |= INST_FINALIZED;
@@ -1619,7 +3558,7 @@ static int evmSimpleSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
   else if(m->arg == ARG_I8) {
     int32_t operand;
 
-    if(sscanf(&i->text[0], "%*s %d", &operand) == 1) {
+    if(evmasmScan(i, "%*s %d", &operand) == 1) {
       if(-128 <= operand && operand <= 127) {
         i->binary[1] = (int8_t) operand;
         i->flags |= INST_FINALIZED;
@@ -1640,7 +3579,7 @@ static int evmSimpleSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
   else if(m->arg == ARG_U8) {
     int32_t operand;
 
-    if(sscanf(&i->text[0], "%*s %d", &operand) == 1) {
+    if(evmasmScan(i, "%*s %d", &operand) == 1) {
       if(0 <= operand && operand <= 255) {
         i->binary[1] = operand & 0xFF;
         i->flags |= INST_FINALIZED;
@@ -1662,7 +3601,7 @@ static int evmSimpleSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
   else if(m->arg == ARG_U16) {
     int32_t operand;
 
-    if(sscanf(&i->text[0], "%*s %x", &operand) == 1) {
+    if(evmasmScan(i, "%*s %x", &operand) == 1) {
       if(0 <= operand && operand <= 0xFFFF) {
         i->binary[1] =  operand       & 0xFF;
         i->binary[2] = (operand >> 8) & 0xFF;
@@ -1684,7 +3623,7 @@ static int evmSimpleSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
   else if(m->arg == ARG_U24) {
     int32_t operand;
 
-    if(sscanf(&i->text[0], "%*s %x", &operand) == 1) {
+    if(evmasmScan(i, "%*s %x", &operand) == 1) {
       if(0 <= operand && operand <= 0xFFFFFF) {
         i->binary[1] =  operand        & 0xFF;
         i->binary[2] = (operand >>  8) & 0xFF;
@@ -1722,7 +3661,7 @@ static int evmCompareSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
   if(m->arg == ARG_O8) {
     int32_t operand;
 
-    if(sscanf(&i->text[0], "%*s %d", &operand) == 1) {
+    if(evmasmScan(i, "%*s %d", &operand) == 1) {
       if(-1 <= operand  && operand <= 1) {
         switch(operand) {
           case -1:
@@ -1755,7 +3694,7 @@ static int evmCompareSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
   else if(m->arg == ARG_OF32) {
     float operand;
 
-    if(sscanf(&i->text[0], "%*s %f", &operand) == 1) {
+    if(evmasmScan(i, "%*s %f", &operand) == 1) {
       if(fabsf(operand + 1.0f) < FLT_EPSILON) {
         i->binary[0] = m->op + 2; // cmpf -1.0
         i->flags |= INST_FINALIZED;
@@ -1796,7 +3735,7 @@ static int evmOptionalSerializer(const evm_mnemonic_t *m, evm_instruction_t *i)
 
   if(ARG_O1 <= m->arg && m->arg <= ARG_O8) {
     int32_t first = 0, second = 1;
-    int count = sscanf(&i->text[0], "%*s %d %d", &first, &second);
+    int count = evmasmScan(i, "%*s %d %d", &first, &second);
 
     if(m->arg != ARG_I4_O4 || count >= 1) { // ensure the required args are given
       // validate the operand values
@@ -1891,3 +3830,214 @@ static int evmOptionalSerializer(const evm_mnemonic_t *m, evm_instruction_t *i)
   return result;
 }
 
+
+static int evmFrameSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
+  int result = 0;
+
+  i->binary[0] = m->op;
+  i->count = 1;
+
+  if(m->arg == ARG_SLOT) {
+    const char *ptr = &i->text[0], *end = &i->text[i->length];
+    int32_t operand = 0, limit = m->op == OP_LEAVE ? 255 : 65535;
+    // skip the mnemonic
+    while(ptr != end && !isspace(*ptr)) { ++ptr; }
+    // skip the whitespace
+    while(ptr != end && isspace(*ptr)) { ++ptr; }
+
+    if(ptr == end && m->op == OP_ENTER) {
+      // counted once the locals of the frame are known
+      i->binary[1] = (int8_t) (ptr - &i->text[0]);
+      i->flags |= INST_UNRESOLVED;
+    }
+    else if(ptr == end && m->op == OP_LEAVE) {
+      (void) evmasmFrameOperand(i, 0); // nothing is kept
+    }
+    else if(ptr == end) {
+      result = -1;
+      i->flags |= INST_MISSING_ARG;
+      EVM_ERRORF("Missing operand for %s", &m->tag[0]);
+    }
+    else if(isdigit(*ptr) || *ptr == '-') {
+      if(evmasmScan(i, "%*s %d", &operand) != 1 || operand < 0 || limit < operand ||
+         evmasmFrameOperand(i, (uint32_t) operand)) {
+        result = -1;
+        i->flags |= INST_INVALID_ARG;
+        EVM_ERRORF("Operand out of bounds for %s (0 <= %d <= %d)", &m->tag[0], operand, limit);
+      }
+    }
+    else if(m->op == OP_ENTER || m->op == OP_LEAVE) {
+      result = -1;
+      i->flags |= INST_INVALID_ARG;
+      EVM_ERRORF("Operand of %s must be a count", &m->tag[0]);
+    }
+    else {
+      // the name of an argument or local, resolved before the sections are built
+      i->binary[1] = (int8_t) (ptr - &i->text[0]);
+      i->flags |= INST_UNRESOLVED;
+    }
+  }
+  else {
+    EVM_FATALF("Unsupported operand type while processing %s", &m->tag[0]);
+  }
+
+  return result;
+}
+
+
+static int evmOperandSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
+  int result = 0;
+
+  i->binary[0] = m->op;
+  i->count = 1;
+
+  if(m->arg == ARG_I16) {
+    int32_t operand;
+
+    if(evmasmScan(i, "%*s %d", &operand) == 1) {
+      if(-128 <= operand && operand <= 127) { // single byte
+        i->binary[1] = (uint8_t) (operand & 0xFF);
+        i->flags |= INST_FINALIZED;
+        i->count++;
+      }
+      else if(-32768 <= operand && operand <= 32767) { // two bytes
+        i->binary[0] = m->op + (OP_ADD_16I - OP_ADD_8I);
+        i->binary[1] = (uint8_t) (operand & 0xFF);
+        i->binary[2] = (uint8_t) ((operand >> 8) & 0xFF);
+        i->flags |= INST_FINALIZED;
+        i->count += 2;
+      }
+      else {
+        result = -1;
+        i->flags |= INST_INVALID_ARG;
+        EVM_ERRORF("Operand out of bounds for %s (-32768 <= %d <= 32767)", &m->tag[0], operand);
+      }
+    }
+    else {
+      result = -1;
+      i->flags |= INST_MISSING_ARG;
+      EVM_ERRORF("Missing operand for %s", &m->tag[0]);
+    }
+  }
+  else {
+    EVM_FATALF("Unsupported operand type while processing %s", &m->tag[0]);
+  }
+
+  return result;
+}
+
+
+// the flags each conditional jump tests (less 1, equal 2, greater 4), the fused compare and
+// branch carries them in its operand
+static const uint8_t JUMP_FLAGS[8] = { 0, 1, 1 | 2, 1 | 4, 2, 4 | 2, 4, 0 };
+
+
+static int evmFusedSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
+  int result = 0;
+
+  i->binary[0] = m->op < OP_LJMP ? OP_JCMP_8I : OP_LJCMP_8I;
+  i->count = 1;
+
+  if(m->arg == ARG_I8_L) {
+    int32_t operand, label = 0;
+
+    if(evmasmScan(i, "%*s %d %n", &operand, &label) < 1 || !label || label >= (int) i->length) {
+      result = -1;
+      i->flags |= INST_MISSING_ARG;
+      EVM_ERRORF("Missing operand for %s", &m->tag[0]);
+    }
+    else if(operand < -128 || 127 < operand) {
+      result = -1;
+      i->flags |= INST_INVALID_ARG;
+      EVM_ERRORF("Operand out of bounds for %s (-128 <= %d <= 127)", &m->tag[0], operand);
+    }
+    else {
+      i->binary[1] = (int8_t) label;
+      i->binary[2] = JUMP_FLAGS[m->op & 0x07];
+      i->binary[3] = (uint8_t) (operand & 0xFF);
+      i->flags |= INST_UNRESOLVED;
+
+      // the near form may be promoted to its far equivalent as needed
+      if(m->op < OP_LJMP) {
+        i->flags |= INST_RELAXABLE;
+      }
+    }
+  }
+  else {
+    EVM_FATALF("Unsupported operand type while processing %s", &m->tag[0]);
+  }
+
+  return result;
+}
+
+
+#if EVM_MEMORY_SUPPORT == 1
+// the scale is encoded as a power of two, giving the base as well selects the address form
+static int evmIndexedSerializer(const evm_mnemonic_t *m, evm_instruction_t *i) {
+  int result = 0;
+
+  i->binary[0] = m->op;
+  i->count = 1;
+
+  if(m->arg == ARG_SCALE) {
+    int32_t scale, base;
+    int count = evmasmScan(i, "%*s %d %x", &scale, &base);
+
+    if(count < 1) {
+      result = -1;
+      i->flags |= INST_MISSING_ARG;
+      EVM_ERRORF("Missing operand for %s", &m->tag[0]);
+    }
+    else if(scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+      result = -1;
+      i->flags |= INST_INVALID_ARG;
+      EVM_ERRORF("Scale out of bounds for %s (1, 2, 4 or 8, not %d)", &m->tag[0], scale);
+    }
+    else if(count > 1 && (base < 0 || 0xFFFF < base)) {
+      result = -1;
+      i->flags |= INST_INVALID_ARG;
+      EVM_ERRORF("Operand out of bounds for %s (0x0000 <= 0x%04X <= 0xFFFF)", &m->tag[0], base);
+    }
+    else {
+      i->binary[1] = (uint8_t) (scale == 1 ? 0 : scale == 2 ? 1 : scale == 4 ? 2 : 3);
+      i->count = 2;
+      if(count > 1) {
+        i->binary[0] = (uint8_t) (m->op + (OP_XREAD - OP_SXREAD));
+        i->binary[2] = (uint8_t) ( base       & 0xFF);
+        i->binary[3] = (uint8_t) ((base >> 8) & 0xFF);
+        i->count = 4;
+      }
+      i->flags |= INST_FINALIZED;
+    }
+  }
+  else {
+    EVM_FATALF("Unsupported operand type while processing %s", &m->tag[0]);
+  }
+
+  return result;
+}
+#endif
+
+
+// encode the slot or count of a frame instruction, using the long form when it needs two bytes
+static int evmasmFrameOperand(evm_instruction_t *i, uint32_t operand) {
+  if(operand <= 0xFF) {
+    i->binary[1] = (uint8_t) operand;
+    i->count = 2;
+  }
+  else if(operand <= 0xFFFF && i->binary[0] != OP_LEAVE) {
+    i->binary[0] = (uint8_t) (i->binary[0] + (OP_LENTER - OP_ENTER));
+    i->binary[1] = (uint8_t) ( operand       & 0xFF);
+    i->binary[2] = (uint8_t) ((operand >> 8) & 0xFF);
+    i->count = 3;
+  }
+  else {
+    return -1;
+  }
+
+  i->flags &= ~INST_UNRESOLVED;
+  i->flags |=  INST_FINALIZED;
+
+  return 0;
+}
+
@@ -0,0 +1,507 @@
+#include "evm/cfg.h"
+#include "evm/decode.h"
+#include "evm/opcodes.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+static uint32_t evmcfgInstructionLength(const evm_disasm_inst_t *);
+static uint32_t evmcfgTableEntries(const evm_disasm_inst_t *);
+static int      evmcfgEndsBlock(const evm_disasm_inst_t *);
+static uint32_t evmcfgAddEdge(uint32_t *, uint32_t, uint32_t);
+static int      evmcfgLink(evm_cfg_t *, const evm_disasm_inst_t **, uint32_t, const uint32_t *);
+static int      evmcfgAnalyze(evm_cfg_t *);
+static uint32_t evmcfgIntersect(const uint32_t *, const uint32_t *, uint32_t, uint32_t);
+
+
+evm_cfg_t *evmcfgAllocate() {
+  return (evm_cfg_t *) calloc(1, sizeof(evm_cfg_t));
+}
+
+
+evm_cfg_t *evmcfgInitialize(evm_cfg_t *cfg) {
+  if(cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+  }
+
+  return cfg;
+}
+
+
+evm_cfg_t *evmcfgFinalize(evm_cfg_t *cfg) {
+  if(cfg) {
+    free(cfg->blocks);
+    free(cfg->edges);
+    memset(cfg, 0, sizeof(*cfg));
+  }
+
+  return cfg;
+}
+
+
+void evmcfgFree(evm_cfg_t *cfg) {
+  free(cfg);
+}
+
+
+int evmcfgFromDisassembler(evm_cfg_t *cfg, const evm_disassembler_t *evm) {
+  const evm_disasm_inst_t *inst, **index;
+  uint32_t *tails, count = 0, idx, block;
+  int result = -1;
+
+  if(!cfg || !evm) {
+    return -1;
+  }
+
+  evmcfgFinalize(cfg); // replace any earlier graph
+
+  for(inst = evm->instructions.next; inst != &evm->instructions; inst = inst->next) {
+    ++count;
+  }
+
+  if(!count) {
+    return 0; // nothing to split
+  }
+
+  if((index = malloc(count * sizeof(*index)))) {
+    count = 0;
+
+    for(inst = evm->instructions.next; inst != &evm->instructions; inst = inst->next) {
+      // blocks start at the entry, at every label and after every transfer of control
+      if(!count || inst->label || evmcfgEndsBlock(index[count - 1])) {
+        ++cfg->count;
+      }
+
+      index[count++] = inst;
+    }
+
+    cfg->blocks = calloc(cfg->count, sizeof(evm_cfg_block_t));
+    tails = malloc(cfg->count * sizeof(uint32_t));
+
+    if(cfg->blocks && tails) {
+      for(block = 0, idx = 0; idx < count; ++idx) {
+        if(idx && (index[idx]->label || evmcfgEndsBlock(index[idx - 1]))) {
+          ++block;
+        }
+
+        if(!cfg->blocks[block].instructions++) {
+          cfg->blocks[block].start = index[idx]->offset;
+        }
+
+        cfg->blocks[block].end = index[idx]->offset + evmcfgInstructionLength(index[idx]);
+        cfg->blocks[block].idom = EVM_CFG_NONE;
+        tails[block] = idx;
+      }
+
+      cfg->blocks[0].flags |= EVM_CFG_ENTRY;
+      result = evmcfgLink(cfg, index, count, tails) || evmcfgAnalyze(cfg) ? -1 : 0;
+    }
+
+    free(tails);
+    free(index);
+  }
+
+  if(result) {
+    evmcfgFinalize(cfg);
+  }
+
+  return result;
+}
+
+
+uint32_t evmcfgFindBlock(const evm_cfg_t *cfg, uint32_t offset) {
+  if(cfg) {
+    uint32_t low = 0, high = cfg->count;
+
+    while(low < high) {
+      uint32_t mid = low + (high - low) / 2U;
+
+      if(cfg->blocks[mid].end <= offset) {
+        low = mid + 1U;
+      }
+      else {
+        high = mid;
+      }
+    }
+
+    if(low < cfg->count && cfg->blocks[low].start <= offset) {
+      return low;
+    }
+  }
+
+  return EVM_CFG_NONE;
+}
+
+
+int evmcfgDominates(const evm_cfg_t *cfg, uint32_t dom, uint32_t block) {
+  if(cfg && dom < cfg->count) {
+    while(block < cfg->count && block != dom) {
+      block = cfg->blocks[block].idom;
+    }
+
+    return block == dom;
+  }
+
+  return 0;
+}
+
+
+int evmcfgToDot(const evm_cfg_t *cfg, FILE *fp) {
+  uint32_t block, idx;
+
+  if(!cfg || !fp) {
+    return -1;
+  }
+
+  fprintf(fp, "digraph evm {\n  node [shape=box fontname=monospace];\n");
+
+  for(block = 0; block < cfg->count; ++block) {
+    const evm_cfg_block_t *b = &cfg->blocks[block];
+
+    fprintf(fp, "  b%u [label=\"LAB_%06X\\n%u instructions, %u bytes\"%s%s];\n",
+            block, b->start, b->instructions, b->end - b->start,
+            b->flags & (EVM_CFG_ENTRY | EVM_CFG_FUNCTION) ? " peripheries=2" : "",
+            b->flags & EVM_CFG_LOOP_HEADER ? " style=filled fillcolor=lightgrey" : "");
+  }
+
+  for(block = 0; block < cfg->count; ++block) {
+    const evm_cfg_block_t *b = &cfg->blocks[block];
+
+    for(idx = 0; idx < b->succCount; ++idx) {
+      const evm_cfg_block_t *succ = &cfg->blocks[b->succ[idx]];
+
+      // back edges close a loop
+      fprintf(fp, "  b%u -> b%u%s;\n", block, b->succ[idx],
+              (succ->flags & EVM_CFG_LOOP_HEADER) && evmcfgDominates(cfg, b->succ[idx], block) ?
+              " [style=bold]" : "");
+    }
+  }
+
+  fprintf(fp, "}\n");
+
+  return ferror(fp) ? -1 : 0;
+}
+
+
+int evmcfgToJson(const evm_cfg_t *cfg, FILE *fp) {
+  uint32_t block, idx;
+
+  if(!cfg || !fp) {
+    return -1;
+  }
+
+  fprintf(fp, "{\n  \"blocks\": [");
+
+  for(block = 0; block < cfg->count; ++block) {
+    const evm_cfg_block_t *b = &cfg->blocks[block];
+
+    fprintf(fp, "%s\n    {\"id\": %u, \"start\": %u, \"end\": %u, \"instructions\": %u, ",
+            block ? "," : "", block, b->start, b->end, b->instructions);
+
+    if(b->idom == EVM_CFG_NONE) {
+      fprintf(fp, "\"idom\": null, ");
+    }
+    else {
+      fprintf(fp, "\"idom\": %u, ", b->idom);
+    }
+
+    fprintf(fp, "\"entry\": %s, \"function\": %s, \"loop_header\": %s, \"exit\": %s, \"succ\": [",
+            b->flags & EVM_CFG_ENTRY ? "true" : "false",
+            b->flags & EVM_CFG_FUNCTION ? "true" : "false",
+            b->flags & EVM_CFG_LOOP_HEADER ? "true" : "false",
+            b->flags & EVM_CFG_EXIT ? "true" : "false");
+
+    for(idx = 0; idx < b->succCount; ++idx) {
+      fprintf(fp, "%s%u", idx ? ", " : "", b->succ[idx]);
+    }
+
+    fprintf(fp, "], \"pred\": [");
+
+    for(idx = 0; idx < b->predCount; ++idx) {
+      fprintf(fp, "%s%u", idx ? ", " : "", b->pred[idx]);
+    }
+
+    fprintf(fp, "]}");
+  }
+
+  fprintf(fp, "\n  ]\n}\n");
+
+  return ferror(fp) ? -1 : 0;
+}
+
+
+static uint32_t evmcfgTableEntries(const evm_disasm_inst_t *inst) {
+  return (((uint32_t) inst->arg.i8) & 0xFF) + 1U;
+}
+
+
+static uint32_t evmcfgInstructionLength(const evm_disasm_inst_t *inst) {
+  const evm_opcode_info_t *info = &EVM_OPCODE_INFO[inst->opcode];
+
+  switch(info->immediate) {
+    case EVM_IMM_TABLE8:
+      return info->length + evmcfgTableEntries(inst);
+
+    case EVM_IMM_TABLE16:
+      return info->length + evmcfgTableEntries(inst) * 2U;
+
+    default:
+      return info->length;
+  }
+}
+
+
+// calls return to the following instruction so only jumps, returns and halts end a block
+static int evmcfgEndsBlock(const evm_disasm_inst_t *inst) {
+  uint8_t branch = EVM_OPCODE_INFO[inst->opcode].branch;
+
+  return branch != EVM_BRANCH_NONE && branch != EVM_BRANCH_CALL;
+}
+
+
+// append a block to an edge list unless it is already there
+static uint32_t evmcfgAddEdge(uint32_t *list, uint32_t count, uint32_t block) {
+  uint32_t idx;
+
+  for(idx = 0; idx < count; ++idx) {
+    if(list[idx] == block) {
+      return count;
+    }
+  }
+
+  list[count] = block;
+
+  return count + 1U;
+}
+
+
+static int evmcfgLink(evm_cfg_t *cfg, const evm_disasm_inst_t **index, uint32_t count,
+                      const uint32_t *tails) {
+  uint32_t block, idx, target, bound = 0, used = 0;
+  uint32_t *preds;
+
+  // every block has at most one edge per target plus the fall through
+  for(block = 0; block < cfg->count; ++block) {
+    const evm_disasm_inst_t *tail = index[tails[block]];
+
+    bound += EVM_OPCODE_INFO[tail->opcode].branch == EVM_BRANCH_TABLE ?
+             evmcfgTableEntries(tail) : 2U;
+  }
+
+  if(!(cfg->edges = malloc(2U * bound * sizeof(uint32_t)))) {
+    return -1;
+  }
+
+  for(block = 0; block < cfg->count; ++block) {
+    const evm_disasm_inst_t *tail = index[tails[block]];
+    evm_cfg_block_t *b = &cfg->blocks[block];
+    int fallthrough = 0;
+
+    b->succ = &cfg->edges[used];
+
+    switch(EVM_OPCODE_INFO[tail->opcode].branch) {
+      case EVM_BRANCH_COND:
+        fallthrough = 1;
+        // fallthrough
+      case EVM_BRANCH_JUMP:
+        if((target = evmcfgFindBlock(cfg, tail->targets[0])) != EVM_CFG_NONE) {
+          b->succCount = evmcfgAddEdge(b->succ, b->succCount, target);
+        }
+      break;
+
+      case EVM_BRANCH_TABLE:
+        for(idx = 0; idx < evmcfgTableEntries(tail); ++idx) {
+          if((target = evmcfgFindBlock(cfg, tail->targets[idx])) != EVM_CFG_NONE) {
+            b->succCount = evmcfgAddEdge(b->succ, b->succCount, target);
+          }
+        }
+      break;
+
+      case EVM_BRANCH_RETURN:
+      case EVM_BRANCH_HALT:
+        b->flags |= EVM_CFG_EXIT;
+      break;
+
+      default:
+        fallthrough = 1; // the next block starts with a label
+      break;
+    }
+
+    if(fallthrough && block + 1U < cfg->count) {
+      b->succCount = evmcfgAddEdge(b->succ, b->succCount, block + 1U);
+    }
+
+    used += b->succCount;
+  }
+
+  cfg->edgeCount = used;
+  preds = &cfg->edges[used];
+
+  // size the predecessor lists, then fill them in block order
+  for(block = 0; block < cfg->count; ++block) {
+    for(idx = 0; idx < cfg->blocks[block].succCount; ++idx) {
+      ++cfg->blocks[cfg->blocks[block].succ[idx]].predCount;
+    }
+  }
+
+  for(block = 0; block < cfg->count; ++block) {
+    cfg->blocks[block].pred = preds;
+    preds += cfg->blocks[block].predCount;
+    cfg->blocks[block].predCount = 0;
+  }
+
+  for(block = 0; block < cfg->count; ++block) {
+    for(idx = 0; idx < cfg->blocks[block].succCount; ++idx) {
+      evm_cfg_block_t *succ = &cfg->blocks[cfg->blocks[block].succ[idx]];
+
+      succ->pred[succ->predCount++] = block;
+    }
+  }
+
+  // call targets start functions, which are only reached through the call graph
+  for(idx = 0; idx < count; ++idx) {
+    if(EVM_OPCODE_INFO[index[idx]->opcode].branch == EVM_BRANCH_CALL &&
+       (target = evmcfgFindBlock(cfg, index[idx]->targets[0])) != EVM_CFG_NONE) {
+      cfg->blocks[target].flags |= EVM_CFG_FUNCTION;
+    }
+  }
+
+  return 0;
+}
+
+
+// walk up the dominator tree from both blocks until they meet, count is the virtual root
+static uint32_t evmcfgIntersect(const uint32_t *doms, const uint32_t *rpo, uint32_t a, uint32_t b) {
+  while(a != b) {
+    while(rpo[a] > rpo[b]) {
+      a = doms[a];
+    }
+
+    while(rpo[b] > rpo[a]) {
+      b = doms[b];
+    }
+  }
+
+  return a;
+}
+
+
+// dominators by the iterative algorithm of Cooper, Harvey and Kennedy. The entry, every call
+// target and every block without predecessors hang off a virtual root so each function gets its
+// own tree. Loop headers are the targets of retreating edges that dominate their source.
+static int evmcfgAnalyze(evm_cfg_t *cfg) {
+  const uint32_t count = cfg->count;
+  uint32_t *work, *order, *rpo, *doms, *stack, *cursor, *pre, *post, *roots;
+  uint32_t block, idx, sp, visited = 0, finished = 0, pass;
+  int changed;
+
+  if(!(work = malloc((8U * count + 2U) * sizeof(uint32_t)))) {
+    return -1;
+  }
+
+  order  = work;
+  rpo    = &order[count];      // count + 1 entries
+  doms   = &rpo[count + 1U];   // count + 1 entries
+  stack  = &doms[count + 1U];
+  cursor = &stack[count];
+  pre    = &cursor[count];
+  post   = &pre[count];
+  roots  = &post[count];
+
+  for(block = 0; block < count; ++block) {
+    const evm_cfg_block_t *b = &cfg->blocks[block];
+
+    roots[block] = !block || (b->flags & EVM_CFG_FUNCTION) || !b->predCount;
+    doms[block] = roots[block] ? count : EVM_CFG_NONE;
+    pre[block] = EVM_CFG_NONE;
+  }
+
+  doms[count] = count;
+  rpo[count] = 0;
+
+  // depth first from every root, anything left over afterwards is unreachable and a root itself
+  for(pass = 0; pass < 2U; ++pass) {
+    for(block = 0; block < count; ++block) {
+      if(pre[block] != EVM_CFG_NONE || (!pass && !roots[block])) {
+        continue;
+      }
+
+      roots[block] = 1;
+      doms[block] = count;
+      pre[block] = visited++;
+      stack[0] = block;
+      cursor[0] = 0;
+      sp = 1;
+
+      while(sp) {
+        const evm_cfg_block_t *top = &cfg->blocks[stack[sp - 1U]];
+
+        if(cursor[sp - 1U] < top->succCount) {
+          uint32_t succ = top->succ[cursor[sp - 1U]++];
+
+          if(pre[succ] == EVM_CFG_NONE) {
+            pre[succ] = visited++;
+            stack[sp] = succ;
+            cursor[sp] = 0;
+            ++sp;
+          }
+        }
+        else {
+          post[stack[sp - 1U]] = finished;
+          order[finished++] = stack[--sp];
+        }
+      }
+    }
+  }
+
+  for(idx = 0; idx < count; ++idx) {
+    rpo[order[idx]] = count - idx;
+  }
+
+  do {
+    changed = 0;
+
+    for(idx = count; idx-- > 0;) {
+      const evm_cfg_block_t *b = &cfg->blocks[order[idx]];
+      uint32_t dom = EVM_CFG_NONE, p;
+
+      if(roots[order[idx]]) {
+        continue; // roots stay attached to the virtual root
+      }
+
+      for(p = 0; p < b->predCount; ++p) {
+        if(doms[b->pred[p]] != EVM_CFG_NONE) {
+          dom = dom == EVM_CFG_NONE ? b->pred[p] : evmcfgIntersect(doms, rpo, b->pred[p], dom);
+        }
+      }
+
+      if(dom != EVM_CFG_NONE && dom != doms[order[idx]]) {
+        doms[order[idx]] = dom;
+        changed = 1;
+      }
+    }
+  } while(changed);
+
+  for(block = 0; block < count; ++block) {
+    cfg->blocks[block].idom = doms[block] == count ? EVM_CFG_NONE : doms[block];
+  }
+
+  // an edge to a depth first ancestor is retreating, it is a back edge when the target dominates
+  for(block = 0; block < count; ++block) {
+    const evm_cfg_block_t *b = &cfg->blocks[block];
+
+    for(idx = 0; idx < b->succCount; ++idx) {
+      uint32_t head = b->succ[idx];
+
+      if(pre[head] <= pre[block] && post[block] <= post[head] &&
+         evmcfgDominates(cfg, head, block)) {
+        cfg->blocks[head].flags |= EVM_CFG_LOOP_HEADER;
+      }
+    }
+  }
+
+  free(work);
+
+  return 0;
+}
@@ -0,0 +1,417 @@
+#include "evm/decode.h"
+#include "evm/opcodes.h"
+
+
+static int32_t evmDecodeImmediate(const uint8_t *, uint8_t);
+
+
+#define INFO(LEN, IMM, BRANCH, POPS, PUSHES) \
+  { LEN, EVM_IMM_##IMM, EVM_BRANCH_##BRANCH, POPS, PUSHES }
+
+// opcodes without an entry are illegal, REM_R and RET_I take their stack effect from the immediate
+const evm_opcode_info_t EVM_OPCODE_INFO[256] = {
+  // FAM_CALL
+  [OP_NOP]       = INFO(1, NONE,    NONE,   0, 0),
+  [OP_CALL]      = INFO(3, I16,     CALL,   0, 1),
+  [OP_LCALL]     = INFO(4, I24,     CALL,   0, 1),
+  [OP_BCALL]     = INFO(2, U8,      NONE,   0, 0),
+  [OP_YIELD]     = INFO(1, NONE,    NONE,   0, 0),
+  [OP_HALT]      = INFO(1, NONE,    HALT,   0, 0),
+
+  // FAM_PUSH
+  [OP_PUSH_I0]   = INFO(1, NONE,    NONE,   0, 1),
+  [OP_PUSH_I1]   = INFO(1, NONE,    NONE,   0, 1),
+  [OP_PUSH_IN1]  = INFO(1, NONE,    NONE,   0, 1),
+  [OP_PUSH_8I]   = INFO(2, I8,      NONE,   0, 1),
+  [OP_PUSH_16I]  = INFO(3, I16,     NONE,   0, 1),
+  [OP_PUSH_24I]  = INFO(4, I24,     NONE,   0, 1),
+  [OP_PUSH_32I]  = INFO(5, I32,     NONE,   0, 1),
+#if EVM_FLOAT_SUPPORT == 1
+  [OP_PUSH_F0]   = INFO(1, NONE,    NONE,   0, 1),
+  [OP_PUSH_F1]   = INFO(1, NONE,    NONE,   0, 1),
+  [OP_PUSH_FN1]  = INFO(1, NONE,    NONE,   0, 1),
+  [OP_PUSH_F]    = INFO(5, F32,     NONE,   0, 1),
+#endif
+  [OP_SWAP]      = INFO(1, NONE,    NONE,   2, 2),
+
+  // FAM_POP
+  [OP_POP_1]     = INFO(1, NONE,    NONE,   1, 0),
+  [OP_POP_2]     = INFO(1, NONE,    NONE,   2, 0),
+  [OP_POP_3]     = INFO(1, NONE,    NONE,   3, 0),
+  [OP_POP_4]     = INFO(1, NONE,    NONE,   4, 0),
+  [OP_POP_5]     = INFO(1, NONE,    NONE,   5, 0),
+  [OP_POP_6]     = INFO(1, NONE,    NONE,   6, 0),
+  [OP_POP_7]     = INFO(1, NONE,    NONE,   7, 0),
+  [OP_POP_8]     = INFO(1, NONE,    NONE,   8, 0),
+  [OP_REM_1]     = INFO(1, NONE,    NONE,   2, 1),
+  [OP_REM_2]     = INFO(1, NONE,    NONE,   3, 2),
+  [OP_REM_3]     = INFO(1, NONE,    NONE,   4, 3),
+  [OP_REM_4]     = INFO(1, NONE,    NONE,   5, 4),
+  [OP_REM_5]     = INFO(1, NONE,    NONE,   6, 5),
+  [OP_REM_6]     = INFO(1, NONE,    NONE,   7, 6),
+  [OP_REM_7]     = INFO(1, NONE,    NONE,   8, 7),
+  [OP_REM_R]     = INFO(2, NIBBLES, NONE,   0, 0),
+
+  // FAM_DUP
+  [OP_DUP_0]     = INFO(1, NONE,    NONE,   1, 2),
+  [OP_DUP_1]     = INFO(1, NONE,    NONE,   2, 3),
+  [OP_DUP_2]     = INFO(1, NONE,    NONE,   3, 4),
+  [OP_DUP_3]     = INFO(1, NONE,    NONE,   4, 5),
+  [OP_DUP_4]     = INFO(1, NONE,    NONE,   5, 6),
+  [OP_DUP_5]     = INFO(1, NONE,    NONE,   6, 7),
+  [OP_DUP_6]     = INFO(1, NONE,    NONE,   7, 8),
+  [OP_DUP_7]     = INFO(1, NONE,    NONE,   8, 9),
+  [OP_DUP_8]     = INFO(1, NONE,    NONE,   9, 10),
+  [OP_DUP_9]     = INFO(1, NONE,    NONE,  10, 11),
+  [OP_DUP_10]    = INFO(1, NONE,    NONE,  11, 12),
+  [OP_DUP_11]    = INFO(1, NONE,    NONE,  12, 13),
+  [OP_DUP_12]    = INFO(1, NONE,    NONE,  13, 14),
+  [OP_DUP_13]    = INFO(1, NONE,    NONE,  14, 15),
+  [OP_DUP_14]    = INFO(1, NONE,    NONE,  15, 16),
+  [OP_DUP_15]    = INFO(1, NONE,    NONE,  16, 17),
+
+  // FAM_MATH
+  [OP_INC_I]     = INFO(1, NONE,    NONE,   1, 1),
+  [OP_DEC_I]     = INFO(1, NONE,    NONE,   1, 1),
+  [OP_ABS_I]     = INFO(1, NONE,    NONE,   1, 1),
+  [OP_NEG_I]     = INFO(1, NONE,    NONE,   1, 1),
+  [OP_ADD_I]     = INFO(1, NONE,    NONE,   2, 1),
+  [OP_SUB_I]     = INFO(1, NONE,    NONE,   2, 1),
+  [OP_MUL_I]     = INFO(1, NONE,    NONE,   2, 1),
+  [OP_DIV_I]     = INFO(1, NONE,    NONE,   2, 1),
+#if EVM_FLOAT_SUPPORT == 1
+  [OP_INC_F]     = INFO(1, NONE,    NONE,   1, 1),
+  [OP_DEC_F]     = INFO(1, NONE,    NONE,   1, 1),
+  [OP_ABS_F]     = INFO(1, NONE,    NONE,   1, 1),
+  [OP_NEG_F]     = INFO(1, NONE,    NONE,   1, 1),
+  [OP_ADD_F]     = INFO(1, NONE,    NONE,   2, 1),
+  [OP_SUB_F]     = INFO(1, NONE,    NONE,   2, 1),
+  [OP_MUL_F]     = INFO(1, NONE,    NONE,   2, 1),
+  [OP_DIV_F]     = INFO(1, NONE,    NONE,   2, 1),
+#endif
+
+  // FAM_BITS
+  [OP_LSH]       = INFO(1, NONE,    NONE,   2, 1),
+  [OP_RSH]       = INFO(1, NONE,    NONE,   2, 1),
+  [OP_AND]       = INFO(1, NONE,    NONE,   2, 1),
+  [OP_OR]        = INFO(1, NONE,    NONE,   2, 1),
+  [OP_XOR]       = INFO(1, NONE,    NONE,   2, 1),
+  [OP_INV]       = INFO(1, NONE,    NONE,   1, 1),
+  [OP_BOOL]      = INFO(1, NONE,    NONE,   1, 1),
+  [OP_NOT]       = INFO(1, NONE,    NONE,   1, 1),
+  [OP_TRUNC]     = INFO(2, U8,      NONE,   1, 1),
+  [OP_SIGNEXT]   = INFO(2, U8,      NONE,   1, 1),
+#if EVM_FLOAT_SUPPORT == 1
+  [OP_CONV_FI]   = INFO(1, NONE,    NONE,   1, 1),
+  [OP_CONV_FI_1] = INFO(1, NONE,    NONE,   2, 2),
+  [OP_CONV_IF]   = INFO(1, NONE,    NONE,   1, 1),
+  [OP_CONV_IF_1] = INFO(1, NONE,    NONE,   2, 2),
+#endif
+
+#if EVM_MEMORY_SUPPORT == 1
+  // FAM_BLOCK
+  [OP_MEMCPY]    = INFO(1, NONE,    NONE,   3, 0),
+  [OP_MEMMOVE]   = INFO(1, NONE,    NONE,   3, 0),
+  [OP_MEMSET]    = INFO(1, NONE,    NONE,   3, 0),
+  [OP_MEMCMP]    = INFO(1, NONE,    NONE,   3, 1),
+
+  // FAM_VEC
+  [OP_VADD_I]    = INFO(1, NONE,    NONE,   3, 0),
+  [OP_VSUB_I]    = INFO(1, NONE,    NONE,   3, 0),
+  [OP_VMUL_I]    = INFO(1, NONE,    NONE,   3, 0),
+  [OP_VDOT_I]    = INFO(1, NONE,    NONE,   2, 1),
+  [OP_VMIN_I]    = INFO(1, NONE,    NONE,   3, 0),
+  [OP_VMAX_I]    = INFO(1, NONE,    NONE,   3, 0),
+#  if EVM_FLOAT_SUPPORT == 1
+  [OP_VADD_F]    = INFO(1, NONE,    NONE,   3, 0),
+  [OP_VSUB_F]    = INFO(1, NONE,    NONE,   3, 0),
+  [OP_VMUL_F]    = INFO(1, NONE,    NONE,   3, 0),
+  [OP_VDOT_F]    = INFO(1, NONE,    NONE,   2, 1),
+  [OP_VMIN_F]    = INFO(1, NONE,    NONE,   3, 0),
+  [OP_VMAX_F]    = INFO(1, NONE,    NONE,   3, 0),
+#  endif
+#endif
+
+  // FAM_FRAME, ENTER and LEAVE push and drop whole frames so they manage the stack themselves
+  [OP_ENTER]     = INFO(2, U8,      NONE,   0, 0),
+  [OP_LEAVE]     = INFO(2, U8,      NONE,   0, 0),
+  [OP_LOAD_L]    = INFO(2, U8,      NONE,   0, 1),
+  [OP_STORE_L]   = INFO(2, U8,      NONE,   1, 0),
+  [OP_LOAD_A]    = INFO(2, U8,      NONE,   0, 1),
+  [OP_LENTER]    = INFO(3, U16,     NONE,   0, 0),
+  [OP_LLOAD_L]   = INFO(3, U16,     NONE,   0, 1),
+  [OP_LSTORE_L]  = INFO(3, U16,     NONE,   1, 0),
+  [OP_LLOAD_A]   = INFO(3, U16,     NONE,   0, 1),
+
+  // FAM_IMM, the value compared to is the operand of JCMP and the top is left on the stack
+  [OP_ADD_8I]    = INFO(2, I8,      NONE,   1, 1),
+  [OP_SUB_8I]    = INFO(2, I8,      NONE,   1, 1),
+  [OP_MUL_8I]    = INFO(2, I8,      NONE,   1, 1),
+  [OP_AND_8I]    = INFO(2, I8,      NONE,   1, 1),
+  [OP_LSH_8I]    = INFO(2, U8,      NONE,   1, 1),
+  [OP_JCMP_8I]   = INFO(4, CMP8,    COND,   1, 1),
+  [OP_DJNZ]      = INFO(2, I8,      COND,   1, 1),
+  [OP_ADD_16I]   = INFO(3, I16,     NONE,   1, 1),
+  [OP_SUB_16I]   = INFO(3, I16,     NONE,   1, 1),
+  [OP_MUL_16I]   = INFO(3, I16,     NONE,   1, 1),
+  [OP_AND_16I]   = INFO(3, I16,     NONE,   1, 1),
+  [OP_LJCMP_8I]  = INFO(5, CMP16,   COND,   1, 1),
+  [OP_LDJNZ]     = INFO(3, I16,     COND,   1, 1),
+
+  // FAM_XMATH
+  [OP_POPCNT]    = INFO(1, NONE,    NONE,   1, 1),
+  [OP_CLZ]       = INFO(1, NONE,    NONE,   1, 1),
+  [OP_CTZ]       = INFO(1, NONE,    NONE,   1, 1),
+  [OP_ROL]       = INFO(1, NONE,    NONE,   2, 1),
+  [OP_ROR]       = INFO(1, NONE,    NONE,   2, 1),
+  [OP_MOD_I]     = INFO(1, NONE,    NONE,   2, 1),
+  [OP_MIN_I]     = INFO(1, NONE,    NONE,   2, 1),
+  [OP_MAX_I]     = INFO(1, NONE,    NONE,   2, 1),
+#if EVM_FLOAT_SUPPORT == 1
+  [OP_MIN_F]     = INFO(1, NONE,    NONE,   2, 1),
+  [OP_MAX_F]     = INFO(1, NONE,    NONE,   2, 1),
+  [OP_SQRT_F]    = INFO(1, NONE,    NONE,   1, 1),
+  [OP_FMA_F]     = INFO(1, NONE,    NONE,   3, 1),
+#endif
+
+#if EVM_MEMORY_SUPPORT == 1
+  // FAM_INDEX, the scale of the address forms is left to be read from the byte after the opcode
+  [OP_SXREAD]    = INFO(2, SCALE,   NONE,   2, 1),
+  [OP_SXREAD8]   = INFO(2, SCALE,   NONE,   2, 1),
+  [OP_SXREAD8U]  = INFO(2, SCALE,   NONE,   2, 1),
+  [OP_SXREAD16]  = INFO(2, SCALE,   NONE,   2, 1),
+  [OP_SXREAD16U] = INFO(2, SCALE,   NONE,   2, 1),
+  [OP_SXWRITE8]  = INFO(2, SCALE,   NONE,   3, 0),
+  [OP_SXWRITE16] = INFO(2, SCALE,   NONE,   3, 0),
+  [OP_SXWRITE32] = INFO(2, SCALE,   NONE,   3, 0),
+  [OP_XREAD]     = INFO(4, SCALE16, NONE,   1, 1),
+  [OP_XREAD8]    = INFO(4, SCALE16, NONE,   1, 1),
+  [OP_XREAD8U]   = INFO(4, SCALE16, NONE,   1, 1),
+  [OP_XREAD16]   = INFO(4, SCALE16, NONE,   1, 1),
+  [OP_XREAD16U]  = INFO(4, SCALE16, NONE,   1, 1),
+  [OP_XWRITE8]   = INFO(4, SCALE16, NONE,   2, 0),
+  [OP_XWRITE16]  = INFO(4, SCALE16, NONE,   2, 0),
+  [OP_XWRITE32]  = INFO(4, SCALE16, NONE,   2, 0),
+
+  // FAM_MEM
+  [OP_SEG]       = INFO(2, U8,      NONE,   0, 0),
+  [OP_READ]      = INFO(3, U16,     NONE,   0, 1),
+  [OP_WRITE8]    = INFO(3, U16,     NONE,   1, 1),
+  [OP_WRITE16]   = INFO(3, U16,     NONE,   1, 1),
+  [OP_WRITE24]   = INFO(3, U16,     NONE,   1, 1),
+  [OP_WRITE32]   = INFO(3, U16,     NONE,   1, 1),
+  [OP_LREAD]     = INFO(4, U24,     NONE,   0, 1),
+  [OP_LWRITE8]   = INFO(4, U24,     NONE,   1, 1),
+  [OP_LWRITE16]  = INFO(4, U24,     NONE,   1, 1),
+  [OP_LWRITE24]  = INFO(4, U24,     NONE,   1, 1),
+  [OP_LWRITE32]  = INFO(4, U24,     NONE,   1, 1),
+  [OP_SREAD]     = INFO(1, NONE,    NONE,   1, 1),
+  [OP_SWRITE8]   = INFO(1, NONE,    NONE,   2, 0),
+  [OP_SWRITE16]  = INFO(1, NONE,    NONE,   2, 0),
+  [OP_SWRITE24]  = INFO(1, NONE,    NONE,   2, 0),
+  [OP_SWRITE32]  = INFO(1, NONE,    NONE,   2, 0),
+#endif
+
+  // FAM_CMP, the operands are left on the stack
+  [OP_CMP_I0]    = INFO(1, NONE,    NONE,   1, 1),
+  [OP_CMP_I1]    = INFO(1, NONE,    NONE,   1, 1),
+  [OP_CMP_IN1]   = INFO(1, NONE,    NONE,   1, 1),
+  [OP_CMP_I]     = INFO(1, NONE,    NONE,   2, 2),
+#if EVM_FLOAT_SUPPORT == 1
+  [OP_CMP_F0]    = INFO(1, NONE,    NONE,   1, 1),
+  [OP_CMP_F1]    = INFO(1, NONE,    NONE,   1, 1),
+  [OP_CMP_FN1]   = INFO(1, NONE,    NONE,   1, 1),
+  [OP_CMP_F]     = INFO(1, NONE,    NONE,   2, 2),
+#endif
+
+  // FAM_JMP, the table index is left on the stack
+  [OP_JMP]       = INFO(2, I8,      JUMP,   0, 0),
+  [OP_JLT]       = INFO(2, I8,      COND,   0, 0),
+  [OP_JLE]       = INFO(2, I8,      COND,   0, 0),
+  [OP_JNE]       = INFO(2, I8,      COND,   0, 0),
+  [OP_JEQ]       = INFO(2, I8,      COND,   0, 0),
+  [OP_JGE]       = INFO(2, I8,      COND,   0, 0),
+  [OP_JGT]       = INFO(2, I8,      COND,   0, 0),
+  [OP_JTBL]      = INFO(2, TABLE8,  TABLE,  1, 1),
+  [OP_LJMP]      = INFO(3, I16,     JUMP,   0, 0),
+  [OP_LJLT]      = INFO(3, I16,     COND,   0, 0),
+  [OP_LJLE]      = INFO(3, I16,     COND,   0, 0),
+  [OP_LJNE]      = INFO(3, I16,     COND,   0, 0),
+  [OP_LJEQ]      = INFO(3, I16,     COND,   0, 0),
+  [OP_LJGE]      = INFO(3, I16,     COND,   0, 0),
+  [OP_LJGT]      = INFO(3, I16,     COND,   0, 0),
+  [OP_LJTBL]     = INFO(2, TABLE16, TABLE,  1, 1),
+
+  // FAM_RET
+  [OP_RET]       = INFO(1, NONE,    RETURN, 1, 0),
+  [OP_RET_1]     = INFO(1, NONE,    RETURN, 2, 1),
+  [OP_RET_2]     = INFO(1, NONE,    RETURN, 3, 2),
+  [OP_RET_3]     = INFO(1, NONE,    RETURN, 4, 3),
+  [OP_RET_4]     = INFO(1, NONE,    RETURN, 5, 4),
+  [OP_RET_5]     = INFO(1, NONE,    RETURN, 6, 5),
+  [OP_RET_6]     = INFO(1, NONE,    RETURN, 7, 6),
+  [OP_RET_7]     = INFO(1, NONE,    RETURN, 8, 7),
+  [OP_RET_8]     = INFO(1, NONE,    RETURN, 9, 8),
+  [OP_RET_9]     = INFO(1, NONE,    RETURN, 10, 9),
+  [OP_RET_10]    = INFO(1, NONE,    RETURN, 11, 10),
+  [OP_RET_11]    = INFO(1, NONE,    RETURN, 12, 11),
+  [OP_RET_12]    = INFO(1, NONE,    RETURN, 13, 12),
+  [OP_RET_13]    = INFO(1, NONE,    RETURN, 14, 13),
+  [OP_RET_14]    = INFO(1, NONE,    RETURN, 15, 14),
+  [OP_RET_I]     = INFO(2, U8,      RETURN, 0, 0),
+};
+
+#undef INFO
+
+
+int evmDecodeNext(const uint8_t *code, size_t length, evm_decoded_t *decoded) {
+  const evm_opcode_info_t *info;
+  const uint8_t *bin;
+  size_t remaining;
+
+  if(!code || !decoded) {
+    return -1;
+  }
+
+  if(decoded->next >= length) {
+    return 0; // nothing left to decode
+  }
+
+  bin = &code[decoded->next];
+  info = &EVM_OPCODE_INFO[bin[0]];
+  remaining = length - decoded->next;
+  decoded->offset = decoded->next;
+
+  if(!info->length || info->length > remaining) {
+    return -1; // illegal or truncated instruction
+  }
+
+  decoded->table = NULL;
+  decoded->length = info->length;
+  decoded->target = 0;
+  decoded->entries = 0;
+  decoded->operand.i32 = evmDecodeImmediate(&bin[1], info->immediate);
+  decoded->opcode = bin[0];
+  decoded->immediate = info->immediate;
+  decoded->branch = info->branch;
+  decoded->pops = info->pops;
+  decoded->pushes = info->pushes;
+
+  switch(info->branch) {
+    case EVM_BRANCH_JUMP:
+    case EVM_BRANCH_COND:
+    case EVM_BRANCH_CALL:
+      decoded->target = decoded->offset + (uint32_t) decoded->operand.i32;
+      if(info->immediate == EVM_IMM_CMP8 || info->immediate == EVM_IMM_CMP16) {
+        // the offset follows the flags and the value compared to
+        decoded->target = decoded->offset + (uint32_t) evmDecodeImmediate(&bin[3],
+            info->immediate == EVM_IMM_CMP16 ? EVM_IMM_I16 : EVM_IMM_I8);
+      }
+    break;
+
+    case EVM_BRANCH_TABLE: {
+      uint32_t size = info->immediate == EVM_IMM_TABLE16 ? 2U : 1U;
+
+      decoded->entries = decoded->operand.u32 + 1U;
+      if(decoded->entries * size > remaining - info->length) {
+        return -1; // the table runs past the end of the code
+      }
+
+      decoded->table = &bin[info->length];
+      decoded->length += decoded->entries * size;
+    } break;
+
+    default:
+      // nothing to do here
+    break;
+  }
+
+  // the stack effect of the variable forms depends on their immediate
+  if(bin[0] == OP_REM_R) {
+    decoded->pushes = (uint8_t) ((decoded->operand.u32 >> 4) + 1U);
+    decoded->pops = (uint8_t) (decoded->pushes + (decoded->operand.u32 & 0x0F) + 1U);
+  }
+  else if(bin[0] == OP_RET_I) {
+    decoded->pushes = (uint8_t) decoded->operand.u32;
+    decoded->pops = (uint8_t) (decoded->operand.u32 + 1U);
+  }
+
+  decoded->next = decoded->offset + decoded->length;
+
+  return 1;
+}
+
+
+uint32_t evmDecodeTableTarget(const evm_decoded_t *decoded, uint32_t index) {
+  if(decoded && decoded->table && index < decoded->entries) {
+    if(decoded->immediate == EVM_IMM_TABLE16) {
+      return decoded->offset + (uint32_t) evmDecodeImmediate(&decoded->table[index * 2U],
+                                                             EVM_IMM_I16);
+    }
+
+    return decoded->offset + (uint32_t) evmDecodeImmediate(&decoded->table[index], EVM_IMM_I8);
+  }
+
+  return 0;
+}
+
+
+// widen a little endian immediate, sign extending without relying on signed shifts
+static int32_t evmDecodeImmediate(const uint8_t *bin, uint8_t immediate) {
+  uint32_t value = 0;
+
+  switch(immediate) {
+    case EVM_IMM_I8:
+      value = ((uint32_t) bin[0] ^ 0x80U) - 0x80U;
+    break;
+
+    case EVM_IMM_U8:
+    case EVM_IMM_NIBBLES:
+    case EVM_IMM_TABLE8:
+    case EVM_IMM_TABLE16:
+      value = bin[0];
+    break;
+
+    case EVM_IMM_I16:
+      value = (((uint32_t) bin[0] | ((uint32_t) bin[1] << 8)) ^ 0x8000U) - 0x8000U;
+    break;
+
+    case EVM_IMM_CMP8:
+    case EVM_IMM_CMP16:
+      value = ((uint32_t) bin[1] ^ 0x80U) - 0x80U;
+    break;
+
+    case EVM_IMM_U16:
+      value = (uint32_t) bin[0] | ((uint32_t) bin[1] << 8);
+    break;
+
+    case EVM_IMM_SCALE:
+      value = 1U << (bin[0] & 0x03U);
+    break;
+
+    case EVM_IMM_SCALE16:
+      value = (uint32_t) bin[1] | ((uint32_t) bin[2] << 8);
+    break;
+
+    case EVM_IMM_I24:
+      value = (((uint32_t) bin[0] | ((uint32_t) bin[1] << 8) | ((uint32_t) bin[2] << 16)) ^
+               0x800000U) - 0x800000U;
+    break;
+
+    case EVM_IMM_U24:
+      value = (uint32_t) bin[0] | ((uint32_t) bin[1] << 8) | ((uint32_t) bin[2] << 16);
+    break;
+
+    case EVM_IMM_I32:
+    case EVM_IMM_F32:
+      value = (uint32_t) bin[0]         | ((uint32_t) bin[1] <<  8) |
+              ((uint32_t) bin[2] << 16) | ((uint32_t) bin[3] << 24);
+    break;
+
+    default:
+      // no immediate
+    break;
+  }
+
+  return (int32_t) value;
+}
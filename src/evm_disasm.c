@@ -1,6 +1,8 @@
 #include "evm/disasm.h"
+#include "evm/decode.h"
 #include "evm/opcodes.h"
 
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -41,155 +43,81 @@ void evmdisFree(evm_disassembler_t *evm) {
 }
 
 
-static void evmdisAddTableEntry(evm_disassembler_t *evm, const uint8_t *bin, int length) {
-  evm_disasm_inst_t *inst = evm->instructions.prev;
-  int32_t *ptr = NULL;
-
-  switch(length) {
-    case 1:
-      if(inst->opcode == OP_JTBL) {
-        ptr = (int32_t *) &inst->targets[inst->arg.pair[1]++];
-      }
-      else {
-        ptr = (int32_t *) &inst->targets[0];
-      }
-
-      *ptr = inst->offset + *(int8_t *) bin;
-    break;
-
-    case 2:
-      if(inst->opcode == OP_LJTBL) {
-        ptr = (int32_t *) &inst->targets[inst->arg.pair[1]++];
-      }
-      else {
-        ptr = (int32_t *) &inst->targets[0];
-      }
-
-      *ptr = inst->offset + (((((int32_t) bin[0]) << 16) | (((int32_t) bin[1]) << 24)) >> 16);
-    break;
-
-    case 3:
-      inst->targets[0] = inst->offset + (((((int32_t) bin[0]) <<  8) |
-                                         (((int32_t) bin[1]) << 16) |
-                                          (((int32_t) bin[2]) << 24)) >> 8);
-    break;
-  }
-}
-
-
 #define SIZE_FOR(_cnt) (((sizeof(evm_disasm_inst_t) + 7) & ~7) + (sizeof(uint32_t) * _cnt))
 
-static void evmdisAddInstruction(evm_disassembler_t *evm, const uint8_t *bin, uint32_t off, int len) {
+static int evmdisAddInstruction(evm_disassembler_t *evm, const uint8_t *bin,
+                                const evm_decoded_t *decoded) {
   evm_disasm_inst_t *inst;
+  uint32_t count = 0, idx;
 
-  switch(bin[off]) {
-    // function calls
-    case OP_CALL:
-    case OP_LCALL:
-    // jump instructions
-    case OP_JMP:
-    case OP_JLT:
-    case OP_JLE:
-    case OP_JNE:
-    case OP_JEQ:
-    case OP_JGE:
-    case OP_JGT:
-    case OP_LJMP:
-    case OP_LJLT:
-    case OP_LJLE:
-    case OP_LJNE:
-    case OP_LJEQ:
-    case OP_LJGE:
-    case OP_LJGT:
-      if((inst = calloc(1, SIZE_FOR(1)))) {
-        inst->targets = (uint32_t *) &inst[1];
-      }
+  switch(decoded->branch) {
+    case EVM_BRANCH_JUMP:
+    case EVM_BRANCH_COND:
+    case EVM_BRANCH_CALL:
+      count = 1;
     break;
 
-    // jump table instructions
-    case OP_JTBL:
-    case OP_LJTBL:
-      if((inst = calloc(1, SIZE_FOR(bin[off + 1] + 1)))) {
-        inst->targets = (uint32_t *) &inst[1];
-      }
+    case EVM_BRANCH_TABLE:
+      count = decoded->entries;
     break;
 
-    default: // simple instructions
-      inst = calloc(1, SIZE_FOR(0));
+    default:
+      // simple instructions
     break;
   }
 
-  if(inst) {
-    inst->prev = evm->instructions.prev;
-    inst->next = &evm->instructions;
-    evm->instructions.prev = inst;
-    inst->prev->next = inst;
-    inst->offset = off;
-    memcpy(&inst->arg.raw[0], &bin[off + 1], len - 1);
-    inst->opcode = bin[off];
-
-    if(inst->targets) {
-      switch(inst->opcode) {
-        // one byte delta
-        case OP_JMP:
-        case OP_JLT:
-        case OP_JLE:
-        case OP_JNE:
-        case OP_JEQ:
-        case OP_JGE:
-        case OP_JGT:
-          evmdisAddTableEntry(evm, &bin[off + 1], 1);
-        break;
+  if(!(inst = calloc(1, SIZE_FOR(count)))) {
+    return -1;
+  }
 
-        // two bytte delta
-        case OP_CALL:
-        case OP_LJMP:
-        case OP_LJLT:
-        case OP_LJLE:
-        case OP_LJNE:
-        case OP_LJEQ:
-        case OP_LJGE:
-        case OP_LJGT:
-          evmdisAddTableEntry(evm, &bin[off + 1], 2);
-        break;
+  inst->prev = evm->instructions.prev;
+  inst->next = &evm->instructions;
+  evm->instructions.prev = inst;
+  inst->prev->next = inst;
+  inst->offset = decoded->offset;
+  memcpy(&inst->arg.raw[0], &bin[decoded->offset + 1], EVM_OPCODE_INFO[decoded->opcode].length - 1);
+  inst->opcode = decoded->opcode;
 
-        // three byte delta
-        case OP_LCALL:
-          evmdisAddTableEntry(evm, &bin[off + 1], 3);
-        break;
+  if(count) {
+    inst->targets = (uint32_t *) &inst[1];
 
-        default:
-          // nothing to do here
-        break;
+    if(decoded->table) {
+      for(idx = 0; idx < count; ++idx) {
+        inst->targets[idx] = evmDecodeTableTarget(decoded, idx);
       }
     }
+    else {
+      inst->targets[0] = decoded->target;
+    }
   }
+
+  return 0;
 }
 
 #undef SIZE_FOR
 
 
-static int evmdisResolve(evm_disassembler_t *evm, evm_disasm_inst_t *inst, int entry) {
-  uint32_t target = inst->targets[entry];
+// binary search of the instructions, which are decoded in ascending order of offset
+static int evmdisResolve(evm_disasm_inst_t **index, uint32_t count, uint32_t target) {
+  uint32_t low = 0, high = count;
 
-  if(target > inst->offset) {
-    for(inst = inst->next; inst != &evm->instructions; inst = inst->next) {
-      if(inst->offset == target) {
-        inst->label = -1;
-        return 0;
-      }
+  while(low < high) {
+    uint32_t mid = low + (high - low) / 2U;
+
+    if(index[mid]->offset < target) {
+      low = mid + 1U;
     }
-  }
-  else {
-    for(; inst != &evm->instructions; inst = inst->prev) {
-      if(inst->offset == target) {
-        inst->label = -1;
-        return 0;
-      }
+    else {
+      high = mid;
     }
   }
 
-  return -1;
+  if(low < count && index[low]->offset == target) {
+    index[low]->label = -1;
+    return 0;
+  }
+
+  return -1; // not the start of an instruction
 }
 
 
@@ -198,253 +126,61 @@ uint32_t evmdisFromBuffer(evm_disassembler_t *evm, const uint8_t *buffer, uint32
   int ok = -1;
 
   if(evm && buffer) {
-    int entries = 0;
+    evm_decoded_t decoded;
+    int result;
 
-    while(ok && consumed < length) {
-      if(entries) {
-        if(evm->instructions.prev->opcode == OP_JTBL) {
-          evmdisAddTableEntry(evm, &buffer[consumed], 1);
-          consumed += 1;
-        }
-        else if(evm->instructions.prev->opcode == OP_LJTBL) {
-          if((length - consumed) >= 2) {
-            evmdisAddTableEntry(evm, &buffer[consumed], 2);
-            consumed += 2;
-          }
-          else {
-            ok = 0; // not enough program remaining
-          }
-        }
-        else {
-          ok = 0; // not a table based jump
-        }
-        --entries;
-        continue; // don't do normal instruction processing
-      }
+    memset(&decoded, 0, sizeof(decoded));
 
-      switch(buffer[consumed]) {
-        // just the opcode
-        case OP_NOP:
-        case OP_YIELD:
-        case OP_HALT:
-        case OP_PUSH_I0:
-        case OP_PUSH_I1:
-        case OP_PUSH_IN1:
-        case OP_SWAP:
-        case OP_POP_1:
-        case OP_POP_2:
-        case OP_POP_3:
-        case OP_POP_4:
-        case OP_POP_5:
-        case OP_POP_6:
-        case OP_POP_7:
-        case OP_POP_8:
-        case OP_REM_1:
-        case OP_REM_2:
-        case OP_REM_3:
-        case OP_REM_4:
-        case OP_REM_5:
-        case OP_REM_6:
-        case OP_REM_7:
-        case OP_DUP_0:
-        case OP_DUP_1:
-        case OP_DUP_2:
-        case OP_DUP_3:
-        case OP_DUP_4:
-        case OP_DUP_5:
-        case OP_DUP_6:
-        case OP_DUP_7:
-        case OP_DUP_8:
-        case OP_DUP_9:
-        case OP_DUP_10:
-        case OP_DUP_11:
-        case OP_DUP_12:
-        case OP_DUP_13:
-        case OP_DUP_14:
-        case OP_DUP_15:
-        case OP_INC_I:
-        case OP_DEC_I:
-        case OP_ABS_I:
-        case OP_NEG_I:
-        case OP_ADD_I:
-        case OP_SUB_I:
-        case OP_MUL_I:
-        case OP_DIV_I:
-        case OP_LSH:
-        case OP_RSH:
-        case OP_AND:
-        case OP_OR:
-        case OP_XOR:
-        case OP_INV:
-        case OP_BOOL:
-        case OP_NOT:
-        case OP_SREAD:
-        case OP_SWRITE8:
-        case OP_SWRITE16:
-        case OP_SWRITE24:
-        case OP_SWRITE32:
-        case OP_CMP_I0:
-        case OP_CMP_I1:
-        case OP_CMP_IN1:
-        case OP_CMP_I:
-        case OP_RET:
-        case OP_RET_1:
-        case OP_RET_2:
-        case OP_RET_3:
-        case OP_RET_4:
-        case OP_RET_5:
-        case OP_RET_6:
-        case OP_RET_7:
-        case OP_RET_8:
-        case OP_RET_9:
-        case OP_RET_10:
-        case OP_RET_11:
-        case OP_RET_12:
-        case OP_RET_13:
-        case OP_RET_14:
-#if EVM_FLOAT_SUPPORT == 1
-        case OP_PUSH_F0:
-        case OP_PUSH_F1:
-        case OP_PUSH_FN1:
-        case OP_INC_F:
-        case OP_DEC_F:
-        case OP_ABS_F:
-        case OP_NEG_F:
-        case OP_ADD_F:
-        case OP_SUB_F:
-        case OP_MUL_F:
-        case OP_DIV_F:
-        case OP_CONV_FI:
-        case OP_CONV_FI_1:
-        case OP_CONV_IF:
-        case OP_CONV_IF_1:
-        case OP_CMP_F0:
-        case OP_CMP_F1:
-        case OP_CMP_FN1:
-        case OP_CMP_F:
-#endif
-          evmdisAddInstruction(evm, buffer, consumed, 1);
-          consumed += 1;
+    while((result = evmDecodeNext(buffer, length, &decoded)) > 0) {
+      if(evmdisAddInstruction(evm, buffer, &decoded)) {
+        result = -1;
         break;
+      }
+    }
 
-        // opcode + 1
-        case OP_JTBL:
-        case OP_LJTBL:
-          if((length - consumed) >= 2) {
-            entries = buffer[consumed + 1] + 1;
-          }
-          // fallthrough
-        case OP_BCALL:
-        case OP_PUSH_8I:
-        case OP_REM_R:
-        case OP_TRUNC:
-        case OP_SIGNEXT:
-#if EVM_MEMORY_SUPPORT == 1
-        case OP_SEG:
-#endif
-        case OP_JMP:
-        case OP_JLT:
-        case OP_JLE:
-        case OP_JNE:
-        case OP_JEQ:
-        case OP_JGE:
-        case OP_JGT:
-        case OP_RET_I:
-          if((length - consumed) >= 2) {
-            evmdisAddInstruction(evm, buffer, consumed, 2);
-            consumed += 2;
-          }
-          else {
-            ok = 0;
-          }
-        break;
+    consumed = decoded.next;
+    ok = !result;
 
-        // opcode + 2
-        case OP_CALL:
-        case OP_PUSH_16I:
-#if EVM_MEMORY_SUPPORT == 1
-        case OP_READ:
-        case OP_WRITE8:
-        case OP_WRITE16:
-        case OP_WRITE24:
-        case OP_WRITE32:
-#endif
-        case OP_LJMP:
-        case OP_LJLT:
-        case OP_LJLE:
-        case OP_LJNE:
-        case OP_LJEQ:
-        case OP_LJGE:
-        case OP_LJGT:
-          if((length - consumed) >= 3) {
-            evmdisAddInstruction(evm, buffer, consumed, 3);
-            consumed += 3;
-          }
-          else {
-            ok = 0;
-          }
-        break;
+    if(ok) {
+      evm_disasm_inst_t *inst, **index;
+      uint32_t count = 0;
 
-        // opcode + 3
-        case OP_LCALL:
-        case OP_PUSH_24I:
-#if EVM_MEMORY_SUPPORT == 1
-        case OP_LREAD:
-        case OP_LWRITE8:
-        case OP_LWRITE16:
-        case OP_LWRITE24:
-        case OP_LWRITE32:
-#endif
-          if((length - consumed) >= 4) {
-            evmdisAddInstruction(evm, buffer, consumed, 4);
-            consumed += 4;
-          }
-          else {
-            ok = 0;
-          }
-        break;
+      for(inst = evm->instructions.next; inst != &evm->instructions; inst = inst->next) {
+        ++count;
+      }
 
-        // opcode + 4
-        case OP_PUSH_32I:
-#if EVM_FLOAT_SUPPORT == 1
-        case OP_PUSH_F:
-#endif
-          if((length - consumed) >= 5) {
-            evmdisAddInstruction(evm, buffer, consumed, 5);
-            consumed += 5;
-          }
-          else {
-            ok = 0;
-          }
+      // index the instructions by offset so each target is found in logarithmic time
+      if((index = malloc((count ? count : 1U) * sizeof(evm_disasm_inst_t *)))) {
+        count = 0;
 
-        break;
+        for(inst = evm->instructions.next; inst != &evm->instructions; inst = inst->next) {
+          index[count++] = inst;
+        }
 
-        default:
-          ok = 0;
-        break;
-      }
-    }
+        // locate all the jump targets
+        for(inst = evm->instructions.next; ok && inst != &evm->instructions; inst = inst->next) {
+          if(inst->targets) {
+            int entries, idx;
 
-    if(ok) {
-      evm_disasm_inst_t *inst;
-      // locate all the jump targets
-      for(inst = evm->instructions.next; ok && inst != &evm->instructions; inst = inst->next) {
-        if(inst->targets) {
-          int entries, idx;
-
-          if(inst->opcode == OP_JTBL || inst->opcode == OP_LJTBL) {
-            entries = (((uint32_t) inst->arg.i8) & 0xFF) + 1;
-          }
-          else {
-            entries = 1;
-          }
+            if(inst->opcode == OP_JTBL || inst->opcode == OP_LJTBL) {
+              entries = (((uint32_t) inst->arg.i8) & 0xFF) + 1;
+            }
+            else {
+              entries = 1;
+            }
 
-          for(idx = 0; idx < entries; ++idx) {
-            if(evmdisResolve(evm, inst, idx)) {
-              ok = 0;
+            for(idx = 0; idx < entries; ++idx) {
+              if(evmdisResolve(index, count, inst->targets[idx])) {
+                ok = 0;
+              }
             }
           }
         }
+
+        free(index);
+      }
+      else {
+        ok = 0;
       }
     }
   }
@@ -508,19 +244,47 @@ static const char *OP_STRINGS[] = {
   "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
 #endif
   "!INVAL!", "!INVAL!",
-  // unused
-  "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
-  "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
-  "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
-  "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
-  "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
+  // FAM_BLOCK
+#if EVM_MEMORY_SUPPORT == 1
+  "MEMCPY",  "MEMMOVE", "MEMSET",  "MEMCMP",  "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
+#else
   "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
+#endif
   "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
+  // FAM_VEC
+#if EVM_MEMORY_SUPPORT == 1
+  "VADD",    "VSUB",    "VMUL",    "VDOT",    "VMIN",    "VMAX",    "!INVAL!", "!INVAL!",
+#  if EVM_FLOAT_SUPPORT == 1
+  "VADDF",   "VSUBF",   "VMULF",   "VDOTF",   "VMINF",   "VMAXF",   "!INVAL!", "!INVAL!",
+#  else
   "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
+#  endif
+#else
   "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
   "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
+#endif
+  // FAM_FRAME
+  "ENTER",   "LEAVE",   "LDLOC",   "STLOC",   "LDARG",   "!INVAL!", "!INVAL!", "!INVAL!",
+  "ENTER",   "!INVAL!", "LDLOC",   "STLOC",   "LDARG",   "!INVAL!", "!INVAL!", "!INVAL!",
+  // FAM_IMM
+  "ADDI",    "SUBI",    "MULI",    "ANDI",    "SHLI",    "JCMPI",   "DJNZ",    "!INVAL!",
+  "ADDI",    "SUBI",    "MULI",    "ANDI",    "!INVAL!", "LJCMPI",  "LDJNZ",   "!INVAL!",
+  // FAM_XMATH
+  "POPCNT",  "CLZ",     "CTZ",     "ROL",     "ROR",     "MOD",     "MIN",     "MAX",
+#if EVM_FLOAT_SUPPORT == 1
+  "MINF",    "MAXF",    "SQRTF",   "FMAF",
+#else
+  "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
+#endif
+  "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
+  // FAM_INDEX
+#if EVM_MEMORY_SUPPORT == 1
+  "XREAD",   "XREAD8",  "XREAD8U", "XREAD16", "XREAD16U", "XWRITE8", "XWRITE16", "XWRITE32",
+  "XREAD",   "XREAD8",  "XREAD8U", "XREAD16", "XREAD16U", "XWRITE8", "XWRITE16", "XWRITE32",
+#else
   "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
   "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!", "!INVAL!",
+#endif
   // FAM_MEM
 #if EVM_MEMORY_SUPPORT == 1
   "SEG",      "READ",     "WRITE8",   "WRITE16", "WRITE24", "WRITE32",  "LREAD",    "LWRITE8",
@@ -546,395 +310,311 @@ static const char *OP_STRINGS[] = {
 };
 
 
-static int evmdisStringifyInstructions(const evm_disassembler_t *evm) {
-  int result = -1;
+// output is formatted into a fixed buffer that is handed to the writer whenever it fills up
+typedef struct evm_disasm_stream_s {
+  evm_disasm_writer_t  write;
+  void                *context;
+  uint32_t             used;
+  int                  result;
+  char                 buffer[EVM_DISASM_BUFFER];
+} evm_disasm_stream_t;
 
-  if(evm) {
-    evm_disasm_inst_t *inst;
-    result = 0;
 
-    // don't do anything if it has already been stringified
-    if(!evm->instructions.next->text) {
-      for(inst = evm->instructions.next; inst != &evm->instructions; inst = inst->next) {
-        int len = inst->label ? snprintf(NULL, 0U, "\nLAB_%06X:\n", inst->offset): 0;
-
-        switch(inst->opcode) {
-          // just the opcode
-          case OP_NOP:
-          case OP_YIELD:
-          case OP_HALT:
-          case OP_PUSH_I0:
-          case OP_PUSH_I1:
-          case OP_PUSH_IN1:
-          case OP_SWAP:
-          case OP_POP_1:
-          case OP_POP_2:
-          case OP_POP_3:
-          case OP_POP_4:
-          case OP_POP_5:
-          case OP_POP_6:
-          case OP_POP_7:
-          case OP_POP_8:
-          case OP_REM_1:
-          case OP_REM_2:
-          case OP_REM_3:
-          case OP_REM_4:
-          case OP_REM_5:
-          case OP_REM_6:
-          case OP_REM_7:
-          case OP_DUP_0:
-          case OP_DUP_1:
-          case OP_DUP_2:
-          case OP_DUP_3:
-          case OP_DUP_4:
-          case OP_DUP_5:
-          case OP_DUP_6:
-          case OP_DUP_7:
-          case OP_DUP_8:
-          case OP_DUP_9:
-          case OP_DUP_10:
-          case OP_DUP_11:
-          case OP_DUP_12:
-          case OP_DUP_13:
-          case OP_DUP_14:
-          case OP_DUP_15:
-          case OP_INC_I:
-          case OP_DEC_I:
-          case OP_ABS_I:
-          case OP_NEG_I:
-          case OP_ADD_I:
-          case OP_SUB_I:
-          case OP_MUL_I:
-          case OP_DIV_I:
-          case OP_LSH:
-          case OP_RSH:
-          case OP_AND:
-          case OP_OR:
-          case OP_XOR:
-          case OP_INV:
-          case OP_BOOL:
-          case OP_NOT:
-#if EVM_MEMORY_SUPPORT == 1
-          case OP_SEG:
-          case OP_SREAD:
-          case OP_SWRITE8:
-          case OP_SWRITE16:
-          case OP_SWRITE24:
-          case OP_SWRITE32:
-#endif
-          case OP_CMP_I0:
-          case OP_CMP_I1:
-          case OP_CMP_IN1:
-          case OP_CMP_I:
-          case OP_RET:
-          case OP_RET_1:
-          case OP_RET_2:
-          case OP_RET_3:
-          case OP_RET_4:
-          case OP_RET_5:
-          case OP_RET_6:
-          case OP_RET_7:
-          case OP_RET_8:
-          case OP_RET_9:
-          case OP_RET_10:
-          case OP_RET_11:
-          case OP_RET_12:
-          case OP_RET_13:
-          case OP_RET_14:
-#if EVM_FLOAT_SUPPORT == 1
-          case OP_PUSH_F0:
-          case OP_PUSH_F1:
-          case OP_PUSH_FN1:
-          case OP_INC_F:
-          case OP_DEC_F:
-          case OP_ABS_F:
-          case OP_NEG_F:
-          case OP_ADD_F:
-          case OP_SUB_F:
-          case OP_MUL_F:
-          case OP_DIV_F:
-          case OP_CONV_FI:
-          case OP_CONV_FI_1:
-          case OP_CONV_IF:
-          case OP_CONV_IF_1:
-          case OP_CMP_F0:
-          case OP_CMP_F1:
-          case OP_CMP_FN1:
-          case OP_CMP_F:
-#endif
-            len += snprintf(NULL, 0U, "    %s\n", OP_STRINGS[inst->opcode]);
-            inst->text = malloc(len + 1);
-            inst->length = len;
+static void evmdisFlush(evm_disasm_stream_t *stream) {
+  if(stream->used && !stream->result) {
+    stream->result = stream->write(stream->context, &stream->buffer[0], stream->used);
+  }
 
-            if(inst->label) {
-              snprintf(inst->text, len + 1, "\nLAB_%06X:\n    %s\n",
-                       inst->offset, OP_STRINGS[inst->opcode]);
-            }
-            else {
-              snprintf(inst->text, len + 1, "    %s\n", OP_STRINGS[inst->opcode]);
-            }
-          break;
+  stream->used = 0;
+}
 
-          case OP_JTBL:
-          case OP_LJTBL: {
-            int entries = inst->arg.i8 + 1, idx;
 
-            len += snprintf(NULL, 0U, "    %s\n", OP_STRINGS[inst->opcode]);
-            // determine the jump table length
-            for(idx = 0; idx < entries; ++idx) {
-              len += snprintf(NULL, 0U, ".addr LAB_%06X\n", inst->targets[idx]);
-            }
+static void evmdisPrintf(evm_disasm_stream_t *stream, const char *format, ...) {
+  uint32_t space = EVM_DISASM_BUFFER - stream->used;
+  va_list args;
+  int length;
 
-            inst->text = malloc(len + 1);
-            inst->length = len;
+  va_start(args, format);
+  length = vsnprintf(&stream->buffer[stream->used], space, format, args);
+  va_end(args);
 
-            len = inst->label ? snprintf(inst->text, len, "\nLAB_%06X:\n", inst->offset) : 0;
+  // a single line always fits once the buffer has been flushed
+  if(length >= 0 && (uint32_t) length >= space) {
+    evmdisFlush(stream);
 
-            len += snprintf(&inst->text[len], inst->length - len + 1,
-                            "    %s\n", OP_STRINGS[inst->opcode]);
-            // print the jump table
-            for(idx = 0; idx < entries; ++idx) {
-              len += snprintf(&inst->text[len], inst->length - len + 1,
-                              ".addr LAB_%06X\n", inst->targets[idx]);
-            }
-          } break;
+    va_start(args, format);
+    length = vsnprintf(&stream->buffer[0], EVM_DISASM_BUFFER, format, args);
+    va_end(args);
+  }
 
-          // op + int8
-          case OP_PUSH_8I:
-            len += snprintf(NULL, 0U, "    %s %d\n", OP_STRINGS[inst->opcode], inst->arg.i8);
-            inst->text = malloc(len + 1);
-            inst->length = len;
+  if(length < 0) {
+    stream->result = -1;
+  }
+  else {
+    stream->used += (uint32_t) length;
+  }
+}
 
-            if(inst->label) {
-              snprintf(inst->text, len + 1, "\nLAB_%06X:\n    %s %d\n",
-                       inst->offset, OP_STRINGS[inst->opcode], inst->arg.i8);
-            }
-            else {
-              snprintf(inst->text, len + 1, "    %s %d\n", OP_STRINGS[inst->opcode], inst->arg.i8);
-            }
-          break;
-
-          // op + uint8
-          case OP_BCALL:
-          case OP_TRUNC:
-          case OP_SIGNEXT:
-          case OP_RET_I:
-            len += snprintf(NULL, 0U, "    %s %u\n", OP_STRINGS[inst->opcode], inst->arg.i32 & 0xFF);
-            inst->text = malloc(len + 1);
-            inst->length = len;
-
-            if(inst->label) {
-              snprintf(inst->text, len + 1, "\nLAB_%06X:\n    %s %u\n",
-                       inst->offset, OP_STRINGS[inst->opcode], inst->arg.i32 & 0xFF);
-            }
-            else {
-              snprintf(inst->text, len + 1, "    %s %u\n",
-                       OP_STRINGS[inst->opcode], inst->arg.i32 & 0xFF);
-            }
-          break;
-
-          // op + 2 nybbles
-          case OP_REM_R:
-            len += snprintf(NULL, 0U, "    %s %d %d\n", OP_STRINGS[inst->opcode],
-                            ((inst->arg.i8 >> 4) & 0x0F) + 1, (inst->arg.i8 & 0x0F) + 1);
-            inst->text = malloc(len + 1);
-            inst->length = len; // don't count the NUL terminator
-
-            if(inst->label) {
-              snprintf(inst->text, len + 1, "\nLAB_%06X:\n    %s %d %d\n",
-                       inst->offset, OP_STRINGS[inst->opcode],
-                       ((inst->arg.i8 >> 4) & 0x0F) + 1, (inst->arg.i8 & 0x0F) + 1);
-            }
-            else {
-              snprintf(inst->text, len + 1, "    %s %d %d\n", OP_STRINGS[inst->opcode],
-                       ((inst->arg.i8 >> 4) & 0x0F) + 1, (inst->arg.i8 & 0x0F) + 1);
-            }
-          break;
-
-          // op + label
-          case OP_JMP:
-          case OP_JLT:
-          case OP_JLE:
-          case OP_JNE:
-          case OP_JEQ:
-          case OP_JGE:
-          case OP_JGT:
-          case OP_CALL:
-          case OP_LJMP:
-          case OP_LJLT:
-          case OP_LJLE:
-          case OP_LJNE:
-          case OP_LJEQ:
-          case OP_LJGE:
-          case OP_LJGT:
-          case OP_LCALL:
-            len += snprintf(NULL, 0U, "    %s LAB_%06X\n",
-                            OP_STRINGS[inst->opcode], inst->targets[0]);
-            inst->text = malloc(len + 1);
-            inst->length = len;
-
-            if(inst->label) {
-              snprintf(inst->text, len + 1, "\nLAB_%06X:\n    %s LAB_%06X\n",
-                       inst->offset, OP_STRINGS[inst->opcode], inst->targets[0]);
-            }
-            else {
-              snprintf(inst->text, len + 1, "    %s LAB_%06X\n",
-                       OP_STRINGS[inst->opcode], inst->targets[0]);
-            }
-          break;
 
-          // op + int16
-          case OP_PUSH_16I:
-            len += snprintf(NULL, 0U, "    %s %d\n", OP_STRINGS[inst->opcode], inst->arg.i16);
-            inst->text = malloc(len + 1);
-            inst->length = len;
+// the jumps a compare and branch flag mask stands for, indexed by the mask
+static const char *JCMP_CONDITIONS[8] = {
+  "!INVAL!", "LT", "EQ", "LE", "GT", "NE", "GE", "!INVAL!"
+};
+
+static void evmdisFormatInstruction(evm_disasm_stream_t *stream, const evm_disasm_inst_t *inst) {
+  const char *op = OP_STRINGS[inst->opcode];
 
-            if(inst->label) {
-              snprintf(inst->text, len + 1, "\nLAB_%06X:\n    %s %d\n",
-                       inst->offset, OP_STRINGS[inst->opcode], inst->arg.i16);
-            }
-            else {
-              snprintf(inst->text, len + 1, "    %s %d\n", OP_STRINGS[inst->opcode], inst->arg.i16);
-            }
-          break;
+  if(inst->label) {
+    evmdisPrintf(stream, "\nLAB_%06X:\n", inst->offset);
+  }
+
+  switch(inst->opcode) {
+    case OP_JTBL:
+    case OP_LJTBL: {
+      int entries = (((uint32_t) inst->arg.i8) & 0xFF) + 1, idx;
+
+      evmdisPrintf(stream, "    %s\n", op);
+      // print the jump table
+      for(idx = 0; idx < entries; ++idx) {
+        evmdisPrintf(stream, ".addr LAB_%06X\n", inst->targets[idx]);
+      }
+    } break;
+
+    // op + int8
+    case OP_PUSH_8I:
+    case OP_ADD_8I:
+    case OP_SUB_8I:
+    case OP_MUL_8I:
+    case OP_AND_8I:
+      evmdisPrintf(stream, "    %s %d\n", op, inst->arg.i8);
+    break;
+
+    // op + uint8
+    case OP_BCALL:
+    case OP_TRUNC:
+    case OP_SIGNEXT:
+    case OP_LSH_8I:
+    case OP_RET_I:
+      evmdisPrintf(stream, "    %s %u\n", op, inst->arg.i32 & 0xFF);
+    break;
+
+    // op + 2 nybbles
+    case OP_REM_R:
+      evmdisPrintf(stream, "    %s %d %d\n", op,
+                   ((inst->arg.i8 >> 4) & 0x0F) + 1, (inst->arg.i8 & 0x0F) + 1);
+    break;
+
+    // op + label
+    case OP_JMP:
+    case OP_JLT:
+    case OP_JLE:
+    case OP_JNE:
+    case OP_JEQ:
+    case OP_JGE:
+    case OP_JGT:
+    case OP_CALL:
+    case OP_LJMP:
+    case OP_LJLT:
+    case OP_LJLE:
+    case OP_LJNE:
+    case OP_LJEQ:
+    case OP_LJGE:
+    case OP_LJGT:
+    case OP_LCALL:
+    case OP_DJNZ:
+    case OP_LDJNZ:
+      evmdisPrintf(stream, "    %s LAB_%06X\n", op, inst->targets[0]);
+    break;
+
+    // op + flags + int8 + label, printed as the jump the flags select
+    case OP_JCMP_8I:
+    case OP_LJCMP_8I:
+      evmdisPrintf(stream, "    %sJ%sI %d LAB_%06X\n", inst->opcode == OP_LJCMP_8I ? "L" : "",
+                   JCMP_CONDITIONS[inst->arg.raw[0] & 0x07], (int8_t) inst->arg.raw[1],
+                   inst->targets[0]);
+    break;
+
+    // op + int16
+    case OP_PUSH_16I:
+    case OP_ADD_16I:
+    case OP_SUB_16I:
+    case OP_MUL_16I:
+    case OP_AND_16I:
+      evmdisPrintf(stream, "    %s %d\n", op, inst->arg.i16);
+    break;
+
+    // op + uint8/uint16
+    case OP_ENTER:
+    case OP_LEAVE:
+    case OP_LOAD_L:
+    case OP_STORE_L:
+    case OP_LOAD_A:
+      evmdisPrintf(stream, "    %s %u\n", op, (uint32_t) inst->arg.raw[0]);
+    break;
+
+    case OP_LENTER:
+    case OP_LLOAD_L:
+    case OP_LSTORE_L:
+    case OP_LLOAD_A:
+      evmdisPrintf(stream, "    %s %u\n", op, (uint32_t) (uint16_t) inst->arg.i16);
+    break;
 
 #if EVM_MEMORY_SUPPORT == 1
-          // op + uint16/uint24
-          case OP_READ:
-          case OP_WRITE8:
-          case OP_WRITE16:
-          case OP_WRITE24:
-          case OP_WRITE32:
-          case OP_LREAD:
-          case OP_LWRITE8:
-          case OP_LWRITE16:
-          case OP_LWRITE24:
-          case OP_LWRITE32:
-            len += snprintf(NULL, 0U, "    %s 0x%X\n", OP_STRINGS[inst->opcode], inst->arg.i32);
-            inst->text = malloc(len + 1);
-            inst->length = len;
-
-            if(inst->label) {
-              snprintf(inst->text, len + 1, "\nLAB_%06X:\n    %s 0x%X\n",
-                       inst->offset, OP_STRINGS[inst->opcode], inst->arg.i32);
-            }
-            else {
-              snprintf(inst->text, len + 1, "    %s 0x%X\n", OP_STRINGS[inst->opcode], inst->arg.i32);
-            }
-          break;
-#endif
+    // op + uint16/uint24
+    case OP_READ:
+    case OP_WRITE8:
+    case OP_WRITE16:
+    case OP_WRITE24:
+    case OP_WRITE32:
+    case OP_LREAD:
+    case OP_LWRITE8:
+    case OP_LWRITE16:
+    case OP_LWRITE24:
+    case OP_LWRITE32:
+      evmdisPrintf(stream, "    %s 0x%X\n", op, inst->arg.i32);
+    break;
 
-          // op + int24/int32
-          case OP_PUSH_24I:
-          case OP_PUSH_32I:
-            len += snprintf(NULL, 0U, "    %s %d\n", OP_STRINGS[inst->opcode], inst->arg.i32);
-            inst->text = malloc(len + 1);
-            inst->length = len;
+    // op + scale, op + scale + uint16
+    case OP_SXREAD:
+    case OP_SXREAD8:
+    case OP_SXREAD8U:
+    case OP_SXREAD16:
+    case OP_SXREAD16U:
+    case OP_SXWRITE8:
+    case OP_SXWRITE16:
+    case OP_SXWRITE32:
+      evmdisPrintf(stream, "    %s %u\n", op, 1U << (inst->arg.raw[0] & 0x03));
+    break;
 
-            if(inst->label) {
-              snprintf(inst->text, len + 1, "\nLAB_%06X:\n    %s %d\n",
-                       inst->offset, OP_STRINGS[inst->opcode], inst->arg.i32);
-            }
-            else {
-              snprintf(inst->text, len + 1, "    %s %d\n", OP_STRINGS[inst->opcode], inst->arg.i32);
-            }
-          break;
+    case OP_XREAD:
+    case OP_XREAD8:
+    case OP_XREAD8U:
+    case OP_XREAD16:
+    case OP_XREAD16U:
+    case OP_XWRITE8:
+    case OP_XWRITE16:
+    case OP_XWRITE32:
+      evmdisPrintf(stream, "    %s %u 0x%X\n", op, 1U << (inst->arg.raw[0] & 0x03),
+                   (uint32_t) inst->arg.raw[1] | ((uint32_t) inst->arg.raw[2] << 8));
+    break;
+#endif
+
+    // op + int24/int32
+    case OP_PUSH_24I:
+    case OP_PUSH_32I:
+      evmdisPrintf(stream, "    %s %d\n", op, inst->arg.i32);
+    break;
 
 #if EVM_FLOAT_SUPPORT == 1
-          // op + float
-          case OP_PUSH_F:
-            len += snprintf(NULL, 0U, "    %s %f\n", OP_STRINGS[inst->opcode], inst->arg.f32);
-            inst->text = malloc(len + 1);
-            inst->length = len;
-
-            if(inst->label) {
-              snprintf(inst->text, len + 1, "\nLAB_%06X:\n    %s %f\n",
-                       inst->offset, OP_STRINGS[inst->opcode], inst->arg.f32);
-            }
-            else {
-              snprintf(inst->text, len + 1, "    %s %f\n", OP_STRINGS[inst->opcode], inst->arg.f32);
-            }
-          break;
+    // op + float
+    case OP_PUSH_F:
+      evmdisPrintf(stream, "    %s %f\n", op, inst->arg.f32);
+    break;
 #endif
 
-          default:
-            len += snprintf(NULL, 0U, "    %s\n", OP_STRINGS[inst->opcode]);
-            inst->text = malloc(len + 1);
-            inst->length = len;
+    // just the opcode
+    default:
+      evmdisPrintf(stream, "    %s\n", op);
+    break;
+  }
+}
 
-            if(inst->label) {
-              snprintf(inst->text, len + 1, "\nLAB_%06X:\n    %s\n",
-                       inst->offset, OP_STRINGS[inst->opcode]);
-            }
-            else {
-              snprintf(inst->text, len + 1, "    %s\n", OP_STRINGS[inst->opcode]);
-            }
-          break;
-        }
-      }
+
+int evmdisToWriter(const evm_disassembler_t *evm, evm_disasm_writer_t write, void *context) {
+  evm_disasm_stream_t *stream;
+  int result = -1;
+
+  // the stream is too large to comfortably live on the stack of a builtin
+  if(evm && write && (stream = malloc(sizeof(evm_disasm_stream_t)))) {
+    const evm_disasm_inst_t *inst;
+
+    stream->write = write;
+    stream->context = context;
+    stream->used = 0;
+    stream->result = 0;
+
+    evmdisPrintf(stream, ".name MAIN\n.offset 0\n\n");
+
+    for(inst = evm->instructions.next; !stream->result && inst != &evm->instructions;
+        inst = inst->next) {
+      evmdisFormatInstruction(stream, inst);
     }
+
+    evmdisFlush(stream);
+    result = stream->result;
+    free(stream);
   }
 
   return result;
 }
 
 
-int evmdisToBuffer(const evm_disassembler_t *evm, char **buf, int *len) {
-  int result = -1;
+typedef struct evm_disasm_string_s {
+  char *buffer;
+  int   length;
+  int   capacity;
+} evm_disasm_string_t;
 
-  if(len) {
-    result = evmdisStringifyInstructions(evm);
 
-    if(!result) {
-      int length = snprintf(NULL, 0U, ".name MAIN\n.offset 0\n\n") - 1;
-      evm_disasm_inst_t *inst;
+static int evmdisStringWriter(void *context, const char *text, uint32_t length) {
+  evm_disasm_string_t *string = (evm_disasm_string_t *) context;
 
-      for(inst = evm->instructions.next; inst != &evm->instructions; inst = inst->next) {
-        length += inst->length;
-      }
+  if(length >= (uint32_t) (INT32_MAX - string->length)) {
+    return -1;
+  }
 
-      *len = length; // don't report the NUL terminator as part of the buffer
+  if(string->length + (int) length >= string->capacity) {
+    int capacity = string->capacity ? string->capacity : (int) EVM_DISASM_BUFFER;
+    char *buffer;
 
-      if(buf) {
-        if((*buf = malloc(length + 1))) { // include a NUL terminator
-          char *ptr = *buf;
-          int count = snprintf(ptr, length, ".name MAIN\n.offset 0\n\n");
-          ptr += count;
-
-          for(inst = evm->instructions.next; inst != &evm->instructions; inst = inst->next) {
-            strcpy(ptr, inst->text);
-            length -= inst->length;
-            ptr += inst->length;
-          }
-        }
-        else {
-          result = -1;
-        }
-      }
+    while(string->length + (int) length >= capacity) {
+      capacity = capacity > INT32_MAX / 2 ? INT32_MAX : capacity * 2;
     }
+
+    if(!(buffer = realloc(string->buffer, capacity))) {
+      return -1;
+    }
+
+    string->buffer = buffer;
+    string->capacity = capacity;
   }
 
-  return result;
+  memcpy(&string->buffer[string->length], text, length);
+  string->length += (int) length;
+  string->buffer[string->length] = '\0';
+
+  return 0;
 }
 
 
-int evmdisToFile(const evm_disassembler_t *evm, FILE *dst) {
+int evmdisToBuffer(const evm_disassembler_t *evm, char **buf, int *len) {
+  evm_disasm_string_t string = { NULL, 0, 0 };
   int result = -1;
 
-  if(evm && dst) {
-    char *buffer = NULL;
-    int length = 0;
+  if(len) {
+    result = evmdisToWriter(evm, &evmdisStringWriter, &string);
 
-    if(!(result = evmdisToBuffer(evm, &buffer, &length)) && length > 0) {
-      fprintf(dst, "%s", buffer);
-      result = 0;
-    }
+    if(!result) {
+      *len = string.length; // don't report the NUL terminator as part of the buffer
 
-    if(buffer) {
-      free(buffer);
+      if(buf) {
+        *buf = string.buffer;
+        string.buffer = NULL;
+      }
     }
+
+    free(string.buffer);
   }
 
   return result;
 }
 
+
+static int evmdisFileWriter(void *context, const char *text, uint32_t length) {
+  return fwrite(text, 1, length, (FILE *) context) == length ? 0 : -1;
+}
+
+
+int evmdisToFile(const evm_disassembler_t *evm, FILE *dst) {
+  return dst ? evmdisToWriter(evm, &evmdisFileWriter, dst) : -1;
+}
@@ -0,0 +1,1645 @@
+#include "evm/ir.h"
+#include "evm/cfg.h"
+#include "evm/decode.h"
+#include "evm/opcodes.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef enum evm_ir_shape_e {
+  SHAPE_MOVE,   // only rearranges the stack
+  SHAPE_DEF,    // consumes its operands and pushes a value
+  SHAPE_USE,    // consumes its operands
+  SHAPE_PEEK,   // reads its operands and leaves them in place
+  SHAPE_SECOND, // replaces the second value, leaving the top in place
+  SHAPE_RETURN, // removes the return address from below the results
+  SHAPE_FLOW,   // doesn't touch the stack
+} evm_ir_shape_t;
+
+
+// a growing list of values, also used for the stack being simulated
+typedef struct evm_ir_list_s {
+  uint32_t *values;
+  uint32_t  count;
+  uint32_t  capacity;
+} evm_ir_list_t;
+
+
+// bytecode being lowered, branches with targets are laid out once every block is known
+typedef struct evm_ir_code_s {
+  uint8_t  *bytes;
+  uint32_t  count;
+  uint32_t  capacity;
+  uint32_t *body;   // start of the code of each block
+  uint32_t *branch; // instruction ending each block that needs a target, EVM_IR_NONE otherwise
+  uint8_t  *wide;   // the branch uses its long form
+  uint32_t *offset; // of each block in the final program
+} evm_ir_code_t;
+
+
+static uint8_t  evmirShape(uint8_t);
+static int      evmirIsBarrier(uint8_t);
+static uint32_t evmirReserve(evm_ir_t *, uint32_t);
+static uint32_t evmirNewValue(evm_ir_t *, uint8_t, uint32_t, uint32_t);
+static evm_ir_inst_t *evmirNewInst(evm_ir_t *);
+static int      evmirListPush(evm_ir_list_t *, uint32_t);
+static int      evmirListInsert(evm_ir_list_t *, uint32_t, uint32_t);
+static uint32_t evmirSlot(evm_ir_t *, evm_ir_list_t *, uint32_t, uint32_t);
+static uint32_t evmirExitValue(evm_ir_t *, evm_ir_list_t *, uint32_t, uint32_t);
+static int      evmirLift(evm_ir_t *, uint32_t, evm_ir_list_t *, evm_ir_list_t *,
+                          const evm_disasm_inst_t *);
+static int      evmirLiftFused(evm_ir_t *, uint32_t, evm_ir_list_t *, evm_ir_list_t *,
+                               const evm_disasm_inst_t *);
+static uint32_t evmirFindBlock(const evm_ir_t *, uint32_t);
+static uint32_t evmirResolve(uint32_t *, uint32_t);
+static int      evmirPasses(const evm_ir_t *, uint32_t);
+static uint32_t evmirJoins(const evm_ir_t *, uint32_t);
+static int      evmirJoin(evm_ir_t *, evm_ir_list_t *);
+static int      evmirEmit(evm_ir_code_t *, uint8_t, int32_t);
+static int      evmirArrange(evm_ir_code_t *, evm_ir_list_t *, const uint32_t *, uint32_t,
+                             const uint32_t *, int);
+static int      evmirCopy(evm_ir_code_t *, evm_ir_list_t *, uint32_t);
+static int      evmirDropDead(evm_ir_code_t *, evm_ir_list_t *, const uint32_t *);
+static int      evmirShapeStack(evm_ir_code_t *, evm_ir_list_t *, const evm_ir_list_t *);
+static int      evmirLowerBlock(const evm_ir_t *, evm_ir_code_t *, uint32_t, uint32_t *);
+static int      evmirKeepBlock(const evm_ir_t *, evm_ir_code_t *, uint32_t);
+static uint32_t evmirBranchSize(const evm_ir_inst_t *, int);
+static int      evmirLayout(const evm_ir_t *, evm_ir_code_t *);
+static void     evmirPrintInst(const evm_ir_t *, const evm_ir_inst_t *, FILE *);
+
+
+evm_ir_t *evmirAllocate() {
+  return (evm_ir_t *) calloc(1, sizeof(evm_ir_t));
+}
+
+
+evm_ir_t *evmirInitialize(evm_ir_t *ir) {
+  if(ir) {
+    memset(ir, 0, sizeof(*ir));
+  }
+
+  return ir;
+}
+
+
+evm_ir_t *evmirFinalize(evm_ir_t *ir) {
+  if(ir) {
+    free(ir->blocks);
+    free(ir->insts);
+    free(ir->values);
+    free(ir->pool);
+    free(ir->bytes);
+    memset(ir, 0, sizeof(*ir));
+  }
+
+  return ir;
+}
+
+
+void evmirFree(evm_ir_t *ir) {
+  free(ir);
+}
+
+
+int evmirFromDisassembler(evm_ir_t *ir, const evm_disassembler_t *evm) {
+  const evm_disasm_inst_t *inst;
+  evm_ir_list_t *scratch = NULL, stack = { NULL, 0, 0 };
+  uint32_t *lastOf = NULL, *cfgOf = NULL;
+  uint32_t cblock = 0, block, idx;
+  evm_cfg_t cfg;
+  int result = -1;
+
+  if(!ir || !evm) {
+    return -1;
+  }
+
+  evmirFinalize(ir); // replace any earlier program
+  evmcfgInitialize(&cfg);
+
+  if(evmcfgFromDisassembler(&cfg, evm) || !cfg.count) {
+    result = cfg.count ? -1 : 0; // an empty program has nothing to lift
+    evmcfgFinalize(&cfg);
+    return result;
+  }
+
+  // split the blocks of the graph after every call, builtin, yield and frame instruction
+  for(inst = evm->instructions.next; inst != &evm->instructions; inst = inst->next) {
+    int first = cblock + 1U < cfg.count && inst->offset == cfg.blocks[cblock + 1U].start;
+
+    if(first) {
+      ++cblock;
+    }
+
+    if(first || inst == evm->instructions.next || evmirIsBarrier(inst->prev->opcode)) {
+      evm_ir_block_t *blocks;
+
+      if(ir->count == ir->blockCapacity) {
+        uint32_t capacity = ir->blockCapacity ? ir->blockCapacity * 2U : 64U;
+        uint32_t *cfgs = realloc(cfgOf, capacity * sizeof(uint32_t));
+
+        if(cfgs) {
+          cfgOf = cfgs;
+        }
+
+        if(!cfgs || !(blocks = realloc(ir->blocks, capacity * sizeof(evm_ir_block_t)))) {
+          goto cleanup;
+        }
+
+        ir->blocks = blocks;
+        ir->blockCapacity = capacity;
+      }
+
+      first = inst->offset == cfg.blocks[cblock].start;
+      memset(&ir->blocks[ir->count], 0, sizeof(evm_ir_block_t));
+      ir->blocks[ir->count].start = inst->offset;
+
+      // the first part of a root of the graph and everything after a call, builtin or yield is
+      // entered from outside, the part after a frame instruction only from the part before it
+      if(first ? cfg.blocks[cblock].idom == EVM_CFG_NONE :
+                 (inst->prev->opcode & 0xF0) != FAM_FRAME) {
+        ir->blocks[ir->count].flags |= EVM_IR_ENTRY;
+      }
+
+      cfgOf[ir->count++] = first ? cblock : EVM_CFG_NONE;
+    }
+  }
+
+  if(!(scratch = calloc(ir->count, sizeof(evm_ir_list_t))) ||
+     !(lastOf = malloc(cfg.count * sizeof(uint32_t)))) {
+    goto cleanup;
+  }
+
+  // lift every instruction into the block it belongs to
+  for(block = 0, inst = evm->instructions.next; inst != &evm->instructions; inst = inst->next) {
+    evm_ir_block_t *b;
+
+    if(block + 1U < ir->count && inst->offset == ir->blocks[block + 1U].start) {
+      evm_ir_block_t *done = &ir->blocks[block];
+
+      // the stack left behind is what the successors find
+      if((done->exits = evmirReserve(ir, stack.count)) == EVM_IR_NONE) {
+        goto cleanup;
+      }
+
+      for(idx = 0; idx < stack.count; ++idx) {
+        ir->pool[done->exits + idx] = stack.values[stack.count - 1U - idx];
+      }
+
+      done->exitCount = stack.count;
+      done->consumed = scratch[block].count;
+      stack.count = 0;
+      ir->blocks[++block].insts = ir->instCount;
+    }
+
+    b = &ir->blocks[block];
+    b->end = inst->offset + EVM_OPCODE_INFO[inst->opcode].length;
+
+    if(inst->opcode == OP_JTBL || inst->opcode == OP_LJTBL) {
+      b->end += ((((uint32_t) inst->arg.i8) & 0xFF) + 1U) * (inst->opcode == OP_LJTBL ? 2U : 1U);
+    }
+
+    idx = ir->instCount;
+
+    if(evmirLift(ir, block, &scratch[block], &stack, inst)) {
+      goto cleanup;
+    }
+
+    ir->blocks[block].instCount += ir->instCount - idx;
+
+    // targets are blocks, which the lifter knows by their offset
+    if(inst->targets && ir->instCount != idx) {
+      const evm_opcode_info_t *info = &EVM_OPCODE_INFO[inst->opcode];
+      uint32_t count = info->branch == EVM_BRANCH_TABLE ? (((uint32_t) inst->arg.i8) & 0xFF) + 1U : 1U;
+      uint32_t targets = evmirReserve(ir, count);
+
+      if(targets == EVM_IR_NONE) {
+        goto cleanup;
+      }
+
+      for(idx = 0; idx < count; ++idx) {
+        ir->pool[targets + idx] = inst->targets[idx];
+      }
+
+      ir->insts[ir->instCount - 1U].targets = targets;
+      ir->insts[ir->instCount - 1U].targetCount = (uint16_t) count;
+    }
+  }
+
+  if((ir->blocks[block].exits = evmirReserve(ir, stack.count)) == EVM_IR_NONE) {
+    goto cleanup;
+  }
+
+  for(idx = 0; idx < stack.count; ++idx) {
+    ir->pool[ir->blocks[block].exits + idx] = stack.values[stack.count - 1U - idx];
+  }
+
+  ir->blocks[block].exitCount = stack.count;
+  ir->blocks[block].consumed = scratch[block].count;
+
+  // the bytecode is kept for the blocks that can't be lowered, jump tables are always rewritten
+  if(!(ir->bytes = calloc(ir->blocks[block].end ? ir->blocks[block].end : 1U, sizeof(uint8_t)))) {
+    goto cleanup;
+  }
+
+  ir->byteCount = ir->blocks[block].end;
+
+  for(inst = evm->instructions.next; inst != &evm->instructions; inst = inst->next) {
+    ir->bytes[inst->offset] = inst->opcode;
+    memcpy(&ir->bytes[inst->offset + 1U], &inst->arg.raw[0],
+           EVM_OPCODE_INFO[inst->opcode].length - 1U);
+  }
+
+  for(idx = 0; idx < ir->instCount; ++idx) {
+    uint32_t target;
+
+    for(target = 0; target < ir->insts[idx].targetCount; ++target) {
+      uint32_t *slot = &ir->pool[ir->insts[idx].targets + target];
+
+      if((*slot = evmirFindBlock(ir, *slot)) == EVM_IR_NONE) {
+        goto cleanup;
+      }
+    }
+  }
+
+  // the slots of the first part of a block come from the last parts of its predecessors
+  for(cblock = 0, block = 0; block < ir->count; ++block) {
+    if(cfgOf[block] != EVM_CFG_NONE) {
+      cblock = cfgOf[block];
+    }
+
+    lastOf[cblock] = block;
+  }
+
+  for(block = 0; block < ir->count; ++block) {
+    if(cfgOf[block] != EVM_CFG_NONE) {
+      const evm_cfg_block_t *c = &cfg.blocks[cfgOf[block]];
+
+      if((ir->blocks[block].preds = evmirReserve(ir, c->predCount)) == EVM_IR_NONE) {
+        goto cleanup;
+      }
+
+      for(idx = 0; idx < c->predCount; ++idx) {
+        ir->pool[ir->blocks[block].preds + idx] = lastOf[c->pred[idx]];
+      }
+
+      ir->blocks[block].predCount = c->predCount;
+    }
+    else if(!(ir->blocks[block].flags & EVM_IR_ENTRY)) {
+      if((ir->blocks[block].preds = evmirReserve(ir, 1U)) == EVM_IR_NONE) {
+        goto cleanup;
+      }
+
+      ir->pool[ir->blocks[block].preds] = block - 1U;
+      ir->blocks[block].predCount = 1;
+    }
+  }
+
+  result = evmirJoin(ir, scratch);
+
+cleanup:
+  if(scratch) {
+    for(block = 0; block < ir->count; ++block) {
+      free(scratch[block].values);
+    }
+  }
+
+  free(scratch);
+  free(stack.values);
+  free(lastOf);
+  free(cfgOf);
+  evmcfgFinalize(&cfg);
+
+  if(result) {
+    evmirFinalize(ir);
+  }
+
+  return result;
+}
+
+
+int evmirFromBuffer(evm_ir_t *ir, const uint8_t *buffer, uint32_t length) {
+  evm_disassembler_t evm;
+  int result = -1;
+
+  if(ir && buffer) {
+    evmdisInitialize(&evm);
+
+    if(evmdisFromBuffer(&evm, buffer, length) == length) {
+      result = evmirFromDisassembler(ir, &evm);
+    }
+
+    evmdisFinalize(&evm);
+  }
+
+  return result;
+}
+
+
+int evmirToFile(const evm_ir_t *ir, FILE *fp) {
+  uint32_t block, idx, pred;
+
+  if(!ir || !fp) {
+    return -1;
+  }
+
+  for(block = 0; block < ir->count; ++block) {
+    const evm_ir_block_t *b = &ir->blocks[block];
+    uint32_t width = b->predCount + ((b->flags & EVM_IR_ENTRY) ? 1U : 0U);
+
+    fprintf(fp, "%sb%u @%06X", block ? "\n" : "", block, b->start);
+
+    for(pred = 0; pred < b->predCount; ++pred) {
+      fprintf(fp, "%s b%u", pred ? "" : " <-", ir->pool[b->preds + pred]);
+    }
+
+    fprintf(fp, "%s\n", (b->flags & EVM_IR_ENTRY) ? " entry" : "");
+
+    // only slots that aren't simply the value of a predecessor are defined here
+    for(idx = 0; idx < b->inputs; ++idx) {
+      uint32_t value = ir->pool[b->slots + idx];
+      const evm_ir_value_t *v = &ir->values[value];
+
+      if(v->kind == EVM_IR_DEF || v->block != block || v->index != idx) {
+        continue;
+      }
+
+      if(v->kind == EVM_IR_ARG) {
+        fprintf(fp, "  v%u = arg %u\n", value, idx);
+      }
+      else {
+        fprintf(fp, "  v%u = phi", value);
+
+        for(pred = 0; pred < width; ++pred) {
+          uint32_t operand = ir->pool[b->phis + idx * width + pred];
+
+          if(pred < b->predCount && operand == EVM_IR_NONE) {
+            fprintf(fp, " b%u:-", ir->pool[b->preds + pred]); // its barrier rewrote the slot
+          }
+          else if(pred < b->predCount) {
+            fprintf(fp, " b%u:v%u", ir->pool[b->preds + pred], operand);
+          }
+          else {
+            fprintf(fp, " entry");
+          }
+        }
+
+        fprintf(fp, "\n");
+      }
+    }
+
+    for(idx = 0; idx < b->instCount; ++idx) {
+      evmirPrintInst(ir, &ir->insts[b->insts + idx], fp);
+    }
+
+    fprintf(fp, "  exit [");
+
+    for(idx = 0; idx < b->exitCount; ++idx) {
+      fprintf(fp, "%sv%u", idx ? " " : "", ir->pool[b->exits + idx]);
+    }
+
+    for(idx = b->consumed; idx < b->inputs; ++idx) {
+      fprintf(fp, "%sv%u", idx || b->exitCount ? " " : "", ir->pool[b->slots + idx]);
+    }
+
+    fprintf(fp, "]\n");
+  }
+
+  return ferror(fp) ? -1 : 0;
+}
+
+
+int evmirToBuffer(const evm_ir_t *ir, uint8_t **buf, uint32_t *len) {
+  evm_ir_code_t code;
+  uint32_t *uses = NULL, block;
+  int result = -1;
+
+  if(!ir || !buf || !len) {
+    return -1;
+  }
+
+  memset(&code, 0, sizeof(code));
+  code.body = malloc((ir->count + 1U) * sizeof(uint32_t));
+  code.branch = malloc((ir->count + 1U) * sizeof(uint32_t));
+  code.offset = malloc((ir->count + 1U) * sizeof(uint32_t));
+  code.wide = calloc(ir->count + 1U, sizeof(uint8_t));
+  uses = calloc(ir->valueCount + 1U, sizeof(uint32_t));
+
+  if(code.body && code.branch && code.offset && code.wide && uses) {
+    for(result = 0, block = 0; !result && block < ir->count; ++block) {
+      code.body[block] = code.count;
+      result = evmirLowerBlock(ir, &code, block, uses);
+    }
+
+    code.body[ir->count] = code.count;
+
+    if(!result) {
+      result = evmirLayout(ir, &code);
+    }
+  }
+
+  if(!result) {
+    *buf = code.bytes;
+    *len = code.count;
+    code.bytes = NULL;
+  }
+
+  free(code.bytes);
+  free(code.body);
+  free(code.branch);
+  free(code.offset);
+  free(code.wide);
+  free(uses);
+
+  return result;
+}
+
+
+static uint8_t evmirShape(uint8_t opcode) {
+  const evm_opcode_info_t *info = &EVM_OPCODE_INFO[opcode];
+
+  switch(opcode) {
+    case OP_NOP:
+    case OP_SWAP:
+      return SHAPE_MOVE;
+
+    case OP_JTBL:
+    case OP_LJTBL:
+#if EVM_MEMORY_SUPPORT == 1
+    case OP_WRITE8:
+    case OP_WRITE16:
+    case OP_WRITE24:
+    case OP_WRITE32:
+    case OP_LWRITE8:
+    case OP_LWRITE16:
+    case OP_LWRITE24:
+    case OP_LWRITE32:
+#endif
+      return SHAPE_PEEK;
+
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_CONV_FI_1:
+    case OP_CONV_IF_1:
+      return SHAPE_SECOND;
+#endif
+
+    case OP_BCALL:
+    case OP_YIELD:
+      return SHAPE_FLOW;
+  }
+
+  switch(opcode & 0xF0) {
+    case FAM_POP:
+    case FAM_DUP:
+      return SHAPE_MOVE;
+
+    case FAM_FRAME:
+      return SHAPE_FLOW; // the frame is left on the stack where the instructions expect it
+
+    case FAM_CMP:
+      return SHAPE_PEEK;
+  }
+
+  switch(info->branch) {
+    case EVM_BRANCH_RETURN:
+      return SHAPE_RETURN;
+
+    case EVM_BRANCH_JUMP:
+    case EVM_BRANCH_COND:
+    case EVM_BRANCH_CALL:
+    case EVM_BRANCH_HALT:
+      return SHAPE_FLOW;
+  }
+
+  return info->pushes ? SHAPE_DEF : SHAPE_USE;
+}
+
+
+// anything else may rearrange the stack while these run, frame instructions reach below the values
+// a block tracks
+static int evmirIsBarrier(uint8_t opcode) {
+  return opcode == OP_CALL || opcode == OP_LCALL || opcode == OP_BCALL || opcode == OP_YIELD ||
+         (opcode & 0xF0) == FAM_FRAME;
+}
+
+
+static uint32_t evmirReserve(evm_ir_t *ir, uint32_t count) {
+  uint32_t start = ir->poolCount;
+
+  if(ir->poolCount + count > ir->poolCapacity) {
+    uint32_t capacity = ir->poolCapacity ? ir->poolCapacity : 256U;
+    uint32_t *pool;
+
+    while(capacity < ir->poolCount + count) {
+      capacity *= 2U;
+    }
+
+    if(!(pool = realloc(ir->pool, capacity * sizeof(uint32_t)))) {
+      return EVM_IR_NONE;
+    }
+
+    ir->pool = pool;
+    ir->poolCapacity = capacity;
+  }
+
+  ir->poolCount += count;
+
+  return start;
+}
+
+
+static uint32_t evmirNewValue(evm_ir_t *ir, uint8_t kind, uint32_t block, uint32_t index) {
+  if(ir->valueCount == ir->valueCapacity) {
+    uint32_t capacity = ir->valueCapacity ? ir->valueCapacity * 2U : 256U;
+    evm_ir_value_t *values = realloc(ir->values, capacity * sizeof(evm_ir_value_t));
+
+    if(!values) {
+      return EVM_IR_NONE;
+    }
+
+    ir->values = values;
+    ir->valueCapacity = capacity;
+  }
+
+  ir->values[ir->valueCount].block = block;
+  ir->values[ir->valueCount].index = index;
+  ir->values[ir->valueCount].kind = kind;
+
+  return ir->valueCount++;
+}
+
+
+static evm_ir_inst_t *evmirNewInst(evm_ir_t *ir) {
+  if(ir->instCount == ir->instCapacity) {
+    uint32_t capacity = ir->instCapacity ? ir->instCapacity * 2U : 256U;
+    evm_ir_inst_t *insts = realloc(ir->insts, capacity * sizeof(evm_ir_inst_t));
+
+    if(!insts) {
+      return NULL;
+    }
+
+    ir->insts = insts;
+    ir->instCapacity = capacity;
+  }
+
+  memset(&ir->insts[ir->instCount], 0, sizeof(evm_ir_inst_t));
+  ir->insts[ir->instCount].def = EVM_IR_NONE;
+
+  return &ir->insts[ir->instCount++];
+}
+
+
+static int evmirListPush(evm_ir_list_t *list, uint32_t value) {
+  return evmirListInsert(list, list->count, value);
+}
+
+
+static int evmirListInsert(evm_ir_list_t *list, uint32_t at, uint32_t value) {
+  if(value == EVM_IR_NONE) {
+    return -1;
+  }
+
+  if(list->count == list->capacity) {
+    uint32_t capacity = list->capacity ? list->capacity * 2U : 16U;
+    uint32_t *values = realloc(list->values, capacity * sizeof(uint32_t));
+
+    if(!values) {
+      return -1;
+    }
+
+    list->values = values;
+    list->capacity = capacity;
+  }
+
+  memmove(&list->values[at + 1U], &list->values[at], (list->count - at) * sizeof(uint32_t));
+  list->values[at] = value;
+  ++list->count;
+
+  return 0;
+}
+
+
+// the value held by an entry slot, created on first use
+static uint32_t evmirSlot(evm_ir_t *ir, evm_ir_list_t *slots, uint32_t block, uint32_t slot) {
+  while(slots->count <= slot) {
+    if(slots->count >= EVM_IR_MAX_DEPTH ||
+       evmirListPush(slots, evmirNewValue(ir, EVM_IR_PHI, block, slots->count))) {
+      return EVM_IR_NONE;
+    }
+  }
+
+  return slots->values[slot];
+}
+
+
+// the value a successor finds in one of its entry slots
+static uint32_t evmirExitValue(evm_ir_t *ir, evm_ir_list_t *scratch, uint32_t block,
+                               uint32_t slot) {
+  const evm_ir_block_t *b = &ir->blocks[block];
+
+  if(slot < b->exitCount) {
+    return ir->pool[b->exits + slot];
+  }
+
+  return evmirSlot(ir, &scratch[block], block, b->consumed + slot - b->exitCount);
+}
+
+
+// the fused branches stand for the compare and jump they replace, which the IR lowers unfused
+static int evmirLiftFused(evm_ir_t *ir, uint32_t block, evm_ir_list_t *slots,
+                          evm_ir_list_t *stack, const evm_disasm_inst_t *inst) {
+  // the jump for each flag mask, NOP where no single jump tests it
+  static const uint8_t JUMPS[8] = {
+    OP_NOP, OP_JLT, OP_JEQ, OP_JLE, OP_JGT, OP_JNE, OP_JGE, OP_NOP
+  };
+  evm_disasm_inst_t parts[5];
+  uint32_t count = 0, idx;
+  uint8_t far = 0;
+
+  memset(parts, 0, sizeof(parts));
+
+  if(inst->opcode == OP_LJCMP_8I || inst->opcode == OP_LDJNZ) {
+    far = OP_LJMP - OP_JMP; // each long jump follows its short form
+  }
+
+  if(inst->opcode == OP_DJNZ || inst->opcode == OP_LDJNZ) {
+    parts[count++].opcode = OP_DEC_I;
+    parts[count++].opcode = OP_CMP_I0;
+    parts[count++].opcode = OP_JNE + far;
+  }
+  else {
+    if(JUMPS[inst->arg.raw[0] & 0x07] == OP_NOP) {
+      return -1;
+    }
+
+    // the value compared to is pushed below the top, where CMP finds its second operand
+    parts[count].opcode = OP_PUSH_8I;
+    parts[count++].arg.i8 = (int8_t) inst->arg.raw[1];
+    parts[count++].opcode = OP_SWAP;
+    parts[count++].opcode = OP_CMP_I;
+    parts[count++].opcode = OP_REM_1;
+    parts[count++].opcode = JUMPS[inst->arg.raw[0] & 0x07] + far;
+  }
+
+  for(idx = 0; idx < count; ++idx) {
+    parts[idx].offset = inst->offset;
+
+    if(evmirLift(ir, block, slots, stack, &parts[idx])) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+
+// simulate a single instruction on a stack of values, pulling entry slots in from below
+static int evmirLift(evm_ir_t *ir, uint32_t block, evm_ir_list_t *slots, evm_ir_list_t *stack,
+                     const evm_disasm_inst_t *inst) {
+  const evm_opcode_info_t *info = &EVM_OPCODE_INFO[inst->opcode];
+  uint32_t depth = 0, count = 0, idx;
+  uint8_t shape = evmirShape(inst->opcode);
+  evm_ir_inst_t *ins;
+
+  if(inst->opcode == OP_JCMP_8I || inst->opcode == OP_LJCMP_8I || inst->opcode == OP_DJNZ ||
+     inst->opcode == OP_LDJNZ) {
+    return evmirLiftFused(ir, block, slots, stack, inst);
+  }
+
+  switch(inst->opcode & 0xF0) {
+    case FAM_POP:
+      if(inst->opcode == OP_REM_R) {
+        depth = (((uint32_t) inst->arg.raw[0]) >> 4) + 1U;
+        count = (inst->arg.raw[0] & 0x0FU) + 1U;
+      }
+      else if(inst->opcode >= OP_REM_1) {
+        depth = inst->opcode - OP_REM_1 + 1U;
+        count = 1;
+      }
+      else {
+        count = inst->opcode - OP_POP_1 + 1U;
+      }
+    break;
+
+    case FAM_DUP:
+      depth = inst->opcode - OP_DUP_0 + 1U;
+    break;
+  }
+
+  // every operand has to be on the stack before it is read
+  while(stack->count < (uint32_t) (info->pops > depth + count ? info->pops : depth + count) ||
+        stack->count < (shape == SHAPE_RETURN ? (uint32_t) info->pops : 0U)) {
+    if(evmirListInsert(stack, 0, evmirSlot(ir, slots, block, slots->count))) {
+      return -1;
+    }
+  }
+
+  if(shape == SHAPE_MOVE) {
+    if(inst->opcode == OP_SWAP) {
+      uint32_t tmp = stack->values[stack->count - 1U];
+
+      stack->values[stack->count - 1U] = stack->values[stack->count - 2U];
+      stack->values[stack->count - 2U] = tmp;
+    }
+    else if((inst->opcode & 0xF0) == FAM_DUP) {
+      return evmirListPush(stack, stack->values[stack->count - depth]);
+    }
+    else if(count) {
+      memmove(&stack->values[stack->count - depth - count], &stack->values[stack->count - depth],
+              depth * sizeof(uint32_t));
+      stack->count -= count;
+    }
+
+    return 0;
+  }
+
+  if(!(ins = evmirNewInst(ir))) {
+    return -1;
+  }
+
+  ins->offset = inst->offset;
+  ins->opcode = inst->opcode;
+
+  // widen the immediate the same way the virtual machine reads it
+  switch(info->immediate) {
+    case EVM_IMM_I8:
+      ins->imm = inst->arg.i8;
+    break;
+
+    case EVM_IMM_I16:
+      ins->imm = inst->arg.i16;
+    break;
+
+    case EVM_IMM_I24:
+      ins->imm = (int32_t) ((((uint32_t) inst->arg.i32 & 0xFFFFFFU) ^ 0x800000U) - 0x800000U);
+    break;
+
+    case EVM_IMM_U16:
+      ins->imm = inst->arg.i32 & 0xFFFF;
+    break;
+
+    case EVM_IMM_U24:
+      ins->imm = inst->arg.i32 & 0xFFFFFF;
+    break;
+
+    case EVM_IMM_I32:
+    case EVM_IMM_F32:
+      ins->imm = inst->arg.i32;
+    break;
+
+    case EVM_IMM_SCALE16:
+      // the scale byte and the base after it, lowered back as the same three bytes
+      ins->imm = (int32_t) ((uint32_t) inst->arg.raw[0] | ((uint32_t) inst->arg.raw[1] << 8) |
+                            ((uint32_t) inst->arg.raw[2] << 16));
+    break;
+
+    case EVM_IMM_NONE:
+    break;
+
+    default:
+      ins->imm = inst->arg.raw[0];
+    break;
+  }
+
+  switch(shape) {
+    case SHAPE_DEF:
+    case SHAPE_USE:
+    case SHAPE_PEEK:
+      ins->argCount = info->pops;
+    break;
+
+    case SHAPE_SECOND:
+    case SHAPE_RETURN:
+      ins->argCount = 1;
+    break;
+  }
+
+  if(ins->argCount) {
+    uint32_t args = evmirReserve(ir, ins->argCount);
+
+    if(args == EVM_IR_NONE) {
+      return -1;
+    }
+
+    ins = &ir->insts[ir->instCount - 1U];
+    ins->args = args;
+  }
+
+  switch(shape) {
+    case SHAPE_DEF:
+    case SHAPE_USE:
+    case SHAPE_PEEK:
+      for(idx = 0; idx < ins->argCount; ++idx) {
+        ir->pool[ins->args + idx] = stack->values[stack->count - 1U - idx];
+      }
+
+      if(shape != SHAPE_PEEK) {
+        stack->count -= ins->argCount;
+      }
+
+      if(shape == SHAPE_DEF) {
+        ins->def = evmirNewValue(ir, EVM_IR_DEF, block, ir->instCount - 1U);
+        return evmirListPush(stack, ins->def);
+      }
+    break;
+
+    case SHAPE_SECOND:
+      // the conversion of the second value reads just like the one of the top
+      ins->opcode = inst->opcode - 1U;
+      ir->pool[ins->args] = stack->values[stack->count - 2U];
+      ins->def = evmirNewValue(ir, EVM_IR_DEF, block, ir->instCount - 1U);
+      stack->values[stack->count - 2U] = ins->def;
+      return ins->def == EVM_IR_NONE ? -1 : 0;
+
+    case SHAPE_RETURN:
+      depth = info->pops - 1U;
+
+      if(inst->opcode == OP_RET_I) {
+        depth = inst->arg.raw[0];
+
+        while(stack->count < depth + 1U) {
+          if(evmirListInsert(stack, 0, evmirSlot(ir, slots, block, slots->count))) {
+            return -1;
+          }
+        }
+      }
+
+      ins->imm = (int32_t) depth;
+      ir->pool[ins->args] = stack->values[stack->count - 1U - depth];
+      memmove(&stack->values[stack->count - 1U - depth], &stack->values[stack->count - depth],
+              depth * sizeof(uint32_t));
+      --stack->count;
+    break;
+  }
+
+  return 0;
+}
+
+
+static uint32_t evmirFindBlock(const evm_ir_t *ir, uint32_t offset) {
+  uint32_t low = 0, high = ir->count;
+
+  while(low < high) {
+    uint32_t mid = low + (high - low) / 2U;
+
+    if(ir->blocks[mid].start < offset) {
+      low = mid + 1U;
+    }
+    else {
+      high = mid;
+    }
+  }
+
+  return low < ir->count && ir->blocks[low].start == offset ? low : EVM_IR_NONE;
+}
+
+
+static uint32_t evmirResolve(uint32_t *alias, uint32_t value) {
+  uint32_t root = value;
+
+  while(alias[root] != root) {
+    root = alias[root];
+  }
+
+  // shorten the chain for the next lookup
+  while(alias[value] != root) {
+    uint32_t next = alias[value];
+
+    alias[value] = root;
+    value = next;
+  }
+
+  return root;
+}
+
+
+// the values a block leaves behind reach its successors unless a barrier ends it, which rewrites
+// the stack they are found on
+static int evmirPasses(const evm_ir_t *ir, uint32_t block) {
+  const evm_ir_block_t *b = &ir->blocks[block];
+
+  return !b->instCount || !evmirIsBarrier(ir->insts[b->insts + b->instCount - 1U].opcode);
+}
+
+
+// predecessors whose values reach a block, its slots are arguments without any
+static uint32_t evmirJoins(const evm_ir_t *ir, uint32_t block) {
+  const evm_ir_block_t *b = &ir->blocks[block];
+  uint32_t pred, count = 0;
+
+  for(pred = 0; pred < b->predCount; ++pred) {
+    count += (uint32_t) evmirPasses(ir, ir->pool[b->preds + pred]);
+  }
+
+  return count;
+}
+
+
+// give every slot read by a block the values of its predecessors, then drop the phis that don't
+// actually join different values
+static int evmirJoin(evm_ir_t *ir, evm_ir_list_t *scratch) {
+  uint32_t *alias, block, slot, pred, idx;
+  int changed;
+
+  // reading a slot the predecessor didn't write makes it read that slot as well
+  do {
+    changed = 0;
+
+    for(block = 0; block < ir->count; ++block) {
+      for(slot = 0; slot < scratch[block].count; ++slot) {
+        for(pred = 0; pred < ir->blocks[block].predCount; ++pred) {
+          uint32_t p = ir->pool[ir->blocks[block].preds + pred];
+          uint32_t before = scratch[p].count;
+
+          if(!evmirPasses(ir, p)) {
+            continue;
+          }
+
+          if(evmirExitValue(ir, scratch, p, slot) == EVM_IR_NONE) {
+            return -1; // the stack keeps shrinking around a loop
+          }
+
+          changed |= scratch[p].count != before;
+        }
+      }
+    }
+  } while(changed);
+
+  for(block = 0; block < ir->count; ++block) {
+    evm_ir_block_t *b = &ir->blocks[block];
+    uint32_t width = b->predCount + ((b->flags & EVM_IR_ENTRY) ? 1U : 0U);
+    uint32_t joins = evmirJoins(ir, block);
+    uint32_t slots = evmirReserve(ir, scratch[block].count);
+    uint32_t phis = evmirReserve(ir, scratch[block].count * (joins ? width : 0U));
+
+    if(slots == EVM_IR_NONE || phis == EVM_IR_NONE) {
+      return -1;
+    }
+
+    b = &ir->blocks[block];
+    b->slots = slots;
+    b->phis = phis;
+    b->inputs = scratch[block].count;
+
+    for(slot = 0; slot < b->inputs; ++slot) {
+      ir->pool[b->slots + slot] = scratch[block].values[slot];
+
+      if(!joins) {
+        ir->values[scratch[block].values[slot]].kind = EVM_IR_ARG;
+        continue;
+      }
+
+      for(pred = 0; pred < width; ++pred) {
+        uint32_t p = pred < b->predCount ? ir->pool[b->preds + pred] : EVM_IR_NONE;
+
+        ir->pool[b->phis + slot * width + pred] = p != EVM_IR_NONE && evmirPasses(ir, p) ?
+          evmirExitValue(ir, scratch, p, slot) : EVM_IR_NONE;
+      }
+    }
+  }
+
+  if(!(alias = malloc((ir->valueCount + 1U) * sizeof(uint32_t)))) {
+    return -1;
+  }
+
+  for(idx = 0; idx < ir->valueCount; ++idx) {
+    alias[idx] = idx;
+  }
+
+  // a phi whose operands are all the same value, or itself around a loop, is that value
+  do {
+    changed = 0;
+
+    for(block = 0; block < ir->count; ++block) {
+      const evm_ir_block_t *b = &ir->blocks[block];
+      uint32_t width = b->predCount + ((b->flags & EVM_IR_ENTRY) ? 1U : 0U);
+      uint32_t joins = evmirJoins(ir, block);
+
+      for(slot = 0; joins && slot < b->inputs; ++slot) {
+        uint32_t self = ir->pool[b->slots + slot], same = EVM_IR_NONE;
+
+        if(evmirResolve(alias, self) != self) {
+          continue;
+        }
+
+        for(pred = 0; pred < width; ++pred) {
+          uint32_t operand = ir->pool[b->phis + slot * width + pred];
+
+          if(operand != EVM_IR_NONE) {
+            operand = evmirResolve(alias, operand);
+          }
+
+          if(operand == self || operand == same) {
+            continue;
+          }
+
+          if(same != EVM_IR_NONE || operand == EVM_IR_NONE) {
+            same = EVM_IR_NONE;
+            break;
+          }
+
+          same = operand;
+        }
+
+        if(same != EVM_IR_NONE && pred == width) {
+          alias[self] = same;
+          changed = 1;
+        }
+      }
+    }
+  } while(changed);
+
+  // replace every use of a dropped phi
+  for(block = 0; block < ir->count; ++block) {
+    evm_ir_block_t *b = &ir->blocks[block];
+    uint32_t width = b->predCount + ((b->flags & EVM_IR_ENTRY) ? 1U : 0U);
+    uint32_t joins = evmirJoins(ir, block);
+
+    for(idx = 0; idx < b->exitCount; ++idx) {
+      ir->pool[b->exits + idx] = evmirResolve(alias, ir->pool[b->exits + idx]);
+    }
+
+    for(idx = 0; idx < b->inputs; ++idx) {
+      ir->pool[b->slots + idx] = evmirResolve(alias, ir->pool[b->slots + idx]);
+    }
+
+    for(idx = 0; joins && idx < b->inputs * width; ++idx) {
+      if(ir->pool[b->phis + idx] != EVM_IR_NONE) {
+        ir->pool[b->phis + idx] = evmirResolve(alias, ir->pool[b->phis + idx]);
+      }
+    }
+
+    for(idx = 0; idx < b->instCount; ++idx) {
+      const evm_ir_inst_t *inst = &ir->insts[b->insts + idx];
+      uint32_t arg;
+
+      for(arg = 0; arg < inst->argCount; ++arg) {
+        ir->pool[inst->args + arg] = evmirResolve(alias, ir->pool[inst->args + arg]);
+      }
+    }
+  }
+
+  free(alias);
+
+  return 0;
+}
+
+
+static int evmirEmit(evm_ir_code_t *code, uint8_t opcode, int32_t imm) {
+  uint32_t length = EVM_OPCODE_INFO[opcode].length, idx;
+
+  if(code->count + length > code->capacity) {
+    uint32_t capacity = code->capacity ? code->capacity * 2U : 1024U;
+    uint8_t *bytes = realloc(code->bytes, capacity);
+
+    if(!bytes) {
+      return -1;
+    }
+
+    code->bytes = bytes;
+    code->capacity = capacity;
+  }
+
+  code->bytes[code->count++] = opcode;
+
+  for(idx = 1; idx < length; ++idx) {
+    code->bytes[code->count++] = (uint8_t) (((uint32_t) imm >> (8U * (idx - 1U))) & 0xFF);
+  }
+
+  return 0;
+}
+
+
+// bring the operands to the top of the stack in order, reusing them in place when nothing needs
+// them afterwards
+static int evmirArrange(evm_ir_code_t *code, evm_ir_list_t *stack, const uint32_t *args,
+                        uint32_t count, const uint32_t *uses, int consume) {
+  int inPlace = count <= stack->count;
+  uint32_t idx, other;
+
+  for(idx = 0; inPlace && idx < count; ++idx) {
+    inPlace = stack->values[stack->count - 1U - idx] == args[idx];
+  }
+
+  // every other use needs a copy that survives
+  for(idx = 0; inPlace && consume && idx < count; ++idx) {
+    uint32_t copies = 0, reads = 0;
+
+    for(other = 0; other + count < stack->count; ++other) {
+      copies += stack->values[other] == args[idx];
+    }
+
+    for(other = 0; other < count; ++other) {
+      reads += args[other] == args[idx];
+    }
+
+    inPlace = uses[args[idx]] <= reads || copies;
+  }
+
+  for(idx = count; !inPlace && idx-- > 0;) {
+    if(evmirCopy(code, stack, args[idx])) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+
+// pop the values on top nobody reads anymore
+static int evmirDropDead(evm_ir_code_t *code, evm_ir_list_t *stack, const uint32_t *uses) {
+  uint32_t count = 0;
+
+  while(count < 8U && count < stack->count && !uses[stack->values[stack->count - 1U - count]]) {
+    ++count;
+  }
+
+  stack->count -= count;
+
+  return count ? evmirEmit(code, (uint8_t) (OP_POP_1 + count - 1U), 0) : 0;
+}
+
+
+// push the nearest copy of a value, DUP reaches sixteen values deep
+static int evmirCopy(evm_ir_code_t *code, evm_ir_list_t *stack, uint32_t value) {
+  uint32_t depth;
+
+  for(depth = 0; depth < stack->count && stack->values[stack->count - 1U - depth] != value;
+      ++depth) {}
+
+  if(depth > 15U || depth == stack->count) {
+    return -1;
+  }
+
+  return evmirEmit(code, (uint8_t) (OP_DUP_0 + depth), 0) || evmirListPush(stack, value) ? -1 : 0;
+}
+
+
+// turn the stack into the layout the successors expect, top first
+static int evmirShapeStack(evm_ir_code_t *code, evm_ir_list_t *stack,
+                           const evm_ir_list_t *layout) {
+  uint32_t idx, extra, junk;
+  int match = layout->count <= stack->count;
+
+  // the layout may already be there with values left above it
+  for(idx = 0; match && idx < layout->count; ++idx) {
+    match = stack->values[idx] == layout->values[layout->count - 1U - idx];
+  }
+
+  if(match) {
+    for(extra = stack->count - layout->count; extra; extra -= idx) {
+      idx = extra > 8U ? 8U : extra;
+
+      if(evmirEmit(code, (uint8_t) (OP_POP_1 + idx - 1U), 0)) {
+        return -1;
+      }
+    }
+
+    stack->count = layout->count;
+    return 0;
+  }
+
+  // or on top with values left below it
+  match = layout->count <= stack->count;
+
+  for(idx = 0; match && idx < layout->count; ++idx) {
+    match = stack->values[stack->count - 1U - idx] == layout->values[idx];
+  }
+
+  // otherwise copy it to the top
+  junk = stack->count - (match ? layout->count : 0U);
+
+  for(idx = layout->count; !match && idx-- > 0;) {
+    if(evmirCopy(code, stack, layout->values[idx])) {
+      return -1;
+    }
+  }
+
+  if(layout->count > 16U && junk) {
+    return -1; // REM doesn't reach below that
+  }
+
+  while(junk) {
+    uint32_t count = junk > 16U ? 16U : junk;
+
+    if(!layout->count) {
+      count = count > 8U ? 8U : count;
+
+      if(evmirEmit(code, (uint8_t) (OP_POP_1 + count - 1U), 0)) {
+        return -1;
+      }
+    }
+    else if(count == 1U && layout->count <= 7U) {
+      if(evmirEmit(code, (uint8_t) (OP_REM_1 + layout->count - 1U), 0)) {
+        return -1;
+      }
+    }
+    else if(evmirEmit(code, OP_REM_R, (int32_t) (((layout->count - 1U) << 4) | (count - 1U)))) {
+      return -1;
+    }
+
+    junk -= count;
+  }
+
+  memmove(&stack->values[0], &stack->values[stack->count - layout->count],
+          layout->count * sizeof(uint32_t));
+  stack->count = layout->count;
+
+  return 0;
+}
+
+
+static int evmirLowerBlock(const evm_ir_t *ir, evm_ir_code_t *code, uint32_t block,
+                           uint32_t *uses) {
+  const evm_ir_block_t *b = &ir->blocks[block];
+  const evm_ir_inst_t *last = b->instCount ? &ir->insts[b->insts + b->instCount - 1U] : NULL;
+  evm_ir_list_t stack = { NULL, 0, 0 }, layout = { NULL, 0, 0 };
+  uint32_t idx, arg, body = b->instCount;
+  int result = 0;
+
+  code->branch[block] = EVM_IR_NONE;
+
+  // the last instruction leaves the block once the stack has been shaped
+  if(last && (evmirShape(last->opcode) == SHAPE_FLOW || evmirShape(last->opcode) == SHAPE_RETURN ||
+              EVM_OPCODE_INFO[last->opcode].branch == EVM_BRANCH_TABLE)) {
+    --body;
+  }
+  else {
+    last = NULL;
+  }
+
+  for(idx = b->inputs; !result && idx-- > 0;) {
+    result = evmirListPush(&stack, ir->pool[b->slots + idx]);
+  }
+
+  for(idx = 0; !result && idx < b->exitCount; ++idx) {
+    result = evmirListPush(&layout, ir->pool[b->exits + idx]);
+  }
+
+  for(idx = b->consumed; !result && idx < b->inputs; ++idx) {
+    result = evmirListPush(&layout, ir->pool[b->slots + idx]);
+  }
+
+  if(!result && last && evmirShape(last->opcode) == SHAPE_RETURN) {
+    result = evmirListInsert(&layout, (uint32_t) last->imm, ir->pool[last->args]);
+  }
+
+  // count the reads of every value so operands can be used up in place
+  for(idx = 0; idx < body; ++idx) {
+    const evm_ir_inst_t *inst = &ir->insts[b->insts + idx];
+
+    for(arg = 0; arg < inst->argCount; ++arg) {
+      ++uses[ir->pool[inst->args + arg]];
+    }
+  }
+
+  for(idx = 0; idx < layout.count; ++idx) {
+    ++uses[layout.values[idx]];
+  }
+
+  for(idx = 0; !result && idx < body; ++idx) {
+    const evm_ir_inst_t *inst = &ir->insts[b->insts + idx];
+    const uint32_t *args = &ir->pool[inst->args];
+    uint8_t shape = evmirShape(inst->opcode);
+
+    result = evmirDropDead(code, &stack, uses) ||
+             evmirArrange(code, &stack, args, inst->argCount, uses, shape != SHAPE_PEEK) ||
+             evmirEmit(code, inst->opcode, inst->imm) ? -1 : 0;
+
+    if(result) {
+      EVM_DEBUGF("Unable to reach the operands of %06X in b%u with %u live values", inst->offset,
+                 block, stack.count);
+    }
+
+    for(arg = 0; arg < inst->argCount; ++arg) {
+      --uses[args[arg]];
+    }
+
+    if(!result && shape != SHAPE_PEEK) {
+      stack.count -= inst->argCount;
+
+      if(inst->def != EVM_IR_NONE) {
+        result = evmirListPush(&stack, inst->def);
+      }
+    }
+  }
+
+  for(idx = 0; idx < layout.count; ++idx) {
+    uses[layout.values[idx]] = 0;
+  }
+
+  if(!result && (result = evmirShapeStack(code, &stack, &layout))) {
+    EVM_DEBUGF("Unable to leave b%u @%06X with its %u live values in place", block, b->start,
+               layout.count);
+  }
+
+  if(!result && last) {
+    if(last->targetCount) {
+      code->branch[block] = b->insts + b->instCount - 1U; // laid out once the blocks are placed
+    }
+    else {
+      result = evmirEmit(code, last->opcode, last->imm);
+    }
+  }
+
+  free(stack.values);
+  free(layout.values);
+
+  if(result) {
+    // the reads left over from where the block gave up aren't needed by any other block
+    for(idx = 0; idx < body; ++idx) {
+      const evm_ir_inst_t *inst = &ir->insts[b->insts + idx];
+
+      for(arg = 0; arg < inst->argCount; ++arg) {
+        uses[ir->pool[inst->args + arg]] = 0;
+      }
+    }
+
+    result = evmirKeepBlock(ir, code, block);
+  }
+
+  return result;
+}
+
+
+// copy the bytecode a block was lifted from, the stack on either side of it is the one the
+// program had so the copy fits between lowered blocks
+static int evmirKeepBlock(const evm_ir_t *ir, evm_ir_code_t *code, uint32_t block) {
+  const evm_ir_block_t *b = &ir->blocks[block];
+  const evm_ir_inst_t *last = b->instCount ? &ir->insts[b->insts + b->instCount - 1U] : NULL;
+  uint32_t at, end = b->end, idx;
+
+  EVM_DEBUGF("Keeping the bytecode of b%u @%06X", block, b->start);
+
+  code->count = code->body[block];
+  code->branch[block] = EVM_IR_NONE;
+
+  // branches are placed with the blocks, so stop before the one ending this block
+  if(last && last->targetCount) {
+    end = last->offset;
+  }
+
+  for(at = b->start; at < end; at += EVM_OPCODE_INFO[ir->bytes[at]].length) {
+    uint32_t imm = 0;
+
+    for(idx = EVM_OPCODE_INFO[ir->bytes[at]].length; idx-- > 1U;) {
+      imm = (imm << 8) | ir->bytes[at + idx];
+    }
+
+    if(evmirEmit(code, ir->bytes[at], (int32_t) imm)) {
+      return -1;
+    }
+  }
+
+  if(!last || !last->targetCount) {
+    return 0;
+  }
+
+  // a fused branch is placed as the jump it was lifted into, after the compare it did
+  switch(ir->bytes[end]) {
+    case OP_DJNZ:
+    case OP_LDJNZ:
+      if(evmirEmit(code, OP_DEC_I, 0) || evmirEmit(code, OP_CMP_I0, 0)) {
+        return -1;
+      }
+    break;
+
+    case OP_JCMP_8I:
+    case OP_LJCMP_8I:
+      if(evmirEmit(code, OP_PUSH_8I, (int8_t) ir->bytes[end + 2U]) || evmirEmit(code, OP_SWAP, 0) ||
+         evmirEmit(code, OP_CMP_I, 0) || evmirEmit(code, OP_REM_1, 0)) {
+        return -1;
+      }
+    break;
+  }
+
+  code->branch[block] = b->insts + b->instCount - 1U;
+
+  return 0;
+}
+
+
+static uint32_t evmirBranchSize(const evm_ir_inst_t *inst, int wide) {
+  switch(EVM_OPCODE_INFO[inst->opcode].branch) {
+    case EVM_BRANCH_TABLE:
+      return 2U + inst->targetCount * (wide ? 2U : 1U);
+
+    case EVM_BRANCH_CALL:
+      return wide ? 4U : 3U;
+
+    default:
+      return wide ? 3U : 2U;
+  }
+}
+
+
+// place the blocks, widening branches until every target is in reach, then write the branches
+static int evmirLayout(const evm_ir_t *ir, evm_ir_code_t *code) {
+  uint32_t block, offset, idx, size = 0;
+  uint8_t *bytes;
+  int changed;
+
+  do {
+    changed = 0;
+
+    for(offset = 0, block = 0; block < ir->count; ++block) {
+      code->offset[block] = offset;
+      offset += code->body[block + 1U] - code->body[block];
+
+      if(code->branch[block] != EVM_IR_NONE) {
+        offset += evmirBranchSize(&ir->insts[code->branch[block]], code->wide[block]);
+      }
+    }
+
+    size = offset;
+
+    for(block = 0; block < ir->count; ++block) {
+      const evm_ir_inst_t *inst;
+      int32_t at, limit;
+
+      if(code->branch[block] == EVM_IR_NONE) {
+        continue;
+      }
+
+      inst = &ir->insts[code->branch[block]];
+      at = (int32_t) (code->offset[block] + code->body[block + 1U] - code->body[block]);
+
+      if(EVM_OPCODE_INFO[inst->opcode].branch == EVM_BRANCH_CALL) {
+        limit = code->wide[block] ? 0x7FFFFF : 0x7FFF;
+      }
+      else {
+        limit = code->wide[block] ? 0x7FFF : 0x7F;
+      }
+
+      for(idx = 0; idx < inst->targetCount; ++idx) {
+        int32_t delta = (int32_t) code->offset[ir->pool[inst->targets + idx]] - at;
+
+        if(delta > limit || delta < -limit - 1) {
+          if(code->wide[block]) {
+            return -1; // out of reach of the widest form
+          }
+
+          code->wide[block] = 1;
+          changed = 1;
+          break;
+        }
+      }
+    }
+  } while(changed);
+
+  if(!(bytes = malloc(size ? size : 1U))) {
+    return -1;
+  }
+
+  for(block = 0; block < ir->count; ++block) {
+    uint32_t length = code->body[block + 1U] - code->body[block];
+    uint8_t *out = &bytes[code->offset[block]];
+
+    memcpy(out, &code->bytes[code->body[block]], length);
+
+    if(code->branch[block] != EVM_IR_NONE) {
+      const evm_ir_inst_t *inst = &ir->insts[code->branch[block]];
+      uint32_t at = code->offset[block] + length, width = 1;
+      uint8_t opcode = inst->opcode;
+
+      out += length;
+
+      switch(EVM_OPCODE_INFO[opcode].branch) {
+        case EVM_BRANCH_TABLE:
+          opcode = code->wide[block] ? OP_LJTBL : OP_JTBL;
+          width = code->wide[block] ? 2U : 1U;
+          *out++ = opcode;
+          *out++ = (uint8_t) (inst->targetCount - 1U);
+        break;
+
+        case EVM_BRANCH_CALL:
+          *out++ = code->wide[block] ? OP_LCALL : OP_CALL;
+          width = code->wide[block] ? 3U : 2U;
+        break;
+
+        default:
+          // the near and far jumps differ only by a bit
+          *out++ = (uint8_t) (code->wide[block] ? (opcode | (OP_LJMP - OP_JMP)) :
+                                                  (opcode & ~(OP_LJMP - OP_JMP)));
+          width = code->wide[block] ? 2U : 1U;
+        break;
+      }
+
+      for(idx = 0; idx < inst->targetCount; ++idx) {
+        uint32_t delta = code->offset[ir->pool[inst->targets + idx]] - at, byte;
+
+        for(byte = 0; byte < width; ++byte) {
+          *out++ = (uint8_t) ((delta >> (8U * byte)) & 0xFF);
+        }
+      }
+    }
+  }
+
+  free(code->bytes);
+  code->bytes = bytes;
+  code->count = size;
+
+  return 0;
+}
+
+
+static void evmirPrintInst(const evm_ir_t *ir, const evm_ir_inst_t *inst, FILE *fp) {
+  const evm_opcode_info_t *info = &EVM_OPCODE_INFO[inst->opcode];
+  uint32_t idx;
+
+  fprintf(fp, "  ");
+
+  if(inst->def != EVM_IR_NONE) {
+    fprintf(fp, "v%u = ", inst->def);
+  }
+
+  fprintf(fp, "%s", evmOpcodeToMnemonic((opcode_t) inst->opcode));
+
+  switch(inst->opcode) {
+    // constants folded into the opcode
+    case OP_PUSH_I0:
+    case OP_CMP_I0:
+      fprintf(fp, " 0");
+    break;
+
+    case OP_PUSH_I1:
+    case OP_CMP_I1:
+      fprintf(fp, " 1");
+    break;
+
+    case OP_PUSH_IN1:
+    case OP_CMP_IN1:
+      fprintf(fp, " -1");
+    break;
+
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_PUSH_F0:
+    case OP_CMP_F0:
+      fprintf(fp, " 0.0");
+    break;
+
+    case OP_PUSH_F1:
+    case OP_CMP_F1:
+      fprintf(fp, " 1.0");
+    break;
+
+    case OP_PUSH_FN1:
+    case OP_CMP_FN1:
+      fprintf(fp, " -1.0");
+    break;
+#endif
+
+    default:
+      switch(info->immediate) {
+        case EVM_IMM_I8:
+        case EVM_IMM_I16:
+        case EVM_IMM_I24:
+        case EVM_IMM_I32:
+          if(!inst->targetCount) {
+            fprintf(fp, " %d", inst->imm);
+          }
+        break;
+
+        case EVM_IMM_U16:
+        case EVM_IMM_U24:
+          fprintf(fp, " 0x%X", (uint32_t) inst->imm);
+        break;
+
+#if EVM_FLOAT_SUPPORT == 1
+        case EVM_IMM_F32: {
+          union { int32_t i; float f; } bits;
+
+          bits.i = inst->imm;
+          fprintf(fp, " %f", bits.f);
+        } break;
+#endif
+
+        case EVM_IMM_U8:
+          fprintf(fp, " %u", (uint32_t) inst->imm);
+        break;
+
+        case EVM_IMM_SCALE:
+          fprintf(fp, " %u", 1U << ((uint32_t) inst->imm & 0x03U));
+        break;
+
+        case EVM_IMM_SCALE16:
+          fprintf(fp, " %u 0x%X", 1U << ((uint32_t) inst->imm & 0x03U), (uint32_t) inst->imm >> 8);
+        break;
+      }
+    break;
+  }
+
+  if(info->branch == EVM_BRANCH_RETURN && inst->opcode != OP_RET_I && inst->imm) {
+    fprintf(fp, " %d", inst->imm);
+  }
+
+  for(idx = 0; idx < inst->argCount; ++idx) {
+    fprintf(fp, "%sv%u", idx ? ", " : " ", ir->pool[inst->args + idx]);
+  }
+
+  for(idx = 0; idx < inst->targetCount; ++idx) {
+    fprintf(fp, " b%u", ir->pool[inst->targets + idx]);
+  }
+
+  fprintf(fp, "\n");
+}
@@ -0,0 +1,518 @@
+#include "evm/ld.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+// where a section of an object ends up once linked
+typedef struct evm_chunk_s {
+  uint32_t output;   // index of the output section
+  uint32_t offset;   // position within the output section
+  uint32_t contents; // position of the bytes within the contents of the object
+} evm_chunk_t;
+
+
+struct evm_object_s {
+  char          *name;
+  uint8_t       *data;     // the whole object, owned by the linker
+  const uint8_t *sections; // records as described in evm/object.h
+  const uint8_t *symbols;
+  const uint8_t *relocs;
+  const char    *strings;
+  const uint8_t *contents;
+  evm_chunk_t   *chunks;   // one per section
+  uint32_t       sectionCount;
+  uint32_t       symbolCount;
+  uint32_t       relocCount;
+  uint32_t       stringLength;
+};
+
+
+typedef struct evm_output_s {
+  const char *name;
+  uint32_t    base;
+  uint32_t    length;
+  uint32_t    flags; // evm_object_flags_t
+  uint32_t    order; // keeps sections sharing a base in the order they were first seen
+} evm_output_t;
+
+
+typedef struct evm_definition_s {
+  const char         *name;
+  const evm_object_t *object;
+  uint32_t            output;
+  uint32_t            offset;
+} evm_definition_t;
+
+
+static int         evmldAdopt(evm_linker_t *, const char *, uint8_t *, uint32_t);
+static uint32_t    evmldLoadWord(const uint8_t *);
+static const char *evmldString(const evm_object_t *, uint32_t);
+static int         evmldCompareOutputs(const void *, const void *);
+static int         evmldCompareDefinitions(const void *, const void *);
+
+
+evm_linker_t *evmldAllocate() {
+  return (evm_linker_t *) calloc(1, sizeof(evm_linker_t));
+}
+
+
+evm_linker_t *evmldInitialize(evm_linker_t *ld) {
+  if(ld) {
+    memset((void *) ld, 0, sizeof(evm_linker_t));
+  }
+
+  return ld;
+}
+
+
+evm_linker_t *evmldFinalize(evm_linker_t *ld) {
+  if(ld) {
+    uint32_t index;
+
+    for(index = 0; index < ld->count; ++index) {
+      free(ld->objects[index].name);
+      free(ld->objects[index].data);
+      free(ld->objects[index].chunks);
+    }
+
+    free(ld->objects);
+    free(ld->program);
+    memset((void *) ld, 0, sizeof(evm_linker_t));
+  }
+
+  return ld;
+}
+
+
+void evmldFree(evm_linker_t *ld) {
+  free(ld);
+}
+
+
+int evmldAddBuffer(evm_linker_t *ld, const char *name, const uint8_t *buf, uint32_t len) {
+  uint8_t *copy;
+
+  if(ld && name && buf && (copy = malloc(len ? len : 1U))) {
+    memcpy(copy, buf, len);
+    return evmldAdopt(ld, name, copy, len);
+  }
+
+  return -1;
+}
+
+
+int evmldAddFile(evm_linker_t *ld, const char *name, FILE *fp) {
+  uint8_t *buffer = NULL;
+  size_t length = 0, capacity = 0;
+
+  if(ld && name && fp) {
+    // streams aren't necessarily seekable so read until the end in growing blocks
+    while(!feof(fp) && !ferror(fp)) {
+      if(length == capacity) {
+        uint8_t *grown = realloc(buffer, capacity = capacity ? capacity * 2U : 65536U);
+
+        if(!grown) {
+          EVM_ERRORF("Unable to allocate memory for object %s", name);
+          free(buffer);
+          return -1;
+        }
+
+        buffer = grown;
+      }
+
+      length += fread(&buffer[length], 1, capacity - length, fp);
+    }
+
+    if(!ferror(fp) && length <= UINT32_MAX) {
+      return evmldAdopt(ld, name, buffer, (uint32_t) length);
+    }
+
+    EVM_ERRORF("Unable to read object %s", name);
+    free(buffer);
+  }
+
+  return -1;
+}
+
+
+int evmldLink(evm_linker_t *ld) {
+  evm_output_t     *outputs = NULL, *sorted = NULL;
+  evm_definition_t *definitions = NULL;
+  uint32_t          outputCount = 0, definitionCount = 0, sections = 0, symbols = 0;
+  uint32_t          index, object, section;
+  int               result = 0;
+
+  if(!ld) {
+    return -1;
+  }
+
+  free(ld->program);
+  ld->program = NULL;
+  ld->length = 0;
+
+  for(object = 0; object < ld->count; ++object) {
+    sections += ld->objects[object].sectionCount;
+    symbols += ld->objects[object].symbolCount;
+  }
+
+  if(!sections) {
+    EVM_ERROR("Nothing to link");
+    return 8;
+  }
+
+  if(!(outputs = malloc(sections * sizeof(evm_output_t))) ||
+     !(sorted = malloc(sections * sizeof(evm_output_t))) ||
+     (symbols && !(definitions = malloc(symbols * sizeof(evm_definition_t))))) {
+    EVM_ERROR("Unable to allocate memory for linking");
+    result |= 64;
+  }
+
+  // concatenate the sections sharing a name, the last base given for a section wins
+  for(object = 0; !result && object < ld->count; ++object) {
+    evm_object_t *obj = &ld->objects[object];
+    uint32_t contents = 0;
+
+    for(section = 0; section < obj->sectionCount; ++section) {
+      const uint8_t *record = &obj->sections[section * 4U * EVM_OBJECT_SECTION_WORDS];
+      const char *name = evmldString(obj, evmldLoadWord(&record[0]));
+      uint32_t flags = evmldLoadWord(&record[8]);
+      uint32_t length = evmldLoadWord(&record[12]);
+      evm_output_t *out;
+
+      for(index = 0; index < outputCount && strcmp(outputs[index].name, name); ++index);
+
+      out = &outputs[index];
+      if(index == outputCount) {
+        out->name = name;
+        out->base = 0;
+        out->length = 0;
+        out->flags = 0;
+        out->order = outputCount++;
+      }
+
+      if(!out->length && (flags & EVM_OBJECT_DATA_FIRST)) {
+        out->flags |= EVM_OBJECT_DATA_FIRST;
+      }
+
+      if(flags & EVM_OBJECT_BASED) {
+        out->base = evmldLoadWord(&record[4]);
+        out->flags |= EVM_OBJECT_BASED;
+      }
+
+      obj->chunks[section].output = index;
+      obj->chunks[section].offset = out->length;
+      obj->chunks[section].contents = contents;
+      out->length += length;
+      contents += length;
+    }
+  }
+
+  // collect the labels every object defines
+  for(object = 0; !result && object < ld->count; ++object) {
+    const evm_object_t *obj = &ld->objects[object];
+
+    for(index = 0; index < obj->symbolCount; ++index) {
+      const uint8_t *record = &obj->symbols[index * 4U * EVM_OBJECT_SYMBOL_WORDS];
+      uint32_t owner = evmldLoadWord(&record[4]);
+
+      if(owner != EVM_OBJECT_UNDEFINED) {
+        evm_definition_t *def = &definitions[definitionCount++];
+
+        def->name = evmldString(obj, evmldLoadWord(&record[0]));
+        def->object = obj;
+        def->output = obj->chunks[owner].output;
+        def->offset = obj->chunks[owner].offset + evmldLoadWord(&record[8]);
+      }
+    }
+  }
+
+  if(!result && definitionCount) {
+    qsort(definitions, definitionCount, sizeof(evm_definition_t), &evmldCompareDefinitions);
+
+    for(index = 1; index < definitionCount; ++index) {
+      if(!strcmp(definitions[index - 1].name, definitions[index].name)) {
+        EVM_ERRORF(
+          "Duplicate label %s in %s and %s", definitions[index].name,
+          definitions[index - 1].object->name, definitions[index].object->name
+        );
+        result |= 1;
+      }
+    }
+  }
+
+  if(!result) {
+    // ensure that no sections overlap
+    memcpy(sorted, outputs, outputCount * sizeof(evm_output_t));
+    qsort(sorted, outputCount, sizeof(evm_output_t), &evmldCompareOutputs);
+
+    for(index = 0; index < outputCount; ++index) {
+      if(!sorted[index].length) {
+        EVM_ERRORF("Section %s is empty", sorted[index].name);
+        result |= 8;
+      }
+      else if(index + 1 < outputCount &&
+              (uint64_t) sorted[index].base + sorted[index].length > sorted[index + 1].base) {
+        EVM_ERRORF("Sections %s and %s overlap", sorted[index].name, sorted[index + 1].name);
+        result |= 16;
+      }
+    }
+
+    // ensure first byte is a valid instruction and not data
+    if(sorted[0].flags & EVM_OBJECT_DATA_FIRST) {
+      EVM_ERRORF("First byte of section %s is not an instruction", sorted[0].name);
+      result |= 32;
+    }
+  }
+
+  if(!result) {
+    uint64_t length = (uint64_t) sorted[outputCount - 1].base + sorted[outputCount - 1].length;
+
+    if(length > UINT32_MAX || !(ld->program = calloc((size_t) length, 1))) {
+      EVM_ERROR("Unable to allocate memory for the program");
+      result |= 64;
+    }
+    else {
+      ld->length = (uint32_t) length;
+    }
+  }
+
+  // place the contents of every object and patch the fields left for the linker
+  for(object = 0; !result && object < ld->count; ++object) {
+    const evm_object_t *obj = &ld->objects[object];
+
+    for(section = 0; section < obj->sectionCount; ++section) {
+      const evm_chunk_t *chunk = &obj->chunks[section];
+      uint32_t length = evmldLoadWord(&obj->sections[(section * EVM_OBJECT_SECTION_WORDS + 3U) * 4U]);
+
+      memcpy(&ld->program[outputs[chunk->output].base + chunk->offset],
+             &obj->contents[chunk->contents], length);
+    }
+
+    for(index = 0; index < obj->relocCount; ++index) {
+      const uint8_t *record = &obj->relocs[index * 4U * EVM_OBJECT_RELOC_WORDS];
+      const evm_chunk_t *chunk = &obj->chunks[evmldLoadWord(&record[0])];
+      uint32_t start = outputs[chunk->output].base + chunk->offset;
+      uint32_t size = evmldLoadWord(&record[12]);
+      const uint8_t *symbol = &obj->symbols[evmldLoadWord(&record[16]) * 4U * EVM_OBJECT_SYMBOL_WORDS];
+      evm_definition_t key, *def;
+
+      key.name = evmldString(obj, evmldLoadWord(&symbol[0]));
+      def = definitionCount ? bsearch(&key, definitions, definitionCount, sizeof(evm_definition_t),
+                                      &evmldCompareDefinitions) : NULL;
+
+      if(def) {
+        int64_t delta = (int64_t) outputs[def->output].base + def->offset -
+                        ((int64_t) start + evmldLoadWord(&record[8]));
+        int64_t limit = (int64_t) 1 << (size * 8U - 1U);
+
+        if(-limit <= delta && delta < limit) {
+          uint8_t *field = &ld->program[start + evmldLoadWord(&record[4])];
+
+          while(size--) {
+            *field++ = delta & 0xFF;
+            delta >>= 8;
+          }
+        }
+        else {
+          EVM_ERRORF("Jump too far to %s in %s", key.name, obj->name);
+          result |= 4;
+        }
+      }
+      else {
+        EVM_ERRORF("Missing label %s referenced in %s", key.name, obj->name);
+        result |= 2;
+      }
+    }
+  }
+
+  if(result) {
+    free(ld->program);
+    ld->program = NULL;
+    ld->length = 0;
+  }
+
+  free(definitions);
+  free(sorted);
+  free(outputs);
+
+  return result;
+}
+
+
+uint32_t evmldProgramSize(const evm_linker_t *ld) {
+  return ld ? ld->length : 0;
+}
+
+
+uint32_t evmldProgramToBuffer(const evm_linker_t *ld, uint8_t *buf, uint32_t max) {
+  if(ld && buf && ld->program && ld->length <= max) {
+    memcpy(buf, ld->program, ld->length);
+    return ld->length;
+  }
+
+  return 0;
+}
+
+
+int evmldProgramToFile(const evm_linker_t *ld, FILE *fp) {
+  if(ld && fp && ld->program) {
+    return fwrite(ld->program, 1, ld->length, fp) == ld->length ? 0 : -1;
+  }
+
+  return -1;
+}
+
+
+// check the tables of an object before taking ownership of it
+static int evmldAdopt(evm_linker_t *ld, const char *name, uint8_t *data, uint32_t len) {
+  evm_object_t obj;
+  uint64_t size, contents = 0;
+  uint32_t index;
+
+  memset((void *) &obj, 0, sizeof(evm_object_t));
+
+  if(len < 4U * EVM_OBJECT_HEADER_WORDS ||
+     evmldLoadWord(&data[0]) != EVM_OBJECT_MAGIC || evmldLoadWord(&data[4]) != EVM_OBJECT_VERSION) {
+    EVM_ERRORF("%s is not an object", name);
+    free(data);
+    return -1;
+  }
+
+  obj.sectionCount = evmldLoadWord(&data[8]);
+  obj.symbolCount = evmldLoadWord(&data[12]);
+  obj.relocCount = evmldLoadWord(&data[16]);
+  obj.stringLength = evmldLoadWord(&data[20]);
+
+  size = 4U * (EVM_OBJECT_HEADER_WORDS + (uint64_t) obj.sectionCount * EVM_OBJECT_SECTION_WORDS +
+               (uint64_t) obj.symbolCount * EVM_OBJECT_SYMBOL_WORDS +
+               (uint64_t) obj.relocCount * EVM_OBJECT_RELOC_WORDS) + obj.stringLength;
+
+  // every name has to be terminated within the string table
+  if(size > len || (obj.stringLength && data[size - 1U])) {
+    EVM_ERRORF("Object %s is truncated", name);
+    free(data);
+    return -1;
+  }
+
+  obj.sections = &data[4U * EVM_OBJECT_HEADER_WORDS];
+  obj.symbols = &obj.sections[4U * EVM_OBJECT_SECTION_WORDS * obj.sectionCount];
+  obj.relocs = &obj.symbols[4U * EVM_OBJECT_SYMBOL_WORDS * obj.symbolCount];
+  obj.strings = (const char *) &obj.relocs[4U * EVM_OBJECT_RELOC_WORDS * obj.relocCount];
+  obj.contents = &data[size];
+
+  for(index = 0; index < obj.sectionCount; ++index) {
+    const uint8_t *record = &obj.sections[index * 4U * EVM_OBJECT_SECTION_WORDS];
+
+    if(evmldLoadWord(&record[0]) >= obj.stringLength) {
+      break;
+    }
+
+    contents += evmldLoadWord(&record[12]);
+  }
+
+  if(index != obj.sectionCount || size + contents != len) {
+    EVM_ERRORF("Object %s has an invalid section table", name);
+    free(data);
+    return -1;
+  }
+
+  for(index = 0; index < obj.symbolCount; ++index) {
+    const uint8_t *record = &obj.symbols[index * 4U * EVM_OBJECT_SYMBOL_WORDS];
+    uint32_t section = evmldLoadWord(&record[4]);
+
+    if(evmldLoadWord(&record[0]) >= obj.stringLength ||
+       (section != EVM_OBJECT_UNDEFINED &&
+        (section >= obj.sectionCount ||
+         evmldLoadWord(&record[8]) > evmldLoadWord(&obj.sections[(section * 4U + 3U) * 4U])))) {
+      break;
+    }
+  }
+
+  if(index != obj.symbolCount) {
+    EVM_ERRORF("Object %s has an invalid symbol table", name);
+    free(data);
+    return -1;
+  }
+
+  for(index = 0; index < obj.relocCount; ++index) {
+    const uint8_t *record = &obj.relocs[index * 4U * EVM_OBJECT_RELOC_WORDS];
+    uint32_t section = evmldLoadWord(&record[0]);
+    uint32_t size = evmldLoadWord(&record[12]);
+    uint64_t length;
+
+    if(section >= obj.sectionCount || size < 1 || size > 3 ||
+       evmldLoadWord(&record[16]) >= obj.symbolCount) {
+      break;
+    }
+
+    length = evmldLoadWord(&obj.sections[(section * 4U + 3U) * 4U]);
+
+    if((uint64_t) evmldLoadWord(&record[4]) + size > length || evmldLoadWord(&record[8]) > length) {
+      break;
+    }
+  }
+
+  if(index != obj.relocCount) {
+    EVM_ERRORF("Object %s has an invalid relocation table", name);
+    free(data);
+    return -1;
+  }
+
+  if(ld->count == ld->capacity) {
+    uint32_t capacity = ld->capacity ? ld->capacity * 2U : 16U;
+    evm_object_t *objects = realloc(ld->objects, capacity * sizeof(evm_object_t));
+
+    if(!objects) {
+      EVM_ERRORF("Unable to allocate memory for object %s", name);
+      free(data);
+      return -1;
+    }
+
+    ld->objects = objects;
+    ld->capacity = capacity;
+  }
+
+  obj.data = data;
+  obj.name = malloc(strlen(name) + 1U);
+  obj.chunks = calloc(obj.sectionCount ? obj.sectionCount : 1U, sizeof(evm_chunk_t));
+
+  if(!obj.name || !obj.chunks) {
+    EVM_ERRORF("Unable to allocate memory for object %s", name);
+    free(obj.chunks);
+    free(obj.name);
+    free(data);
+    return -1;
+  }
+
+  strcpy(obj.name, name);
+  ld->objects[ld->count++] = obj;
+
+  return 0;
+}
+
+
+static uint32_t evmldLoadWord(const uint8_t *data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+
+static const char *evmldString(const evm_object_t *obj, uint32_t offset) {
+  return &obj->strings[offset];
+}
+
+
+static int evmldCompareOutputs(const void *lhs, const void *rhs) {
+  const evm_output_t *a = (const evm_output_t *) lhs, *b = (const evm_output_t *) rhs;
+
+  if(a->base != b->base) {
+    return a->base < b->base ? -1 : 1;
+  }
+
+  return a->order < b->order ? -1 : a->order > b->order;
+}
+
+
+static int evmldCompareDefinitions(const void *lhs, const void *rhs) {
+  return strcmp(((const evm_definition_t *) lhs)->name, ((const evm_definition_t *) rhs)->name);
+}
@@ -0,0 +1,1303 @@
+#define EVM_IMPL
+
+#include "evm.h"
+#include "evm/decode.h"
+#include "evm/opcodes.h"
+#include "evm/reg.h"
+#if EVM_TRACE_SUPPORT == 1
+#  include "evm/trace.h"
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#if EVM_REGISTER_SUPPORT == 1
+
+#define EVM_REG_NONE    0xFFFFFFFFU
+#define EVM_REG_NOWHERE INT16_MIN
+#define EVM_REG_NO_ID   0xFFFFU
+#define EVM_REG_DEPTH   32  // furthest a block reaches from the stack pointer it starts at
+#define EVM_REG_TEMPS   (2 * EVM_REG_DEPTH + 2) // every live value and one more to break a cycle
+#define EVM_REG_SLOTS   (2 * EVM_REG_DEPTH + EVM_REG_TEMPS)
+#define EVM_REG_LENGTH  128 // instructions in a block
+#define EVM_REG_SHORT   4   // blocks shorter than this are left in a stretch run by the stack interpreter
+#define EVM_REG_VALUES  (EVM_REG_DEPTH + EVM_REG_LENGTH) // values on entry then results
+
+// a binary operation reading both operands from slots, B from imm and A from imm
+#define EVM_REG_FORMS(NAME) NAME, NAME##_RK, NAME##_KR
+
+#define EVM_REG_AT(ST, POS)    (&(ST)->stack[(POS) + EVM_REG_DEPTH])
+#define EVM_REG_REFS(ST, SLOT) ((ST)->refs[(SLOT) + EVM_REG_DEPTH])
+#define EVM_REG_F(IDX)         (*(float *) &R[IDX])
+
+
+typedef enum evm_reg_opcode_e {
+  ROP_MOV = 0, // R[dst] = R[a]
+  ROP_LOADK,   // R[dst] = imm
+  ROP_INC_I,   // R[dst] = f(R[a])
+  ROP_DEC_I,
+  ROP_ABS_I,
+  ROP_NEG_I,
+  ROP_INV,
+  ROP_BOOL,
+  ROP_NOT,
+  ROP_TRUNC,   // with the mask in imm
+  ROP_SIGNEXT, // with the shift in imm
+#if EVM_FLOAT_SUPPORT == 1
+  ROP_INC_F,
+  ROP_DEC_F,
+  ROP_ABS_F,
+  ROP_NEG_F,
+  ROP_CONV_FI,
+  ROP_CONV_IF,
+#endif
+  EVM_REG_FORMS(ROP_ADD_I), // R[dst] = A op B
+  EVM_REG_FORMS(ROP_SUB_I),
+  EVM_REG_FORMS(ROP_MUL_I),
+  EVM_REG_FORMS(ROP_DIV_I),
+  EVM_REG_FORMS(ROP_LSH),
+  EVM_REG_FORMS(ROP_RSH),
+  EVM_REG_FORMS(ROP_AND),
+  EVM_REG_FORMS(ROP_OR),
+  EVM_REG_FORMS(ROP_XOR),
+  EVM_REG_FORMS(ROP_CMP_I), // flags = A compared to B
+#if EVM_FLOAT_SUPPORT == 1
+  EVM_REG_FORMS(ROP_ADD_F),
+  EVM_REG_FORMS(ROP_SUB_F),
+  EVM_REG_FORMS(ROP_MUL_F),
+  EVM_REG_FORMS(ROP_DIV_F),
+  EVM_REG_FORMS(ROP_CMP_F),
+#endif
+  ROP_JMP,      // leave for block target, every exit moves the stack pointer by b
+  ROP_BRANCH,   // leave for block target when any of the flags in imm is set, next otherwise
+  ROP_CALL,     // R[dst] = imm, the return address, and leave for block target
+  ROP_RET,      // leave for the address in R[a]
+  ROP_RET_MOVE, // leave for the address in R[a] after R[dst] = R[imm]
+  ROP_HALT,     // halt at the offset in imm
+} evm_reg_opcode_t;
+
+
+typedef struct evm_reg_op_s {
+  union {
+    int32_t i;
+#if EVM_FLOAT_SUPPORT == 1
+    float   f;
+#endif
+  }        imm;
+  uint32_t target; // block index, the bytecode offset until the program is linked
+  uint32_t next;
+  int16_t  dst;    // slots, relative to the stack pointer the block was entered at
+  int16_t  a;
+  int16_t  b;
+  uint8_t  op;     // evm_reg_opcode_t
+} evm_reg_op_t;
+
+
+typedef struct evm_reg_block_s {
+  uint32_t start; // offset of the first instruction
+  uint32_t last;  // offset of the last one, only kept for a stretch left to the stack interpreter
+  uint32_t ops;   // first op, EVM_REG_NONE when the stack interpreter runs the instructions
+  uint16_t count; // instructions the block stands for
+  uint16_t below; // values it reads from the stack it is entered with
+  uint16_t above; // room it needs above the stack pointer it is entered at
+} evm_reg_block_t;
+
+
+struct evm_reg_code_s {
+  evm_reg_block_t *blocks; // in ascending order of offset
+  evm_reg_op_t    *ops;
+  uint32_t         count;
+  uint32_t         opCount;
+  uint32_t         blockCapacity;
+  uint32_t         opCapacity;
+};
+
+
+// what a position of the simulated stack holds
+typedef struct evm_reg_value_s {
+  int32_t  value;    // the slot holding it or the constant itself
+  uint16_t id;       // numbered the same way by both passes over a block
+  uint8_t  constant;
+} evm_reg_value_t;
+
+
+// a block is simulated twice, first to find its end and where its values have to be left and
+// then to generate code that computes them there whenever the slot is free
+typedef struct evm_reg_state_s {
+  evm_reg_value_t stack[2 * EVM_REG_DEPTH]; // by position, zero is the entry stack pointer
+  evm_reg_value_t held;                     // return address taken off the stack by a RET
+  evm_reg_op_t    scratch;                  // where the first pass emits
+  int16_t         home[EVM_REG_VALUES];     // position each value leaves the block in
+  uint16_t        refs[EVM_REG_SLOTS];      // values read from each slot
+  int32_t         low;                      // deepest position read
+  int32_t         height;
+  int32_t         pushed;                   // highest height anything was pushed at
+  int32_t         top;                      // highest slot written
+  int32_t         temps;                    // first slot above every position
+  uint16_t        results;
+  uint8_t         emit;
+  uint8_t         holding;
+} evm_reg_state_t;
+
+
+static int             evmregSupported(uint8_t);
+static uint32_t        evmregLowerBound(const evm_reg_code_t *, uint32_t);
+static uint32_t        evmregFindBlock(const evm_reg_code_t *, uint32_t);
+static evm_reg_block_t *evmregAddBlock(evm_reg_code_t *, uint32_t);
+static evm_reg_op_t   *evmregEmit(evm_reg_code_t *, evm_reg_state_t *, uint8_t, int32_t, int32_t,
+                                  int32_t, int32_t);
+static void            evmregReset(evm_reg_state_t *, int);
+static int             evmregReach(evm_reg_state_t *, uint32_t);
+static void            evmregDrop(evm_reg_state_t *, const evm_reg_value_t *);
+static int             evmregPush(evm_reg_state_t *, evm_reg_value_t);
+static evm_reg_value_t evmregConstant(int32_t);
+static void            evmregRemove(evm_reg_state_t *, int32_t, int32_t);
+static int32_t         evmregPlace(evm_reg_state_t *, uint16_t, int32_t);
+static int             evmregUnary(evm_reg_code_t *, evm_reg_state_t *, uint8_t, int32_t, int32_t);
+static int             evmregBinary(evm_reg_code_t *, evm_reg_state_t *, uint8_t);
+static int             evmregCompare(evm_reg_code_t *, evm_reg_state_t *, uint8_t, evm_reg_value_t,
+                                     evm_reg_value_t);
+static int             evmregStep(evm_reg_code_t *, evm_reg_state_t *, const evm_decoded_t *);
+static int             evmregFlush(evm_reg_code_t *, evm_reg_state_t *);
+static int             evmregLeave(evm_reg_code_t *, evm_reg_state_t *, const uint8_t *,
+                                    const evm_decoded_t *);
+static int             evmregJoin(evm_reg_code_t *, const uint8_t *, const uint8_t *, uint32_t,
+                                   uint32_t, uint32_t);
+static int             evmregBlock(evm_reg_code_t *, const uint8_t *, const uint8_t *, uint32_t,
+                                   uint32_t, uint32_t *);
+static int             evmregLink(evm_reg_code_t *);
+static uint32_t        evmregExecute(evm_t *, const evm_reg_code_t *, const evm_reg_block_t *);
+#if EVM_FLOAT_SUPPORT == 1
+static int32_t         evmregFloatBits(float);
+#endif
+
+
+evm_reg_code_t *evmregTranslate(const uint8_t *bin, uint32_t length) {
+  evm_reg_code_t *code;
+  evm_decoded_t decoded;
+  uint8_t *leaders;
+  uint32_t offset = 0, idx, translated = 0;
+
+  if(!bin || !length) {
+    return NULL;
+  }
+
+  code = (evm_reg_code_t *) calloc(1, sizeof(evm_reg_code_t));
+  leaders = (uint8_t *) calloc((length + 7U) / 8U, sizeof(uint8_t));
+  if(!code || !leaders) {
+    free(leaders);
+    evmregFree(code);
+    return NULL;
+  }
+
+  // every branch target starts a block
+  memset(&decoded, 0, sizeof(decoded));
+  while(evmDecodeNext(bin, length, &decoded) == 1) {
+    if(decoded.branch == EVM_BRANCH_JUMP || decoded.branch == EVM_BRANCH_COND ||
+       decoded.branch == EVM_BRANCH_CALL) {
+      if(decoded.target < length) {
+        leaders[decoded.target >> 3] |= (uint8_t) (1U << (decoded.target & 7U));
+      }
+    }
+    else if(decoded.branch == EVM_BRANCH_TABLE) {
+      for(idx = 0; idx < decoded.entries; ++idx) {
+        uint32_t target = evmDecodeTableTarget(&decoded, idx);
+
+        if(target < length) {
+          leaders[target >> 3] |= (uint8_t) (1U << (target & 7U));
+        }
+      }
+    }
+  }
+
+  // and every block starts where the one before it stopped
+  while(offset < length) {
+    if(evmregBlock(code, leaders, bin, length, offset, &offset)) {
+      free(leaders);
+      evmregFree(code);
+      return NULL;
+    }
+  }
+
+  free(leaders);
+
+  for(idx = 0; idx < code->count; ++idx) {
+    translated += code->blocks[idx].ops != EVM_REG_NONE;
+  }
+
+  if(!translated || evmregLink(code)) {
+    evmregFree(code);
+    return NULL;
+  }
+
+  EVM_DEBUGF("Translated %u of %u blocks into %u ops", translated, code->count, code->opCount);
+  return code;
+}
+
+
+void evmregFree(evm_reg_code_t *code) {
+  if(code) {
+    free(code->blocks);
+    free(code->ops);
+    free(code);
+  }
+}
+
+
+int evmregRun(evm_t *vm, uint32_t maxOps) {
+  EVM_TRACEF("Enter %s", __FUNCTION__);
+  if(vm && vm->program && vm->regs) {
+    const evm_reg_code_t *code = vm->regs;
+    evm_t local = *vm; // copy the state back to a local eVM
+    uint32_t ops = 0, block;
+
+    local.flags &= ~EVM_YIELD; // clear the yield flag if it is set
+    EVM_DEBUGF("Running VM for %u operations", maxOps);
+    block = evmregFindBlock(code, local.ip);
+    while(ops < maxOps && (local.flags & (EVM_HALTED | EVM_YIELD)) == 0) {
+      const evm_reg_block_t *b = block != EVM_REG_NONE ? &code->blocks[block] : NULL;
+
+      // a block only runs as a whole when the stack interpreter would neither fault nor stop
+      // part of the way through it
+      if(b && b->ops != EVM_REG_NONE && local.sp >= b->below &&
+         (uint32_t) local.sp + b->above < local.maxStack && b->count <= maxOps - ops) {
+        EVM_TRACEF("%08X: BLOCK %u", local.ip, block);
+        ops += b->count;
+        block = evmregExecute(&local, code, b);
+      }
+      else {
+        // an untranslated stretch runs in one go, anything else an instruction at a time
+        const int stretch = b && b->ops == EVM_REG_NONE;
+        const uint32_t room = maxOps - ops;
+        const uint32_t steps = !stretch ? 1U : b->count < room ? b->count : room;
+#if EVM_TRACE_SUPPORT == 1
+        const uint32_t from = stretch ? b->last : local.ip;
+        const uint8_t branch = EVM_OPCODE_INFO[local.program[from]].branch;
+#endif
+        ops += steps;
+        (void) evmRunStack(&local, steps);
+#if EVM_TRACE_SUPPORT == 1
+        // a loop whose backward jump the register code couldn't run is left to its trace,
+        // entered the way the stack interpreter enters it
+        if((branch == EVM_BRANCH_JUMP || branch == EVM_BRANCH_COND) && local.ip < from &&
+           ops < maxOps && !(local.flags & (EVM_HALTED | EVM_YIELD))) {
+          ops += evmtraceLoop(&local, maxOps - ops);
+        }
+#endif
+        block = evmregFindBlock(code, local.ip);
+      }
+    }
+    EVM_DEBUGF("Performed %u of %u VM operations", ops, maxOps);
+
+    *vm = local; // copy the state back to the canonical eVM
+    EVM_TRACEF("Exit %s", __FUNCTION__);
+    return !!(local.flags & EVM_HALTED);
+  }
+
+  EVM_TRACEF("Exit %s", __FUNCTION__);
+  return -1;
+}
+
+
+static int evmregSupported(uint8_t opcode) {
+  switch(opcode) {
+    case OP_NOP:
+    case OP_CALL:
+    case OP_LCALL:
+    case OP_HALT:
+    case OP_PUSH_I0:
+    case OP_PUSH_I1:
+    case OP_PUSH_IN1:
+    case OP_PUSH_8I:
+    case OP_PUSH_16I:
+    case OP_PUSH_24I:
+    case OP_PUSH_32I:
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_PUSH_F0:
+    case OP_PUSH_F1:
+    case OP_PUSH_FN1:
+    case OP_PUSH_F:
+#endif
+    case OP_SWAP:
+    case OP_INC_I:
+    case OP_DEC_I:
+    case OP_ABS_I:
+    case OP_NEG_I:
+    case OP_ADD_I:
+    case OP_SUB_I:
+    case OP_MUL_I:
+    case OP_DIV_I:
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_INC_F:
+    case OP_DEC_F:
+    case OP_ABS_F:
+    case OP_NEG_F:
+    case OP_ADD_F:
+    case OP_SUB_F:
+    case OP_MUL_F:
+    case OP_DIV_F:
+#endif
+    case OP_LSH:
+    case OP_RSH:
+    case OP_AND:
+    case OP_OR:
+    case OP_XOR:
+    case OP_INV:
+    case OP_BOOL:
+    case OP_NOT:
+    case OP_TRUNC:
+    case OP_SIGNEXT:
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_CONV_FI:
+    case OP_CONV_FI_1:
+    case OP_CONV_IF:
+    case OP_CONV_IF_1:
+#endif
+    case OP_CMP_I0:
+    case OP_CMP_I1:
+    case OP_CMP_IN1:
+    case OP_CMP_I:
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_CMP_F0:
+    case OP_CMP_F1:
+    case OP_CMP_FN1:
+    case OP_CMP_F:
+#endif
+    case OP_JMP:
+    case OP_JLT:
+    case OP_JLE:
+    case OP_JNE:
+    case OP_JEQ:
+    case OP_JGE:
+    case OP_JGT:
+    case OP_LJMP:
+    case OP_LJLT:
+    case OP_LJLE:
+    case OP_LJNE:
+    case OP_LJEQ:
+    case OP_LJGE:
+    case OP_LJGT:
+    case OP_RET_I:
+    case OP_ADD_8I:
+    case OP_SUB_8I:
+    case OP_MUL_8I:
+    case OP_AND_8I:
+    case OP_LSH_8I:
+    case OP_JCMP_8I:
+    case OP_DJNZ:
+    case OP_ADD_16I:
+    case OP_SUB_16I:
+    case OP_MUL_16I:
+    case OP_AND_16I:
+    case OP_LJCMP_8I:
+    case OP_LDJNZ:
+      return 1;
+
+    default:
+      // pops, removes, dups and returns come in runs of opcodes
+      return (opcode >= OP_POP_1 && opcode <= OP_REM_R) ||
+             (opcode >= OP_DUP_0 && opcode <= OP_DUP_15) ||
+             (opcode >= OP_RET && opcode <= OP_RET_14);
+  }
+}
+
+
+static uint32_t evmregLowerBound(const evm_reg_code_t *code, uint32_t offset) {
+  uint32_t lo = 0, hi = code->count;
+
+  while(lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2U;
+
+    if(code->blocks[mid].start < offset) {
+      lo = mid + 1U;
+    }
+    else {
+      hi = mid;
+    }
+  }
+
+  return lo;
+}
+
+
+static uint32_t evmregFindBlock(const evm_reg_code_t *code, uint32_t offset) {
+  uint32_t idx = evmregLowerBound(code, offset);
+
+  return idx < code->count && code->blocks[idx].start == offset ? idx : EVM_REG_NONE;
+}
+
+
+// a block the stack interpreter runs until it's translated
+static evm_reg_block_t *evmregAddBlock(evm_reg_code_t *code, uint32_t start) {
+  uint32_t at = evmregLowerBound(code, start);
+
+  if(code->count == code->blockCapacity) {
+    uint32_t capacity = code->blockCapacity ? code->blockCapacity * 2U : 64U;
+    evm_reg_block_t *blocks = realloc(code->blocks, capacity * sizeof(evm_reg_block_t));
+
+    if(!blocks) {
+      return NULL;
+    }
+
+    code->blocks = blocks;
+    code->blockCapacity = capacity;
+  }
+
+  memmove(&code->blocks[at + 1U], &code->blocks[at], (code->count - at) * sizeof(evm_reg_block_t));
+  memset(&code->blocks[at], 0, sizeof(evm_reg_block_t));
+  code->blocks[at].start = start;
+  code->blocks[at].ops = EVM_REG_NONE;
+  ++code->count;
+
+  return &code->blocks[at];
+}
+
+
+static evm_reg_op_t *evmregEmit(evm_reg_code_t *code, evm_reg_state_t *st, uint8_t opcode,
+                                int32_t dst, int32_t a, int32_t b, int32_t imm) {
+  evm_reg_op_t *op = &st->scratch;
+
+  if(st->emit) {
+    if(code->opCount == code->opCapacity) {
+      uint32_t capacity = code->opCapacity ? code->opCapacity * 2U : 256U;
+      evm_reg_op_t *ops = realloc(code->ops, capacity * sizeof(evm_reg_op_t));
+
+      if(!ops) {
+        return NULL;
+      }
+
+      code->ops = ops;
+      code->opCapacity = capacity;
+    }
+
+    op = &code->ops[code->opCount++];
+  }
+
+  op->imm.i = imm;
+  op->target = EVM_REG_NONE;
+  op->next = EVM_REG_NONE;
+  op->dst = (int16_t) dst;
+  op->a = (int16_t) a;
+  op->b = (int16_t) b;
+  op->op = opcode;
+
+  if(dst != EVM_REG_NOWHERE && dst > st->top) {
+    st->top = dst;
+  }
+
+  return op;
+}
+
+
+static void evmregReset(evm_reg_state_t *st, int emit) {
+  uint32_t idx;
+
+  memset(st, 0, sizeof(evm_reg_state_t));
+  for(idx = 0; idx < EVM_REG_VALUES; ++idx) {
+    st->home[idx] = EVM_REG_NOWHERE;
+  }
+
+  st->pushed = -1;
+  st->temps = EVM_REG_DEPTH;
+  st->emit = (uint8_t) emit;
+}
+
+
+// make the values down to the given depth known, each still in the slot it was entered in
+static int evmregReach(evm_reg_state_t *st, uint32_t depth) {
+  int32_t bottom = st->height - (int32_t) depth;
+
+  if(bottom < -EVM_REG_DEPTH) {
+    return -1;
+  }
+
+  while(st->low > bottom) {
+    evm_reg_value_t *v = EVM_REG_AT(st, --st->low);
+
+    v->value = st->low;
+    v->id = (uint16_t) (st->low + EVM_REG_DEPTH);
+    v->constant = 0;
+    ++EVM_REG_REFS(st, st->low);
+  }
+
+  return 0;
+}
+
+
+static void evmregDrop(evm_reg_state_t *st, const evm_reg_value_t *v) {
+  if(!v->constant) {
+    --EVM_REG_REFS(st, v->value);
+  }
+}
+
+
+static int evmregPush(evm_reg_state_t *st, evm_reg_value_t v) {
+  if(st->height >= EVM_REG_DEPTH) {
+    return -1;
+  }
+
+  if(st->height > st->pushed) {
+    st->pushed = st->height;
+  }
+
+  if(!v.constant) {
+    ++EVM_REG_REFS(st, v.value);
+  }
+
+  *EVM_REG_AT(st, st->height++) = v;
+
+  return 0;
+}
+
+
+static evm_reg_value_t evmregConstant(int32_t constant) {
+  evm_reg_value_t v;
+
+  v.value = constant;
+  v.id = EVM_REG_NO_ID;
+  v.constant = 1;
+
+  return v;
+}
+
+
+// drop count values from below the top depth values
+static void evmregRemove(evm_reg_state_t *st, int32_t depth, int32_t count) {
+  int32_t pos;
+
+  for(pos = st->height - depth - count; pos < st->height - depth; ++pos) {
+    evmregDrop(st, EVM_REG_AT(st, pos));
+  }
+
+  memmove(EVM_REG_AT(st, st->height - depth - count), EVM_REG_AT(st, st->height - depth),
+          (size_t) depth * sizeof(evm_reg_value_t));
+  st->height -= count;
+}
+
+
+// the slot a new value is computed into, where it leaves the block if that is free
+static int32_t evmregPlace(evm_reg_state_t *st, uint16_t id, int32_t pos) {
+  int32_t slot = id != EVM_REG_NO_ID ? st->home[id] : EVM_REG_NOWHERE;
+
+  if(slot != EVM_REG_NOWHERE && !EVM_REG_REFS(st, slot)) {
+    return slot;
+  }
+
+  if(pos != EVM_REG_NOWHERE && !EVM_REG_REFS(st, pos)) {
+    return pos;
+  }
+
+  for(slot = st->temps; slot < EVM_REG_DEPTH + EVM_REG_TEMPS; ++slot) {
+    if(!EVM_REG_REFS(st, slot)) {
+      return slot;
+    }
+  }
+
+  return EVM_REG_NOWHERE;
+}
+
+
+// replace the value at a position with a function of it
+static int evmregUnary(evm_reg_code_t *code, evm_reg_state_t *st, uint8_t opcode, int32_t pos,
+                       int32_t imm) {
+  evm_reg_value_t *v = EVM_REG_AT(st, pos);
+  int32_t slot, source = v->value;
+
+  evmregDrop(st, v);
+  v->id = (uint16_t) (EVM_REG_DEPTH + st->results++);
+  if((slot = evmregPlace(st, v->id, pos)) == EVM_REG_NOWHERE) {
+    return -1;
+  }
+
+  if(v->constant && !evmregEmit(code, st, ROP_LOADK, slot, EVM_REG_NOWHERE, EVM_REG_NOWHERE,
+                                v->value)) {
+    return -1;
+  }
+
+  if(!evmregEmit(code, st, opcode, slot, v->constant ? slot : source, EVM_REG_NOWHERE, imm)) {
+    return -1;
+  }
+
+  v->value = slot;
+  v->constant = 0;
+  ++EVM_REG_REFS(st, slot);
+
+  return 0;
+}
+
+
+// replace the top two values with the top combined with the second
+static int evmregBinary(evm_reg_code_t *code, evm_reg_state_t *st, uint8_t opcode) {
+  evm_reg_value_t lhs = *EVM_REG_AT(st, st->height - 1);
+  evm_reg_value_t rhs = *EVM_REG_AT(st, st->height - 2);
+  evm_reg_value_t *v = EVM_REG_AT(st, st->height - 2);
+  evm_reg_op_t *op;
+  int32_t slot;
+
+  evmregDrop(st, &lhs);
+  evmregDrop(st, &rhs);
+  --st->height;
+
+  v->id = (uint16_t) (EVM_REG_DEPTH + st->results++);
+  if((slot = evmregPlace(st, v->id, st->height - 1)) == EVM_REG_NOWHERE) {
+    return -1;
+  }
+
+  if(lhs.constant && rhs.constant) {
+    // compute into the slot starting from the second value
+    if(!evmregEmit(code, st, ROP_LOADK, slot, EVM_REG_NOWHERE, EVM_REG_NOWHERE, rhs.value)) {
+      return -1;
+    }
+
+    rhs.value = slot;
+    rhs.constant = 0;
+  }
+
+  if(lhs.constant) {
+    op = evmregEmit(code, st, opcode + 2U, slot, EVM_REG_NOWHERE, rhs.value, lhs.value);
+  }
+  else if(rhs.constant) {
+    op = evmregEmit(code, st, opcode + 1U, slot, lhs.value, EVM_REG_NOWHERE, rhs.value);
+  }
+  else {
+    op = evmregEmit(code, st, opcode, slot, lhs.value, rhs.value, 0);
+  }
+
+  if(!op) {
+    return -1;
+  }
+
+  v->value = slot;
+  v->constant = 0;
+  ++EVM_REG_REFS(st, slot);
+
+  return 0;
+}
+
+
+// set the flags from comparing the top of the stack with a constant or the value below it
+static int evmregCompare(evm_reg_code_t *code, evm_reg_state_t *st, uint8_t opcode,
+                         evm_reg_value_t lhs, evm_reg_value_t rhs) {
+  int32_t slot;
+
+  if(lhs.constant && rhs.constant) {
+    if((slot = evmregPlace(st, EVM_REG_NO_ID, EVM_REG_NOWHERE)) == EVM_REG_NOWHERE ||
+       !evmregEmit(code, st, ROP_LOADK, slot, EVM_REG_NOWHERE, EVM_REG_NOWHERE, rhs.value)) {
+      return -1;
+    }
+
+    rhs.value = slot;
+    rhs.constant = 0;
+  }
+
+  if(lhs.constant) {
+    return evmregEmit(code, st, opcode + 2U, EVM_REG_NOWHERE, EVM_REG_NOWHERE, rhs.value,
+                      lhs.value) ? 0 : -1;
+  }
+
+  if(rhs.constant) {
+    return evmregEmit(code, st, opcode + 1U, EVM_REG_NOWHERE, lhs.value, EVM_REG_NOWHERE,
+                      rhs.value) ? 0 : -1;
+  }
+
+  return evmregEmit(code, st, opcode, EVM_REG_NOWHERE, lhs.value, rhs.value, 0) ? 0 : -1;
+}
+
+
+// apply an instruction to the simulated stack, -1 when it reaches further than a block tracks
+// which leaves the state untouched
+static int evmregStep(evm_reg_code_t *code, evm_reg_state_t *st, const evm_decoded_t *ins) {
+  const int32_t h = st->height;
+
+  if(h - (int32_t) ins->pops + (int32_t) ins->pushes > EVM_REG_DEPTH ||
+     evmregReach(st, ins->pops)) {
+    return -1;
+  }
+
+  switch(ins->opcode) {
+    case OP_PUSH_I0:  return evmregPush(st, evmregConstant(0));
+    case OP_PUSH_I1:  return evmregPush(st, evmregConstant(1));
+    case OP_PUSH_IN1: return evmregPush(st, evmregConstant(-1));
+    case OP_PUSH_8I:
+    case OP_PUSH_16I:
+    case OP_PUSH_24I:
+    case OP_PUSH_32I:
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_PUSH_F:
+#endif
+      return evmregPush(st, evmregConstant(ins->operand.i32));
+
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_PUSH_F0:  return evmregPush(st, evmregConstant(evmregFloatBits(0.0f)));
+    case OP_PUSH_F1:  return evmregPush(st, evmregConstant(evmregFloatBits(1.0f)));
+    case OP_PUSH_FN1: return evmregPush(st, evmregConstant(evmregFloatBits(-1.0f)));
+#endif
+
+    case OP_SWAP: {
+      evm_reg_value_t tmp = *EVM_REG_AT(st, h - 1);
+      *EVM_REG_AT(st, h - 1) = *EVM_REG_AT(st, h - 2);
+      *EVM_REG_AT(st, h - 2) = tmp;
+    } return 0;
+
+    case OP_REM_R:
+      evmregRemove(st, (int32_t) (ins->operand.u32 >> 4) + 1,
+                   (int32_t) (ins->operand.u32 & 0x0FU) + 1);
+    return 0;
+
+    case OP_INC_I:   return evmregUnary(code, st, ROP_INC_I, h - 1, 0);
+    case OP_DEC_I:   return evmregUnary(code, st, ROP_DEC_I, h - 1, 0);
+    case OP_ABS_I:   return evmregUnary(code, st, ROP_ABS_I, h - 1, 0);
+    case OP_NEG_I:   return evmregUnary(code, st, ROP_NEG_I, h - 1, 0);
+    case OP_INV:     return evmregUnary(code, st, ROP_INV, h - 1, 0);
+    case OP_BOOL:    return evmregUnary(code, st, ROP_BOOL, h - 1, 0);
+    case OP_NOT:     return evmregUnary(code, st, ROP_NOT, h - 1, 0);
+    case OP_TRUNC:
+      return evmregUnary(code, st, ROP_TRUNC, h - 1,
+                         (int32_t) (0xFFFFFFFFU >> (32 - (ins->operand.u32 & 0x1F))));
+    case OP_SIGNEXT:
+      return evmregUnary(code, st, ROP_SIGNEXT, h - 1, (int32_t) (ins->operand.u32 & 0x1F));
+
+    case OP_ADD_I:   return evmregBinary(code, st, ROP_ADD_I);
+    case OP_SUB_I:   return evmregBinary(code, st, ROP_SUB_I);
+    case OP_MUL_I:   return evmregBinary(code, st, ROP_MUL_I);
+    case OP_DIV_I:   return evmregBinary(code, st, ROP_DIV_I);
+    case OP_LSH:     return evmregBinary(code, st, ROP_LSH);
+    case OP_RSH:     return evmregBinary(code, st, ROP_RSH);
+    case OP_AND:     return evmregBinary(code, st, ROP_AND);
+    case OP_OR:      return evmregBinary(code, st, ROP_OR);
+    case OP_XOR:     return evmregBinary(code, st, ROP_XOR);
+
+    case OP_CMP_I0:
+      return evmregCompare(code, st, ROP_CMP_I, *EVM_REG_AT(st, h - 1), evmregConstant(0));
+    case OP_CMP_I1:
+      return evmregCompare(code, st, ROP_CMP_I, *EVM_REG_AT(st, h - 1), evmregConstant(1));
+    case OP_CMP_IN1:
+      return evmregCompare(code, st, ROP_CMP_I, *EVM_REG_AT(st, h - 1), evmregConstant(-1));
+    case OP_CMP_I:
+      return evmregCompare(code, st, ROP_CMP_I, *EVM_REG_AT(st, h - 1), *EVM_REG_AT(st, h - 2));
+
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_INC_F:     return evmregUnary(code, st, ROP_INC_F, h - 1, 0);
+    case OP_DEC_F:     return evmregUnary(code, st, ROP_DEC_F, h - 1, 0);
+    case OP_ABS_F:     return evmregUnary(code, st, ROP_ABS_F, h - 1, 0);
+    case OP_NEG_F:     return evmregUnary(code, st, ROP_NEG_F, h - 1, 0);
+    case OP_CONV_FI:   return evmregUnary(code, st, ROP_CONV_FI, h - 1, 0);
+    case OP_CONV_FI_1: return evmregUnary(code, st, ROP_CONV_FI, h - 2, 0);
+    case OP_CONV_IF:   return evmregUnary(code, st, ROP_CONV_IF, h - 1, 0);
+    case OP_CONV_IF_1: return evmregUnary(code, st, ROP_CONV_IF, h - 2, 0);
+
+    case OP_ADD_F:   return evmregBinary(code, st, ROP_ADD_F);
+    case OP_SUB_F:   return evmregBinary(code, st, ROP_SUB_F);
+    case OP_MUL_F:   return evmregBinary(code, st, ROP_MUL_F);
+    case OP_DIV_F:   return evmregBinary(code, st, ROP_DIV_F);
+
+    case OP_CMP_F0:
+      return evmregCompare(code, st, ROP_CMP_F, *EVM_REG_AT(st, h - 1),
+                           evmregConstant(evmregFloatBits(0.0f)));
+    case OP_CMP_F1:
+      return evmregCompare(code, st, ROP_CMP_F, *EVM_REG_AT(st, h - 1),
+                           evmregConstant(evmregFloatBits(1.0f)));
+    case OP_CMP_FN1:
+      return evmregCompare(code, st, ROP_CMP_F, *EVM_REG_AT(st, h - 1),
+                           evmregConstant(evmregFloatBits(-1.0f)));
+    case OP_CMP_F:
+      return evmregCompare(code, st, ROP_CMP_F, *EVM_REG_AT(st, h - 1), *EVM_REG_AT(st, h - 2));
+#endif
+
+    case OP_ADD_8I:
+    case OP_ADD_16I: return evmregUnary(code, st, ROP_ADD_I_RK, h - 1, ins->operand.i32);
+    case OP_SUB_8I:
+    case OP_SUB_16I: return evmregUnary(code, st, ROP_SUB_I_RK, h - 1, ins->operand.i32);
+    case OP_MUL_8I:
+    case OP_MUL_16I: return evmregUnary(code, st, ROP_MUL_I_RK, h - 1, ins->operand.i32);
+    case OP_AND_8I:
+    case OP_AND_16I: return evmregUnary(code, st, ROP_AND_RK, h - 1, ins->operand.i32);
+    case OP_LSH_8I:
+      return evmregUnary(code, st, ROP_LSH_RK, h - 1, (int32_t) (ins->operand.u32 & 0x1F));
+
+    case OP_JCMP_8I:
+    case OP_LJCMP_8I:
+      return evmregCompare(code, st, ROP_CMP_I, *EVM_REG_AT(st, h - 1),
+                           evmregConstant(ins->operand.i32));
+    case OP_DJNZ:
+    case OP_LDJNZ:
+      if(evmregUnary(code, st, ROP_DEC_I, h - 1, 0)) {
+        return -1;
+      }
+      return evmregCompare(code, st, ROP_CMP_I, *EVM_REG_AT(st, h - 1), evmregConstant(0));
+
+    case OP_CALL:
+    case OP_LCALL:
+      return evmregPush(st, evmregConstant((int32_t) ins->next));
+
+    default:
+      break;
+  }
+
+  if(ins->opcode >= OP_POP_1 && ins->opcode <= OP_POP_8) {
+    evmregRemove(st, 0, ins->opcode - OP_POP_1 + 1);
+  }
+  else if(ins->opcode >= OP_REM_1 && ins->opcode <= OP_REM_7) {
+    evmregRemove(st, ins->opcode - OP_REM_1 + 1, 1);
+  }
+  else if(ins->opcode >= OP_DUP_0 && ins->opcode <= OP_DUP_15) {
+    return evmregPush(st, *EVM_REG_AT(st, h - 1 - (ins->opcode - OP_DUP_0)));
+  }
+  else if(ins->branch == EVM_BRANCH_RETURN) {
+    // keep reading the return address from where it is until the block is left
+    st->held = *EVM_REG_AT(st, h - (int32_t) ins->pops);
+    st->holding = 1;
+    memmove(EVM_REG_AT(st, h - (int32_t) ins->pops), EVM_REG_AT(st, h - (int32_t) ins->pushes),
+            ins->pushes * sizeof(evm_reg_value_t));
+    --st->height;
+  }
+
+  return 0; // NOP and the remaining branches leave the stack alone
+}
+
+
+// move every value to its position, the stack is exact from here on
+static int evmregFlush(evm_reg_code_t *code, evm_reg_state_t *st) {
+  int32_t pos, slot, pending, progress;
+
+  for(;;) {
+    pending = EVM_REG_NOWHERE;
+    progress = 0;
+
+    for(pos = st->low; pos < st->height; ++pos) {
+      evm_reg_value_t *v = EVM_REG_AT(st, pos);
+
+      if(!v->constant && v->value == pos) {
+        continue;
+      }
+
+      if(EVM_REG_REFS(st, pos)) {
+        pending = pos; // another value still has to be read from the slot
+        continue;
+      }
+
+      if(!evmregEmit(code, st, v->constant ? ROP_LOADK : ROP_MOV, pos,
+                     v->constant ? EVM_REG_NOWHERE : v->value, EVM_REG_NOWHERE,
+                     v->constant ? v->value : 0)) {
+        return -1;
+      }
+
+      evmregDrop(st, v);
+      v->value = pos;
+      v->constant = 0;
+      ++EVM_REG_REFS(st, pos);
+      progress = 1;
+    }
+
+    if(pending == EVM_REG_NOWHERE) {
+      return 0;
+    }
+
+    if(!progress) {
+      // the moves left form a cycle, park the value in one of its slots elsewhere to break it
+      if((slot = evmregPlace(st, EVM_REG_NO_ID, EVM_REG_NOWHERE)) == EVM_REG_NOWHERE ||
+         !evmregEmit(code, st, ROP_MOV, slot, pending, EVM_REG_NOWHERE, 0)) {
+        return -1;
+      }
+
+      for(pos = st->low; pos < st->height; ++pos) {
+        evm_reg_value_t *v = EVM_REG_AT(st, pos);
+
+        if(!v->constant && v->value == pending) {
+          v->value = slot;
+        }
+      }
+
+      if(st->holding && !st->held.constant && st->held.value == pending) {
+        st->held.value = slot;
+      }
+
+      EVM_REG_REFS(st, slot) = EVM_REG_REFS(st, pending);
+      EVM_REG_REFS(st, pending) = 0;
+    }
+  }
+}
+
+
+// end the block with the instruction leaving it
+static int evmregLeave(evm_reg_code_t *code, evm_reg_state_t *st, const uint8_t *bin,
+                       const evm_decoded_t *ins) {
+  evm_reg_op_t *op = NULL;
+  int32_t pos, slot, pending = EVM_REG_NOWHERE, moves = 0;
+  uint32_t flags = 0;
+
+  switch(ins->opcode) {
+    case OP_JLT: case OP_LJLT: flags = EVM_LESS;                break;
+    case OP_JLE: case OP_LJLE: flags = EVM_LESS | EVM_EQUAL;    break;
+    case OP_JNE: case OP_LJNE: flags = EVM_LESS | EVM_GREATER;  break;
+    case OP_JEQ: case OP_LJEQ: flags = EVM_EQUAL;               break;
+    case OP_JGE: case OP_LJGE: flags = EVM_GREATER | EVM_EQUAL; break;
+    case OP_JGT: case OP_LJGT: flags = EVM_GREATER;             break;
+
+    // the compare and the count down were stepped through with the rest of the block
+    case OP_JCMP_8I: case OP_LJCMP_8I: flags = bin[ins->offset + 1U];   break;
+    case OP_DJNZ:    case OP_LDJNZ:    flags = EVM_LESS | EVM_GREATER; break;
+    default:
+      // not a conditional branch
+    break;
+  }
+
+  switch(ins->branch) {
+    case EVM_BRANCH_JUMP:
+      if(evmregFlush(code, st) ||
+         !(op = evmregEmit(code, st, ROP_JMP, EVM_REG_NOWHERE, EVM_REG_NOWHERE, st->height, 0))) {
+        return -1;
+      }
+      op->target = ins->target;
+    break;
+
+    case EVM_BRANCH_COND:
+      if(evmregFlush(code, st) ||
+         !(op = evmregEmit(code, st, ROP_BRANCH, EVM_REG_NOWHERE, EVM_REG_NOWHERE, st->height,
+                           (int32_t) flags))) {
+        return -1;
+      }
+      op->target = ins->target;
+      op->next = ins->next;
+    break;
+
+    case EVM_BRANCH_CALL:
+      --st->height; // the return address is written by the call itself
+      if(evmregFlush(code, st) ||
+         !(op = evmregEmit(code, st, ROP_CALL, st->height, EVM_REG_NOWHERE, st->height + 1,
+                           (int32_t) ins->next))) {
+        return -1;
+      }
+      op->target = ins->target;
+    break;
+
+    case EVM_BRANCH_RETURN:
+      if(st->held.constant) {
+        if((slot = evmregPlace(st, EVM_REG_NO_ID, EVM_REG_NOWHERE)) == EVM_REG_NOWHERE ||
+           !evmregEmit(code, st, ROP_LOADK, slot, EVM_REG_NOWHERE, EVM_REG_NOWHERE,
+                       st->held.value)) {
+          return -1;
+        }
+
+        st->held.value = slot;
+        st->held.constant = 0;
+        ++EVM_REG_REFS(st, slot);
+      }
+
+      for(pos = st->low; pos < st->height; ++pos) {
+        const evm_reg_value_t *v = EVM_REG_AT(st, pos);
+
+        if(v->constant || v->value != pos) {
+          pending = pos;
+          ++moves;
+        }
+      }
+
+      // a single value taking the place of the return address moves with the return
+      if(moves == 1 && pending == st->held.value && !EVM_REG_AT(st, pending)->constant &&
+         EVM_REG_REFS(st, pending) == 1) {
+        return evmregEmit(code, st, ROP_RET_MOVE, pending, st->held.value, st->height,
+                          EVM_REG_AT(st, pending)->value) ? 0 : -1;
+      }
+
+      if(evmregFlush(code, st)) {
+        return -1;
+      }
+
+      return evmregEmit(code, st, ROP_RET, EVM_REG_NOWHERE, st->held.value, st->height, 0) ? 0 : -1;
+
+    case EVM_BRANCH_HALT:
+      if(evmregFlush(code, st)) {
+        return -1;
+      }
+
+      return evmregEmit(code, st, ROP_HALT, EVM_REG_NOWHERE, EVM_REG_NOWHERE, st->height,
+                        (int32_t) ins->offset) ? 0 : -1;
+
+    default:
+      // ran into the next block
+      if(evmregFlush(code, st) ||
+         !(op = evmregEmit(code, st, ROP_JMP, EVM_REG_NOWHERE, EVM_REG_NOWHERE, st->height, 0))) {
+        return -1;
+      }
+      op->target = ins->next;
+    break;
+  }
+
+  return 0;
+}
+
+
+// the stretch the stack interpreter runs before start takes in the instructions from start to
+// last when it falls through into them, so it runs up to the next block in a single call
+static int evmregJoin(evm_reg_code_t *code, const uint8_t *leaders, const uint8_t *bin,
+                      uint32_t start, uint32_t last, uint32_t count) {
+  evm_reg_block_t *block = code->count ? &code->blocks[code->count - 1U] : NULL;
+
+  if(!block || block->ops != EVM_REG_NONE || block->count + count > UINT16_MAX ||
+     EVM_OPCODE_INFO[bin[block->last]].branch != EVM_BRANCH_NONE ||
+     (leaders[start >> 3] & (1U << (start & 7U)))) {
+    return 0;
+  }
+
+  block->count = (uint16_t) (block->count + count);
+  block->last = last;
+  return 1;
+}
+
+
+// translate the block at start, or leave it to the stack interpreter when its first instruction
+// can't be translated
+static int evmregBlock(evm_reg_code_t *code, const uint8_t *leaders, const uint8_t *bin,
+                       uint32_t length, uint32_t start, uint32_t *next) {
+  evm_decoded_t insts[EVM_REG_LENGTH], decoded;
+  evm_reg_state_t st;
+  evm_reg_block_t *block;
+  int16_t home[EVM_REG_VALUES];
+  uint32_t count = 0, idx;
+  int32_t low, pushed, pos;
+  int result = 0;
+
+  memset(&decoded, 0, sizeof(decoded));
+  decoded.next = start;
+  evmregReset(&st, 0);
+
+  // the block ends at a branch target, after a branch and before anything it can't translate
+  while(count < EVM_REG_LENGTH && (result = evmDecodeNext(bin, length, &decoded)) == 1) {
+    if((count && (leaders[decoded.offset >> 3] & (1U << (decoded.offset & 7U)))) ||
+       !evmregSupported(decoded.opcode) || evmregStep(code, &st, &decoded)) {
+      break;
+    }
+
+    insts[count++] = decoded;
+    if(decoded.branch != EVM_BRANCH_NONE) {
+      break;
+    }
+  }
+
+  if(!count) {
+    *next = result == 1 ? decoded.next : EVM_REG_NONE; // nothing follows an illegal instruction
+    if(result != 1 || evmregJoin(code, leaders, bin, start, start, 1U)) {
+      return 0;
+    }
+
+    if(!(block = evmregAddBlock(code, start))) {
+      return -1;
+    }
+    block->count = 1;
+    block->last = start;
+    return 0;
+  }
+
+  *next = insts[count - 1].next;
+  if(count < EVM_REG_SHORT && insts[count - 1].branch == EVM_BRANCH_NONE &&
+     evmregJoin(code, leaders, bin, start, insts[count - 1].offset, count)) {
+    return 0;
+  }
+  low = st.low;
+  pushed = st.pushed;
+
+  // the second pass computes values straight into the position they leave the block in
+  memcpy(home, st.home, sizeof(home));
+  for(pos = st.low; pos < st.height; ++pos) {
+    const evm_reg_value_t *v = EVM_REG_AT(&st, pos);
+
+    if(!v->constant && v->id >= EVM_REG_DEPTH && home[v->id] == EVM_REG_NOWHERE) {
+      home[v->id] = (int16_t) pos;
+    }
+  }
+
+  evmregReset(&st, 1);
+  memcpy(st.home, home, sizeof(home));
+  st.temps = pushed + 1 > 0 ? pushed + 1 : 0;
+  (void) evmregReach(&st, (uint32_t) -low);
+
+  if(!(block = evmregAddBlock(code, start))) {
+    return -1;
+  }
+
+  block->ops = code->opCount;
+  block->count = (uint16_t) count;
+  block->below = (uint16_t) -low;
+
+  for(idx = 0; idx < count; ++idx) {
+    if(evmregStep(code, &st, &insts[idx])) {
+      return -1;
+    }
+  }
+
+  if(evmregLeave(code, &st, bin, &insts[count - 1])) {
+    return -1;
+  }
+
+  block->above = (uint16_t) (st.top > pushed + 1 ? st.top : pushed + 1 > 0 ? pushed + 1 : 0);
+
+  return 0;
+}
+
+
+// point every branch at the index of its block, a branch into something left untranslated
+// lands on a block the stack interpreter runs
+static int evmregLink(evm_reg_code_t *code) {
+  uint32_t idx;
+
+  for(idx = 0; idx < code->opCount; ++idx) {
+    const evm_reg_op_t *op = &code->ops[idx];
+
+    if(op->op == ROP_JMP || op->op == ROP_BRANCH || op->op == ROP_CALL) {
+      if(evmregFindBlock(code, op->target) == EVM_REG_NONE && !evmregAddBlock(code, op->target)) {
+        return -1;
+      }
+
+      if(op->op == ROP_BRANCH && evmregFindBlock(code, op->next) == EVM_REG_NONE &&
+         !evmregAddBlock(code, op->next)) {
+        return -1;
+      }
+    }
+  }
+
+  for(idx = 0; idx < code->opCount; ++idx) {
+    evm_reg_op_t *op = &code->ops[idx];
+
+    if(op->op == ROP_JMP || op->op == ROP_BRANCH || op->op == ROP_CALL) {
+      op->target = evmregFindBlock(code, op->target);
+      if(op->op == ROP_BRANCH) {
+        op->next = evmregFindBlock(code, op->next);
+      }
+    }
+  }
+
+  return 0;
+}
+
+
+#define EVM_REG_COMPARE(VM, LHS, RHS) \
+  do { \
+    (VM)->flags &= ~(EVM_LESS | EVM_EQUAL | EVM_GREATER); \
+    if((LHS) < (RHS)) {       (VM)->flags |= EVM_LESS;    } \
+    else if((LHS) == (RHS)) { (VM)->flags |= EVM_EQUAL;   } \
+    else {                    (VM)->flags |= EVM_GREATER; } \
+  } while(0)
+
+
+#define EVM_REG_BINARY_I(NAME, OP) \
+  case NAME:      R[op->dst] = R[op->a] OP R[op->b];  break; \
+  case NAME##_RK: R[op->dst] = R[op->a] OP op->imm.i; break; \
+  case NAME##_KR: R[op->dst] = op->imm.i OP R[op->b]; break
+
+
+#define EVM_REG_BINARY_F(NAME, OP) \
+  case NAME:      EVM_REG_F(op->dst) = EVM_REG_F(op->a) OP EVM_REG_F(op->b); break; \
+  case NAME##_RK: EVM_REG_F(op->dst) = EVM_REG_F(op->a) OP op->imm.f;        break; \
+  case NAME##_KR: EVM_REG_F(op->dst) = op->imm.f OP EVM_REG_F(op->b);        break
+
+
+// run a block through to its exit, returns the block to continue with or EVM_REG_NONE when
+// there isn't one
+static uint32_t evmregExecute(evm_t *vm, const evm_reg_code_t *code, const evm_reg_block_t *block) {
+  int32_t *R = &vm->stack[vm->sp];
+  const evm_reg_op_t *op;
+  uint32_t next;
+
+  for(op = &code->ops[block->ops];; ++op) {
+    switch((evm_reg_opcode_t) op->op) {
+      case ROP_MOV:     R[op->dst] = R[op->a];                              break;
+      case ROP_LOADK:   R[op->dst] = op->imm.i;                             break;
+      case ROP_INC_I:   R[op->dst] = R[op->a] + 1;                          break;
+      case ROP_DEC_I:   R[op->dst] = R[op->a] - 1;                          break;
+      case ROP_ABS_I:   R[op->dst] = abs(R[op->a]);                         break;
+      case ROP_NEG_I:   R[op->dst] = -R[op->a];                             break;
+      case ROP_INV:     R[op->dst] = ~R[op->a];                             break;
+      case ROP_BOOL:    R[op->dst] = !!R[op->a];                            break;
+      case ROP_NOT:     R[op->dst] = !R[op->a];                             break;
+      case ROP_TRUNC:   R[op->dst] = R[op->a] & op->imm.i;                  break;
+      case ROP_SIGNEXT: R[op->dst] = (R[op->a] << op->imm.i) >> op->imm.i;  break;
+#if EVM_FLOAT_SUPPORT == 1
+      case ROP_INC_F:   EVM_REG_F(op->dst) = EVM_REG_F(op->a) + 1.0f;       break;
+      case ROP_DEC_F:   EVM_REG_F(op->dst) = EVM_REG_F(op->a) - 1.0f;       break;
+      case ROP_ABS_F:   EVM_REG_F(op->dst) = fabs(EVM_REG_F(op->a));        break;
+      case ROP_NEG_F:   EVM_REG_F(op->dst) = -EVM_REG_F(op->a);             break;
+      case ROP_CONV_FI: R[op->dst] = (int32_t) EVM_REG_F(op->a);            break;
+      case ROP_CONV_IF: EVM_REG_F(op->dst) = (float) R[op->a];              break;
+#endif
+
+      EVM_REG_BINARY_I(ROP_ADD_I, +);
+      EVM_REG_BINARY_I(ROP_SUB_I, -);
+      EVM_REG_BINARY_I(ROP_MUL_I, *);
+      EVM_REG_BINARY_I(ROP_DIV_I, /);
+      EVM_REG_BINARY_I(ROP_LSH, <<);
+      EVM_REG_BINARY_I(ROP_RSH, >>);
+      EVM_REG_BINARY_I(ROP_AND, &);
+      EVM_REG_BINARY_I(ROP_OR, |);
+      EVM_REG_BINARY_I(ROP_XOR, ^);
+
+      case ROP_CMP_I:    EVM_REG_COMPARE(vm, R[op->a], R[op->b]);  break;
+      case ROP_CMP_I_RK: EVM_REG_COMPARE(vm, R[op->a], op->imm.i); break;
+      case ROP_CMP_I_KR: EVM_REG_COMPARE(vm, op->imm.i, R[op->b]); break;
+
+#if EVM_FLOAT_SUPPORT == 1
+      EVM_REG_BINARY_F(ROP_ADD_F, +);
+      EVM_REG_BINARY_F(ROP_SUB_F, -);
+      EVM_REG_BINARY_F(ROP_MUL_F, *);
+      EVM_REG_BINARY_F(ROP_DIV_F, /);
+
+      case ROP_CMP_F:    EVM_REG_COMPARE(vm, EVM_REG_F(op->a), EVM_REG_F(op->b)); break;
+      case ROP_CMP_F_RK: EVM_REG_COMPARE(vm, EVM_REG_F(op->a), op->imm.f);        break;
+      case ROP_CMP_F_KR: EVM_REG_COMPARE(vm, op->imm.f, EVM_REG_F(op->b));        break;
+#endif
+
+      case ROP_JMP:
+        vm->sp = (uint16_t) (vm->sp + op->b);
+        vm->ip = code->blocks[op->target].start;
+        return op->target;
+
+      case ROP_BRANCH:
+        next = (vm->flags & (uint32_t) op->imm.i) ? op->target : op->next;
+        vm->sp = (uint16_t) (vm->sp + op->b);
+        vm->ip = code->blocks[next].start;
+        return next;
+
+      case ROP_CALL:
+        R[op->dst] = op->imm.i; // push the return instruction pointer
+        vm->sp = (uint16_t) (vm->sp + op->b);
+        vm->ip = code->blocks[op->target].start;
+        return op->target;
+
+      case ROP_RET:
+        vm->ip = (uint32_t) R[op->a];
+        vm->sp = (uint16_t) (vm->sp + op->b);
+        return evmregFindBlock(code, vm->ip);
+
+      case ROP_RET_MOVE:
+        vm->ip = (uint32_t) R[op->a];
+        R[op->dst] = R[op->imm.i];
+        vm->sp = (uint16_t) (vm->sp + op->b);
+        return evmregFindBlock(code, vm->ip);
+
+      case ROP_HALT:
+        vm->sp = (uint16_t) (vm->sp + op->b);
+        vm->ip = (uint32_t) op->imm.i;
+        vm->flags |= EVM_HALTED;
+        EVM_INFOF("HALTING @ %08X", vm->ip);
+        return EVM_REG_NONE;
+    }
+  }
+}
+
+
+#if EVM_FLOAT_SUPPORT == 1
+static int32_t evmregFloatBits(float value) {
+  union {
+    float   f;
+    int32_t i;
+  } bits;
+
+  bits.f = value;
+  return bits.i;
+}
+#endif
+
+#endif
@@ -0,0 +1,704 @@
+#define EVM_IMPL
+
+#include "evm.h"
+#include "evm/decode.h"
+#include "evm/opcodes.h"
+#include "evm/trace.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#if EVM_TRACE_SUPPORT == 1
+
+#define EVM_TRACE_HOT      64  // backward branches taken to a loop before a pass is recorded
+#define EVM_TRACE_LENGTH   256 // instructions in a trace
+#define EVM_TRACE_ATTEMPTS 4   // recordings abandoned before a loop is left to the interpreter
+#define EVM_TRACE_BITS     6
+#define EVM_TRACE_HEADERS  (1U << EVM_TRACE_BITS) // loops counted at once
+
+#if EVM_STATIC_PROGRAM == 1
+#  define EVM_TRACE_PROGRAM(VM) ((VM)->maxProgram)
+#else
+#  define EVM_TRACE_PROGRAM(VM) ((VM)->maxProgram + 1U) // with the halt terminating it
+#endif
+
+#define EVM_TRACE_SF(IDX) (*(float *) &S[IDX])
+
+
+typedef enum evm_trace_opcode_e {
+  TOP_PUSH = 0, // push imm
+  TOP_POP,      // remove imm values
+  TOP_REMOVE,   // remove b values from below the top a
+  TOP_DUP,      // push the value imm down
+  TOP_SWAP,
+  TOP_INC_I,    // replace the top, or the value a down, with a function of it
+  TOP_DEC_I,
+  TOP_ABS_I,
+  TOP_NEG_I,
+  TOP_INV,
+  TOP_BOOL,
+  TOP_NOT,
+  TOP_TRUNC,    // with the mask in imm
+  TOP_SIGNEXT,  // with the shift in imm
+  TOP_ADD_IK,   // with imm as the other operand
+  TOP_MUL_IK,
+  TOP_AND_IK,
+  TOP_LSH_IK,
+  TOP_POPCNT,
+  TOP_CLZ,
+  TOP_CTZ,
+#if EVM_FLOAT_SUPPORT == 1
+  TOP_INC_F,
+  TOP_DEC_F,
+  TOP_ABS_F,
+  TOP_NEG_F,
+  TOP_CONV_FI,
+  TOP_CONV_IF,
+  TOP_SQRT_F,
+#endif
+  TOP_ADD_I,    // replace the top two values with the top combined with the second
+  TOP_SUB_I,
+  TOP_MUL_I,
+  TOP_DIV_I,
+  TOP_LSH,
+  TOP_RSH,
+  TOP_AND,
+  TOP_OR,
+  TOP_XOR,
+  TOP_ROL,
+  TOP_ROR,
+  TOP_MOD_I,
+  TOP_MIN_I,
+  TOP_MAX_I,
+  TOP_CMP_I,    // flags = the top compared to the second
+  TOP_CMP_IK,   // flags = the top compared to imm
+#if EVM_FLOAT_SUPPORT == 1
+  TOP_ADD_F,
+  TOP_SUB_F,
+  TOP_MUL_F,
+  TOP_DIV_F,
+  TOP_MIN_F,
+  TOP_MAX_F,
+  TOP_FMA_F,    // replace the top three values with the top two multiplied and the third added
+  TOP_CMP_F,
+  TOP_CMP_FK,
+#endif
+  TOP_GUARD,    // leave for exit unless any of the flags in imm is set exactly when a is
+  TOP_GUARD_K,  // flags = the top compared to imm, then guard on the flags in b
+  TOP_GUARD_DEC, // decrement the top, then guard as TOP_GUARD_K
+  TOP_RET,      // remove the address imm down, leave for it unless it is exit
+  TOP_STEP,     // interpret the instruction at exit, leave unless it continues at imm at height
+} evm_trace_opcode_t;
+
+
+typedef struct evm_trace_op_s {
+  union {
+    int32_t i;
+#if EVM_FLOAT_SUPPORT == 1
+    float   f;
+#endif
+  }        imm;
+  uint32_t exit;   // offset the bytecode continues at when the trace is left here
+  uint16_t count;  // instructions a pass has run once it is through this op
+  int16_t  height; // of the stack after the op, relative to where the pass started
+  uint8_t  op;     // evm_trace_opcode_t
+  uint8_t  a;
+  uint8_t  b;
+} evm_trace_op_t;
+
+
+typedef struct evm_trace_s {
+  uint16_t       length; // ops
+  uint16_t       count;  // instructions a whole pass runs
+  uint16_t       below;  // values it reads from the stack it is entered with
+  uint16_t       above;  // room it needs above the stack pointer it is entered at
+  evm_trace_op_t ops[];
+} evm_trace_t;
+
+
+typedef struct evm_trace_header_s {
+  evm_trace_t *trace;  // NULL until a pass was recorded
+  uint32_t     offset; // the loop starts at
+  uint16_t     count;  // backward branches taken to it, or passes entered once it is traced
+  uint8_t      failed; // recordings abandoned
+} evm_trace_header_t;
+
+
+struct evm_trace_cache_s {
+  evm_trace_header_t headers[EVM_TRACE_HEADERS];
+};
+
+
+static int                   evmtraceDecode(const evm_decoded_t *, const evm_t *,
+                                            evm_trace_op_t *);
+static uint32_t              evmtraceRecord(evm_t *, evm_trace_header_t *, uint32_t);
+static const evm_trace_op_t *evmtracePass(evm_t *, const evm_trace_t *);
+static uint32_t              evmtraceReplay(evm_t *, const evm_trace_t *, uint32_t);
+#if EVM_FLOAT_SUPPORT == 1
+static int32_t               evmtraceFloatBits(float);
+#endif
+
+
+evm_trace_cache_t *evmtraceAllocate() {
+  return (evm_trace_cache_t *) calloc(1, sizeof(evm_trace_cache_t));
+}
+
+
+void evmtraceFree(evm_trace_cache_t *cache) {
+  uint32_t idx;
+
+  if(cache) {
+    for(idx = 0; idx < EVM_TRACE_HEADERS; ++idx) {
+      free(cache->headers[idx].trace);
+    }
+    free(cache);
+  }
+}
+
+
+uint32_t evmtraceLoop(evm_t *vm, uint32_t maxOps) {
+  evm_trace_header_t *header;
+
+  if(!vm || !vm->traces || !maxOps) {
+    return 0;
+  }
+
+  header = &vm->traces->headers[(vm->ip * 2654435761U) >> (32 - EVM_TRACE_BITS)];
+  if(header->offset != vm->ip) {
+    // another loop holds the slot, this one takes it over once it has been taken more often
+    if(header->count) {
+      --header->count;
+      return 0;
+    }
+
+    free(header->trace);
+    memset(header, 0, sizeof(evm_trace_header_t));
+    header->offset = vm->ip;
+  }
+
+  if(header->trace) {
+    header->count += header->count < UINT16_MAX;
+    return evmtraceReplay(vm, header->trace, maxOps);
+  }
+
+  if(header->failed >= EVM_TRACE_ATTEMPTS || ++header->count < EVM_TRACE_HOT) {
+    return 0;
+  }
+
+  header->count = 0;
+  return evmtraceRecord(vm, header, maxOps);
+}
+
+
+uint32_t evmtraceCount(const evm_trace_cache_t *cache) {
+  uint32_t idx, count = 0;
+
+  for(idx = 0; cache && idx < EVM_TRACE_HEADERS; ++idx) {
+    count += cache->headers[idx].trace != NULL;
+  }
+
+  return count;
+}
+
+
+// the op standing for an instruction the interpreter has just run, returns 1 when there is one,
+// 0 when the instruction needs none and -1 when the interpreter has to step it
+static int evmtraceDecode(const evm_decoded_t *ins, const evm_t *vm, evm_trace_op_t *op) {
+  uint32_t flags = 0;
+
+  switch(ins->opcode) {
+    case OP_NOP:
+    case OP_JMP:
+    case OP_LJMP:
+      return 0;
+
+    case OP_CALL:
+    case OP_LCALL:
+      op->op = TOP_PUSH;
+      op->imm.i = (int32_t) ins->next; // the return instruction pointer
+    return 1;
+
+    case OP_PUSH_I0:  op->op = TOP_PUSH; op->imm.i = 0;  return 1;
+    case OP_PUSH_I1:  op->op = TOP_PUSH; op->imm.i = 1;  return 1;
+    case OP_PUSH_IN1: op->op = TOP_PUSH; op->imm.i = -1; return 1;
+    case OP_PUSH_8I:
+    case OP_PUSH_16I:
+    case OP_PUSH_24I:
+    case OP_PUSH_32I:
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_PUSH_F:
+#endif
+      op->op = TOP_PUSH;
+      op->imm.i = ins->operand.i32;
+    return 1;
+
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_PUSH_F0:  op->op = TOP_PUSH; op->imm.i = evmtraceFloatBits(0.0f);  return 1;
+    case OP_PUSH_F1:  op->op = TOP_PUSH; op->imm.i = evmtraceFloatBits(1.0f);  return 1;
+    case OP_PUSH_FN1: op->op = TOP_PUSH; op->imm.i = evmtraceFloatBits(-1.0f); return 1;
+#endif
+
+    case OP_SWAP:    op->op = TOP_SWAP;  return 1;
+    case OP_INC_I:   op->op = TOP_INC_I; return 1;
+    case OP_DEC_I:   op->op = TOP_DEC_I; return 1;
+    case OP_ABS_I:   op->op = TOP_ABS_I; return 1;
+    case OP_NEG_I:   op->op = TOP_NEG_I; return 1;
+    case OP_INV:     op->op = TOP_INV;   return 1;
+    case OP_BOOL:    op->op = TOP_BOOL;  return 1;
+    case OP_NOT:     op->op = TOP_NOT;   return 1;
+    case OP_TRUNC:
+      op->op = TOP_TRUNC;
+      op->imm.i = (int32_t) (0xFFFFFFFFU >> (32 - (ins->operand.u32 & 0x1F)));
+    return 1;
+    case OP_SIGNEXT:
+      op->op = TOP_SIGNEXT;
+      op->imm.i = (int32_t) (ins->operand.u32 & 0x1F);
+    return 1;
+
+    case OP_ADD_I:   op->op = TOP_ADD_I; return 1;
+    case OP_SUB_I:   op->op = TOP_SUB_I; return 1;
+    case OP_MUL_I:   op->op = TOP_MUL_I; return 1;
+    case OP_DIV_I:   op->op = TOP_DIV_I; return 1;
+    case OP_LSH:     op->op = TOP_LSH;   return 1;
+    case OP_RSH:     op->op = TOP_RSH;   return 1;
+    case OP_AND:     op->op = TOP_AND;   return 1;
+    case OP_OR:      op->op = TOP_OR;    return 1;
+    case OP_XOR:     op->op = TOP_XOR;   return 1;
+    case OP_POPCNT:  op->op = TOP_POPCNT; return 1;
+    case OP_CLZ:     op->op = TOP_CLZ;   return 1;
+    case OP_CTZ:     op->op = TOP_CTZ;   return 1;
+    case OP_ROL:     op->op = TOP_ROL;   return 1;
+    case OP_ROR:     op->op = TOP_ROR;   return 1;
+    case OP_MOD_I:   op->op = TOP_MOD_I; op->exit = ins->offset; return 1;
+    case OP_MIN_I:   op->op = TOP_MIN_I; return 1;
+    case OP_MAX_I:   op->op = TOP_MAX_I; return 1;
+
+    case OP_CMP_I0:  op->op = TOP_CMP_IK; op->imm.i = 0;  return 1;
+    case OP_CMP_I1:  op->op = TOP_CMP_IK; op->imm.i = 1;  return 1;
+    case OP_CMP_IN1: op->op = TOP_CMP_IK; op->imm.i = -1; return 1;
+    case OP_CMP_I:   op->op = TOP_CMP_I;                  return 1;
+
+#if EVM_FLOAT_SUPPORT == 1
+    case OP_INC_F:     op->op = TOP_INC_F;               return 1;
+    case OP_DEC_F:     op->op = TOP_DEC_F;               return 1;
+    case OP_ABS_F:     op->op = TOP_ABS_F;               return 1;
+    case OP_NEG_F:     op->op = TOP_NEG_F;               return 1;
+    case OP_CONV_FI:   op->op = TOP_CONV_FI;             return 1;
+    case OP_CONV_FI_1: op->op = TOP_CONV_FI; op->a = 1U; return 1;
+    case OP_CONV_IF:   op->op = TOP_CONV_IF;             return 1;
+    case OP_CONV_IF_1: op->op = TOP_CONV_IF; op->a = 1U; return 1;
+
+    case OP_ADD_F:   op->op = TOP_ADD_F; return 1;
+    case OP_SUB_F:   op->op = TOP_SUB_F; return 1;
+    case OP_MUL_F:   op->op = TOP_MUL_F; return 1;
+    case OP_DIV_F:   op->op = TOP_DIV_F; return 1;
+    case OP_MIN_F:   op->op = TOP_MIN_F; return 1;
+    case OP_MAX_F:   op->op = TOP_MAX_F; return 1;
+    case OP_SQRT_F:  op->op = TOP_SQRT_F; return 1;
+    case OP_FMA_F:   op->op = TOP_FMA_F; return 1;
+
+    case OP_CMP_F0:  op->op = TOP_CMP_FK; op->imm.f = 0.0f;  return 1;
+    case OP_CMP_F1:  op->op = TOP_CMP_FK; op->imm.f = 1.0f;  return 1;
+    case OP_CMP_FN1: op->op = TOP_CMP_FK; op->imm.f = -1.0f; return 1;
+    case OP_CMP_F:   op->op = TOP_CMP_F;                     return 1;
+#endif
+
+    case OP_ADD_8I: case OP_ADD_16I: op->op = TOP_ADD_IK; op->imm.i = ins->operand.i32;  return 1;
+    case OP_SUB_8I: case OP_SUB_16I: op->op = TOP_ADD_IK; op->imm.i = -ins->operand.i32; return 1;
+    case OP_MUL_8I: case OP_MUL_16I: op->op = TOP_MUL_IK; op->imm.i = ins->operand.i32;  return 1;
+    case OP_AND_8I: case OP_AND_16I: op->op = TOP_AND_IK; op->imm.i = ins->operand.i32;  return 1;
+    case OP_LSH_8I:
+      op->op = TOP_LSH_IK;
+      op->imm.i = (int32_t) (ins->operand.u32 & 0x1FU);
+    return 1;
+
+    // the fused branches set the flags or the count even when they continue either way
+    case OP_JCMP_8I:
+    case OP_LJCMP_8I:
+      op->op = TOP_GUARD_K;
+      op->imm.i = ins->operand.i32;
+      op->b = vm->program[ins->offset + 1U];
+      op->a = vm->ip == ins->target;
+      op->exit = op->a ? ins->next : ins->target;
+    return 1;
+
+    case OP_DJNZ:
+    case OP_LDJNZ:
+      op->op = TOP_GUARD_DEC;
+      op->imm.i = 0;
+      op->b = EVM_LESS | EVM_GREATER;
+      op->a = vm->ip == ins->target;
+      op->exit = op->a ? ins->next : ins->target;
+    return 1;
+
+    case OP_REM_R:
+      op->op = TOP_REMOVE;
+      op->a = (uint8_t) ((ins->operand.u32 >> 4) + 1U);
+      op->b = (uint8_t) ((ins->operand.u32 & 0x0FU) + 1U);
+    return 1;
+
+    case OP_JLT: case OP_LJLT: flags = EVM_LESS;                break;
+    case OP_JLE: case OP_LJLE: flags = EVM_LESS | EVM_EQUAL;    break;
+    case OP_JNE: case OP_LJNE: flags = EVM_LESS | EVM_GREATER;  break;
+    case OP_JEQ: case OP_LJEQ: flags = EVM_EQUAL;               break;
+    case OP_JGE: case OP_LJGE: flags = EVM_GREATER | EVM_EQUAL; break;
+    case OP_JGT: case OP_LJGT: flags = EVM_GREATER;             break;
+
+    default:
+      // pops, removes, dups and returns come in runs of opcodes
+      if(ins->opcode >= OP_POP_1 && ins->opcode <= OP_POP_8) {
+        op->op = TOP_POP;
+        op->imm.i = ins->opcode - OP_POP_1 + 1;
+        return 1;
+      }
+
+      if(ins->opcode >= OP_REM_1 && ins->opcode <= OP_REM_7) {
+        op->op = TOP_REMOVE;
+        op->a = (uint8_t) (ins->opcode - OP_REM_1 + 1);
+        op->b = 1U;
+        return 1;
+      }
+
+      if(ins->opcode >= OP_DUP_0 && ins->opcode <= OP_DUP_15) {
+        op->op = TOP_DUP;
+        op->imm.i = ins->opcode - OP_DUP_0 + 1;
+        return 1;
+      }
+
+      if(ins->branch == EVM_BRANCH_RETURN) {
+        op->op = TOP_RET;
+        op->imm.i = ins->pops - 1;
+        op->exit = vm->ip; // where it returned to while recording
+        return 1;
+      }
+
+      // the memory instructions, builtins, yields and jump tables
+      op->op = TOP_STEP;
+      op->imm.i = (int32_t) vm->ip;
+      op->exit = ins->offset;
+    return -1;
+  }
+
+  if(ins->target == ins->next) {
+    return 0; // continues at the same place either way
+  }
+
+  op->op = TOP_GUARD;
+  op->imm.i = (int32_t) flags;
+  op->a = vm->ip == ins->target;
+  op->exit = op->a ? ins->next : ins->target;
+  return 1;
+}
+
+
+// run and record the next pass through the loop at vm->ip, returns the instructions it ran
+static uint32_t evmtraceRecord(evm_t *vm, evm_trace_header_t *header, uint32_t maxOps) {
+  evm_trace_op_t ops[EVM_TRACE_LENGTH];
+  evm_decoded_t decoded;
+  evm_trace_t *trace;
+  const int32_t entry = vm->sp;
+  int32_t low = 0, high = 0, before;
+  uint32_t count = 0, length = 0;
+  int result;
+
+  memset(&decoded, 0, sizeof(decoded));
+  while(count < maxOps) {
+    evm_trace_op_t *op = &ops[length];
+
+    decoded.next = vm->ip;
+    if(count == EVM_TRACE_LENGTH ||
+       evmDecodeNext(vm->program, EVM_TRACE_PROGRAM(vm), &decoded) != 1) {
+      ++header->failed;
+      return count;
+    }
+
+    before = (int32_t) vm->sp - entry;
+    (void) evmRunStack(vm, 1U);
+    ++count;
+
+    if(vm->flags & EVM_HALTED) {
+      return count;
+    }
+
+    memset(op, 0, sizeof(evm_trace_op_t));
+    if((result = evmtraceDecode(&decoded, vm, op)) > 0) {
+      // the ops that don't step the interpreter must neither underflow nor overflow
+      if(before - (int32_t) decoded.pops < low) {
+        low = before - (int32_t) decoded.pops;
+      }
+
+      if((int32_t) vm->sp - entry > high) {
+        high = (int32_t) vm->sp - entry;
+      }
+    }
+
+    if(result) {
+      op->count = (uint16_t) count;
+      op->height = (int16_t) ((int32_t) vm->sp - entry);
+      ++length;
+    }
+
+    // a pass that yields is traced up to the yield and leaves the trace there
+    if(vm->ip == header->offset || (vm->flags & EVM_YIELD)) {
+      if(!(trace = (evm_trace_t *) malloc(sizeof(evm_trace_t) + length * sizeof(evm_trace_op_t)))) {
+        return count;
+      }
+
+      trace->length = (uint16_t) length;
+      trace->count = (uint16_t) count;
+      trace->below = (uint16_t) -low;
+      trace->above = (uint16_t) high;
+      memcpy(trace->ops, ops, length * sizeof(evm_trace_op_t));
+      header->trace = trace;
+      header->count = 1U;
+      EVM_DEBUGF("Traced the loop at %08X in %u ops for %u instructions",
+                 header->offset, length, count);
+      return count;
+    }
+  }
+
+  return count; // out of operations, try again with the next pass
+}
+
+
+#define EVM_TRACE_COMPARE(FLAGS, LHS, RHS) \
+  do { \
+    (FLAGS) &= ~(EVM_LESS | EVM_EQUAL | EVM_GREATER); \
+    if((LHS) < (RHS)) {       (FLAGS) |= EVM_LESS;    } \
+    else if((LHS) == (RHS)) { (FLAGS) |= EVM_EQUAL;   } \
+    else {                    (FLAGS) |= EVM_GREATER; } \
+  } while(0)
+
+
+#define EVM_TRACE_BINARY_I(NAME, OP) \
+  case NAME: S[sp - 2U] = S[sp - 1U] OP S[sp - 2U]; --sp; break
+
+
+#define EVM_TRACE_BINARY_F(NAME, OP) \
+  case NAME: EVM_TRACE_SF(sp - 2U) = EVM_TRACE_SF(sp - 1U) OP EVM_TRACE_SF(sp - 2U); --sp; break
+
+
+// the top rotated left by the low five bits of the count, as the interpreter does
+static int32_t evmtraceRotate(int32_t value, uint32_t count) {
+  count &= 0x1FU;
+  return (int32_t) (((uint32_t) value << count) | ((uint32_t) value >> ((32U - count) & 0x1FU)));
+}
+
+
+// run one pass, returns NULL when it went all the way through and the op it left at otherwise
+static const evm_trace_op_t *evmtracePass(evm_t *vm, const evm_trace_t *trace) {
+  const evm_trace_op_t *op, *end = &trace->ops[trace->length];
+  int32_t *S = vm->stack;
+  uint32_t sp = vm->sp, entry = vm->sp, flags = vm->flags, value;
+
+  for(op = trace->ops; op != end; ++op) {
+    switch((evm_trace_opcode_t) op->op) {
+      case TOP_PUSH:    S[sp++] = op->imm.i;                                             break;
+      case TOP_POP:     sp -= (uint32_t) op->imm.i;                                      break;
+      case TOP_DUP:     S[sp] = S[sp - (uint32_t) op->imm.i]; ++sp;                      break;
+      case TOP_SWAP:    value = S[sp - 1U]; S[sp - 1U] = S[sp - 2U]; S[sp - 2U] = value; break;
+      case TOP_REMOVE:
+        memmove(&S[sp - (op->a + op->b)], &S[sp - op->a], op->a * sizeof(*S));
+        sp -= op->b;
+      break;
+
+      case TOP_INC_I:   ++S[sp - 1U];                                                    break;
+      case TOP_DEC_I:   --S[sp - 1U];                                                    break;
+      case TOP_ABS_I:   S[sp - 1U] = abs(S[sp - 1U]);                                    break;
+      case TOP_NEG_I:   S[sp - 1U] = -S[sp - 1U];                                        break;
+      case TOP_INV:     S[sp - 1U] = ~S[sp - 1U];                                        break;
+      case TOP_BOOL:    S[sp - 1U] = !!S[sp - 1U];                                       break;
+      case TOP_NOT:     S[sp - 1U] = !S[sp - 1U];                                        break;
+      case TOP_TRUNC:   S[sp - 1U] &= op->imm.i;                                         break;
+      case TOP_SIGNEXT: S[sp - 1U] = (S[sp - 1U] << op->imm.i) >> op->imm.i;             break;
+      case TOP_ADD_IK:  S[sp - 1U] += op->imm.i;                                         break;
+      case TOP_MUL_IK:  S[sp - 1U] *= op->imm.i;                                         break;
+      case TOP_AND_IK:  S[sp - 1U] &= op->imm.i;                                         break;
+      case TOP_LSH_IK:  S[sp - 1U] <<= op->imm.i;                                        break;
+      case TOP_POPCNT:  S[sp - 1U] = __builtin_popcount((uint32_t) S[sp - 1U]);          break;
+      case TOP_CLZ:     S[sp - 1U] = S[sp - 1U] ? __builtin_clz((uint32_t) S[sp - 1U]) : 32; break;
+      case TOP_CTZ:     S[sp - 1U] = S[sp - 1U] ? __builtin_ctz((uint32_t) S[sp - 1U]) : 32; break;
+#if EVM_FLOAT_SUPPORT == 1
+      case TOP_INC_F:   EVM_TRACE_SF(sp - 1U) += 1.0f;                                   break;
+      case TOP_DEC_F:   EVM_TRACE_SF(sp - 1U) -= 1.0f;                                   break;
+      case TOP_ABS_F:   EVM_TRACE_SF(sp - 1U) = fabs(EVM_TRACE_SF(sp - 1U));             break;
+      case TOP_NEG_F:   EVM_TRACE_SF(sp - 1U) = -EVM_TRACE_SF(sp - 1U);                  break;
+      case TOP_CONV_FI: S[sp - 1U - op->a] = (int32_t) EVM_TRACE_SF(sp - 1U - op->a);    break;
+      case TOP_CONV_IF: EVM_TRACE_SF(sp - 1U - op->a) = (float) S[sp - 1U - op->a];      break;
+      case TOP_SQRT_F:  EVM_TRACE_SF(sp - 1U) = sqrtf(EVM_TRACE_SF(sp - 1U));            break;
+#endif
+
+      EVM_TRACE_BINARY_I(TOP_ADD_I, +);
+      EVM_TRACE_BINARY_I(TOP_SUB_I, -);
+      EVM_TRACE_BINARY_I(TOP_MUL_I, *);
+      EVM_TRACE_BINARY_I(TOP_DIV_I, /);
+      EVM_TRACE_BINARY_I(TOP_LSH, <<);
+      EVM_TRACE_BINARY_I(TOP_RSH, >>);
+      EVM_TRACE_BINARY_I(TOP_AND, &);
+      EVM_TRACE_BINARY_I(TOP_OR, |);
+      EVM_TRACE_BINARY_I(TOP_XOR, ^);
+
+      case TOP_MOD_I: // the stack interpreter halts on the remainders that would trap
+        if(!S[sp - 2U] || (S[sp - 2U] == -1 && S[sp - 1U] == INT32_MIN)) {
+          vm->ip = op->exit;
+          vm->sp = (uint16_t) sp;
+          vm->flags = flags;
+          (void) evmRunStack(vm, 1U);
+          return op;
+        }
+
+        S[sp - 2U] = S[sp - 1U] % S[sp - 2U];
+        --sp;
+      break;
+
+      case TOP_ROL:
+      case TOP_ROR:
+        value = (uint32_t) S[sp - 2U];
+        S[sp - 2U] = evmtraceRotate(S[sp - 1U], op->op == TOP_ROL ? value : 0U - value);
+        --sp;
+      break;
+
+      case TOP_MIN_I:
+        if(S[sp - 1U] < S[sp - 2U]) { S[sp - 2U] = S[sp - 1U]; }
+        --sp;
+      break;
+
+      case TOP_MAX_I:
+        if(S[sp - 1U] > S[sp - 2U]) { S[sp - 2U] = S[sp - 1U]; }
+        --sp;
+      break;
+
+      case TOP_CMP_I:  EVM_TRACE_COMPARE(flags, S[sp - 1U], S[sp - 2U]); break;
+      case TOP_CMP_IK: EVM_TRACE_COMPARE(flags, S[sp - 1U], op->imm.i);  break;
+
+#if EVM_FLOAT_SUPPORT == 1
+      EVM_TRACE_BINARY_F(TOP_ADD_F, +);
+      EVM_TRACE_BINARY_F(TOP_SUB_F, -);
+      EVM_TRACE_BINARY_F(TOP_MUL_F, *);
+      EVM_TRACE_BINARY_F(TOP_DIV_F, /);
+
+      case TOP_MIN_F:
+        if(EVM_TRACE_SF(sp - 1U) < EVM_TRACE_SF(sp - 2U)) { S[sp - 2U] = S[sp - 1U]; }
+        --sp;
+      break;
+
+      case TOP_MAX_F:
+        if(EVM_TRACE_SF(sp - 1U) > EVM_TRACE_SF(sp - 2U)) { S[sp - 2U] = S[sp - 1U]; }
+        --sp;
+      break;
+
+      case TOP_FMA_F:
+        EVM_TRACE_SF(sp - 3U) = fmaf(EVM_TRACE_SF(sp - 1U), EVM_TRACE_SF(sp - 2U),
+                                     EVM_TRACE_SF(sp - 3U));
+        sp -= 2U;
+      break;
+
+      case TOP_CMP_F:
+        EVM_TRACE_COMPARE(flags, EVM_TRACE_SF(sp - 1U), EVM_TRACE_SF(sp - 2U));
+      break;
+
+      case TOP_CMP_FK:
+        EVM_TRACE_COMPARE(flags, EVM_TRACE_SF(sp - 1U), op->imm.f);
+      break;
+#endif
+
+      case TOP_GUARD:
+        if(!(flags & (uint32_t) op->imm.i) == !op->a) {
+          break;
+        }
+
+        vm->ip = op->exit;
+        vm->sp = (uint16_t) sp;
+        vm->flags = flags;
+      return op;
+
+      case TOP_GUARD_K:
+      case TOP_GUARD_DEC:
+        if(op->op == TOP_GUARD_DEC) {
+          --S[sp - 1U];
+        }
+
+        EVM_TRACE_COMPARE(flags, S[sp - 1U], op->imm.i);
+        if(!(flags & op->b) == !op->a) {
+          break;
+        }
+
+        vm->ip = op->exit;
+        vm->sp = (uint16_t) sp;
+        vm->flags = flags;
+      return op;
+
+      case TOP_RET:
+        value = (uint32_t) S[sp - 1U - (uint32_t) op->imm.i];
+        memmove(&S[sp - 1U - (uint32_t) op->imm.i], &S[sp - (uint32_t) op->imm.i],
+                (uint32_t) op->imm.i * sizeof(*S));
+        --sp;
+        if(value == op->exit) {
+          break;
+        }
+
+        vm->ip = value;
+        vm->sp = (uint16_t) sp;
+        vm->flags = flags;
+      return op;
+
+      case TOP_STEP:
+        vm->ip = op->exit;
+        vm->sp = (uint16_t) sp;
+        vm->flags = flags;
+        (void) evmRunStack(vm, 1U);
+        if((vm->flags & (EVM_HALTED | EVM_YIELD)) || vm->ip != (uint32_t) op->imm.i ||
+           (int32_t) vm->sp - (int32_t) entry != op->height) {
+          return op;
+        }
+
+        sp = vm->sp;
+        flags = vm->flags;
+      break;
+    }
+  }
+
+  vm->sp = (uint16_t) sp;
+  vm->flags = flags;
+  return NULL;
+}
+
+
+// replay whole passes while the stack interpreter wouldn't fault or stop part of the way through
+// one, returns the instructions they ran
+static uint32_t evmtraceReplay(evm_t *vm, const evm_trace_t *trace, uint32_t maxOps) {
+  const uint32_t header = vm->ip;
+  const evm_trace_op_t *left;
+  uint32_t ops = 0;
+
+  while(trace->count <= maxOps - ops && vm->sp >= trace->below &&
+        (uint32_t) vm->sp + trace->above < vm->maxStack) {
+    if((left = evmtracePass(vm, trace))) {
+      EVM_TRACEF("%08X: LEFT THE TRACE AT %08X", vm->ip, header);
+      return ops + left->count;
+    }
+
+    ops += trace->count;
+  }
+
+  vm->ip = header;
+  return ops;
+}
+
+
+#if EVM_FLOAT_SUPPORT == 1
+static int32_t evmtraceFloatBits(float value) {
+  union {
+    float   f;
+    int32_t i;
+  } bits;
+
+  bits.f = value;
+  return bits.i;
+}
+#endif
+
+#endif
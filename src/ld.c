@@ -0,0 +1,50 @@
+#include "evm/ld.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char **argv) {
+  evm_linker_t *linker = evmldInitialize(evmldAllocate());
+  int result = EXIT_FAILURE;
+  int arg;
+
+  if(linker) {
+    if(argc > 1) {
+      for(result = EXIT_SUCCESS, arg = 1; arg < argc; ++arg) {
+        FILE *src = fopen(argv[arg], "rb");
+
+        if(src) {
+          if(evmldAddFile(linker, argv[arg], src)) {
+            fprintf(stderr, "%s: failed to load object %s\n", *argv, argv[arg]);
+            result = EXIT_FAILURE;
+          }
+
+          fclose(src);
+        }
+        else {
+          fprintf(stderr, "%s: Unable to open %s for reading\n", *argv, argv[arg]);
+          result = EXIT_FAILURE;
+        }
+      }
+
+      // sections are concatenated in command line order
+      if(result == EXIT_SUCCESS) {
+        if(evmldLink(linker)) {
+          fprintf(stderr, "%s: program failed to link\n", *argv);
+          result = EXIT_FAILURE;
+        }
+        else if(evmldProgramToFile(linker, stdout)) {
+          fprintf(stderr, "%s: program failed to output\n", *argv);
+          result = EXIT_FAILURE;
+        }
+      }
+    }
+    else {
+      fprintf(stderr, "Usage: %s OBJ...\n", *argv);
+    }
+  }
+
+  evmldFree(evmldFinalize(linker));
+
+  return result;
+}
@@ -11,10 +11,10 @@ extern "C" {
 
 static const char *MNEMONIC_STRINGS[256] = {
   // FAM_CALL
-  "NOP",  "CALL", "CALL", "BLTIN", INVAL, INVAL,  INVAL,   INVAL,
-   INVAL,  INVAL,  INVAL,  INVAL,  INVAL, INVAL, "YIELD", "HALT",
+  "NOP",   "CALL",  "CALL",  "BLTIN", INVAL,   INVAL,   INVAL,   INVAL,
+   INVAL,   INVAL,   INVAL,   INVAL,  INVAL,   INVAL,  "YIELD", "HALT",
   // FAM_PUSH
-  "PUSH",  "PUSH",  "PUSH",  "PUSH",  "PUSH", "PUSH", "PUSH",
+  "PUSH",  "PUSH",  "PUSH",  "PUSH",  "PUSH",  "PUSH",  "PUSH",
 #if EVM_FLOAT_SUPPORT == 1
   "PUSHF", "PUSHF", "PUSHF", "PUSHF",
 #else
@@ -22,61 +22,91 @@ static const char *MNEMONIC_STRINGS[256] = {
 #endif
    INVAL,   INVAL,   INVAL,   INVAL,  "SWAP",
   // FAM_POP
-  "POP",  "POP",  "POP",  "POP", "POP", "POP", "POP", "POP", 
-  "POP",  "POP",  "POP",  "POP", "POP", "POP", "POP", "POP", 
+  "POP",   "POP",   "POP",   "POP",   "POP",   "POP",   "POP",   "POP",
+  "REM",   "REM",   "REM",   "REM",   "REM",   "REM",   "REM",   "REM",
   // FAM_DUP
-  "DUP",  "DUP",  "DUP",  "DUP", "DUP", "DUP", "DUP", "DUP", 
-  "DUP",  "DUP",  "DUP",  "DUP", "DUP", "DUP", "DUP", "DUP", 
+  "DUP",   "DUP",   "DUP",   "DUP",   "DUP",   "DUP",   "DUP",   "DUP",
+  "DUP",   "DUP",   "DUP",   "DUP",   "DUP",   "DUP",   "DUP",   "DUP",
   // FAM_MATH
-  "INC",  "DEC",  "ABS",  "NEG",  "ADD",  "SUB",  "MUL",  "DIV",
+  "INC",   "DEC",   "ABS",   "NEG",   "ADD",   "SUB",   "MUL",   "DIV",
 #if EVM_FLOAT_SUPPORT == 1
-  "INCF", "DECF", "ABSF", "NEGF", "ADDF", "SUBF", "MULF", "DIVF",
+  "INCF",  "DECF",  "ABSF",  "NEGF",  "ADDF",  "SUBF",  "MULF",  "DIVF",
 #else
-   INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
+   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,
 #endif
-   // FAM_BITS
-   "LSH",   "RSH",   "AND",   "OR",    "XOR", "INV", "BOOL", "NOT"
+  // FAM_BITS
+  "LSH",   "RSH",   "AND",   "OR",    "XOR",   "INV",   "BOOL",  "NOT",
+  "TRUNC", "SIGNEXT",
 #if EVM_FLOAT_SUPPORT == 1
-   "CNVFI", "CNVFI", "CNVIF", "CNVIF",
+  "CNVFI", "CNVFI", "CNVIF", "CNVIF",
 #else
-    INVAL,   INVAL,   INVAL,   INVAL,
+   INVAL,   INVAL,   INVAL,   INVAL,
+#endif
+   INVAL,   INVAL,
+#if EVM_MEMORY_SUPPORT == 1
+  // FAM_BLOCK
+  "MEMCPY", "MEMMOVE", "MEMSET", "MEMCMP",  INVAL,   INVAL,   INVAL,   INVAL,
+#else
+   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,
+#endif
+   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,
+#if EVM_MEMORY_SUPPORT == 1
+  // FAM_VEC
+  "VADD",  "VSUB",  "VMUL",  "VDOT",  "VMIN",  "VMAX",   INVAL,   INVAL,
+#  if EVM_FLOAT_SUPPORT == 1
+  "VADDF", "VSUBF", "VMULF", "VDOTF", "VMINF", "VMAXF",  INVAL,   INVAL,
+#  else
+   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,
+#  endif
+#else
+   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,
+   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,
 #endif
-    INVAL,   INVAL,   INVAL,   INVAL,
-   // 0x60
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-   // 0x70
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-   // 0x80
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-   // 0x90
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-   // 0xA0
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-   // 0xB0
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-   // 0xC0
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-   // FAM_CMP
-   "CMP",  "CMP",  "CMP",  "CMP"
+  // FAM_FRAME
+  "ENTER", "LEAVE", "LDLOC", "STLOC", "LDARG",  INVAL,   INVAL,   INVAL,
+  "ENTER",  INVAL,  "LDLOC", "STLOC", "LDARG",  INVAL,   INVAL,   INVAL,
+  // FAM_IMM
+  "ADDI",  "SUBI",  "MULI",  "ANDI",  "SHLI",  "JCMPI", "DJNZ",   INVAL,
+  "ADDI",  "SUBI",  "MULI",  "ANDI",   INVAL,  "JCMPI", "DJNZ",   INVAL,
+  // FAM_XMATH
+  "POPCNT", "CLZ",  "CTZ",   "ROL",   "ROR",   "MOD",   "MIN",   "MAX",
 #if EVM_FLOAT_SUPPORT == 1
-   "CMPF", "CMPF", "CMPF", "CMPF", 
+  "MINF",  "MAXF",  "SQRTF", "FMAF",
 #else
-    INVAL,  INVAL,  INVAL,  INVAL,
+   INVAL,   INVAL,   INVAL,   INVAL,
+#endif
+   INVAL,   INVAL,   INVAL,   INVAL,
+#if EVM_MEMORY_SUPPORT == 1
+  // FAM_INDEX
+  "XREAD", "XREAD8", "XREAD8U", "XREAD16", "XREAD16U", "XWRITE8", "XWRITE16", "XWRITE32",
+  "XREAD", "XREAD8", "XREAD8U", "XREAD16", "XREAD16U", "XWRITE8", "XWRITE16", "XWRITE32",
+#else
+   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,
+   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,
+#endif
+#if EVM_MEMORY_SUPPORT == 1
+  // FAM_MEM
+  "SEG",   "READ",  "WRITE8", "WRITE16", "WRITE24", "WRITE32",
+  "LREAD", "LWRITE8", "LWRITE16", "LWRITE24", "LWRITE32",
+  "SREAD", "SWRITE8", "SWRITE16", "SWRITE24", "SWRITE32",
+#else
+   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,
+   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,
+#endif
+  // FAM_CMP
+  "CMP",   "CMP",   "CMP",   "CMP",
+#if EVM_FLOAT_SUPPORT == 1
+  "CMPF",  "CMPF",  "CMPF",  "CMPF",
+#else
+   INVAL,   INVAL,   INVAL,   INVAL,
 #endif
-    INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,  INVAL,
-   // FAM_JMP
-   "JMP", "JMP", "JMP", "JMP", "JMP", "JMP", "JMP", "JMP",
-   "JMP", "JMP", "JMP", "JMP", "JMP", "JMP", "JMP", "JMP",
-   // FAM_RET
-   "RET", "RET", "RET", "RET", "RET", "RET", "RET", "RET",
-   "RET", "RET", "RET", "RET", "RET", "RET", "RET", "RET"
+   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,   INVAL,
+  // FAM_JMP
+  "JMP",   "JLT",   "JLE",   "JNE",   "JEQ",   "JGE",   "JGT",   "JTBL",
+  "LJMP",  "LJLT",  "LJLE",  "LJNE",  "LJEQ",  "LJGE",  "LJGT",  "LJTBL",
+  // FAM_RET
+  "RET",   "RET",   "RET",   "RET",   "RET",   "RET",   "RET",   "RET",
+  "RET",   "RET",   "RET",   "RET",   "RET",   "RET",   "RET",   "RET",
 };
 
 